@@ -0,0 +1,161 @@
+/*
+ *  avr_b3_vl.cpp -- Verilator driver for avr_b3
+ *
+ *  Runs the Verilated avr_b3 for a number of board clocks with the flash image,
+ *  the switches, the buttons and a keypad key given on the command line.  The
+ *  UART is the console: characters sent on RsTx are decoded to stdout, and the
+ *  -i text is typed on RsRx.  The firmware sets UBRR0 = 54-1 on the 50MHz
+ *  system clock, 16 samples per bit, i.e. 1728 board clocks per bit.
+ */
+
+#include "Vavr_b3_vl.h"
+#include "harness.h"
+
+static unsigned bitClocks = 1728;
+static std::string input;
+static uint64_t inputCycle = 0;
+
+static bool ExtraOpt(int opt, const char *arg)
+{
+    switch (opt)
+    {
+        case 'u':
+            bitClocks = strtoul(arg, NULL, 0);
+            return bitClocks > 0;
+        case 'i':
+            // a "\n" in the text from the cmd line is a newline
+            for (const char *p = arg; *p; p++)
+            {
+                if (p[0] == '\\' && p[1] == 'n')
+                {
+                    input += '\n';
+                    p++;
+                }
+                else
+                    input += *p;
+            }
+            return true;
+        case 'I':
+            inputCycle = strtoull(arg, NULL, 0);
+            return true;
+    }
+    return false;
+}
+
+// 8N1 receiver on RsTx, sampled mid bit
+struct UartRx
+{
+    int bit = -1;           // -1 idle, 0 start bit, 1-8 data, 9 stop
+    uint64_t next = 0;
+    unsigned data = 0;
+
+    void Sample(uint64_t cycle, unsigned line)
+    {
+        if (bit < 0)
+        {
+            if (!line)
+            {
+                bit = 0;
+                next = cycle + bitClocks / 2;
+            }
+        }
+        else if (cycle >= next)
+        {
+            if (bit == 0 && line)
+            {
+                bit = -1;   // glitch, not a start bit
+                return;
+            }
+            if (bit >= 1 && bit <= 8)
+                data = (data >> 1) | (line ? 0x80 : 0);
+            else if (bit == 9)
+            {
+                putchar(data);
+                fflush(stdout);
+                bit = -1;
+                return;
+            }
+            bit++;
+            next += bitClocks;
+        }
+    }
+};
+
+// 8N1 transmitter on RsRx, newlines are sent as returns
+struct UartTx
+{
+    const char *text = "";
+    uint64_t next = 0;
+    int bit = -1;           // -1 idle, 0 start bit, 1-8 data, 9-10 stop
+    unsigned data = 0;
+
+    unsigned Line(uint64_t cycle)
+    {
+        if (cycle < next)
+            return Level();
+        if (bit < 0 || bit == 10)
+        {
+            if (!*text)
+            {
+                bit = -1;
+                return 1;
+            }
+            data = *text == '\n' ? '\r' : *text;
+            text++;
+            bit = 0;
+        }
+        else
+            bit++;
+        next = cycle + bitClocks;
+        return Level();
+    }
+
+    unsigned Level()
+    {
+        return bit == 0 ? 0 : (bit >= 1 && bit <= 8) ? (data >> (bit - 1)) & 1 : 1;
+    }
+};
+
+int main(int argc, char **argv)
+{
+    Harness<Vavr_b3_vl> h(argc, argv, "avr_b3_vl", "flash", "rom.mem", "u:i:I:", ExtraOpt,
+        "         -u <clocks>:   set the UART bit time in board clocks (default 1728)\n"
+        "         -i <text>:     type the text on the UART, \\n is sent as a return\n"
+        "         -I <cycle>:    start typing at this board clock (default 0)\n");
+    Vavr_b3_vl *top = h.top;
+    SevenSeg display;
+    UartRx rx;
+    UartTx tx;
+    unsigned leds;
+
+    tx.text = input.c_str();
+    tx.next = inputCycle;
+    top->sw = h.options.switches;
+    top->btn = h.options.buttons;
+    top->rows = 0xf;
+    top->RsRx = 1;
+    top->clk = 0;
+    top->eval();
+    leds = top->led;
+
+    h.StartClock();
+    while (h.cycles < h.options.maxCycles && !h.context.gotFinish())
+    {
+        h.Tick();
+        top->rows = KeypadRows(h.KeyHeld(), top->cols);
+        top->RsRx = tx.Line(h.cycles);
+        rx.Sample(h.cycles, top->RsTx);
+        display.Sample(top->an, top->seg);
+        if (h.options.verbose && top->led != leds)
+            fprintf(stderr, "%12llu: leds = %04X\n", (unsigned long long)h.cycles, top->led);
+        leds = top->led;
+    }
+
+    printf("\nleds    = %04X\n", top->led);
+    display.Print(stdout);
+    h.ReportSpeed(stdout);
+
+    return 0;
+}
+
+// end of avr_b3_vl.cpp
@@ -0,0 +1,39 @@
+/*
+ *  avr_b3_vl.v
+ *
+ *  Description:
+ *      Verilator top for avr_b3.  The PS2 keyboard lines are left idle with their
+ *      pullups, no SD card is inserted, and the VGA signals are not brought out.
+ *      The UART and the PmodKYPD rows and columns are driven by the harness.
+ */
+
+`include "../sysdefs.h"
+
+module avr_b3_vl(
+    input  clk,         // 100MHz clock
+    input [15:0] sw,    // switches
+    input [4:0] btn,    // buttons
+    output [15:0] led,  // LEDs
+    output [6:0] seg,   // display segments
+    output dp,          // decimal point
+    output [3:0] an,    // display anode
+    output [3:0] cols,  // PmodKYPD columns
+    input [3:0] rows,   // PmodKYPD rows
+    output JA7,         // audio
+    input RsRx,         // UART receive signal
+    output RsTx         // UART transmit signal
+);
+
+    wire PS2Clk, PS2Data;
+    wire JC0, JC1, JC2, JC3;
+    wire [3:0] vgaBlue, vgaGreen, vgaRed;
+    wire Vsync, Hsync;
+    wire sdsck, sdmosi, sdcs;
+
+    pullup(PS2Clk);
+    pullup(PS2Data);
+
+    avr_b3 sys(clk, sw, btn, led, seg, dp, an, cols, rows, JA7, JC0, JC1, JC2, JC3, RsRx, RsTx,
+        PS2Clk, PS2Data, vgaBlue, vgaGreen, vgaRed, Vsync, Hsync, sdsck, 1'b1, sdmosi, sdcs, 1'b1);
+
+endmodule
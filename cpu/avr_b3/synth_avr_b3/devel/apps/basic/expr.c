@@ -92,13 +92,14 @@
 #include <ctype.h>
 #include <string.h>
 #include <stdbool.h>
+#include <inttypes.h>
 #include "symtab.h"
 #include "lexer.h"
 #include "expr.h"
 #include "parser.h"
 #include "main.h"
 
-bool IsExpr(Node **ppNode);
+bool IsExpr(Expr **ppExpr);
 bool IsLogicExpr(Node **ppNode);
 bool IsLogicExprPrime(Node **ppNode);
 bool IsRelExpr(Node **ppNode);
@@ -114,41 +115,38 @@ bool IsPostfixExpr(Node **ppNode);
 bool IsSubExprList(Node **ppNode, int *subExprQty);
 bool IsPrimaryExpr(Node **ppNode);
 Node *TraverseParseTree(Node *node);
+Expr *CompileSyntaxTree(Node *root);
 Node *NewNode(enum NodeType type, union NodeValue value);
 void FreeNode(Node *node);
-void FreeExprTrees(void);
 Node *AddSon(Node *parent, Node *node);
 
-// expression root node list used to free expression trees
-Node *ExprList[TABLE_LEN];
-int exprListIdx;
+// list of compiled expressions used to free them, the last one created first
+Expr *exprList = NULL;
 
-// syntax tree list used to free them
-Node *SyntaxTreeList[TABLE_LEN];
-int syntaxTreeListIdx;
-
-// total node count
+// total node count and size of the compiled expressions
 int gNodeQty = 0;
+int gCodeSize = 0;
 
 // expression -- this is the top-level query for an expression
 // expr : logicExpr
-bool IsExpr(Node **ppNode)
+bool IsExpr(Expr **ppExpr)
 {
     Node *parseTree, *syntaxTree;
     
     if (IsLogicExpr(&parseTree))
     {
-        // create syntax tree from parse tree
+        // create syntax tree from parse tree then free the unnecessary parse tree
         syntaxTree = TraverseParseTree(parseTree);
-        
-        // add to list of syntax trees so they can be freed then free the unnecessary parse tree
-        SyntaxTreeList[syntaxTreeListIdx++] = syntaxTree;        
         FreeNode(parseTree);
         
-        // return the syntax tree
-        *ppNode = syntaxTree;
-        
-        return true;
+        // compile the syntax tree to the code the runtime executes, the syntax tree isn't needed either
+        if (syntaxTree)
+        {
+            *ppExpr = CompileSyntaxTree(syntaxTree);
+            FreeNode(syntaxTree);
+            
+            return (*ppExpr != NULL);
+        }
     }
     
     return false;
@@ -761,6 +759,7 @@ Node *TraverseParseTree(Node *node)
                 {    
                     case '+':
                     case '-':
+                    case '~':
                     case NOT_OP:
                         stNode = NewNode(NT_UNOP, (union NodeValue)(NODE_VAL_OP(node)));
                         return stNode;
@@ -797,6 +796,314 @@ Node *TraverseParseTree(Node *node)
 }
 
 
+// the compilation of a syntax tree to postfix byte code, the bytes are only counted while code is NULL
+enum ValueType {VT_NONE, VT_NUM, VT_STR};
+static unsigned char *code;
+static int codeSize, numDepth, strDepth, maxDepth;
+
+static void Emit(const void *bytes, int size)
+{
+    if (code)
+    {
+        memcpy(&code[codeSize], bytes, size);
+    }
+    codeSize += size;
+}
+
+static void EmitByte(int byte)
+{
+    unsigned char c = byte;
+    
+    Emit(&c, 1);
+}
+
+// account for the values pushed onto (qty > 0) or popped from a stack at runtime
+static void Push(int *depth, int qty)
+{
+    *depth += qty;
+    if (*depth > maxDepth)
+    {
+        maxDepth = *depth;
+    }
+}
+
+static int BinopCode(int op)
+{
+    switch (op)
+    {
+        case AND_OP:    return OC_AND;
+        case OR_OP:     return OC_OR;
+        case XOR_OP:    return OC_XOR;
+        case '=':       return OC_EQ;
+        case NE_OP:     return OC_NE;
+        case '>':       return OC_GT;
+        case GE_OP:     return OC_GE;
+        case '<':       return OC_LT;
+        case LE_OP:     return OC_LE;
+        case SL_OP:     return OC_SL;
+        case SR_OP:     return OC_SR;
+        case '+':       return OC_ADD;
+        case '-':       return OC_SUB;
+        case '*':       return OC_MUL;
+        case '/':       return OC_DIV;
+        case '%':
+        case MOD_OP:    return OC_MOD;
+    }
+    return OC_END;
+}
+
+// emit the code of a node in postfix order and return the type of the value it leaves on the stack
+static enum ValueType CompileNode(Node *node)
+{
+    int qty = 0, fct;
+    
+    if (node == NULL)
+    {
+        return VT_NONE;
+    }
+    
+    switch (NODE_TYPE(node))
+    {
+        case NT_BINOP:
+            // binop
+            //   opndL opndR
+            if (CompileNode(SON(node)) != VT_NUM || CompileNode(BRO(node)) != VT_NUM)
+            {
+                break;
+            }
+            EmitByte(BinopCode(NODE_VAL_OP(node)));
+            Push(&numDepth, -1);
+            return VT_NUM;
+            
+        case NT_UNOP:
+            // unop
+            //   opnd
+            if (CompileNode(SON(node)) != VT_NUM)
+            {
+                break;
+            }
+            switch (NODE_VAL_OP(node))
+            {
+                case '-':
+                    EmitByte(OC_NEG);
+                    break;
+                case '~':
+                    EmitByte(OC_COMPL);
+                    break;
+                case NOT_OP:
+                    EmitByte(OC_NOT);
+                    break;
+            }
+            return VT_NUM;
+            
+        case NT_CONSTANT:
+            // an integral constant is an int so that integer arithmetic can be used
+            if (NODE_VAL_CONST(node) >= INT32_MIN && NODE_VAL_CONST(node) < -(float)INT32_MIN &&
+                NODE_VAL_CONST(node) == (int32_t)NODE_VAL_CONST(node))
+            {
+                int32_t value = (int32_t)NODE_VAL_CONST(node);
+                
+                EmitByte(OC_INTEGER);
+                Emit(&value, sizeof(int32_t));
+            }
+            else
+            {
+                EmitByte(OC_CONSTANT);
+                Emit(&NODE_VAL_CONST(node), sizeof(float));
+            }
+            Push(&numDepth, 1);
+            return VT_NUM;
+            
+        case NT_STRING:
+            EmitByte(OC_STRING);
+            Emit(&NODE_VAL_STRING(node), sizeof(char *));
+            Push(&strDepth, 1);
+            return VT_STR;
+            
+        case NT_NUMVAR:
+        case NT_STRVAR:
+        case NT_FCT:
+            // the indeces or args are the sons of the expr placeholders following the var or fct node,
+            // they could be empty so only compile the non-empty ones
+            for (Node *next = BRO(node); next; next = BRO(next))
+            {
+                if (SON(next))
+                {
+                    if (CompileNode(SON(next)) != VT_NUM)
+                    {
+                        strcpy(errorStr, "invalid array index or argument expression");
+                        return VT_NONE;
+                    }
+                    qty++;
+                }
+            }
+            Push(&numDepth, -qty);
+            if (NODE_TYPE(node) == NT_FCT)
+            {
+                // call the builtin fct by its index in the builtin fct table
+                for (fct = 0; fct < builtinFctTableSize; fct++)
+                {
+                    if (!strcmp(builtinFctTab[fct].name, SYM_NAME(NODE_VAL_VARSYM(node))))
+                    {
+                        break;
+                    }
+                }
+                if (fct == builtinFctTableSize)
+                {
+                    strcpy(errorStr, "unknown builtin function");
+                    return VT_NONE;
+                }
+                EmitByte(OC_FCT);
+                EmitByte(fct);
+                EmitByte(qty);
+                Push(&numDepth, 1);
+                return VT_NUM;
+            }
+            if (qty > 0)
+            {
+                EmitByte(NODE_TYPE(node) == NT_NUMVAR ? OC_NUMARRAY : OC_STRARRAY);
+                Emit(&NODE_VAL_VARSYM(node), sizeof(Symbol *));
+                EmitByte(qty);
+            }
+            else
+            {
+                EmitByte(NODE_TYPE(node) == NT_NUMVAR ? OC_NUMVAR : OC_STRVAR);
+                Emit(&NODE_VAL_VARSYM(node), sizeof(Symbol *));
+            }
+            if (NODE_TYPE(node) == NT_NUMVAR)
+            {
+                Push(&numDepth, 1);
+                return VT_NUM;
+            }
+            Push(&strDepth, 1);
+            return VT_STR;
+            
+        case NT_EXPR:
+            return CompileNode(SON(node));
+            
+        default:
+            break;
+    }
+    
+    strcpy(errorStr, "incompatible types");
+    return VT_NONE;
+}
+
+// compile a syntax tree to an expression, a list of byte codes in postfix order run by the runtime on a stack
+Expr *CompileSyntaxTree(Node *root)
+{
+    Expr *expr;
+    
+    // count the bytes of code and check that the expression fits the runtime stacks
+    code = NULL;
+    codeSize = numDepth = strDepth = maxDepth = 0;
+    if (CompileNode(root) == VT_NONE)
+    {
+        return NULL;
+    }
+    if (maxDepth > EXPR_STACK_SIZE)
+    {
+        strcpy(errorStr, "expression too complex");
+        return NULL;
+    }
+    
+    // allocate the expression and emit the code into it
+    expr = (Expr *)calloc(1, sizeof(Expr) + codeSize + 1);
+    if (expr == NULL)
+    {
+        Panic("system error: memory allocation error while compiling expression\n");
+        return NULL;
+    }
+    code = expr->code;
+    codeSize = 0;
+    CompileNode(root);
+    EmitByte(OC_END);
+    code = NULL;
+    
+    expr->type = NODE_TYPE(root);
+    expr->next = exprList;
+    exprList = expr;
+    gCodeSize += sizeof(Expr) + codeSize;
+    
+    return expr;
+}
+
+// the last expression created, to later free the ones created after it
+Expr *LastExpr(void)
+{
+    return exprList;
+}
+
+// a constant expression is a single constant, e.g. the line number of a GOTO bound when the program is edited
+bool IsConstantExpr(Expr *expr, float *pValue)
+{
+    int32_t value;
+    
+    if (expr->code[0] == OC_CONSTANT && expr->code[1 + sizeof(float)] == OC_END)
+    {
+        memcpy(pValue, &expr->code[1], sizeof(float));
+        return true;
+    }
+    if (expr->code[0] == OC_INTEGER && expr->code[1 + sizeof(int32_t)] == OC_END)
+    {
+        memcpy(&value, &expr->code[1], sizeof(int32_t));
+        *pValue = value;
+        return true;
+    }
+    
+    return false;
+}
+
+// the size of an expression found by stepping over the opcodes and their operands
+static int ExprSize(Expr *expr)
+{
+    unsigned char *pc = expr->code;
+    
+    while (*pc != OC_END)
+    {
+        switch (*pc++)
+        {
+            case OC_CONSTANT:
+                pc += sizeof(float);
+                break;
+            case OC_INTEGER:
+                pc += sizeof(int32_t);
+                break;
+            case OC_STRING:
+                pc += sizeof(char *);
+                break;
+            case OC_NUMVAR:
+            case OC_STRVAR:
+                pc += sizeof(Symbol *);
+                break;
+            case OC_NUMARRAY:
+            case OC_STRARRAY:
+                pc += sizeof(Symbol *) + 1;
+                break;
+            case OC_FCT:
+                pc += 2;
+                break;
+        }
+    }
+    
+    return sizeof(Expr) + (pc - expr->code) + 1;
+}
+
+// free the expressions created after the last one given, or all of them if it is NULL
+void FreeExprs(Expr *last)
+{
+    Expr *expr;
+    
+    while (exprList && exprList != last)
+    {
+        expr = exprList;
+        exprList = expr->next;
+        gCodeSize -= ExprSize(expr);
+        free(expr);
+    }
+}
+
+
 // Utility Functions
 
 Node *NewNode(enum NodeType type, union NodeValue value)
@@ -831,20 +1138,6 @@ void FreeNode(Node *node)
     gNodeQty--;
 }
 
-void FreeExprTrees(void)
-{
-    for (int i = 0; i < exprListIdx; i++)
-    {
-        FreeNode(ExprList[i]);
-    }
-    exprListIdx = 0;
-    for (int i = 0; i < syntaxTreeListIdx; i++)
-    {
-        FreeNode(SyntaxTreeList[i]);
-    }
-    syntaxTreeListIdx = 0;
-}
-
 Node *AddSon(Node *parent, Node *node)
 {
     Node *next, *last;
@@ -45,8 +45,44 @@ typedef struct Node {
     struct Node *son;
 } Node;
 
-void FreeExprTrees(void);
-bool IsExpr(Node **ppNode);
+// opcodes of the postfix byte code an expression's syntax tree is compiled into
+enum OpCode {
+    OC_END = 0,
+    OC_CONSTANT,        // followed by the float constant, push it
+    OC_INTEGER,         // followed by the int32_t constant of an integral one, push it
+    OC_STRING,          // followed by the string pointer, push it
+    OC_NUMVAR,          // followed by the symbol pointer, push the scaler's value
+    OC_STRVAR,
+    OC_NUMARRAY,        // followed by the symbol pointer and the index qty byte, pop the indeces and push the element
+    OC_STRARRAY,
+    OC_FCT,             // followed by the builtin fct index byte and the arg qty byte, pop the args and push the result
+    
+    // binary operators pop the right operand and replace the left one with the result
+    OC_AND, OC_OR, OC_XOR,
+    OC_EQ, OC_NE, OC_GT, OC_GE, OC_LT, OC_LE,
+    OC_SL, OC_SR,
+    OC_ADD, OC_SUB, OC_MUL, OC_DIV, OC_MOD,
+    
+    // unary operators replace the top of the stack
+    OC_NEG, OC_COMPL, OC_NOT
+};
+
+// the max depth of the num and string stacks of an expression
+#define EXPR_STACK_SIZE 20
+
+// an expression is a list of byte codes in postfix order ending with OC_END, the operands are unaligned
+typedef struct Expr {
+    enum NodeType type;         // of the root of the syntax tree, to tell string from numeric expressions
+    struct Expr *next;          // list of all expressions used to free them
+    unsigned char code[];
+} Expr;
+#define EXPR_TYPE(expr)         (expr)->type
+
+Expr *LastExpr(void);
+void FreeExprs(Expr *last);
+bool IsExpr(Expr **ppExpr);
+bool IsConstantExpr(Expr *expr, float *pValue);
 
 extern int gNodeQty;
+extern int gCodeSize;
 
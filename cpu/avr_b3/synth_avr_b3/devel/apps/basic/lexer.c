@@ -107,6 +107,7 @@ struct KeywordTableEntry {
 };
 int keywordTableSize = sizeof keywordTab / sizeof(struct KeywordTableEntry);
 
+// in the order of enum BuiltinFct
 struct BuiltinFctTableEntry builtinFctTab[] = {
     {"peek",        1},
     {"rnd",         1},
@@ -73,6 +73,9 @@ struct BuiltinFctTableEntry {
     char *name;
     int arity;
 };
+
+// the index of each builtin fct in the builtin fct table
+enum BuiltinFct {BF_PEEK, BF_RND, BF_ABS, BF_SWITCHES, BF_BUTTONS, BF_GETCHAR, BF_GETDB};
 extern struct BuiltinFctTableEntry builtinFctTab[];
 extern int builtinFctTableSize;
 
@@ -59,7 +59,7 @@ ISR(_VECTOR(2))
 #endif
 
 char message[80];
-char *versionStr = "v4.0";
+char *versionStr = "v5.4";
 char *promptStr = "> ";
     
 extern bool ready;
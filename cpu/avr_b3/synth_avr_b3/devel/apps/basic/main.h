@@ -6,6 +6,11 @@
  *      2.0     Added file system
  *      3.0     Added expression tree reduction
  *      4.0     Added proper syntax tree to correctly reduce node usage
+ *      5.0     Compiled expressions to postfix byte code
+ *      5.1     Bound jump destinations to command lines
+ *      5.2     Sized variables to their scalar or DIM storage
+ *      5.3     Array element indexes with integer strides
+ *      5.4     Integer arithmetic on int values
  */
 
 #include <inttypes.h>
@@ -147,6 +147,7 @@
 #include <ctype.h>
 #include <string.h>
 #include <stdbool.h>
+#include <inttypes.h>
 #include "symtab.h"
 #include "lexer.h"
 #include "expr.h"
@@ -361,21 +362,21 @@ bool IsExprList(PrintCommand *cmd, int *listIdx)
 
 // parse the indeces of an array variable
 // this MUST parse the given number of indeces
-bool ParseIndeces(Node *indexNodes[], int dim)
+bool ParseIndeces(Expr *indexExprs[], int dim)
 {
-    int nodeIdx = 0;
+    int exprIdx = 0;
 
     if (token == '(')
     {
-        // this is an array reference so get the first index node
-        if (GetNextToken(NULL) && IsExpr(&indexNodes[nodeIdx++]))
+        // this is an array reference so get the first index expr
+        if (GetNextToken(NULL) && IsExpr(&indexExprs[exprIdx++]))
         {
-            // get the rest of the index nodes if any
+            // get the rest of the index exprs if any
             for (int i = 1; i < dim; i++)
             {
                 if (token == ',')
                 {
-                    if (!GetNextToken(NULL) || !IsExpr(&indexNodes[nodeIdx++]))
+                    if (!GetNextToken(NULL) || !IsExpr(&indexExprs[exprIdx++]))
                     {
                         return false;
                     }
@@ -415,10 +416,10 @@ bool IsAssign(Command *pCommand)
     // [let] Strvar ['(' expr [',' expr]* ')'] '=' String | postfixExpr
     if (token == Numvar || token == Strvar)
     {
-        // parse the index nodes for arrays
+        // parse the index exprs for arrays
         if (SYM_DIM(pCommand->cmd.assignCmd.varsym) > 0)
         {
-            if (!GetNextToken(NULL) || !ParseIndeces(pCommand->cmd.assignCmd.indexNodes, SYM_DIM(pCommand->cmd.assignCmd.varsym)))
+            if (!GetNextToken(NULL) || !ParseIndeces(pCommand->cmd.assignCmd.indexExprs, SYM_DIM(pCommand->cmd.assignCmd.varsym)))
             {
                 strcpy(errorStr,"subscript error");
                 return false;
@@ -503,7 +504,7 @@ bool IsNext(Command *pCommand)
 // goto : GOTO Constant
 bool IsGoto(Command *pCommand)
 {
-    Node *dest;
+    Expr *dest;
     
     if (token == GOTO)
     {
@@ -521,7 +522,7 @@ bool IsGoto(Command *pCommand)
 // if : IF expr THEN command-list
 bool IsIf(Command *pCommand)
 {
-    Node *expr;
+    Expr *expr;
     
     if (token == IF)
     {
@@ -548,7 +549,7 @@ bool IsIf(Command *pCommand)
 // gosub : GOSUB Constant
 bool IsGosub(Command *pCommand)
 {
-    Node *dest;
+    Expr *dest;
     
     if (token == GOSUB)
     {
@@ -599,11 +600,11 @@ bool IsInput(Command *pCommand)
             pCommand->cmd.inputCmd.varsym = lexval.lexsym;
             if (token == Numvar || token == Strvar)
             {
-                // parse the index nodes for arrays
+                // parse the index exprs for arrays
                 if (SYM_DIM(pCommand->cmd.assignCmd.varsym) > 0)
                 {
-                    // parse the index nodes for arrays
-                    if (!GetNextToken(NULL) || !ParseIndeces(pCommand->cmd.assignCmd.indexNodes, SYM_DIM(pCommand->cmd.assignCmd.varsym)))
+                    // parse the index exprs for arrays
+                    if (!GetNextToken(NULL) || !ParseIndeces(pCommand->cmd.assignCmd.indexExprs, SYM_DIM(pCommand->cmd.assignCmd.varsym)))
                     {
                         strcpy(errorStr,"subscript error");
                         return false;
@@ -620,7 +621,7 @@ bool IsInput(Command *pCommand)
 // poke : POKE expr ',' expr
 bool IsPoke(Command *pCommand)
 {
-    Node *addr, *data;
+    Expr *addr, *data;
     
     if (token == POKE)
     {
@@ -645,7 +646,7 @@ bool IsPoke(Command *pCommand)
 // tone : TONE expr [',' expr]
 bool IsTone(Command *pCommand)
 {
-    Node *freq, *duration;
+    Expr *freq, *duration;
     
     if (token == TONE)
     {
@@ -693,7 +694,7 @@ bool IsBeep(Command *pCommand)
 // leds : LEDS expr
 bool IsLeds(Command *pCommand)
 {
-    Node *value;
+    Expr *value;
     
     if (token == LEDS)
     {
@@ -712,7 +713,7 @@ bool IsLeds(Command *pCommand)
 bool IsDisplay(Command *pCommand)
 {
     // note: display quantity is either 2 or 4 (the number of 7-seg displays)
-    Node *value, *displayQty;
+    Expr *value, *displayQty;
     
     if (token == DISPLAY)
     {
@@ -737,7 +738,7 @@ bool IsDisplay(Command *pCommand)
 // putFB : PUTFB expr ',' expr ',' expr
 bool IsPutchar(Command *pCommand)
 {
-    Node *row, *col, *value;
+    Expr *row, *col, *value;
     
     if (token == PUTCHAR)
     {
@@ -769,7 +770,7 @@ bool IsPutchar(Command *pCommand)
 // putDB : PUTDB expr ',' expr ',' expr
 bool IsPutDB(Command *pCommand)
 {
-    Node *row, *col, *value;
+    Expr *row, *col, *value;
     
     if (token == PUTDB)
     {
@@ -861,7 +862,7 @@ bool IsGr(Command *pCommand)
 // outchar : OUTCHAR expr
 bool IsOutchar(Command *pCommand)
 {
-    Node *outputChar;
+    Expr *outputChar;
     
     if (token == OUTCHAR)
     {
@@ -879,7 +880,7 @@ bool IsOutchar(Command *pCommand)
 // rseed : RSEED expr
 bool IsRseed(Command *pCommand)
 {
-    Node *seed;
+    Expr *seed;
     
     if (token == RSEED)
     {
@@ -897,7 +898,7 @@ bool IsRseed(Command *pCommand)
 // delay : DELAY expr
 bool IsDelay(Command *pCommand)
 {
-    Node *duration;
+    Expr *duration;
     
     if (token == DELAY)
     {
@@ -926,19 +927,19 @@ bool IsDim(Command *pCommand)
             if (GetNextToken(NULL) && (token == '('))
             {
                 // get the first index
-                if (GetNextToken(NULL) && IsExpr(&pCommand->cmd.dimCmd.dimSizeNodes[dim++]))
+                if (GetNextToken(NULL) && IsExpr(&pCommand->cmd.dimCmd.dimSizeExprs[dim++]))
                 {
                     // get the rest of the indeces
                     while (token == ',')
                     {
-                        if (!GetNextToken(NULL) || !IsExpr(&pCommand->cmd.dimCmd.dimSizeNodes[dim++]) || dim > DIM_MAX)
+                        if (!GetNextToken(NULL) || dim == DIM_MAX || !IsExpr(&pCommand->cmd.dimCmd.dimSizeExprs[dim++]))
                         {
                             return false;
                         } 
                     } 
                     if (token == ')')
                     {
-                        SYM_DIM(pCommand->cmd.dimCmd.varsym) = dim;
+                        SymSetDim(pCommand->cmd.dimCmd.varsym, dim);
                         return GetNextToken(NULL);
                     }
                 }
@@ -13,9 +13,10 @@ extern char errorStr[];
 // command data structures are loaded by the parser and used by the runtime
 
 typedef struct Command Command;
+typedef struct CommandLine CommandLine;
 
 typedef struct Printable {
-    Node *expr;
+    Expr *expr;
     char separator;
 } Printable;
 enum PrintStyle {PS_DECIMAL, PS_HEX, PS_ASCII};
@@ -27,16 +28,17 @@ typedef struct PrintCommand {
 
 typedef struct AssignCommand {
     Symbol *varsym;             // LHS symbol to which to assign a RHS value
-    Node *indexNodes[DIM_MAX];  // possible array index nodes
-    Node *expr;                 // RHS
+    Expr *indexExprs[DIM_MAX];  // possible array index exprs
+    Expr *expr;                 // RHS
 } AssignCommand;
 
 typedef struct ForCommand {
     int lineNum;
+    CommandLine *line;          // of the for command, bound when the program is edited
     Symbol *symbol;
-    Node *init;
-    Node *to;
-    Node *step;
+    Expr *init;
+    Expr *to;
+    Expr *step;
 } ForCommand;
 
 typedef struct NextCommand {
@@ -45,34 +47,36 @@ typedef struct NextCommand {
 } NextCommand;
 
 typedef struct GotoCommand {
-    Node *dest;
+    Expr *dest;
+    CommandLine *destLine;      // of a constant dest, bound when the program is edited
 } GotoCommand;
 
 enum IF_TYPE {IT_PRINT, IT_ASSIGN, IT_GOTO};
 typedef struct IfCommand {
-    Node *expr;
+    Expr *expr;
     Command *commandList;
 } IfCommand;
 
 typedef struct GosubCommand {
     int lineNum;
-    Node *dest;
+    Expr *dest;
+    CommandLine *destLine;
 } GosubCommand;
 
 typedef struct InputCommand {
     Symbol *varsym;                 // LHS symbol to which to assign an input value
-    Node *indexNodes[DIM_MAX];
+    Expr *indexExprs[DIM_MAX];
 } InputCommand;
 
 typedef struct PlatformCommand {
-    Node *arg1;
-    Node *arg2;
-    Node *arg3;
+    Expr *arg1;
+    Expr *arg2;
+    Expr *arg3;
 } PlatformCommand;
 
 typedef struct DimCommand {
     Symbol *varsym;                 // contains the linear data array
-    Node *dimSizeNodes[DIM_MAX];    // the expression of each dimension
+    Expr *dimSizeExprs[DIM_MAX];    // the expression of each dimension
 } DimCommand;
 
 enum EX_COMMAND_TYPE {
@@ -124,11 +128,11 @@ typedef struct Command {
     struct Command *next;
 } Command;
 
-typedef struct CommandLine {
+struct CommandLine {
     char commandStr[MAX_CMDLINE_LEN];
     int lineNum;
     Command *commandList;
-} CommandLine;    
+};    
 
 extern CommandLine Program[MAX_PROGRAM_LEN];
 extern int programSize;
@@ -16,6 +16,7 @@
 #include <string.h>
 #include <inttypes.h>
 #include <math.h>
+#include <limits.h>
 #include "symtab.h"
 #include "lexer.h"
 #include "expr.h"
@@ -66,26 +67,26 @@ bool ExecRseed(PlatformCommand *cmd);
 bool ExecDelay(PlatformCommand *cmd);
 bool ExecDim(DimCommand *cmd);
 bool ExecBreak(PlatformCommand *cmd);
-bool ExecBuiltinFct(const char *name);
-
-bool EvaluateNumExpr(Node *exprTreeRoot, float *pValue);
-bool EvaluateStrExpr(Node *exprTreeRoot, char **pValue);
-bool TraverseSyntaxTree(Node *node);
-
-float NumStackPush(float a);
-float NumStackPop(void);
-float NumStackTop(void);
-float NumStackPut(float a);
-char *StrStackPush(char *a);
-char *StrStackPop(void);
-char *StrStackTop(void);
-char *StrStackPut(char *a);
+bool ExecBuiltinFct(int fct, Number *args, Number *pValue);
+
+bool EvaluateNumber(Expr *expr, Number *pValue);
+bool EvaluateNumExpr(Expr *expr, float *pValue);
+bool EvaluateIntExpr(Expr *expr, int32_t *pValue);
+bool EvaluateStrExpr(Expr *expr, char **pValue);
+bool RunExpr(Expr *expr, Number **pNumTop, char ***pStrTop);
+static bool IsTrue(Number *num);
+static int CompareNumbers(Number *a, Number *b);
+static void AddNumbers(Number *a, Number *b);
+static void SubNumbers(Number *a, Number *b);
+static void MulNumbers(Number *a, Number *b);
 
 void FreeCommand(Command *cmd);
 void FreeCommandList(Command *commandList);
 void FreeProgram(void);
 Command *IterateCmdPtr(bool cmdListOnly);
 bool LineNum2CmdLineIdx(int lineNum);
+CommandLine *FindCommandLine(int lineNum);
+void BindProgram(void);
 void SwapProgLines(int progIdxA, int progIdxB);
 void SortProgramByLineNum(void);
 void PrintResult(void);
@@ -116,17 +117,20 @@ CommandLine emptyCommandLine = {0};
 ForCommand *fortab[TABLE_LEN];
 int fortabSize = 0, lastForIdx;
 
-// call stack used for subroutines/returns
-Command *callStack[STACK_SIZE];
+// call stack used for subroutines/returns, a frame is the command and the command line to return to
+typedef struct CallFrame {
+    Command *cmdPtr;
+    int cmdListIdx;
+} CallFrame;
+CallFrame callStack[STACK_SIZE];
 unsigned callSP = 0;
 
-// floating point stack and its index, i.e. real stack pointer
-float numStack[STACK_SIZE];
-unsigned numSP = 0;
+// set by a command that changes the command pointer, which may be to the command itself
+bool jumped;
 
-// string stack and its index, i.e. string stack pointer
-char *strStack[STACK_SIZE];
-unsigned strSP = 0;
+// number and string stacks of the expression being run
+Number numStack[EXPR_STACK_SIZE];
+char *strStack[EXPR_STACK_SIZE];
 
 // built-in function list
 typedef struct FctList {
@@ -146,6 +150,7 @@ bool ProcessCommand(char *commandStr)
     char tempStr[80];
     char commandBuf[80];
     char *filename;
+    Expr *lastExpr = LastExpr();
     
     // default parser error
     strcpy(errorStr, "syntax error");
@@ -246,10 +251,10 @@ bool ProcessCommand(char *commandStr)
                     PrintResult();
                 }
                 
-                // free the command line and all expressions immediately
+                // free the command line and its expressions immediately
                 FreeCommandList(commandLine.commandList);
                 commandLine = emptyCommandLine;
-                FreeExprTrees();
+                FreeExprs(lastExpr);
                 return success;
             }
             else
@@ -277,7 +282,8 @@ bool ProcessCommand(char *commandStr)
                     }
                 }
                 SortProgramByLineNum();
-                sprintf(message, "%d nodes in use\n", gNodeQty);
+                BindProgram();
+                sprintf(message, "%d bytes of expression code in use\n", gCodeSize);
                 MESSAGE(message);
                 ready = false;
                 return true;
@@ -285,6 +291,8 @@ bool ProcessCommand(char *commandStr)
         }
         else
         {
+            // free the expressions of the partially parsed command line
+            FreeExprs(lastExpr);
             sprintf(tempStr, ": %s", commandStr);
             strcat(errorStr, tempStr);
         }
@@ -307,10 +315,8 @@ bool RunProgram(void)
         // ready for more commands whether or not the program executes correctly
         ready = true;    
 
-        // init all stacks
+        // init the call stack
         callSP = 0;
-        numSP = 0;
-        strSP = 0;
                   
         // init the command pointer to the first command in the first command line
         cmdPtr = Program[0].commandList;
@@ -360,9 +366,7 @@ bool NewProgram(void)
     programSize = 0;
     cmdListIdx = 0;
     callSP = 0;
-    numSP = 0;
-    strSP = 0;
-    FreeExprTrees();
+    FreeExprs(NULL);
     FreeSymtab();
     InstallBuiltinFcts();
     FreeProgram();
@@ -373,7 +377,7 @@ bool NewProgram(void)
 // execute a possible list of commands
 bool ExecCommand(Command *command, bool cmdListOnly)
 {
-    Command *lastCmdPtr = cmdPtr;
+    jumped = false;
     
     switch (command->type)
     {
@@ -514,7 +518,7 @@ bool ExecCommand(Command *command, bool cmdListOnly)
                 return false;
             break;                
     }
-    if (cmdPtr == lastCmdPtr)
+    if (!jumped)
     {
         // if a command didn't change the command pointer, logically increment it
         cmdPtr = IterateCmdPtr(cmdListOnly);                      
@@ -527,7 +531,7 @@ bool ExecCommand(Command *command, bool cmdListOnly)
 bool ExecPrint(PrintCommand *cmd)
 {
     char exprStr[80];
-    float numval;
+    Number numval;
     char *strval;
     int intval, decval;
     
@@ -540,14 +544,14 @@ bool ExecPrint(PrintCommand *cmd)
             strcat(resultStr, "    ");
         }
         
-        switch (NODE_TYPE(cmd->printList[i].expr))
+        switch (EXPR_TYPE(cmd->printList[i].expr))
         {
             case NT_BINOP:
             case NT_UNOP:
             case NT_NUMVAR:
             case NT_FCT:
             case NT_CONSTANT:
-                if (!EvaluateNumExpr(cmd->printList[i].expr, &numval))
+                if (!EvaluateNumber(cmd->printList[i].expr, &numval))
                 {
                     if (!strcmp(errorStr, ""))
                     {
@@ -559,18 +563,23 @@ bool ExecPrint(PrintCommand *cmd)
                 switch (cmd->style)
                 {
                     case PS_DECIMAL:
-                        sprintf(exprStr, "%f", numval);
+                        if (numval.isInt)
+                        {
+                            sprintf(exprStr, "%ld", (long)numval.i);
+                            break;
+                        }
+                        sprintf(exprStr, "%f", numval.f);
                         sscanf(exprStr, "%d.%d", &intval, &decval);
                         if (decval == 0)
                         {
-                            sprintf(exprStr, "%.f", numval);
+                            sprintf(exprStr, "%.f", numval.f);
                         }
                         break;
                     case PS_HEX:
-                        sprintf(exprStr, "0x%x", (unsigned int)numval);
+                        sprintf(exprStr, "0x%x", (unsigned int)NUM_INT(numval));
                         break;
                     case PS_ASCII:
-                        sprintf(exprStr, "%c", (int)numval);
+                        sprintf(exprStr, "%c", (int)NUM_INT(numval));
                         break;
                 }
                 if (exprStr == NULL)
@@ -613,41 +622,41 @@ bool ExecPrint(PrintCommand *cmd)
 // [let] Strvar ['(' expr [',' expr]* ')'] '=' String | postfixExpr
 bool ExecAssign(AssignCommand *cmd)
 {
-    float indeces[DIM_MAX] = {0};
-    float numRhs;
+    Number indeces[DIM_MAX];
+    Number numRhs;
     char *strRhs;
-    int i;
+    int index = 0;
     
     if (SYM_DIM(cmd->varsym) > 0)
     {
-        // evaluate the LHS index values from their nodes padding with 0's for unused higher order dimensions
-        for (i = 0; i < DIM_MAX - SYM_DIM(cmd->varsym); i++)
-        {
-            SYM_DIMSIZES(cmd->varsym, i) = 0;
-        }
-        for (int j = 0; j < SYM_DIM(cmd->varsym); j++, i++)
+        // evaluate the LHS index values from their exprs
+        for (int i = 0; i < SYM_DIM(cmd->varsym); i++)
         {
-            if (!EvaluateNumExpr(cmd->indexNodes[j], &indeces[i]))
+            if (!EvaluateNumber(cmd->indexExprs[i], &indeces[i]))
             {
                 strcpy(errorStr, "invalid array index expression");
                 return false;
             }
         }
+        if ((index = SymIndex(cmd->varsym, indeces, SYM_DIM(cmd->varsym))) < 0)
+        {
+            return false;
+        }
     }
             
     // perform the assignment, varsym = expr, can only assign values to variables
     if (SYM_TYPE(cmd->varsym) == ST_NUMVAR)
     {
-        switch (NODE_TYPE(cmd->expr))
+        switch (EXPR_TYPE(cmd->expr))
         {
             case NT_BINOP:
             case NT_UNOP:
             case NT_NUMVAR:
             case NT_FCT:
             case NT_CONSTANT:
-                if (EvaluateNumExpr(cmd->expr, &numRhs))
+                if (EvaluateNumber(cmd->expr, &numRhs))
                 {
-                    if (SymWriteNumvar(cmd->varsym, indeces, numRhs))
+                    if (SymWriteNumvar(cmd->varsym, index, numRhs))
                     {
                         return true;
                     }
@@ -659,13 +668,13 @@ bool ExecAssign(AssignCommand *cmd)
     }        
     else if (SYM_TYPE(cmd->varsym) == ST_STRVAR)
     {
-        switch (NODE_TYPE(cmd->expr))
+        switch (EXPR_TYPE(cmd->expr))
         {
             case NT_STRVAR:
             case NT_STRING:
                 if (EvaluateStrExpr(cmd->expr, &strRhs))
                 {
-                    if (SymWriteStrvar(cmd->varsym, indeces, strRhs))
+                    if (SymWriteStrvar(cmd->varsym, index, strRhs))
                     {
                         return true;
                     }
@@ -687,14 +696,14 @@ bool ExecAssign(AssignCommand *cmd)
 // for : FOR Intvar '=' init TO to [STEP step]
 bool ExecFor(ForCommand *cmd)
 {
-    float value;
+    Number value;
     
     //Console("ExecFor()\n");
     
     // perform initial variable assignment
-    if (EvaluateNumExpr(cmd->init, &value))
+    if (EvaluateNumber(cmd->init, &value))
     {
-        if (SymWriteNumvar(cmd->symbol, NULL, value))
+        if (SymWriteNumvar(cmd->symbol, 0, value))
         {
             // push for-command onto FOR stack if it isn't already there
             for (int i = 0; i < fortabSize; i++)
@@ -718,7 +727,9 @@ bool ExecFor(ForCommand *cmd)
 bool ExecNext(NextCommand *cmd)
 {
     ForCommand *forInstr = NULL;
-    float symval, to, step = 1;
+    Number symval, to, step = {.isInt = true, .i = 1};
+    bool down;
+    int cmp;
     
     //Console("ExecNext()\n");
     
@@ -756,31 +767,35 @@ bool ExecNext(NextCommand *cmd)
     // modify the associated variable and perform a goto if needed        
     if (forInstr->step)
     {
-        if (!EvaluateNumExpr(forInstr->step, &step))
+        if (!EvaluateNumber(forInstr->step, &step))
         {
             return false;
         }
     }
-    if (SymReadNumvar(forInstr->symbol, NULL, &symval))
+    if (SymReadNumvar(forInstr->symbol, 0, &symval))
     {
-        symval += step;
-        if (SymWriteNumvar(forInstr->symbol, NULL, symval))
+        AddNumbers(&symval, &step);
+        if (SymWriteNumvar(forInstr->symbol, 0, symval))
         {
             // check that the variable's value is in the range of the for instruction
-            if (EvaluateNumExpr(forInstr->to, &to))
+            if (EvaluateNumber(forInstr->to, &to))
             {
-                if ((step >= 0 && symval <= to) || (step < 0 && symval >= to))
+                cmp = CompareNumbers(&symval, &to);
+                down = step.isInt ? step.i < 0 : step.f < 0;
+                if (cmp == 0 || (!down && cmp == -1) || (down && cmp == 1))
                 {
                     // goto the first command in the command line following the for command
-                    if (LineNum2CmdLineIdx(forInstr->lineNum))
+                    if (forInstr->line)
                     {
-                        cmdListIdx++;
-                        cmdPtr = Program[cmdListIdx].commandList;
+                        cmdListIdx = forInstr->line - Program;
                     }
-                    else
+                    else if (!LineNum2CmdLineIdx(forInstr->lineNum))
                     {
                         return false;
                     }
+                    cmdListIdx++;
+                    cmdPtr = Program[cmdListIdx].commandList;
+                    jumped = true;
                 }
                 return true;
             }
@@ -790,57 +805,49 @@ bool ExecNext(NextCommand *cmd)
     return false;
 }
 
-// goto : GOTO Constant
-bool ExecGoto(GotoCommand *cmd)
+// goto the first command in the command line of a bound destination, else of the line number of the dest expr
+static bool JumpToLine(CommandLine *destLine, Expr *dest)
 {
-    float dest;
+    int32_t lineNum;
     
-    if (EvaluateNumExpr(cmd->dest, &dest))
+    if (destLine == NULL)
     {
-        if (dest > 0)
+        if (!EvaluateIntExpr(dest, &lineNum) || lineNum <= 0)
         {
-            // goto the first command in the command line of the goto destination
-            if (LineNum2CmdLineIdx((int)dest))
-            {
-                cmdPtr = Program[cmdListIdx].commandList;
-                return true;
-            }
-            else
-            {
-                return false;
-            }
+            return false;
+        }
+        if ((destLine = FindCommandLine((int)lineNum)) == NULL)
+        {
+            sprintf(errorStr, "line %d not found", (int)lineNum);
+            return false;
         }
     }
+    cmdListIdx = destLine - Program;
+    cmdPtr = destLine->commandList;
+    jumped = true;
+    
+    return true;
+}
 
-    return false;
+// goto : GOTO Constant
+bool ExecGoto(GotoCommand *cmd)
+{
+    return JumpToLine(cmd->destLine, cmd->dest);
 }
 
 // if : IF expr THEN [assign | print | goto]
 bool ExecIf(IfCommand *cmd)
 {
-    float predicate;
-    char tempStr[STRING_LEN];
+    Number predicate;
     
-    if (EvaluateNumExpr(cmd->expr, &predicate))
+    if (EvaluateNumber(cmd->expr, &predicate))
     {
-        // if the predicate expr is true then execute the command list, else simply return
-        if (predicate)
+        // if the predicate expr is true then continue with the command list, which ends the
+        // command line, else simply return
+        if (IsTrue(&predicate))
         {
             cmdPtr = cmd->commandList;
-            while (cmdPtr != NULL)
-            {
-                // execute the command
-                if (ExecCommand(cmdPtr, ALL_COMMANDS))
-                {
-                    PrintResult();
-                }
-                else
-                {
-                    sprintf(tempStr, " at line %d", cmdPtr->lineNum);
-                    strcat(errorStr, tempStr);
-                    return false;
-                }
-            }
+            jumped = true;
         }
         return true;
     }
@@ -851,27 +858,20 @@ bool ExecIf(IfCommand *cmd)
 // gosub : GOSUB Constant
 bool ExecGosub(GosubCommand *cmd)
 {
-    float dest;
-    
     //Console("ExecGosub()\n");
     
-    if (EvaluateNumExpr(cmd->dest, &dest))
+    if (callSP == STACK_SIZE)
     {
-        if (dest > 0)
-        {
-            // push the pointer to the next command to be executed after the subroutine return onto the call stack
-            callStack[callSP++] = IterateCmdPtr(false);
-            
-            // goto the first command in the command line of the gosub destination
-            if (LineNum2CmdLineIdx((int)dest))
-            {
-                cmdPtr = Program[cmdListIdx].commandList;
-                return true;
-            }
-        }
+        strcpy(errorStr, "too many nested gosubs");
+        return false;
     }
-
-    return false;
+    
+    // push the next command to be executed after the subroutine return and its command line onto the call stack
+    callStack[callSP].cmdPtr = IterateCmdPtr(false);
+    callStack[callSP].cmdListIdx = cmdListIdx;
+    callSP++;
+    
+    return JumpToLine(cmd->destLine, cmd->dest);
 }
 
 // return : RETURN
@@ -886,14 +886,13 @@ bool ExecReturn(void)
         strcpy(errorStr, "return without gosub");
         return false;
     }
-    // pop the next command to be executed from the call stack
-    cmdPtr = callStack[--callSP];
-    if (LineNum2CmdLineIdx(cmdPtr->lineNum))
-    {
-        return true;
-    }
+    // pop the next command to be executed and its command line from the call stack
+    callSP--;
+    cmdPtr = callStack[callSP].cmdPtr;
+    cmdListIdx = callStack[callSP].cmdListIdx;
+    jumped = true;
     
-    return false;
+    return true;
 }
 
 // end : END
@@ -901,6 +900,7 @@ bool ExecEnd(void)
 {
     // end the program by setting the command point to NULL
     cmdPtr = NULL;
+    jumped = true;
     return true;
 }
 
@@ -908,17 +908,26 @@ bool ExecEnd(void)
 bool ExecInput(InputCommand *cmd)
 {
     char buffer[80];
-    float indeces[4];
-    Node *expr;
-    float numInput;
+    Number indeces[DIM_MAX];
+    Expr *expr, *lastExpr = LastExpr();
+    Number numInput;
     char *strInput;
+    bool success = true;
+    int index = 0;
     
     // evaluate index values for an LHS array
-    for (int i = 0; i < SYM_DIM(cmd->varsym); i++)
+    if (SYM_DIM(cmd->varsym) > 0)
     {
-        if (!EvaluateNumExpr(cmd->indexNodes[i], &indeces[i]))
+        for (int i = 0; i < SYM_DIM(cmd->varsym); i++)
+        {
+            if (!EvaluateNumber(cmd->indexExprs[i], &indeces[i]))
+            {
+                strcpy(errorStr, "invalid array index expression");
+                return false;
+            }
+        }
+        if ((index = SymIndex(cmd->varsym, indeces, SYM_DIM(cmd->varsym))) < 0)
         {
-            strcpy(errorStr, "invalid array index expression");
             return false;
         }
     }
@@ -937,18 +946,15 @@ bool ExecInput(InputCommand *cmd)
             // input can only be a constant
             if (token == Constant && IsExpr(&expr))
             {
-                if (EvaluateNumExpr(expr, &numInput))
+                if (EvaluateNumber(expr, &numInput))
                 {
-                    if (!SymWriteNumvar(cmd->varsym, indeces, numInput))
-                    {
-                        return false;
-                    }
+                    success = SymWriteNumvar(cmd->varsym, index, numInput);
                 }
             }
             else
             {
                 strcpy(errorStr, "invalid input expression");
-                return false;
+                success = false;
             }
         }        
         else if (SYM_TYPE(cmd->varsym) == ST_STRVAR)
@@ -958,32 +964,32 @@ bool ExecInput(InputCommand *cmd)
             {
                 if (EvaluateStrExpr(expr, &strInput))
                 {
-                    if (!SymWriteStrvar(cmd->varsym, indeces, strInput))
-                    {
-                        return false;
-                    }
+                    success = SymWriteStrvar(cmd->varsym, index, strInput);
                 }
             }
             else
             {
                 strcpy(errorStr, "invalid input string");
-                return false;
+                success = false;
             }
         }
     }
 
-    return true;
+    // the input expression isn't needed after its value is assigned
+    FreeExprs(lastExpr);
+    
+    return success;
 }
 
 bool ExecPoke(PlatformCommand *cmd)
 {
-    float numval;
+    int32_t numval;
     int addr, data;
     
-    if (EvaluateNumExpr(cmd->arg1, &numval))
+    if (EvaluateIntExpr(cmd->arg1, &numval))
     {
         addr = (int)numval;
-        if (EvaluateNumExpr(cmd->arg2, &numval))
+        if (EvaluateIntExpr(cmd->arg2, &numval))
         {
             data = (int)numval;
             MemWrite((uint16_t)addr, (uint8_t)data);
@@ -996,13 +1002,13 @@ bool ExecPoke(PlatformCommand *cmd)
 
 bool ExecTone(PlatformCommand *cmd)
 {
-    float numval;
+    int32_t numval;
     int freq, duration;
     
-    if (EvaluateNumExpr(cmd->arg1, &numval))
+    if (EvaluateIntExpr(cmd->arg1, &numval))
     {
         freq = (int)numval;
-        if (EvaluateNumExpr(cmd->arg2, &numval))
+        if (EvaluateIntExpr(cmd->arg2, &numval))
         {
             duration = (int)numval;
             Tone((uint16_t)freq, (uint16_t)duration);
@@ -1021,10 +1027,10 @@ bool ExecBeep(PlatformCommand *cmd)
 
 bool ExecLeds(PlatformCommand *cmd)
 {
-    float numval;
+    int32_t numval;
     int value;
     
-    if (EvaluateNumExpr(cmd->arg1, &numval))
+    if (EvaluateIntExpr(cmd->arg1, &numval))
     {
         value = (int)numval;
         Leds((uint16_t)value);
@@ -1036,13 +1042,13 @@ bool ExecLeds(PlatformCommand *cmd)
 
 bool ExecDisplay(PlatformCommand *cmd)
 {
-    float numval;
+    int32_t numval;
     int value, displayQty;
     
-    if (EvaluateNumExpr(cmd->arg1, &numval))
+    if (EvaluateIntExpr(cmd->arg1, &numval))
     {
         value = (int)numval;
-        if (EvaluateNumExpr(cmd->arg2, &numval))
+        if (EvaluateIntExpr(cmd->arg2, &numval))
         {
             displayQty = (int)numval;
             Display7((uint16_t)value, (uint8_t)displayQty);
@@ -1056,16 +1062,16 @@ bool ExecDisplay(PlatformCommand *cmd)
 // putchar row,col,value
 bool ExecPutchar(PlatformCommand *cmd)
 {
-    float numval;
+    int32_t numval;
     int row, col, value;
     
-    if (EvaluateNumExpr(cmd->arg1, &numval))
+    if (EvaluateIntExpr(cmd->arg1, &numval))
     {
         row = (int)numval;
-        if (EvaluateNumExpr(cmd->arg2, &numval))
+        if (EvaluateIntExpr(cmd->arg2, &numval))
         {
             col = (int)numval;
-            if (EvaluateNumExpr(cmd->arg3, &numval))
+            if (EvaluateIntExpr(cmd->arg3, &numval))
             {
                 value = (int)numval;
                 GfxPutChar((uint8_t)row, (uint8_t)col, (uint8_t)value);
@@ -1080,16 +1086,16 @@ bool ExecPutchar(PlatformCommand *cmd)
 // putdb id,row,col,value
 bool ExecPutDB(PlatformCommand *cmd)
 {
-    float numval;
+    int32_t numval;
     int row, col, value;
     
-    if (EvaluateNumExpr(cmd->arg1, &numval))
+    if (EvaluateIntExpr(cmd->arg1, &numval))
     {
         row = (int)numval;
-        if (EvaluateNumExpr(cmd->arg2, &numval))
+        if (EvaluateIntExpr(cmd->arg2, &numval))
         {
             col = (int)numval;
-            if (EvaluateNumExpr(cmd->arg3, &numval))
+            if (EvaluateIntExpr(cmd->arg3, &numval))
             {
                 value = (int)numval;
                 GfxPutDB((uint8_t)row, (uint8_t)col, (uint8_t)value);
@@ -1135,9 +1141,9 @@ bool ExecGr(PlatformCommand *cmd)
 
 bool ExecOutchar(PlatformCommand *cmd)
 {
-    float numval;
+    int32_t numval;
     
-    if (EvaluateNumExpr(cmd->arg1, &numval))
+    if (EvaluateIntExpr(cmd->arg1, &numval))
     {
         sprintf(message, "%c", (int)numval);
         Console(message);
@@ -1149,9 +1155,9 @@ bool ExecOutchar(PlatformCommand *cmd)
 
 bool ExecRseed(PlatformCommand *cmd)
 {
-    float numval;
+    int32_t numval;
     
-    if (EvaluateNumExpr(cmd->arg1, &numval))
+    if (EvaluateIntExpr(cmd->arg1, &numval))
     {
         srand((unsigned int)numval);
         return true;
@@ -1162,10 +1168,10 @@ bool ExecRseed(PlatformCommand *cmd)
 
 bool ExecDelay(PlatformCommand *cmd)
 {
-    float numval;
+    int32_t numval;
     int duration;
     
-    if (EvaluateNumExpr(cmd->arg1, &numval))
+    if (EvaluateIntExpr(cmd->arg1, &numval))
     {
         duration = (int)numval;
         Delay((uint16_t)duration);
@@ -1178,31 +1184,31 @@ bool ExecDelay(PlatformCommand *cmd)
 // dim : DIM {Numvar | Strvar} '(' expr [',' expr]+ ')'
 bool ExecDim(DimCommand *cmd)
 {
-    int size = 1, i;
+    float size;
     
     // load the dim size array, padding with 0's for unused higher order dimensions
-    for (i = 0; i < DIM_MAX - SYM_DIM(cmd->varsym); i++)
+    for (int i = 0; i < DIM_MAX; i++)
     {
         SYM_DIMSIZES(cmd->varsym, i) = 0;
+        SYM_STRIDES(cmd->varsym, i) = 0;
     }
-    for (int j = 0; j < SYM_DIM(cmd->varsym); j++, i++)
+    for (int i = 0; i < SYM_DIM(cmd->varsym); i++)
     {
-        if (!EvaluateNumExpr(cmd->dimSizeNodes[j], &SYM_DIMSIZES(cmd->varsym, i)))
+        if (!EvaluateNumExpr(cmd->dimSizeExprs[i], &size))
         {
             strcpy(errorStr, "invalid dim expression");
             return false;
         }
-        size *= SYM_DIMSIZES(cmd->varsym, i);
-    }
-    
-    // ensure total number of array elements will fit into a variable
-    if (size > ARRAY_MAX)
-    {
-        strcpy(errorStr, "too many array elements");
-        return false;
+        if (size < 1 || size > INT_MAX)
+        {
+            strcpy(errorStr, "invalid dim size");
+            return false;
+        }
+        SYM_DIMSIZES(cmd->varsym, i) = (int)size;
     }
     
-    return true;
+    // set the strides and allocate the array elements
+    return SymConvertToArray(cmd->varsym);
 }
 
 bool ExecBreak(PlatformCommand *cmd)
@@ -1210,459 +1216,496 @@ bool ExecBreak(PlatformCommand *cmd)
     return true;
 }
 
-bool ExecBuiltinFct(const char *name)
+// exec a builtin fct on its args, args[0] being the first one, the result may replace the args
+bool ExecBuiltinFct(int fct, Number *args, Number *pValue)
 {
-    if (!strcmp(name, "peek"))
-    {
-        // 1 unsigned int arg
-        NumStackPush(MemRead((uint16_t)NumStackPop()));
-    } 
-    else if (!strcmp(name, "rnd"))
-    {
-        // 1 unsigned int arg
-        NumStackPush(rand() % ((uint16_t)NumStackPop()));
-    } 
-    else if (!strcmp(name, "abs"))
-    {
-        // 1 float arg
-        NumStackPush(fabsf(NumStackPop()));
-    } 
-    else if (!strcmp(name, "switches"))
-    {
-        // no args
-        NumStackPush(Switches());
-    } 
-    else if (!strcmp(name, "buttons"))
-    {
-        // no args
-        NumStackPush(Buttons());
-    } 
-    else if (!strcmp(name, "getchar"))
-    {
-        // 2 unsigned int args, row (TOS), col
-        uint16_t col = (uint16_t)NumStackPop();
-        uint16_t row = (uint16_t)NumStackPop();
-        NumStackPush(GfxGetChar(row, col));
-    }
-    else if (!strcmp(name, "getdb"))
+    int32_t value;
+    
+    switch (fct)
     {
-        // 2 unsigned int args, row (TOS), col
-        uint16_t col = (uint16_t)NumStackPop();
-        uint16_t row = (uint16_t)NumStackPop();
-        NumStackPush(GfxGetDB(row, col));
+        case BF_PEEK:
+            // 1 unsigned int arg
+            value = MemRead((uint16_t)NUM_INT(args[0]));
+            break;
+            
+        case BF_RND:
+            // 1 unsigned int arg
+            value = rand() % ((uint16_t)NUM_INT(args[0]));
+            break;
+            
+        case BF_ABS:
+            // 1 int or float arg
+            if (!args[0].isInt || args[0].i == INT32_MIN)
+            {
+                pValue->f = fabsf(NUM_FLOAT(args[0]));
+                pValue->isInt = false;
+                return true;
+            }
+            value = (args[0].i < 0) ? -args[0].i : args[0].i;
+            break;
+            
+        case BF_SWITCHES:
+            // no args
+            value = Switches();
+            break;
+            
+        case BF_BUTTONS:
+            // no args
+            value = Buttons();
+            break;
+            
+        case BF_GETCHAR:
+            // 2 unsigned int args, row, col
+            value = GfxGetChar((uint16_t)NUM_INT(args[0]), (uint16_t)NUM_INT(args[1]));
+            break;
+            
+        case BF_GETDB:
+            // 2 unsigned int args, row, col
+            value = GfxGetDB((uint16_t)NUM_INT(args[0]), (uint16_t)NUM_INT(args[1]));
+            break;
+            
+        default:
+            strcpy(errorStr, "unknown builtin function");
+            return false;
     }
-    else
-    {
-        strcpy(errorStr, "unknown builtin function");
-        return false;
-    } 
+    pValue->i = value;
+    pValue->isInt = true;
         
     return true;       
 }
 
-// return the value of a numberic expression based on the traversal of its expr tree
-bool EvaluateNumExpr(Node *exprTreeRoot, float *pValue)
+// return the value of a numeric expression by running its code
+bool EvaluateNumber(Expr *expr, Number *pValue)
 {
-    if (TraverseSyntaxTree(exprTreeRoot))
+    Number *numTop;
+    char **strTop;
+    
+    if (RunExpr(expr, &numTop, &strTop))
     {
-        *pValue = NumStackPop();
-        return true;
+        if (numTop > numStack)
+        {
+            *pValue = numTop[-1];
+            return true;
+        }
+        strcpy(errorStr, "incompatible types");
     }
 
     return false;
 }
 
-// return the value of a string expression based on the traversal of its expr tree
-bool EvaluateStrExpr(Node *exprTreeRoot, char **pValue)
+// return the value of a numeric expression as a float
+bool EvaluateNumExpr(Expr *expr, float *pValue)
 {
-    if (TraverseSyntaxTree(exprTreeRoot))
+    Number value;
+    
+    if (EvaluateNumber(expr, &value))
     {
-        *pValue = StrStackPop();
+        *pValue = NUM_FLOAT(value);
         return true;
     }
+    
+    return false;
+}
 
+// return the value of a numeric expression truncated to an int
+bool EvaluateIntExpr(Expr *expr, int32_t *pValue)
+{
+    Number value;
+    
+    if (EvaluateNumber(expr, &value))
+    {
+        *pValue = NUM_INT(value);
+        return true;
+    }
+    
     return false;
 }
 
-bool TraverseSyntaxTree(Node *node)
+// return the value of a string expression by running its code
+bool EvaluateStrExpr(Expr *expr, char **pValue)
 {
-    bool retval = true;
-    float indeces[4] = {0};
-    int intval;
-    float numval;
-    char *strval;
+    Number *numTop;
+    char **strTop;
     
-    if (node != NULL)
+    if (RunExpr(expr, &numTop, &strTop))
     {
-        switch (NODE_TYPE(node))
+        if (strTop > strStack)
         {
-            case NT_BINOP:
-                // binop
-                //   opndL opndR
-                // push the operands onto the num stack
-                retval &= TraverseSyntaxTree(node->son);
-                retval &= TraverseSyntaxTree(node->bro);
-                switch (NODE_VAL_OP(node))
-                {    
-                    case AND_OP:
-                        // put the logical AND of the top 2 expr stack entries onto the top of the stack
-                        NumStackPut(NumStackPop() && NumStackTop());
-                        break;
-                        
+            *pValue = strTop[-1];
+            return true;
+        }
+        strcpy(errorStr, "incompatible types");
+    }
+
+    return false;
+}
+
+// a number is true if it isn't 0
+static bool IsTrue(Number *num)
+{
+    return num->isInt ? num->i != 0 : num->f != 0;
+}
+
+// compare two numbers, as ints if both are, returning -1, 0 or 1 if a is less than, equal to or greater
+// than b, or 2 if they're unordered, i.e. one is a NaN
+static int CompareNumbers(Number *a, Number *b)
+{
+    float fa, fb;
     
-                    case OR_OP:
-                        // put the logical OR of the top 2 expr stack entries onto the top of the stack
-                        NumStackPut(NumStackPop() || NumStackTop());
-                        break;
-                        
+    if (a->isInt && b->isInt)
+    {
+        return (a->i > b->i) - (a->i < b->i);
+    }
+    fa = NUM_FLOAT(*a);
+    fb = NUM_FLOAT(*b);
+    if (fa < fb)
+        return -1;
+    if (fa > fb)
+        return 1;
     
-                    case XOR_OP:
-                        // put the exclusive OR of the top 2 expr stack entries onto the top of the stack
-                        NumStackPut((float)((int)NumStackPop() ^ (int)NumStackTop()));
-                        break;
-                                                
-                    case '=':
-                        // put the equality relation of the top 2 expr stack entries onto the top of the stack
-                        NumStackPut(NumStackPop() == NumStackTop());
-                        break;                        
-                        
-                    case NE_OP:
-                        // put the non-equality relation of the top 2 expr stack entries onto the top of the stack
-                        NumStackPut(NumStackPop() != NumStackTop());
-                        break;     
-                                           
-                    case '>':
-                        // put the > relation of the top 2 expr stack entries onto the top of the stack
-                        numval = NumStackPop();
-                        NumStackPut(NumStackTop() > numval);
-                        break;
-                            
-                    case GE_OP:
-                        // put the >= relation of the top 2 expr stack entries onto the top of the stack
-                        numval = NumStackPop();
-                        NumStackPut(NumStackTop() >= numval);
-                        break;
-                        
-                    case '<':
-                        // put the < relation of the top 2 expr stack entries onto the top of the stack
-                        numval = NumStackPop();
-                        NumStackPut(NumStackTop() < numval);
-                        break;
-                        
+    return (fa == fb) ? 0 : 2;
+}
+
+// a = a + b, promoting to floats if either one is a float or the int sum overflows
+static void AddNumbers(Number *a, Number *b)
+{
+    int32_t result;
     
-                    case LE_OP:
-                        // put the <= relation of the top 2 expr stack entries onto the top of the stack
-                        numval = NumStackPop();
-                        NumStackPut(NumStackTop() <= numval);
-                        break;
-                        
-                    case '+':
-                        // put the sum of the top 2 expr stack entries onto the top of the stack
-                        NumStackPut(NumStackPop() + NumStackTop());
-                        break;
-                        
-                    case '-':
-                        // put the difference of the top 2 expr stack entries onto the top of the stack
-                        numval = NumStackPop();
-                        NumStackPut(NumStackTop() - numval);
-                        break;
-                        
-                    case '*':
-                        // put the product of the top 2 expr stack entries onto the top of the stack
-                        NumStackPut(NumStackPop() * NumStackTop());
-                        break;
-                        
-                    case '/':
-                        // put the quotient of the top 2 expr stack entries onto the top of the stack
-                        numval = NumStackPop();
-                        NumStackPut(NumStackTop() / numval);
-                        break;
-                        
-                    // NOTE: the following operators can only operate on
-                    case '%':
-                    case MOD_OP:
-                        // put the modulus of the next to top of stack value by the top of stack value onto the top of the stack
-                        intval = (int)NumStackPop();
-                        NumStackPut((int)NumStackTop() % intval);
-                        break;
-                        
-                    case SL_OP:
-                        // put the left shift of the next to top of stack value by the top of stack onto the top of the stack
-                        intval = (int)NumStackPop();
-                        NumStackPut((int)NumStackTop() << intval);
-                        break;
-                        
-                    case SR_OP:
-                        // put the right shift of the next to top of stack value by the top of stack onto the top of the stack
-                        intval = (int)NumStackPop();
-                        NumStackPut((int)NumStackTop() >> intval);
-                        break;
-                    default:
-                        break;
+    if (a->isInt && b->isInt && !__builtin_add_overflow(a->i, b->i, &result))
+    {
+        a->i = result;
+    }
+    else
+    {
+        a->f = NUM_FLOAT(*a) + NUM_FLOAT(*b);
+        a->isInt = false;
+    }
+}
+
+// a = a - b, promoting to floats if either one is a float or the int difference overflows
+static void SubNumbers(Number *a, Number *b)
+{
+    int32_t result;
+    
+    if (a->isInt && b->isInt && !__builtin_sub_overflow(a->i, b->i, &result))
+    {
+        a->i = result;
+    }
+    else
+    {
+        a->f = NUM_FLOAT(*a) - NUM_FLOAT(*b);
+        a->isInt = false;
+    }
+}
+
+// a = a * b, promoting to floats if either one is a float or the int product overflows
+static void MulNumbers(Number *a, Number *b)
+{
+    int32_t result;
+    
+    if (a->isInt && b->isInt && !__builtin_mul_overflow(a->i, b->i, &result))
+    {
+        a->i = result;
+    }
+    else
+    {
+        a->f = NUM_FLOAT(*a) * NUM_FLOAT(*b);
+        a->isInt = false;
+    }
+}
+
+// run the postfix byte code of an expression and return the tops of the num and string stacks, i.e.
+// the entries after the last ones pushed, the parser has checked that the stacks can't overflow
+//   - ints are run with integer arithmetic, except for a result that overflows or a division with a
+//     remainder which are floats, so a float is only used once a value needs one
+//   - the logical and relational operators give ints, the bitwise ones, shifts and modulus truncate
+//     their operands to ints
+bool RunExpr(Expr *expr, Number **pNumTop, char ***pStrTop)
+{
+    unsigned char *pc = expr->code;
+    Number *num = numStack;
+    char **str = strStack;
+    Symbol *varsym;
+    int qty, fct, index, cmp;
+    
+    while (true)
+    {
+        switch (*pc++)
+        {
+            case OC_END:
+                *pNumTop = num;
+                *pStrTop = str;
+                return true;
+                
+            case OC_CONSTANT:
+                memcpy(&num->f, pc, sizeof(float));
+                num->isInt = false;
+                num++;
+                pc += sizeof(float);
+                break;
+                
+            case OC_INTEGER:
+                memcpy(&num->i, pc, sizeof(int32_t));
+                num->isInt = true;
+                num++;
+                pc += sizeof(int32_t);
+                break;
+                
+            case OC_STRING:
+                memcpy(str++, pc, sizeof(char *));
+                pc += sizeof(char *);
+                break;
+                
+            case OC_NUMVAR:
+                memcpy(&varsym, pc, sizeof(Symbol *));
+                pc += sizeof(Symbol *);
+                if (SYM_DIM(varsym) > 0)
+                {
+                    strcpy(errorStr, "subscript error: number array used without indeces");
+                    return false;
                 }
+                *num++ = SYM_NUMVAL(varsym);
                 break;
                 
-            case NT_UNOP:
-                // unop
-                //   opnd
-                // push the operand onto the num stack
-                retval &= TraverseSyntaxTree(node->son);
-                switch (NODE_VAL_OP(node))
+            case OC_STRVAR:
+                memcpy(&varsym, pc, sizeof(Symbol *));
+                pc += sizeof(Symbol *);
+                if (SYM_DIM(varsym) > 0)
                 {
-                    case '+':
-                        // do nothing to make something positive
-                        break;
-                        
-                    case '-':
-                        // negate the top of the expression
-                        NumStackPut(-NumStackTop());
-                        break;
-                        
-                    case '~':
-                        // negate the top of the expression
-                        NumStackPut((float)(~(int)NumStackTop()));
-                        break;
-                        
-                    case NOT_OP:
-                        // logically invert the top of the expression stack
-                        NumStackPut(!NumStackTop());
-                        break;
+                    strcpy(errorStr, "subscript error: string array used without indeces");
+                    return false;
                 }
+                *str++ = SYM_STRVAL(varsym);
                 break;
                 
-            case NT_CONSTANT:
-                NumStackPush(NODE_VAL_CONST(node));
+            case OC_NUMARRAY:
+                memcpy(&varsym, pc, sizeof(Symbol *));
+                pc += sizeof(Symbol *);
+                qty = *pc++;
+                num -= qty;
+                if ((index = SymIndex(varsym, num, qty)) < 0 || !SymReadNumvar(varsym, index, num))
+                {
+                    return false;
+                }
+                num++;
                 break;
                 
-            case NT_STRING:
-                StrStackPush(NODE_VAL_STRING(node));
+            case OC_STRARRAY:
+                memcpy(&varsym, pc, sizeof(Symbol *));
+                pc += sizeof(Symbol *);
+                qty = *pc++;
+                num -= qty;
+                if ((index = SymIndex(varsym, num, qty)) < 0 || !SymReadStrvar(varsym, index, str))
+                {
+                    return false;
+                }
+                str++;
                 break;
                 
-            // note: for arrays, indeces are the decendents pop the indeces into an index array then read the value, 
-            // the popped values will be the reverse of the needed indeces so reverse them in the indeces array
-            case NT_NUMVAR:
-                // process vector
-                if (SYM_DIM(NODE_VAL_VARSYM(node)) > 0)
+            case OC_FCT:
+                fct = *pc++;
+                qty = *pc++;
+                num -= qty;
+                
+                // check that the arity of the function equals the qty of args parsed then exec the builtin
+                // fct which will replace the args with the result
+                if (builtinFctTab[fct].arity != qty)
                 {
-                    int indexQty = 0;
-                    
-                    // push the indeces onto the stack
-                    for (Node *next = node->bro; next; next = next->bro)
-                    {
-                        // args are expressions which could be empty so only process non-empty arg expressions
-                        if (next->son)
-                        {
-                            TraverseSyntaxTree(next);
-                            indexQty++;
-                        }
-                    }
+                    strcpy(errorStr, "incorrect number of arguments for builtin function");
+                    return false;
+                }
+                if (!ExecBuiltinFct(fct, num, num))
+                {
+                    return false;
+                }
+                num++;
+                break;
                 
-                    // check that the dim of the array equals the qty of indeces parsed
-                    if (SYM_DIM(NODE_VAL_VARSYM(node)) == indexQty)
-                    {                
-                        // build the index list from the num stack in reverse order
-                        for (int i = 0; i < SYM_DIM(NODE_VAL_VARSYM(node)); i++)
-                        {
-                            indeces[DIM_MAX-1 - i] = (int)NumStackPop();
-                        }
-                        if ((retval = SymReadNumvar(NODE_VAL_VARSYM(node), indeces, &numval)))
-                        {
-                            NumStackPush(numval);
-                        }
-                        else
-                        {
-                            strcpy(errorStr, "index out of range");
-                            retval &= false;
-                        }
-                    }
-                    else
-                    {
-                        strcpy(errorStr, "subscript error: dim of the number array does not equal the qty of indeces parsed");
-                        retval &= false;
-                    }
+            // binary operators replace the left operand, num[-2], with the result of it and the right one, num[-1]
+            case OC_AND:
+                num--;
+                num[-1].i = IsTrue(&num[-1]) && IsTrue(&num[0]);
+                num[-1].isInt = true;
+                break;
+                
+            case OC_OR:
+                num--;
+                num[-1].i = IsTrue(&num[-1]) || IsTrue(&num[0]);
+                num[-1].isInt = true;
+                break;
+                
+            case OC_XOR:
+                num--;
+                num[-1].i = NUM_INT(num[-1]) ^ NUM_INT(num[0]);
+                num[-1].isInt = true;
+                break;
+                
+            case OC_EQ:
+                num--;
+                if (num[-1].isInt && num[0].isInt)
+                {
+                    num[-1].i = num[-1].i == num[0].i;
                 }
+                else
+                {
+                    cmp = CompareNumbers(&num[-1], &num[0]);
+                    num[-1].i = (cmp == 0);
+                    num[-1].isInt = true;
+                }
+                break;
                 
-                // process scalar
-                else if ((retval = SymReadNumvar(NODE_VAL_VARSYM(node), indeces, &numval)))
+            case OC_NE:
+                num--;
+                if (num[-1].isInt && num[0].isInt)
                 {
-                    NumStackPush(numval);
+                    num[-1].i = num[-1].i != num[0].i;
+                }
+                else
+                {
+                    cmp = CompareNumbers(&num[-1], &num[0]);
+                    num[-1].i = (cmp != 0);
+                    num[-1].isInt = true;
                 }
-
                 break;
-
-            case NT_STRVAR:         
-                // process vector
-                if (SYM_DIM(NODE_VAL_VARSYM(node)) > 0)
+                
+            case OC_GT:
+                num--;
+                if (num[-1].isInt && num[0].isInt)
                 {
-                    int indexQty = 0;
-                    
-                    // push the indeces onto the stack
-                    for (Node *next = node->bro; next; next = next->bro)
-                    {
-                        // args are expressions which could be empty so only process non-empty arg expressions
-                        if (next->son)
-                        {
-                            TraverseSyntaxTree(next);
-                            indexQty++;
-                        }
-                    }
+                    num[-1].i = num[-1].i > num[0].i;
+                }
+                else
+                {
+                    cmp = CompareNumbers(&num[-1], &num[0]);
+                    num[-1].i = (cmp == 1);
+                    num[-1].isInt = true;
+                }
+                break;
                 
-                    // check that the dim of the array equals the qty of indeces parsed
-                    if (SYM_DIM(NODE_VAL_VARSYM(node)) == indexQty)
-                    {                
-                        // build the index list from the num stack in reverse order
-                        for (int i = 0; i < SYM_DIM(NODE_VAL_VARSYM(node)); i++)
-                        {
-                            indeces[DIM_MAX-1 - i] = (int)NumStackPop();
-                        }
-                        if ((retval = SymReadStrvar(NODE_VAL_VARSYM(node), indeces, &strval)))
-                        {
-                            StrStackPush(strval);
-                        }
-                        else
-                        {
-                            strcpy(errorStr, "index out of range");
-                            retval &= false;
-                        }
-                    }
-                    else
-                    {
-                        strcpy(errorStr, "subscript error: dim of the string array does not equal the qty of indeces parsed");
-                        retval &= false;
-                    }
+            case OC_GE:
+                num--;
+                if (num[-1].isInt && num[0].isInt)
+                {
+                    num[-1].i = num[-1].i >= num[0].i;
                 }
-
-                // process scalar
-                else if ((retval = SymReadStrvar(NODE_VAL_VARSYM(node), indeces, &strval)))
+                else
                 {
-                    StrStackPush(strval);
+                    cmp = CompareNumbers(&num[-1], &num[0]);
+                    num[-1].i = (cmp == 1 || cmp == 0);
+                    num[-1].isInt = true;
                 }
-
                 break;
                 
-            case NT_FCT:
+            case OC_LT:
+                num--;
+                if (num[-1].isInt && num[0].isInt)
                 {
-                    int indexQty = 0;
-                    
-                    // push the args onto the stack
-                    for (Node *next = node->bro; next; next = next->bro)
-                    {
-                        // args are expressions which could be empty so only process non-empty arg expressions
-                        if (next->son)
-                        {
-                            TraverseSyntaxTree(next);
-                            indexQty++;
-                        }
-                    }
-                    
-                    // check that the arity of the function equals the qty of args parsed
-                    if (SYM_DIM(NODE_VAL_VARSYM(node)) == indexQty)
-                    {                
-                        // exec the builtin fct which will put the result on the stack
-                        retval = ExecBuiltinFct(SYM_NAME(NODE_VAL_VARSYM(node)));
-                    }
-                    else
-                    {
-                        strcpy(errorStr, "incorrect number of arguments for builtin function");
-                        retval &= false;
-                    }
+                    num[-1].i = num[-1].i < num[0].i;
+                }
+                else
+                {
+                    cmp = CompareNumbers(&num[-1], &num[0]);
+                    num[-1].i = (cmp == -1);
+                    num[-1].isInt = true;
+                }
+                break;
+                
+            case OC_LE:
+                num--;
+                if (num[-1].isInt && num[0].isInt)
+                {
+                    num[-1].i = num[-1].i <= num[0].i;
+                }
+                else
+                {
+                    cmp = CompareNumbers(&num[-1], &num[0]);
+                    num[-1].i = (cmp == -1 || cmp == 0);
+                    num[-1].isInt = true;
                 }
                 break;
                 
-            case NT_EXPR:
-                TraverseSyntaxTree(node->son);
+            case OC_SL:
+                num--;
+                num[-1].i = (int32_t)((uint32_t)NUM_INT(num[-1]) << (NUM_INT(num[0]) & 31));
+                num[-1].isInt = true;
                 break;
-
-            default:
+                
+            case OC_SR:
+                num--;
+                num[-1].i = NUM_INT(num[-1]) >> (NUM_INT(num[0]) & 31);
+                num[-1].isInt = true;
+                break;
+                
+            case OC_ADD:
+                num--;
+                AddNumbers(&num[-1], &num[0]);
+                break;
+                
+            case OC_SUB:
+                num--;
+                SubNumbers(&num[-1], &num[0]);
                 break;
+                
+            case OC_MUL:
+                num--;
+                MulNumbers(&num[-1], &num[0]);
+                break;
+                
+            // an int quotient only if there's no remainder
+            case OC_DIV:
+                num--;
+                if (num[-1].isInt && num[0].isInt && num[0].i != 0 && !(num[-1].i == INT32_MIN && num[0].i == -1) &&
+                    num[-1].i % num[0].i == 0)
+                {
+                    num[-1].i /= num[0].i;
+                }
+                else
+                {
+                    num[-1].f = NUM_FLOAT(num[-1]) / NUM_FLOAT(num[0]);
+                    num[-1].isInt = false;
+                }
+                break;
+                
+            // NOTE: the modulus operates on ints
+            case OC_MOD:
+                num--;
+                if (NUM_INT(num[0]) == 0)
+                {
+                    strcpy(errorStr, "division by zero");
+                    return false;
+                }
+                num[-1].i = (NUM_INT(num[0]) == -1) ? 0 : NUM_INT(num[-1]) % NUM_INT(num[0]);
+                num[-1].isInt = true;
+                break;
+                
+            // unary operators replace the top of the stack
+            case OC_NEG:
+                if (num[-1].isInt && num[-1].i != INT32_MIN)
+                {
+                    num[-1].i = -num[-1].i;
+                }
+                else
+                {
+                    num[-1].f = -NUM_FLOAT(num[-1]);
+                    num[-1].isInt = false;
+                }
+                break;
+                
+            case OC_COMPL:
+                num[-1].i = ~NUM_INT(num[-1]);
+                num[-1].isInt = true;
+                break;
+                
+            case OC_NOT:
+                num[-1].i = !IsTrue(&num[-1]);
+                num[-1].isInt = true;
+                break;
+                
+            default:
+                strcpy(errorStr, "invalid expression code");
+                return false;
         }
     }
-    
-    return retval;
-}
-
-
-// STACKS
-// TODO: add call stack push/pop functions
-
-// number stack functions
-float NumStackPush(float a)
-{
-    if (numSP < STACK_SIZE)
-    {
-        numStack[numSP++] = a;
-        return a;
-    }
-    Panic("num stack overflow in NumStackPush\n");
-    return 0;
-}
-float NumStackPop(void)
-{
-    if (numSP > 0)
-    {
-        return numStack[--numSP];
-    }
-    Panic("num stack underflow in NumStackPop\n");
-    return 0;
-} 
-float NumStackTop(void)
-{
-    if (numSP > 0)
-    {
-        return numStack[numSP-1];
-    }
-    Panic("num stack underflow in NumStackTop()\n");
-    return 0;
-} 
-float NumStackPut(float a)
-{
-    if (numSP > 0)
-    {
-        numStack[numSP-1] = a;
-        return a;
-    }
-    Panic("num stack underflow in NumStackPut()\n");
-    return 0;
-}
-
-// string stack functions
-char *StrStackPush(char *a)
-{
-    if (strSP < STACK_SIZE)
-    {
-        strStack[strSP++] = a;
-        return a;
-    }
-    Panic("num stack overflow in StrStackPush\n");
-    return 0;
-}
-char *StrStackPop(void)
-{
-    if (strSP > 0)
-    {
-        return strStack[--strSP];
-    }
-    Panic("num stack underflow in StrStackPop\n");
-    return NULL;
-} 
-char *StrStackTop(void)
-{
-    if (strSP > 0)
-    {
-        return strStack[strSP-1];
-    }
-    Panic("num stack underflow in StrStackTop()\n");
-    return NULL;
-} 
-char *StrStackPut(char *a)
-{
-    if (strSP > 0)
-    {
-        strStack[strSP-1] = a;
-        return a;
-    }
-    Panic("num stack underflow in StrStackPut()\n");
-    return NULL;
 }
 
 
@@ -1723,18 +1766,76 @@ Command *IterateCmdPtr(bool cmdListOnly)
 // convert a line number to a program index
 bool LineNum2CmdLineIdx(int lineNum)
 {
-    for (int i = 0; i < programSize; i++)
+    CommandLine *line = FindCommandLine(lineNum);
+    
+    if (line)
     {
-        if (Program[i].lineNum == lineNum)
-        {
-            cmdListIdx = i;
-            return true;
-        }
+        cmdListIdx = line - Program;
+        return true;
     }
     
     return false;
 }
 
+// binary search of the program, which is sorted by line number, for a command line
+CommandLine *FindCommandLine(int lineNum)
+{
+    int lo = 0, hi = programSize - 1, mid;
+    
+    while (lo <= hi)
+    {
+        mid = (lo + hi) / 2;
+        if (Program[mid].lineNum < lineNum)
+            lo = mid + 1;
+        else if (Program[mid].lineNum > lineNum)
+            hi = mid - 1;
+        else
+            return &Program[mid];
+    }
+    
+    return NULL;
+}
+
+// bind the constant destinations of gotos and gosubs and the lines of fors in a command list to their command lines
+static void BindCommandList(Command *cmd, CommandLine *line)
+{
+    float dest;
+    
+    for (; cmd; cmd = cmd->next)
+    {
+        switch (cmd->type)
+        {
+            case CT_GOTO:
+                cmd->cmd.gotoCmd.destLine = NULL;
+                if (IsConstantExpr(cmd->cmd.gotoCmd.dest, &dest) && dest > 0)
+                    cmd->cmd.gotoCmd.destLine = FindCommandLine((int)dest);
+                break;
+            case CT_GOSUB:
+                cmd->cmd.gosubCmd.destLine = NULL;
+                if (IsConstantExpr(cmd->cmd.gosubCmd.dest, &dest) && dest > 0)
+                    cmd->cmd.gosubCmd.destLine = FindCommandLine((int)dest);
+                break;
+            case CT_FOR:
+                cmd->cmd.forCmd.line = line;
+                break;
+            case CT_IF:
+                BindCommandList(cmd->cmd.ifCmd.commandList, line);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+// bind the program once it's edited, as sorting it moves its command lines
+void BindProgram(void)
+{
+    for (int i = 0; i < programSize; i++)
+    {
+        BindCommandList(Program[i].commandList, &Program[i]);
+    }
+}
+
 void SwapProgLines(int progIdxA, int progIdxB) 
 { 
     // copy a to temp, b to a, then temp to b
@@ -4,8 +4,10 @@
 
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <inttypes.h>
+#include <time.h>
 #include "symtab.h"
 #include "expr.h"
 #include "parser.h"
@@ -13,10 +15,10 @@
 
 #define VGA_ROW_MAX         39
 #define VGA_COL_MAX         79
-typedef char VGA_DISPLAY_BUFFER[VGA_ROW_MAX][VGA_COL_MAX];
+typedef char VGA_DISPLAY_BUFFER[VGA_ROW_MAX+1][VGA_COL_MAX+1];
 
 char message[80];
-char *versionStr = "v4.0";
+char *versionStr = "v5.4";
 char *promptStr = "> ";
 char frameBuf[40][80];
 
@@ -275,10 +277,155 @@ char *NodeTypeStr(enum NodeType type)
     return "unknown type";
 }
 
-int main(void)
+// jump benchmark, a loop with a GOSUB, RETURN, computed GOTO, constant GOTOs and NEXTs at the end of
+// a program padded with REMs to nearly its max length
+#define JUMP_LOOPS          10000
+#define JUMPS_PER_LOOP      12
+#define JUMP_PADDING_LINES  80      // lines 100 to 890
+
+char *jumpBenchmark[] = {
+    "10 n = 0 : t = 970",
+    "20 goto 900",
+    "900 gosub 980",
+    "910 goto t",
+    "920 for i = 1 to 8",
+    "930 s = i",
+    "940 next i",
+    "950 n = n + 1",
+    "960 if n < loops then goto 900",
+    "965 end",
+    "970 goto 920",
+    "980 return"
+};
+
+// array benchmark, nested FORs writing then reading each element of a 2D array, as tests/completeness/arrays.bas
+#define ARRAY_PASSES        100
+#define ARRAY_ROWS          20
+#define ARRAY_COLS          30
+
+char *arrayBenchmark[] = {
+    "10 dim a(rows,cols)",
+    "20 for p = 1 to passes",
+    "30 for r = 0 to rows-1",
+    "40 for c = 0 to cols-1",
+    "50 a(r,c) = r + c",
+    "60 next c",
+    "70 next r",
+    "80 s = 0",
+    "90 for r = 0 to rows-1",
+    "100 for c = 0 to cols-1",
+    "110 s = s + a(r,c)",
+    "120 next c",
+    "130 next r",
+    "140 next p"
+};
+
+// enter the lines of a benchmark program
+void LoadBenchmark(char *lines[], int qty)
+{
+    char command[80];
+    
+    InstallBuiltinFcts();
+    for (int i = 0; i < qty; i++)
+    {
+        strcpy(command, lines[i]);
+        ProcessCommand(command);
+    }
+}
+
+// run a benchmark program and return its run time in seconds, or -1 if it fails
+double RunBenchmark(void)
+{
+    char command[80];
+    clock_t start = clock();
+    
+    strcpy(command, "run");
+    if (!ProcessCommand(command))
+    {
+        printf("%s\n", errorStr);
+        return -1;
+    }
+    
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+// run the jump benchmark and report the jumps per second
+int JumpBenchmark(long loops)
+{
+    char command[80];
+    double seconds;
+    long jumps = JUMPS_PER_LOOP * loops;        // and the goto 900 but no jump back after the last loop
+    
+    // the loop tests its count at the end, so it runs at least once
+    if (loops < 1)
+    {
+        printf("the jump benchmark needs at least 1 loop\n");
+        return 1;
+    }
+    
+    LoadBenchmark(jumpBenchmark, sizeof jumpBenchmark / sizeof jumpBenchmark[0]);
+    sprintf(command, "loops = %ld", loops);
+    ProcessCommand(command);
+    for (int i = 0; i < JUMP_PADDING_LINES; i++)
+    {
+        sprintf(command, "%d rem", 100 + 10 * i);
+        ProcessCommand(command);
+    }
+    
+    if ((seconds = RunBenchmark()) < 0)
+    {
+        return 1;
+    }
+    printf("%ld jumps in %.3f s, %.0f jumps/s\n", jumps, seconds, seconds > 0 ? jumps / seconds : 0);
+    
+    return 0;
+}
+
+// run the array benchmark and report the array element reads and writes per second
+int ArrayBenchmark(long passes)
+{
+    char command[80];
+    double seconds;
+    long accesses = 2L * ARRAY_ROWS * ARRAY_COLS * passes;
+    Symbol *sum;
+    
+    LoadBenchmark(arrayBenchmark, sizeof arrayBenchmark / sizeof arrayBenchmark[0]);
+    sprintf(command, "passes = %ld : rows = %d : cols = %d", passes, ARRAY_ROWS, ARRAY_COLS);
+    ProcessCommand(command);
+    
+    if ((seconds = RunBenchmark()) < 0)
+    {
+        return 1;
+    }
+    
+    // the sum of r + c over the array
+    sum = SymFind("s");
+    if (passes > 0 && (!sum || NUM_FLOAT(SYM_NUMVAL(sum)) != ARRAY_ROWS * ARRAY_COLS * (ARRAY_ROWS + ARRAY_COLS - 2) / 2))
+    {
+        printf("wrong sum of the array elements\n");
+        return 1;
+    }
+    printf("%ld array accesses in %.3f s, %.0f accesses/s\n", accesses, seconds, seconds > 0 ? accesses / seconds : 0);
+    
+    return 0;
+}
+
+int main(int argc, char *argv[])
 {
     char command[80]; 
 
+    // basic_simulator -j [loops] runs the jump benchmark
+    if (argc > 1 && !strcmp(argv[1], "-j"))
+    {
+        return JumpBenchmark(argc > 2 ? atol(argv[2]) : JUMP_LOOPS);
+    }
+    
+    // basic_simulator -a [passes] runs the array benchmark
+    if (argc > 1 && !strcmp(argv[1], "-a"))
+    {
+        return ArrayBenchmark(argc > 2 ? atol(argv[2]) : ARRAY_PASSES);
+    }
+    
     InstallBuiltinFcts();
     InitDisplay();    
     while (1)
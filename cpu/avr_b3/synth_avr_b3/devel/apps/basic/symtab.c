@@ -6,6 +6,7 @@
 #include <string.h>
 #include <stdbool.h>
 #include <inttypes.h>
+#include <limits.h>
 #include <stdio.h>
 #include "symtab.h"
 #include "lexer.h"
@@ -13,11 +14,6 @@
 
 extern void Panic(const char *message);
 
-#define SYM_NUMVAL(symbol)              ((symbol)->scalerVal.numval)
-#define SYM_NUMVAL_IDX(symbol, index)   ((symbol)->vectorVal.numvals[(index)])
-#define SYM_STRVAL(symbol)              ((symbol)->scalerVal.strval)
-#define SYM_STRVAL_IDX(symbol, index)   ((symbol)->vectorVal.strvals[(index)])
-
 extern char errorStr[];
 char *emptyStr = "";
 
@@ -132,10 +128,7 @@ bool SymLookup(int token)
             }
             lexval.lexsym = SymCreate(tokenStr);
             lexval.lexsym->type = ST_NUMVAR;
-            for (int i = 0; i < ARRAY_MAX; i++)
-            {
-                lexval.lexsym->value.numvals[i] = 0;
-            }
+            lexval.lexsym->value.numval.isInt = true;
             break;
         case Strvar:
             if ((lexval.lexsym = SymFind(tokenStr)))
@@ -144,10 +137,7 @@ bool SymLookup(int token)
             }
             lexval.lexsym = SymCreate(tokenStr);
             lexval.lexsym->type = ST_STRVAR;
-            for (int i = 0; i < ARRAY_MAX; i++)
-            {
-                lexval.lexsym->value.strvals[i] = emptyStr;
-            }
+            lexval.lexsym->value.strval = emptyStr;
             break;
         case Function:
             if ((lexval.lexsym = SymFind(tokenStr)))
@@ -164,13 +154,74 @@ bool SymLookup(int token)
     return true; 
 }
 
+static bool IsArray(Symbol *symbol)
+{
+    // the dim of a fct is its arity
+    return symbol->type != ST_FCT && symbol->dim > 0;
+}
+
 void FreeSymbol(Symbol *symbol)
 {
     if (symbol->next)
         FreeSymbol(symbol->next);
+    if (IsArray(symbol))
+        free(symbol->value.numvals);
     free(symbol);
 }
 
+// make a variable an array of dim dimensions when its DIM is parsed, its elements are allocated when the DIM is run
+void SymSetDim(Symbol *varsym, int dim)
+{
+    if (IsArray(varsym))
+    {
+        free(varsym->value.numvals);
+    }
+    varsym->value.numvals = NULL;
+    varsym->dim = dim;
+}
+
+// set the strides of an array from its dim sizes and allocate its elements, which are int 0's or empty strings,
+// freeing those of a previous DIM
+bool SymConvertToArray(Symbol *varsym)
+{
+    size_t elementSize = (varsym->type == ST_STRVAR) ? sizeof(char *) : sizeof(Number);
+    long size = 1;
+    
+    free(varsym->value.numvals);
+    varsym->value.numvals = NULL;
+    
+    // the stride of a dimension is the product of the sizes of the dimensions after it
+    for (int i = varsym->dim - 1; i >= 0; i--)
+    {
+        if (varsym->dimSizes[i] < 1)
+        {
+            strcpy(errorStr, "invalid dim size");
+            return false;
+        }
+        varsym->strides[i] = size;
+        size *= varsym->dimSizes[i];
+        if (size > INT_MAX)
+        {
+            break;
+        }
+    }
+    if (size > INT_MAX || (unsigned long)size > SIZE_MAX / elementSize ||
+        (varsym->value.numvals = calloc(size, elementSize)) == NULL)
+    {
+        strcpy(errorStr, "not enough memory for the array");
+        return false;
+    }
+    for (int i = 0; i < size; i++)
+    {
+        if (varsym->type == ST_STRVAR)
+            varsym->value.strvals[i] = emptyStr;
+        else
+            varsym->value.numvals[i].isInt = true;
+    }
+    
+    return true;
+}
+
 void FreeSymtab(void)
 {
     if (symtab)
@@ -178,95 +229,103 @@ void FreeSymtab(void)
     symtab = NULL;
 }
 
-// linearize the indeces into a 1D array
-//   - the array is dimensioned as a(O,P,M,N)
-//   - the array is referenced as a(o,p,m,n)
-//   - the 1D index is calculated as follows:
-//       - index = o*(P*M*N) + p*(M*N) + m*N + n
-//   - dimSizes contain the dimensioned values:
-//       - O = dimSizes[0], P = dimSizes[1], M = dimSizes[2], N = dimSizes[3], 
-//   - using the indeces array:
-//       - o = indeces[0], p = indeces[1], m = indeces[2], n = indeces[3]
-//   - using these definitions, the resulting 1D index is:
-//       - (the sum from i = 0 to 2 of indeces[i] * dimSizes[i+1]) + indeces[3]
-int CalcVarIndex(Symbol *varsym, float indeces[4])
+// an array has elements once its DIM is run
+static bool IsDimmed(Symbol *varsym)
+{
+    if (varsym->value.numvals == NULL)
+    {
+        strcpy(errorStr, "array used before its DIM");
+        return false;
+    }
+    
+    return true;
+}
+
+// linearize the indeces of an array element into the index of the element
+//   - the array is dimensioned as a(O,P,M,N), dimSizes = {O,P,M,N}
+//   - the element a(o,p,m,n) is at o*(P*M*N) + p*(M*N) + m*N + n
+//   - so the strides are {P*M*N,M*N,N,1}, set by SymConvertToArray when the DIM is run
+// the indeces are truncated to ints, a scaler ignores them and its index is 0
+int SymIndex(Symbol *varsym, Number *indeces, int qty)
 {
     int index = 0, i;
+    int32_t n;
     
-    if (SYM_DIM(varsym) > 0)
+    if (varsym->dim > 0)
     {    
-        // test for indeces in range
-        for (i = 0; i < DIM_MAX; i++)
+        // check that the dim of the array equals the qty of indeces parsed
+        if (varsym->dim != qty)
+        {
+            if (varsym->type == ST_NUMVAR)
+                strcpy(errorStr, "subscript error: number array dim does not equal the index qty");
+            else
+                strcpy(errorStr, "subscript error: string array dim does not equal the index qty");
+            return -1;
+        }
+        if (!IsDimmed(varsym))
+        {
+            return -1;
+        }
+        
+        for (i = 0; i < qty; i++)
         {
-            if (indeces[i] != 0)
+            n = NUM_INT(indeces[i]);
+            if (n < 0 || n >= varsym->dimSizes[i])
             {
-                if (indeces[i] >= SYM_DIMSIZES(varsym, i))
-                {
-                    strcpy(errorStr, "index out of range");
-                    return -1;
-                }
+                strcpy(errorStr, "index out of range");
+                return -1;
             }
+            index += n * varsym->strides[i];
         }
-        
-        // TODO: need to come up with an algorithm for this
-        // transform n-dim indeces to 1D index
-        index += indeces[0] * SYM_DIMSIZES(varsym, 1) *SYM_DIMSIZES(varsym, 2) * SYM_DIMSIZES(varsym, 3);
-        index += indeces[1] * SYM_DIMSIZES(varsym, 2) *SYM_DIMSIZES(varsym, 3);
-        index += indeces[2] * SYM_DIMSIZES(varsym, 3);
-        index += indeces[3];
     }
     
     return index;
 }
 
-bool SymReadNumvar(Symbol *varsym, float indeces[4], float *value)
+bool SymReadNumvar(Symbol *varsym, int index, Number *value)
 {
-    int index = CalcVarIndex(varsym, indeces);
-    
-    if (index == -1)
-    {
+    if (SYM_DIM(varsym) == 0)
+        *value = varsym->value.numval;
+    else if (IsDimmed(varsym))
+        *value = varsym->value.numvals[index];
+    else
         return false;
-    }
-    *value = varsym->value.numvals[index];
     
     return true;
 }
 
-bool SymWriteNumvar(Symbol *varsym, float indeces[4], float value)
+bool SymWriteNumvar(Symbol *varsym, int index, Number value)
 {
-    int index = CalcVarIndex(varsym, indeces);
-    
-    if (index == -1)
-    {
+    if (SYM_DIM(varsym) == 0)
+        varsym->value.numval = value;
+    else if (IsDimmed(varsym))
+        varsym->value.numvals[index] = value;
+    else
         return false;
-    }
-    varsym->value.numvals[index] = value;
     
     return true;
 }
 
-bool SymReadStrvar(Symbol *varsym, float indeces[4], char **value)
+bool SymReadStrvar(Symbol *varsym, int index, char **value)
 {
-    int index = CalcVarIndex(varsym, indeces);
-    
-    if (index == -1)
-    {
+    if (SYM_DIM(varsym) == 0)
+        *value = varsym->value.strval;
+    else if (IsDimmed(varsym))
+        *value = varsym->value.strvals[index];
+    else
         return false;
-    }
-    *value = varsym->value.strvals[index];
     
     return true;
 }
 
-bool SymWriteStrvar(Symbol *varsym, float indeces[4], char *value)
+bool SymWriteStrvar(Symbol *varsym, int index, char *value)
 {
-    int index = CalcVarIndex(varsym, indeces);
-    
-    if (index == -1)
-    {
+    if (SYM_DIM(varsym) == 0)
+        varsym->value.strval = value;
+    else if (IsDimmed(varsym))
+        varsym->value.strvals[index] = value;
+    else
         return false;
-    }
-    varsym->value.strvals[index] = value;
     
     return true;
 }
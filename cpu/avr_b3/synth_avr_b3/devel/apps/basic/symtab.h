@@ -3,12 +3,37 @@
  */
 
 #define DIM_MAX 4
-#define ARRAY_MAX 100
 
 #define SYM_NAME(symbol)                ((symbol)->name)
 #define SYM_TYPE(symbol)                ((symbol)->type)
 #define SYM_DIM(symbol)                 ((symbol)->dim)
 #define SYM_DIMSIZES(symbol, index)     ((symbol)->dimSizes[(index)])
+#define SYM_STRIDES(symbol, index)      ((symbol)->strides[(index)])
+#define SYM_NUMVAL(symbol)              ((symbol)->value.numval)
+#define SYM_STRVAL(symbol)              ((symbol)->value.strval)
+
+// a number is an int, which is run with integer arithmetic, until an operation needs a float
+typedef struct Number {
+    bool isInt;
+    union
+    {
+        int32_t i;
+        float f;
+    };
+} Number;
+#define NUM_FLOAT(num)                  ((num).isInt ? (float)(num).i : (num).f)
+#define NUM_INT(num)                    ((num).isInt ? (num).i : FloatToInt((num).f))
+
+// a float truncated to an int, clamped to the range of an int and 0 for a NaN, as the cast alone is undefined
+static inline int32_t FloatToInt(float f)
+{
+    if (f >= 2147483648.0f)
+        return INT32_MAX;
+    if (f < -2147483648.0f)
+        return INT32_MIN;
+
+    return (f == f) ? (int32_t)f : 0;
+}
 
 enum SYMTYPE {ST_NUMVAR, ST_STRVAR, ST_FCT};
 typedef struct Symbol
@@ -17,22 +42,27 @@ typedef struct Symbol
     enum SYMTYPE type;
     union
     {
-        float numvals[ARRAY_MAX];
-        char *strvals[ARRAY_MAX];
+        Number numval;          // a scalar is stored in the symbol
+        char *strval;
+        Number *numvals;        // an array is allocated to its size by DIM, NULL until then
+        char **strvals;
     } value;
-    float dim;                  // the dimension of an array, e.g. dim a(2,3,4) dim = 3, or arity of a fct
-    float dimSizes[DIM_MAX];    // the size of each array dimension, e.g. dim a(2,3,4) dimSizes = {2,3,4,0}, or fct arg values
+    int dim;                    // the dimension of an array, e.g. dim a(2,3,4) dim = 3, or arity of a fct
+    int dimSizes[DIM_MAX];      // the size of each array dimension, e.g. dim a(2,3,4) dimSizes = {2,3,4,0}
+    int strides[DIM_MAX];       // the elements from one index of each dimension to the next, e.g. {12,4,1,0}
     struct Symbol *next;
 } Symbol;
 
 bool SymLookup(int token);
 Symbol *SymFind(const char *name);
-bool SymConvertToArray(Symbol *varsym, int size);
+void SymSetDim(Symbol *varsym, int dim);
+bool SymConvertToArray(Symbol *varsym);
+int SymIndex(Symbol *varsym, Number *indeces, int qty);
 void FreeSymtab(void);
-bool SymReadNumvar(Symbol *varsym, float indeces[4], float *value);
-bool SymWriteNumvar(Symbol *varsym, float indeces[4], float value);
-bool SymReadStrvar(Symbol *varsym, float indeces[4], char **value);
-bool SymWriteStrvar(Symbol *varsym, float indeces[4], char *value);
+bool SymReadNumvar(Symbol *varsym, int index, Number *value);
+bool SymWriteNumvar(Symbol *varsym, int index, Number value);
+bool SymReadStrvar(Symbol *varsym, int index, char **value);
+bool SymWriteStrvar(Symbol *varsym, int index, char *value);
 
 #ifdef DEBUG_ALLOCS
 void *LocalCalloc(size_t nmemb, size_t size);
@@ -18,8 +18,18 @@ always @(posedge clk) begin
 	if (mem_ce) data_read <= flash_array[mem_a];
 end
 
+// a Verilated build can name another flash file with +flash=<file>
+`ifdef VERILATOR
+reg [8*256-1:0] init_file;
+initial begin
+	if (!$value$plusargs("flash=%s", init_file))
+		init_file = flash_file;
+	$readmemh(init_file, flash_array);
+end
+`else
 initial begin
 	$readmemh(flash_file, flash_array);
 end
+`endif
 
 endmodule
@@ -59,10 +59,123 @@ module ALU(A, B, carry, aluop, Y);
 
 endmodule
 
+// barrel shifter operations
+`define SH_ASL      2'h0
+`define SH_LSR      2'h1
+`define SH_ASR      2'h2
+
+
+/*
+ *  Barrel shifter, shifts A by 0 to 15 bits in one clock.  A count of 16 or more
+ *  shifts all the bits out, which leaves 0 or, for asr, the sign in every bit.
+ */
+module SHIFTER(A, count, shiftop, Y);
+
+    input  [15:0] A;        // value to shift
+    input  [15:0] count;    // shift count
+    input  [1:0] shiftop;   // shift operation
+    output reg [15:0] Y;    // result
+
+    wire out = |count[15:4];    // every bit is shifted out
+
+    always @(*)
+        case (shiftop)
+            `SH_ASL:    Y = out ? 16'h0000 : A << count[3:0];
+            `SH_LSR:    Y = out ? 16'h0000 : A >> count[3:0];
+            default:    Y = $signed(A) >>> (out ? 4'hf : count[3:0]);  // the shift by 15 leaves only the sign
+        endcase
+
+endmodule
+
+// multiply/divide unit operations
+`define MD_MUL      2'h0
+`define MD_DIV      2'h1
+`define MD_MOD      2'h2
+
+
+/*
+ *  Signed 16-bit multiply, divide and remainder.  The operands are latched when
+ *  start is asserted and done is set when Y holds the result.  The multiplier is
+ *  a two stage pipeline, the operands are registered and then the product, so it
+ *  maps onto a DSP slice.  The divider is iterative, it divides the magnitudes by
+ *  restoring division, one quotient bit per clock, and then applies the signs.
+ *  As in C the quotient is truncated toward zero and the remainder has the sign
+ *  of the dividend.  A zero divisor gives a zero quotient and the dividend as the
+ *  remainder, the same as the libasm routines.
+ */
+module MULDIV(clk, start, op, A, B, done, Y);
+
+    input  clk;
+    input  start;       // latch the operands and start the operation
+    input  [1:0] op;    // multiply/divide operation
+    input  [15:0] A;    // multiplicand or dividend
+    input  [15:0] B;    // multiplier or divisor
+    output done;        // Y is valid
+    output [15:0] Y;    // result
+
+    reg [4:0] count = 0;    // clocks left
+    reg [1:0] mdop;         // latched operation
+    reg [15:0] ma, mb;      // multiplier operands
+    reg [15:0] product;     // multiplier result
+    reg [15:0] dividend;    // original dividend for a zero divisor
+    reg [15:0] n;           // dividend magnitude, shifted out from the top
+    reg [15:0] d;           // divisor magnitude
+    reg [15:0] q;           // quotient magnitude
+    reg [15:0] r;           // remainder magnitude
+    reg qneg, rneg, dzero;
+
+    // one restoring division step: shift the next dividend bit into the remainder and subtract the divisor
+    wire [16:0] shifted = {r, n[15]};
+    wire [16:0] diff = shifted - {1'b0, d};
+
+    assign done = (count == 0);
+    assign Y = (mdop == `MD_MUL) ? product
+             : (mdop == `MD_DIV) ? (dzero ? 16'h0000 : qneg ? -q : q)
+                                 : (dzero ? dividend : rneg ? -r : r);
+
+    always @(posedge clk)
+        if (start) begin
+            mdop <= op;
+            if (op == `MD_MUL) begin
+                ma <= A;
+                mb <= B;
+                count <= 1;
+            end else begin
+                dividend <= A;
+                n <= A[15] ? -A : A;
+                d <= B[15] ? -B : B;
+                q <= 0;
+                r <= 0;
+                qneg <= A[15] ^ B[15];
+                rneg <= A[15];
+                dzero <= ~|B;
+                count <= 16;
+            end
+        end else if (count != 0) begin
+            count <= count - 1;
+            if (mdop == `MD_MUL)
+                product <= ma * mb;
+            else begin
+                n <= {n[14:0], 1'b0};
+                if (diff[16]) begin
+                    r <= shifted[15:0];
+                    q <= {q[14:0], 1'b0};
+                end else begin
+                    r <= diff[15:0];
+                    q <= {q[14:0], 1'b1};
+                end
+            end
+        end
+
+endmodule
+
 /*
 00000aaa 0++++bbb	operation A + B -> A
 00001aaa 0++++bbb	operation A + [B] -> A
 00011aaa 0++++000	operation A + imm16 -> A
+00100aaa 000oobbb	multiply/divide A * B -> A
+00111aaa 0ss00bbb	shift A << B -> A
+00111aaa 1ss0####	shift A << # -> A
 00101aaa ########	load zero page
 00110aaa ########	store zero page
 01000bbb 00000aaa	store A -> [B]
@@ -90,7 +203,7 @@ module CPU16(clk, reset, hold, busy, address, data_in, data_out, write);
     parameter RAM_WAIT = 1;
 
     reg [15:0] regs[0:7];   // 8 16-bit registers
-    reg [2:0] state;        // CPU state
+    reg [3:0] state;        // CPU state
 
     reg carry = 0;	        // carry flag
     reg zero = 0;	        // zero flag
@@ -116,6 +229,7 @@ module CPU16(clk, reset, hold, busy, address, data_in, data_out, write);
     localparam S_COMPUTE_WAIT       = 5;
     localparam S_COMPUTE_ADDR       = 6;
     localparam S_COMPUTE_SUB_ADDR   = 7;
+    localparam S_MULDIV             = 8;
 
     localparam EP = 4; // eval stack ptr = register 4
     localparam BP = 5; // base ptr = register 5
@@ -132,6 +246,30 @@ module CPU16(clk, reset, hold, busy, address, data_in, data_out, write);
         .carry(carry)
     );
 
+    wire [15:0] shift_Y;    // barrel shifter result
+
+    // the shift count is a register or a 4-bit immediate
+    SHIFTER shifter(
+        .A(regs[rdest]),
+        .count(opcode[7] ? {12'b0, opcode[3:0]} : regs[rsrc]),
+        .shiftop(opcode[6:5]),
+        .Y(shift_Y)
+    );
+
+    wire muldiv_done;       // multiply/divide result is ready
+    wire [15:0] muldiv_Y;   // multiply/divide result
+
+    // the multiply/divide unit starts as the opcode is decoded, with the operand registers still on the bus
+    MULDIV muldiv(
+        .clk(clk),
+        .start(state == S_DECODE && data_in[15:11] == 5'b00100 && data_in[7:5] == 3'b000 && data_in[4:3] != 2'b11),
+        .op(data_in[4:3]),
+        .A(regs[data_in[10:8]]),
+        .B(regs[data_in[2:0]]),
+        .done(muldiv_done),
+        .Y(muldiv_Y)
+    );
+
     // main state machine
     always @(posedge clk)
     if (reset) begin
@@ -188,6 +326,16 @@ module CPU16(clk, reset, hold, busy, address, data_in, data_out, write);
                         aluop <= data_in[6:3];
                     end
                     
+                    //  00100aaa000oobbb	multiply/divide A*B->A, wait for the unit to finish
+                    16'b00100???0000????, 16'b00100???00010???: begin
+                        state <= S_MULDIV;
+                    end
+                    
+                    //  00111aaa0ss00bbb, 00111aaa1ss0####	shift A<<B->A, A<<#->A, the shifter replaces the ALU in S_COMPUTE
+                    16'b00111???00000???, 16'b00111???00100???, 16'b00111???01000???,
+                    16'b00111???1000????, 16'b00111???1010????, 16'b00111???1100????: begin
+                    end
+                    
                     //  11+++aaa########	immediate binary operation
                     16'b11??????????????: begin
                         aluop <= data_in[14:11];
@@ -344,20 +492,37 @@ module CPU16(clk, reset, hold, busy, address, data_in, data_out, write);
             
             // state 3: compute ALU op and flags
             S_COMPUTE: begin
-                // transfer ALU output to destination
-                regs[rdest] <= Y[15:0];
+                if (opcode[15:11] == 5'b00111) begin
+                    // transfer the shifter output to destination, carry is unchanged
+                    regs[rdest] <= shift_Y;
+                    zero <= ~|shift_Y;
+                    neg <= shift_Y[15];
+                end else begin
+                    // transfer ALU output to destination
+                    regs[rdest] <= Y[15:0];
 
-                // set carry for certain operations (4-7,12-15)
-                if (aluop[2]) carry <= Y[16];
-                
-                // set zero flag
-                zero <= ~|Y[15:0];
-                neg <= Y[15];
+                    // set carry for certain operations (4-7,12-15)
+                    if (aluop[2]) carry <= Y[16];
+                    
+                    // set zero flag
+                    zero <= ~|Y[15:0];
+                    neg <= Y[15];
+                end
                 
                 // repeat CPU loop
                 state <= S_SELECT;
             end
 
+            // state 8: wait for the multiply/divide unit then transfer its result like S_COMPUTE, carry is unchanged
+            S_MULDIV: begin
+                if (muldiv_done) begin
+                    regs[rdest] <= muldiv_Y;
+                    zero <= ~|muldiv_Y;
+                    neg <= muldiv_Y[15];
+                    state <= S_SELECT;
+                end
+            end
+
             // state 4: wait 1 cycle for RAM read
             S_DECODE_WAIT: begin
                 state <= S_DECODE;
@@ -386,7 +551,7 @@ module test_CPU16_top(
     output zero,
     output carry,
     output busy,
-    output [2:0] state
+    output [3:0] state
 );
 
     reg [15:0] ram[0:65535];
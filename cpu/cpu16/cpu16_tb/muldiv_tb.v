@@ -0,0 +1,98 @@
+// Force error when implicit net has no type.
+`default_nettype none
+
+/*
+ *  Test bench for the cpu16 multiply/divide unit.  Every operation is checked
+ *  against the Verilog signed operators and the clocks from start to done are
+ *  printed.  They are the S_MULDIV clocks the CPU adds to the 2 clocks of
+ *  S_SELECT and S_DECODE, compare them with the libasm routines:
+ *
+ *      _Multiply   86-283 clocks with the call, 4 with mul
+ *      _Divide     310-502 clocks with the call, 19 with div
+ *      _Modulo     313-505 clocks with the call, 19 with mod
+ *
+ *  "make run NAME_TOP=muldiv" passes if the last line is "muldiv: 0 errors".
+ */
+module muldiv_tb;
+
+    reg clk = 0;
+    reg start = 0;
+    reg [1:0] op;
+    reg [15:0] A, B;
+    wire done;
+    wire [15:0] Y;
+
+    reg [15:0] expected;
+    integer clocks;
+    integer errors = 0;
+
+    MULDIV muldiv(clk, start, op, A, B, done, Y);
+
+    initial
+        forever #1 clk = ~clk;
+
+    // start one operation, wait for it and check the result
+    task check(input [1:0] o, input [15:0] a, input [15:0] b);
+        begin
+            case (o)
+                `MD_MUL: expected = a * b;
+                `MD_DIV: expected = (b == 0) ? 0 : $signed(a) / $signed(b);
+                default: expected = (b == 0) ? $signed(a) : $signed(a) % $signed(b);
+            endcase
+
+            @(negedge clk) begin
+                op = o;
+                A = a;
+                B = b;
+                start = 1;
+            end
+            @(negedge clk) start = 0;
+            clocks = 1;
+            while (!done)
+                @(negedge clk) clocks = clocks + 1;
+
+            if (Y !== expected) begin
+                $display("FAIL: op %0d %0d, %0d = %0d, expected %0d", o, $signed(a), $signed(b), $signed(Y), $signed(expected));
+                errors = errors + 1;
+            end else
+                $display("op %0d %0d, %0d = %0d in %0d clocks", o, $signed(a), $signed(b), $signed(Y), clocks);
+        end
+    endtask
+
+    // all three operations on a pair of operands
+    task check_all(input [15:0] a, input [15:0] b);
+        begin
+            check(`MD_MUL, a, b);
+            check(`MD_DIV, a, b);
+            check(`MD_MOD, a, b);
+        end
+    endtask
+
+    integer i;
+
+    initial begin
+        $dumpfile("muldiv.vcd");
+        $dumpvars(0, muldiv_tb);
+
+        check_all(3, 5);
+        check_all(-3, 5);
+        check_all(3, -5);
+        check_all(-3, -5);
+        check_all(0, 7);
+        check_all(7, 0);
+        check_all(-7, 0);
+        check_all(1234, -567);
+        check_all(30000, 7);
+        check_all(32767, 32767);
+        check_all(-32768, 1);
+        check_all(-32768, -1);
+        check_all(-32768, -32768);
+        check_all(100, -32768);
+        for (i = 0; i < 32; i = i + 1)
+            check_all($random, $random);
+
+        $display("muldiv: %0d errors", errors);
+        $finish;
+    end
+
+endmodule
@@ -0,0 +1,104 @@
+/*
+    Module: CPU16_trace - instruction trace of a CPU16 in a test bench
+
+    Writes each instruction the CPU runs, its IP, its opcode and its clocks,
+    to the binary ring file named with the +trace=<file> plusarg, see
+    "prof16 -t".  +tracering=<records> sets the size of the ring, 65536
+    records by default.  Without +trace nothing is written.  The trace stops
+    at a branch to itself, the end of a program, as sim16 does.
+
+    The file is little endian 32-bit words, as $fwrite "%u" writes them:
+        header: "TR16" (0x36315254), the ring size, the records written, 0
+        record: opcode << 16 | IP, the clocks of the instruction
+    Once the ring is full the oldest record is overwritten.  The header is
+    written again by Close, which the test bench calls before $finish and a
+    Verilated model runs as its final block.
+
+    The ports are connected to the CPU16 inside the system, e.g.
+        CPU16_trace trace(sys.system_clk, sys.cpu.state, sys.hold, sys.cpu_addr, sys.cpu_din);
+*/
+
+module CPU16_trace(clk, state, hold, address, data_in);
+
+    input        clk;                   // CPU clock
+    input  [3:0] state;                 // CPU state
+    input        hold;
+    input [15:0] address;               // CPU address bus
+    input [15:0] data_in;               // CPU data bus
+
+    // CPU states, as in cpu16.v
+    localparam S_SELECT = 1;
+    localparam S_DECODE = 2;
+
+    reg [8*256-1:0] file_name;
+    integer fd = 0;
+    integer ring = 65536;
+    integer records = 0;
+    integer r;
+
+    reg        started = 0;             // an instruction was decoded
+    reg        stopped = 0;             // at a branch to itself
+    reg [15:0] ip;                      // of the instruction being run
+    reg [15:0] opcode;
+    reg [31:0] clocks = 0;
+
+    task WriteHeader;
+        begin
+            r = $fseek(fd, 0, 0);
+            $fwrite(fd, "%u%u%u%u", 32'h36315254, ring, records, 32'h0);
+        end
+    endtask
+
+    task Record;
+        begin
+            if (records != 0 && records % ring == 0)
+                r = $fseek(fd, 16, 0);
+            $fwrite(fd, "%u%u", {opcode, ip}, clocks);
+            records = records + 1;
+        end
+    endtask
+
+    task Close;
+        begin
+            if (fd) begin
+                WriteHeader;
+                $fclose(fd);
+                fd = 0;
+            end
+        end
+    endtask
+
+    initial begin
+        if ($value$plusargs("trace=%s", file_name)) begin
+            r = $value$plusargs("tracering=%d", ring);
+            fd = $fopen(file_name, "wb");
+            WriteHeader;
+        end
+    end
+
+`ifdef VERILATOR
+    final Close;
+`endif
+
+    always @(posedge clk) begin
+        if (fd && !stopped) begin
+            clocks <= clocks + 1;
+
+            // the previous instruction is done when the next one is selected
+            if (state == S_SELECT && !hold) begin
+                if (started)
+                    Record;
+                clocks <= 1;
+            end
+
+            // the opcode is on the data bus and its address on the address bus
+            if (state == S_DECODE) begin
+                stopped <= started && address == ip;
+                started <= 1;
+                ip <= address;
+                opcode <= data_in;
+            end
+        end
+    end
+
+endmodule
@@ -20,6 +20,10 @@ module system16_tb;
     // Instantiate DUT (device under test)
     system16 system16_test(clk, switches, buttons, leds, segments, decimal_point, anode, signal_out);
 
+    // instruction trace, e.g. "vvp system16.vvp +trace=system16.trace", see cpu16_trace.v
+    CPU16_trace trace(system16_test.system_clk, system16_test.cpu.state, system16_test.hold,
+        system16_test.cpu_addr, system16_test.cpu_din);
+
     initial
         forever #1 clk = ~clk;
 
@@ -35,6 +39,7 @@ module system16_tb;
         #4 buttons[0] <= 0;
         #800
 
+        trace.Close;
         $finish;
     end
 
@@ -0,0 +1,45 @@
+/*
+ *  system16_vl.cpp -- Verilator driver for system16
+ *
+ *  Runs the Verilated system16 for a number of board clocks with the ROM, the
+ *  switches, the buttons and a keypad key given on the command line, then
+ *  reports the LEDs, the 7-segment display and the simulation speed.  With -v
+ *  every change of the LEDs is printed as it happens.
+ */
+
+#include "Vsystem16_vl.h"
+#include "harness.h"
+
+int main(int argc, char **argv)
+{
+    Harness<Vsystem16_vl> h(argc, argv, "system16_vl", "rom", "rom.bin");
+    Vsystem16_vl *top = h.top;
+    SevenSeg display;
+    unsigned leds;
+
+    top->sw = h.options.switches;
+    top->btn = h.options.buttons;
+    top->rows = 0xf;
+    top->clk = 0;
+    top->eval();
+    leds = top->led;
+
+    h.StartClock();
+    while (h.cycles < h.options.maxCycles && !h.context.gotFinish())
+    {
+        h.Tick();
+        top->rows = KeypadRows(h.KeyHeld(), top->cols);
+        display.Sample(top->an, top->seg);
+        if (h.options.verbose && top->led != leds)
+            printf("%12llu: leds = %04X\n", (unsigned long long)h.cycles, top->led);
+        leds = top->led;
+    }
+
+    printf("leds    = %04X\n", top->led);
+    display.Print(stdout);
+    h.ReportSpeed(stdout);
+
+    return 0;
+}
+
+// end of system16_vl.cpp
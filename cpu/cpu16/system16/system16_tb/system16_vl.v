@@ -0,0 +1,33 @@
+/*
+ *  system16_vl.v
+ *
+ *  Description:
+ *      Verilator top for system16.  The PmodKYPD port JB is split into the keypad
+ *      rows driven by the harness and the columns it senses, JB[7:4] and JB[3:0].
+ *      The instruction trace is written with the +trace=<file> plusarg, see
+ *      cpu16_trace.v.
+ */
+
+module system16_vl(
+    input  clk,         // 100MHz clock
+    input [15:0] sw,    // switches
+    input [4:0] btn,    // buttons
+    output [15:0] led,  // LEDs
+    output [6:0] seg,   // display segments
+    output dp,          // decimal point
+    output [3:0] an,    // display anode
+    output JA7,         // audio
+    input [3:0] rows,   // PmodKYPD rows
+    output [3:0] cols   // PmodKYPD columns
+);
+
+    wire [7:0] JB;
+
+    assign JB[7:4] = rows;
+    assign cols = JB[3:0];
+
+    system16 sys(clk, sw, btn, led, seg, dp, an, JA7, JB);
+
+    CPU16_trace trace(sys.system_clk, sys.cpu.state, sys.hold, sys.cpu_addr, sys.cpu_din);
+
+endmodule
@@ -0,0 +1,196 @@
+;   muldiv_test.asm
+
+;   This program tests the multiply/divide unit against the libasm routines:
+;    - mul
+;    - div
+;    - mod
+;
+;   The LEDs count the phases, so the -v output of the Verilator driver times them:
+;    1: 16 mul              2: 16 _Multiply calls
+;    3: 16 div              4: 16 _Divide calls
+;    5: 16 mod              6: 16 _Modulo calls
+;    7: the results of 64 operand pairs are compared
+;
+;   The timed operands are 1234 and -567.  Half of the compared pairs have a large
+;   divisor and half have a divisor from -8 to 7, which includes 0.
+;   The test passes if "00" is displayed, the number of mismatches.
+
+#include <system16/system16.asm>
+#include <system16/sys.asm>
+
+.define TIMED_A     0x04d2      ; 1234
+.define TIMED_B     0xfdc9      ; -567
+.define PAIR_QTY    64
+
+.dw opA
+.dw opB
+.dw count
+.dw errors
+
+main:
+    mov     ax,#1               ; phase 1: mul
+    mov     LED_REG,ax
+    mov     cx,#16
+L10:
+    mov     ax,@TIMED_A
+    mov     bx,@TIMED_B
+    mul     ax,bx
+    dec     cx
+    bnz     L10
+
+    mov     ax,#2               ; phase 2: _Multiply
+    mov     LED_REG,ax
+    mov     cx,#16
+L20:
+    mov     ax,@TIMED_A
+    push    ax
+    mov     ax,@TIMED_B
+    push    ax
+    jsr     _Multiply
+    add     sp,#2
+    dec     cx
+    bnz     L20
+
+    mov     ax,#3               ; phase 3: div
+    mov     LED_REG,ax
+    mov     cx,#16
+L30:
+    mov     ax,@TIMED_A
+    mov     bx,@TIMED_B
+    div     ax,bx
+    dec     cx
+    bnz     L30
+
+    mov     ax,#4               ; phase 4: _Divide
+    mov     LED_REG,ax
+    mov     cx,#16
+L40:
+    mov     ax,@TIMED_A
+    push    ax
+    mov     ax,@TIMED_B
+    push    ax
+    jsr     _Divide
+    add     sp,#2
+    dec     cx
+    bnz     L40
+
+    mov     ax,#5               ; phase 5: mod
+    mov     LED_REG,ax
+    mov     cx,#16
+L50:
+    mov     ax,@TIMED_A
+    mov     bx,@TIMED_B
+    mod     ax,bx
+    dec     cx
+    bnz     L50
+
+    mov     ax,#6               ; phase 6: _Modulo
+    mov     LED_REG,ax
+    mov     cx,#16
+L60:
+    mov     ax,@TIMED_A
+    push    ax
+    mov     ax,@TIMED_B
+    push    ax
+    jsr     _Modulo
+    add     sp,#2
+    dec     cx
+    bnz     L60
+
+    mov     ax,#7               ; phase 7: compare
+    mov     LED_REG,ax
+    zero    ax
+    mov     errors,ax
+    mov     opA,ax
+    mov     opB,ax
+    mov     ax,#PAIR_QTY
+    mov     count,ax
+L70:
+    mov     ax,opA              ; next pair of operands
+    add     ax,@0x3d1b
+    mov     opA,ax
+    mov     bx,opB
+    add     bx,@0x0a35
+    xor     bx,ax
+    mov     opB,bx
+    mov     cx,count            ; every other divisor is small
+    lsr     cx
+    bcc     L71
+    and     bx,#0x0f
+    sub     bx,#8
+    mov     opB,bx
+L71:
+    bsr     CheckMul
+    bsr     CheckDiv
+    bsr     CheckMod
+    mov     ax,count
+    dec     ax
+    mov     count,ax
+    bnz     L70
+
+    mov     ax,errors           ; display the mismatches
+    lsr     ax
+    lsr     ax
+    lsr     ax
+    lsr     ax
+    mov     DISPLAY1_REG,ax
+    mov     ax,errors
+    and     ax,#0x0f
+    mov     DISPLAY2_REG,ax
+
+EndMain:
+    bra     EndMain
+
+CheckMul:
+    mov     ax,opA
+    mov     bx,opB
+    mul     ax,bx
+    push    ax                  ; the result of the unit
+    mov     ax,opA
+    push    ax
+    mov     ax,opB
+    push    ax
+    jsr     _Multiply
+    add     sp,#2
+    pop     bx
+    bra     Compare
+
+CheckDiv:
+    mov     ax,opA
+    mov     bx,opB
+    div     ax,bx
+    push    ax                  ; the result of the unit
+    mov     ax,opA
+    push    ax
+    mov     ax,opB
+    push    ax
+    jsr     _Divide
+    add     sp,#2
+    pop     bx
+    bra     Compare
+
+CheckMod:
+    mov     ax,opA
+    mov     bx,opB
+    mod     ax,bx
+    push    ax                  ; the result of the unit
+    mov     ax,opA
+    push    ax
+    mov     ax,opB
+    push    ax
+    jsr     _Modulo
+    add     sp,#2
+    pop     bx
+
+Compare:
+    sub     ax,bx               ; count a mismatch
+    bz      L80
+    mov     ax,errors
+    inc     ax
+    mov     errors,ax
+L80:
+    rts
+
+#include <system16/multiply.asm>
+#include <system16/divide.asm>
+#include <system16/modulo.asm>
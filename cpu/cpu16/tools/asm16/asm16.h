@@ -77,6 +77,22 @@ enum AluOpIds
     OP_SBB
 };
 
+// multiply/divide operator IDs, in the ALU operator field of the multiply/divide format
+enum MulDivOpIds
+{
+    MD_MUL,
+    MD_DIV,
+    MD_MOD
+};
+
+// shift operator IDs of the shift format
+enum ShiftOpIds
+{
+    SH_ASL,
+    SH_LSR,
+    SH_ASR
+};
+
 // one word instruction opcode definitions
 #define REG_OPCODE              0b00000
 #define REG_INDIR_OPCODE        0b00001
@@ -88,6 +104,8 @@ enum AluOpIds
 #define IP_REL_BRANCH_OPCODE    0b10000
 #define IP_REL_CALL_OPCODE      0b10100
 #define REG_CALL_OPCODE         0b01110
+#define MULDIV_OPCODE           0b00100
+#define SHIFT_OPCODE            0b00111
 
 // two word instruction opcode definitions
 #define IMMEDIATE16_OPCODE      0b00011
@@ -118,6 +136,10 @@ enum AluOpIds
 #define INDEX5_SHIFT            3 
 #define BRCOND_MASK             0b0000111100000000
 #define BRCOND_SHIFT            8
+#define SHIFT_OP_MASK           0b0000000001100000
+#define SHIFT_OP_SHIFT          5
+#define SHIFT_IMMED_FLAG        0b0000000010000000
+#define SHIFT_COUNT_MASK        0b0000000000001111
 
 // branch condition definitions
 #define BRCOND_ALLWAYS          0b0000
@@ -127,4 +149,5 @@ enum AluOpIds
 #define BRCOND_ZERO             0b1010
 #define BRCOND_PLUS             0b0100
 #define BRCOND_MINUS            0b1100
+#define BRCOND_INVERT           0b1000      // inverts a condition other than always
 
@@ -16,9 +16,9 @@ extern FILE* yyout;
 #define NAME(x)     (((struct Symbol *)x)->s_name)
 #define VALUE(x)     (((struct Symbol *)x)->s_value)
 
-extern int asm_pass;
 extern unsigned short cur_addr;
 extern int verbose;
+extern int objOnly;
 
 unsigned char regId, srcReg, destReg, aluop, immed8, brcond;
 unsigned short instr;
@@ -59,6 +59,10 @@ unsigned short instr;
 %token SUB
 %token ADC
 %token SBB
+%token ASR
+%token MUL
+%token DIV
+%token MOD
 %token PUSH
 %token PUSHE
 %token POP
@@ -87,24 +91,18 @@ unsigned short instr;
 %token DEFINE_ZPWORD;
 %token DEFINE_STORAGE;
 
+%type <y_num> mov_direct_instr
+
 %%
 
 program
     :   commands
         {
-            if (asm_pass == 1)
+            if (verbose)
             {
-                if (verbose)
-                {
-                    fprintf(stdout, "last instruction address = 0x%04X\n", cur_addr);
-                    fprintf(stdout, "...pass 1 complete\n");
-                }
+                fprintf(stdout, "last instruction address = 0x%04X\n", cur_addr);
+                fprintf(stdout, "...parse complete\n");
             }
-            else
-                if (verbose)
-                {
-                    fprintf(stdout, "...pass 2 complete\n");
-                }
         }
 commands
 	: command
@@ -126,24 +124,36 @@ command
             cur_addr++;
             cur_addr++;
         }
+    | mov_direct_instr
+        {
+            cur_addr += $1;
+        }
 
 origin
     : ORIGIN Immediate
         {
-            cur_addr = $2;
+            // ld16 places the code of an object
+            if (objOnly)
+            {
+                yyerror(".org cannot be used in an object");
+                GenErrorCode();     // so that no object is written
+            }
+            else
+            {
+                GenOrigin();
+                cur_addr = $2;
+            }
         }
 
 definition
     : DEFINITION Identifier Immediate
         {
-            if (asm_pass == 1)
+            if (s_define($2, ST_ID, $3))
             {
-                if (s_define($2, ST_ID, $3))
+                ListValue($2);
+                if (verbose)
                 {
-                    if (verbose)
-                    {
-                        fprintf(stdout, "%s is defined as 0x%04X\n", NAME($2), VALUE($2));
-                    }
+                    fprintf(stdout, "%s is defined as 0x%04X\n", NAME($2), VALUE($2));
                 }
             }
         }
@@ -151,14 +161,13 @@ definition
 label
     : Identifier':'
         {
-            if (asm_pass == 1)
+            if (s_define($1, ST_LABEL, cur_addr))
             {
-                if (s_define($1, ST_LABEL, cur_addr))
+                GenLabel($1);
+                ListValue($1);
+                if (verbose)
                 {
-                    if (verbose)
-                    {
-                        fprintf(stdout, "Label %s is at address 0x%04X\n", NAME($1), VALUE($1));
-                    }
+                    fprintf(stdout, "Label %s is at address 0x%04X\n", NAME($1), VALUE($1));
                 }
             }
         }
@@ -166,14 +175,23 @@ label
 zp_word_alloc
     : DEFINE_ZPWORD Identifier
         {
-            if (asm_pass == 1)
+            if (s_alloc_ram($2, ST_ZPRAM_ADDR, 1))
+            {
+                ListValue($2);
+                if (verbose)
+                {
+                    fprintf(stdout, "%s was allocated ZP offset 0x%02X\n", NAME($2), VALUE($2));
+                }
+            }
+        }
+    | DEFINE_ZPWORD Identifier Immediate
+        {
+            if (s_alloc_ram($2, ST_ZPRAM_ADDR, $3))
             {
-                if (s_alloc_ram($2, ST_ZPRAM_ADDR, 1))
+                ListValue($2);
+                if (verbose)
                 {
-                    if (verbose)
-                    {
-                        fprintf(stdout, "%s was allocated ZP offset 0x%02X\n", NAME($2), VALUE($2));
-                    }
+                    fprintf(stdout, "%d words were allocated as %s beginning at ZP offset 0x%02X\n", $3, NAME($2), VALUE($2));
                 }
             }
         }
@@ -181,14 +199,23 @@ zp_word_alloc
 word_alloc
     : DEFINE_WORD Identifier
         {
-            if (asm_pass == 1)
+            if (s_alloc_ram($2, ST_RAM_ADDR, 1))
             {
-                if (s_alloc_ram($2, ST_RAM_ADDR, 1))
+                ListValue($2);
+                if (verbose)
                 {
-                    if (verbose)
-                    {
-                        fprintf(stdout, "%s was allocated address 0x%04X\n", NAME($2), VALUE($2));
-                    }
+                    fprintf(stdout, "%s was allocated address 0x%04X\n", NAME($2), VALUE($2));
+                }
+            }
+        }
+    | DEFINE_WORD Identifier Immediate
+        {
+            if (s_alloc_ram($2, ST_RAM_ADDR, $3))
+            {
+                ListValue($2);
+                if (verbose)
+                {
+                    fprintf(stdout, "%d words were allocated as %s beginning at address 0x%04X\n", $3, NAME($2), VALUE($2));
                 }
             }
         }
@@ -196,14 +223,12 @@ word_alloc
 heap_alloc
     : DEFINE_STORAGE Identifier Immediate
         {
-            if (asm_pass == 1)
+            if (s_alloc_ram($2, ST_HEAP_ADDR, $3))
             {
-                if (s_alloc_ram($2, ST_HEAP_ADDR, $3))
+                ListValue($2);
+                if (verbose)
                 {
-                    if (verbose)
-                    {
-                        fprintf(stdout, "%d words were allocated as %s beginning at address 0x%04X\n", $3, NAME($2), VALUE($2));
-                    }
+                    fprintf(stdout, "%d words were allocated as %s beginning at address 0x%04X\n", $3, NAME($2), VALUE($2));
                 }
             }
         }
@@ -226,6 +251,8 @@ one_word_instr
     | pop_eval_instr
     | rts_instr
     | reg_call_instr
+    | muldiv_instr
+    | shift_instr
 
 
 two_word_instr
@@ -240,403 +267,353 @@ unary_instr
     : unop dreg
         {
             // unary
-            if (asm_pass == 2)
-            {
-                // use the register instruction format with 0 as source reg and specify unary
-                GenRegCode(REG_OPCODE, destReg, aluop, 0, 1);
-            }
+            // use the register instruction format with 0 as source reg and specify unary
+            GenRegCode(REG_OPCODE, destReg, aluop, 0, 1);
         }
     | unop error
 
 reg_instr             
     : binop dreg','sreg
         {
-            if (asm_pass == 2)
-            {
-                // use the register instruction format and specify not unary
-                GenRegCode(REG_OPCODE, destReg, aluop, srcReg, 0);
-            }
+            // use the register instruction format and specify not unary
+            GenRegCode(REG_OPCODE, destReg, aluop, srcReg, 0);
         }
     | MOV dreg','sreg
         {
-            if (asm_pass == 2)
-            {
-                // use the register instruction format and specify not unary
-                GenRegCode(REG_OPCODE, destReg, MOV_ALU_OP, srcReg, 0);
-            }
+            // use the register instruction format and specify not unary
+            GenRegCode(REG_OPCODE, destReg, MOV_ALU_OP, srcReg, 0);
         }
     | error
 
+muldiv_instr
+    : mdop dreg','sreg
+        {
+            // the register instruction format with the multiply/divide opcode
+            GenRegCode(MULDIV_OPCODE, destReg, aluop, srcReg, 0);
+        }
+
+shift_instr
+    : unop dreg','sreg
+        {
+            // asl and lsr by a count use the shift format
+            GenShiftCode(aluop == OP_ASL ? SH_ASL : aluop == OP_LSR ? SH_LSR : -1, destReg, srcReg, 0);
+        }
+    | unop dreg',''#'Immediate
+        {
+            GenShiftCode(aluop == OP_ASL ? SH_ASL : aluop == OP_LSR ? SH_LSR : -1, destReg, $5, 1);
+        }
+    | ASR dreg','sreg
+        {
+            GenShiftCode(SH_ASR, destReg, srcReg, 0);
+        }
+    | ASR dreg',''#'Immediate
+        {
+            GenShiftCode(SH_ASR, destReg, $5, 1);
+        }
+    | ASR dreg
+        {
+            // there is no single bit asr in the ALU
+            GenShiftCode(SH_ASR, destReg, 1, 1);
+        }
+
 reg_indir_instr       
     : binop dreg',''['sreg']'
         {
-            if (asm_pass == 2)
-            {
-                // use the register instruction format and specify not unary
-                GenRegCode(REG_INDIR_OPCODE, destReg, aluop, srcReg, 0);
-            }
+            // use the register instruction format and specify not unary
+            GenRegCode(REG_INDIR_OPCODE, destReg, aluop, srcReg, 0);
         }
     | MOV dreg',''['sreg']'
         {
-            if (asm_pass == 2)
-            {
-                // use the register instruction format and specify not unary
-                GenRegCode(REG_INDIR_OPCODE, destReg, MOV_ALU_OP, srcReg, 0);
-            }
+            // use the register instruction format and specify not unary
+            GenRegCode(REG_INDIR_OPCODE, destReg, MOV_ALU_OP, srcReg, 0);
         }
 
 immediate8_instr          
     : binop dreg',''#'Immediate
         {
-            if (asm_pass == 2)
-            {
-                // use immed8 instruction formaat
-                GenImmed8Code(IMMEDIATE8_OPCODE, aluop, destReg, $5);
-            }
+            // use immed8 instruction formaat
+            GenImmed8Code(IMMEDIATE8_OPCODE, aluop, destReg, $5);
         }
     | binop dreg',''#'Identifier
         {
-            if (asm_pass == 2)
+            if (FixupIdentifier($5, ST_ID, FIX_IMMED8))
             {
-                if (chk_identifier($5, ST_ID))
-                {
-                    // use immed8 instruction format
-                    GenImmed8Code(IMMEDIATE8_OPCODE, aluop, destReg, VALUE($5));
-                }
+                // use immed8 instruction format
+                GenImmed8Code(IMMEDIATE8_OPCODE, aluop, destReg, VALUE($5));
             }
         }
     | MOV dreg',''#'Immediate
         {
-            if (asm_pass == 2)
-            {
-                // use immed8 instruction format
-                GenImmed8Code(IMMEDIATE8_OPCODE, MOV_ALU_OP, destReg, $5);
-            }
+            // use immed8 instruction format
+            GenImmed8Code(IMMEDIATE8_OPCODE, MOV_ALU_OP, destReg, $5);
         }
     | MOV dreg',''#'Identifier
         {
-            if (asm_pass == 2)
+            if (FixupIdentifier($5, ST_ID, FIX_IMMED8))
             {
-                if (chk_identifier($5, ST_ID))
-                {
-                    // use immed8 instruction format
-                    GenImmed8Code(IMMEDIATE8_OPCODE, MOV_ALU_OP, destReg, VALUE($5));
-                }
+                // use immed8 instruction format
+                GenImmed8Code(IMMEDIATE8_OPCODE, MOV_ALU_OP, destReg, VALUE($5));
             }
         }
     
 load_zp_instr         
     : MOV dreg',''[''#'Immediate']'
         {
-            if (asm_pass == 2)
-            {
-                // use ZP instruction format
-                GenZPCode(ZP_LOAD_OPCODE, destReg, $6);
-            }
+            // use ZP instruction format
+            GenZPCode(ZP_LOAD_OPCODE, destReg, $6);
         }
     | MOV dreg',''[''#'Identifier']'
         {
-            if (asm_pass == 2)
+            if (FixupIdentifier($6, ST_ZPRAM_ADDR, FIX_IMMED8))
             {
-                if (chk_identifier($6, ST_ZPRAM_ADDR))
-                {
-                    // use ZP instruction format
-                    GenZPCode(ZP_LOAD_OPCODE, destReg, VALUE($6));
-                }
+                // use ZP instruction format
+                GenZPCode(ZP_LOAD_OPCODE, destReg, VALUE($6));
             }
         }
 
 store_zp_instr        
     : MOV '[''#'Immediate']'','sreg
         {
-            if (asm_pass == 2)
-            {
-                // use ZP instruction format
-                GenZPCode(ZP_STORE_OPCODE, srcReg, $4);
-            }
+            // use ZP instruction format
+            GenZPCode(ZP_STORE_OPCODE, srcReg, $4);
         }
     | MOV '[''#'Identifier']'','sreg
         {
-            if (asm_pass == 2)
+            if (FixupIdentifier($4, ST_ZPRAM_ADDR, FIX_IMMED8))
             {
-                if (chk_identifier($4, ST_ZPRAM_ADDR))
-                {
-                    // use ZP instruction format
-                    GenZPCode(ZP_STORE_OPCODE, srcReg, VALUE($4));
-                }
+                // use ZP instruction format
+                GenZPCode(ZP_STORE_OPCODE, srcReg, VALUE($4));
             }
         }
 
 load_index5_instr    
     : MOV dreg',''['sreg'+'Immediate']'
         {
-            if (asm_pass == 2)
-            {
-                // use Indexed instruction format
-                GenIndexedCode(INDEX5_LOAD_OPCODE, destReg, $7, srcReg);
-            }
+            // use Indexed instruction format
+            GenIndexedCode(INDEX5_LOAD_OPCODE, destReg, $7, srcReg);
         }
     | MOV dreg',''['sreg'+'Identifier']'
         {
-            if (asm_pass == 2)
+            if (FixupIdentifier($7, ST_ID, FIX_INDEX5))
             {
-                if (chk_identifier($7, ST_ID))
-                {
-                    // use Indexed instruction format
-                    GenIndexedCode(INDEX5_LOAD_OPCODE, destReg, VALUE($7), srcReg);
-                }
+                // use Indexed instruction format
+                GenIndexedCode(INDEX5_LOAD_OPCODE, destReg, VALUE($7), srcReg);
             }
         }
 
 store_index5_instr   
     : MOV '['dreg'+'Immediate']'','sreg
         {
-            if (asm_pass == 2)
-            {
-                // use Indexed instruction format
-                GenIndexedCode(INDEX5_STORE_OPCODE, srcReg, $5, destReg);
-            }
+            // use Indexed instruction format
+            GenIndexedCode(INDEX5_STORE_OPCODE, srcReg, $5, destReg);
         }
     | MOV '['dreg'+'Identifier']'','sreg
         {
-            if (asm_pass == 2)
+            if (FixupIdentifier($5, ST_ID, FIX_INDEX5))
             {
-                if (chk_identifier($5, ST_ID))
-                {
-                    // use Indexed instruction format
-                    GenIndexedCode(INDEX5_STORE_OPCODE, srcReg, VALUE($5), destReg);
-                }
+                // use Indexed instruction format
+                GenIndexedCode(INDEX5_STORE_OPCODE, srcReg, VALUE($5), destReg);
             }
         }
 
 store_reg_instr   
     : MOV '['dreg']'','sreg
         {
-            if (asm_pass == 2)
-            {
-                // use Indexed instruction format with 0 index
-                GenIndexedCode(INDEX5_STORE_OPCODE, srcReg, 0, destReg);
-            }
+            // use Indexed instruction format with 0 index
+            GenIndexedCode(INDEX5_STORE_OPCODE, srcReg, 0, destReg);
         }
 
 ip_rel_branch_instr     
     : bcond Identifier
         {
-            if (asm_pass == 2)
+            // check for defined Identifier
+            if (FixupIdentifier($2, ST_LABEL, FIX_IP_RELATIVE))
             {
-                // check for defined Identifier
-                if (chk_identifier($2, ST_LABEL))
-                {
-                    // use IP-relative instruction format
-                    int offset = VALUE($2) - (cur_addr + 1);
-                    GenIPRelativeCode(IP_REL_BRANCH_OPCODE, brcond, offset);
-                }
+                // use IP-relative instruction format
+                int offset = VALUE($2) - (cur_addr + 1);
+                GenIPRelativeCode(IP_REL_BRANCH_OPCODE, brcond, offset);
             }
         }
 
 ip_rel_call_instr      
     : bscond Identifier
         {
-            if (asm_pass == 2)
+            // check for defined Identifier
+            if (FixupIdentifier($2, ST_LABEL, FIX_IP_RELATIVE))
             {
-                // check for defined Identifier
-                if (chk_identifier($2, ST_LABEL))
-                {
-                    // use IP-relative instruction format
-                    int offset = VALUE($2) - (cur_addr + 1);
-                    GenIPRelativeCode(IP_REL_CALL_OPCODE, brcond, offset);
-                }
+                // use IP-relative instruction format
+                int offset = VALUE($2) - (cur_addr + 1);
+                GenIPRelativeCode(IP_REL_CALL_OPCODE, brcond, offset);
             }
         }
 
 push_instr
     : PUSH dreg
         {
-            if (asm_pass == 2)
-            {
-                // use Indexed instruction format with SP as source and no index
-                GenIndexedCode(INDEX5_STORE_OPCODE, destReg, 0, REG_SP);
-            }
+            // use Indexed instruction format with SP as source and no index
+            GenIndexedCode(INDEX5_STORE_OPCODE, destReg, 0, REG_SP);
         }
     
 push_eval_instr
     : PUSHE dreg
         {
-            if (asm_pass == 2)
-            {
-                // use Indexed instruction format with SP as source and no index
-                GenIndexedCode(INDEX5_STORE_OPCODE, destReg, 0, REG_EP);
-            }
+            // use Indexed instruction format with SP as source and no index
+            GenIndexedCode(INDEX5_STORE_OPCODE, destReg, 0, REG_EP);
         }
     
 pop_instr 
     : POP dreg
         {
-            if (asm_pass == 2)
-            {
-                // use Indexed instruction format with SP as source 
-                // and 1 as index to compensate for the way the stack works
-                GenIndexedCode(INDEX5_LOAD_OPCODE, destReg, 1, REG_SP);
-            }
+            // use Indexed instruction format with SP as source 
+            // and 1 as index to compensate for the way the stack works
+            GenIndexedCode(INDEX5_LOAD_OPCODE, destReg, 1, REG_SP);
         }
     
 pop_eval_instr 
     : POPE dreg
         {
-            if (asm_pass == 2)
-            {
-                // use Indexed instruction format with SP as source 
-                // and 1 as index to compensate for the way the stack works
-                GenIndexedCode(INDEX5_LOAD_OPCODE, destReg, 1, REG_EP);
-            }
+            // use Indexed instruction format with SP as source 
+            // and 1 as index to compensate for the way the stack works
+            GenIndexedCode(INDEX5_LOAD_OPCODE, destReg, 1, REG_EP);
         }
     
 rts_instr
     : RTS
         {
-            if (asm_pass == 2)
-            {
-                // use Indexed instruction format with IP as dest, SP as source, 
-                // and 1 as index to compensate for the implicit inc of the IP before the call
-                GenIndexedCode(INDEX5_LOAD_OPCODE, REG_IP, 1, REG_SP);
-            }
+            // use Indexed instruction format with IP as dest, SP as source, 
+            // and 1 as index to compensate for the implicit inc of the IP before the call
+            GenIndexedCode(INDEX5_LOAD_OPCODE, REG_IP, 1, REG_SP);
         }
     
 reg_call_instr
     : JSR reg
         {
-            if (asm_pass == 2)
-            {
-                // use Call instruction format
-                GenCallCode(REG_CALL_OPCODE, REG_IP, regId, REG_SP);
-            }
+            // use Call instruction format
+            GenCallCode(REG_CALL_OPCODE, REG_IP, regId, REG_SP);
         }
     
 immediate16_instr         
     :  binop dreg',''@'Immediate
         {
-            if (asm_pass == 2)
-            {
-                // use the Direct instruction format with no source reg
-                GenDirectCode(IMMEDIATE16_OPCODE, destReg, aluop, 0, $5);
-            }
+            // use the Direct instruction format with no source reg
+            GenDirectCode(IMMEDIATE16_OPCODE, destReg, aluop, 0, $5);
         }
     |  binop dreg',''@'Identifier
         {
-            if (asm_pass == 2)
+            if (FixupIdentifier($5, ST_ID|ST_LABEL|ST_ZPRAM_ADDR|ST_RAM_ADDR, FIX_VALUE16))
             {
-                if (chk_identifier($5, ST_ID|ST_LABEL|ST_RAM_ADDR))
-                {
-                    // use the Direct instruction format with no source reg
-                    GenDirectCode(IMMEDIATE16_OPCODE, destReg, aluop, 0, VALUE($5));
-                }
+                // use the Direct instruction format with no source reg
+                GenDirectCode(IMMEDIATE16_OPCODE, destReg, aluop, 0, VALUE($5));
             }
         }
     |  MOV dreg',''@'Immediate
         {
-            if (asm_pass == 2)
-            {
-                // use the Direct instruction format with no source reg
-                GenDirectCode(IMMEDIATE16_OPCODE, destReg, MOV_ALU_OP, 0, $5);
-            }
+            // use the Direct instruction format with no source reg
+            GenDirectCode(IMMEDIATE16_OPCODE, destReg, MOV_ALU_OP, 0, $5);
         }
     |  MOV dreg',''@'Identifier
         {
-            if (asm_pass == 2)
+            if (FixupIdentifier($5, ST_ID|ST_LABEL|ST_ZPRAM_ADDR|ST_RAM_ADDR, FIX_VALUE16))
             {
-                if (chk_identifier($5, ST_ID|ST_LABEL|ST_RAM_ADDR))
-                {
-                    // use the Direct instruction format with no source reg
-                    GenDirectCode(IMMEDIATE16_OPCODE, destReg, MOV_ALU_OP, 0, VALUE($5));
-                }
+                // use the Direct instruction format with no source reg
+                GenDirectCode(IMMEDIATE16_OPCODE, destReg, MOV_ALU_OP, 0, VALUE($5));
             }
         }
 
 direct_instr          
     :  binop dreg','Immediate
         {
-            if (asm_pass == 2)
-            {
-                // use the Direct instruction format with no source reg
-                GenDirectCode(DIRECT_OPCODE, destReg, aluop, 0, $4);
-            }
+            // use the Direct instruction format with no source reg
+            GenDirectCode(DIRECT_OPCODE, destReg, aluop, 0, $4);
         }
     |  binop dreg','Identifier
         {
-            if (asm_pass == 2)
+            if (FixupIdentifier($4, ST_ID|ST_ZPRAM_ADDR|ST_RAM_ADDR, FIX_VALUE16))
             {
-                if (chk_identifier($4, ST_ID|ST_RAM_ADDR))
-                {
-                    // use the Direct instruction format with no source reg
-                    GenDirectCode(DIRECT_OPCODE, destReg, aluop, 0, VALUE($4));
-                }
+                // use the Direct instruction format with no source reg
+                GenDirectCode(DIRECT_OPCODE, destReg, aluop, 0, VALUE($4));
             }
         }
     |  MOV dreg','Immediate
         {
-            if (asm_pass == 2)
-            {
-                // use the Direct instruction format with no source reg
-                GenDirectCode(DIRECT_OPCODE, destReg, MOV_ALU_OP, 0, $4);
-            }
+            // use the Direct instruction format with no source reg
+            GenDirectCode(DIRECT_OPCODE, destReg, MOV_ALU_OP, 0, $4);
         }
-    |  MOV dreg','Identifier
+
+store_direct_instr    
+    :  MOV Immediate','sreg
+        {
+            // use the Direct instruction format with no destination reg nor ALU opcode
+            GenDirectCode(DIRECT_STORE_OPCODE, 0, 0, srcReg, $2);
+        }
+
+/*
+ *  A load or store of a ZP address that is already defined uses the one word ZP
+ *  format, so a variable is placed with .dz or .dw without changing the code
+ *  that uses it.  $$ is the number of words.
+ */
+mov_direct_instr
+    :  MOV dreg','Identifier
         {
-            if (asm_pass == 2)
+            if (((struct Symbol *)$4)->s_type == ST_ZPRAM_ADDR)
             {
-                if (chk_identifier($4, ST_ID|ST_RAM_ADDR))
+                if (FixupIdentifier($4, ST_ZPRAM_ADDR, FIX_IMMED8))
+                {
+                    // use ZP instruction format
+                    GenZPCode(ZP_LOAD_OPCODE, destReg, VALUE($4));
+                }
+                $$ = 1;
+            }
+            else
+            {
+                if (FixupIdentifier($4, ST_ID|ST_ZPRAM_ADDR|ST_RAM_ADDR, FIX_VALUE16))
                 {
                     // use the Direct instruction format with no source reg
                     GenDirectCode(DIRECT_OPCODE, destReg, MOV_ALU_OP, 0, VALUE($4));
                 }
+                $$ = 2;
             }
         }
-
-store_direct_instr    
-    :  MOV Immediate','sreg
+    |  MOV Identifier','sreg
         {
-            if (asm_pass == 2)
+            if (((struct Symbol *)$2)->s_type == ST_ZPRAM_ADDR)
             {
-                // use the Direct instruction format with no destination reg nor ALU opcode
-                GenDirectCode(DIRECT_STORE_OPCODE, 0, 0, srcReg, $2);
+                if (FixupIdentifier($2, ST_ZPRAM_ADDR, FIX_IMMED8))
+                {
+                    // use ZP instruction format
+                    GenZPCode(ZP_STORE_OPCODE, srcReg, VALUE($2));
+                }
+                $$ = 1;
             }
-        }
-    |  MOV Identifier','sreg
-        {
-            if (asm_pass == 2)
+            else
             {
-                if (chk_identifier($2, ST_ID|ST_RAM_ADDR))
+                if (FixupIdentifier($2, ST_ID|ST_ZPRAM_ADDR|ST_RAM_ADDR, FIX_VALUE16))
                 {
                     // use the Direct instruction format with no destination reg nor ALU opcode
                     GenDirectCode(DIRECT_STORE_OPCODE, 0, 0, srcReg, VALUE($2));
                 }
+                $$ = 2;
             }
         }
 
 direct_call_instr
     : JSR Identifier
         {
-            if (asm_pass == 2)
+            // check for defined Identifier
+            if (FixupIdentifier($2, ST_LABEL, FIX_VALUE16))
             {
-                // check for defined Identifier
-                if (chk_identifier($2, ST_LABEL))
-                {
-                    // use the Direct instruction format with the IP as the destinition, no ALU opcode, the SP as the source reg, and the address of the Identifier
-                    GenDirectCode(DIRECT_CALL_OPCODE, REG_IP, 0, REG_SP, VALUE($2));
-                }
+                // use the Direct instruction format with the IP as the destinition, no ALU opcode, the SP as the source reg, and the address of the Identifier
+                GenDirectCode(DIRECT_CALL_OPCODE, REG_IP, 0, REG_SP, VALUE($2));
             }
         }
 
 direct_jump_instr
     : JMP Identifier
         {
-            if (asm_pass == 2)
+            if (FixupIdentifier($2, ST_LABEL, FIX_VALUE16))
             {
-                if (chk_identifier($2, ST_LABEL))
-                {
-                    // use the Direct instruction format with the IP as the destinition, the MOV ALU opcode, no source reg, and the address of the Identifier
-                    GenDirectCode(DIRECT_JUMP_OPCODE, REG_IP, MOV_ALU_OP, 0, VALUE($2));
-                }
+                // use the Direct instruction format with the IP as the destinition, the MOV ALU opcode, no source reg, and the address of the Identifier
+                GenDirectCode(DIRECT_JUMP_OPCODE, REG_IP, MOV_ALU_OP, 0, VALUE($2));
             }
         }
     
@@ -665,6 +642,11 @@ binop
     | ADC   {aluop = OP_ADC;}
     | SBB   {aluop = OP_SBB;}
 
+mdop    
+    : MUL   {aluop = MD_MUL;}
+    | DIV   {aluop = MD_DIV;}
+    | MOD   {aluop = MD_MOD;}
+
 bcond                 
     : BRA   {brcond = BRCOND_ALLWAYS;} 
     | BCC   {brcond = BRCOND_CARRY_CLEAR;} 
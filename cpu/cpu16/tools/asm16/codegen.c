@@ -13,6 +13,9 @@
  *      1. register:        00000 aaa 0**** 000                     unary op        A <- <op> A                     <unop>      <reg>                       
  *                          00000 aaa 0++++ bbb                     direct op       A <- A <op> B                   <binop>     <dreg>,<sreg>               
  *                          00001 aaa 0++++ bbb                     indirect op     A <- A <op> [B]                 <binop>     <dreg>,[<sreg>]             
+ *                          00100 aaa 000oo bbb                     multiply/divide A <- A <mdop> B                 <mdop>      <dreg>,<sreg>
+ *                          00111 aaa 0ss00 bbb                     shift           A <- A <shift> B                <shift>     <dreg>,<sreg>
+ *                          00111 aaa 1ss0 ####                     shift           A <- A <shift> ####             <shift>     <reg>,#<immed4>
  *
  *      2. immed8:          11 +++ aaa ########                     op              A <- A <binop> ########         <binop>     <reg>,#<immed8>             
  *
@@ -57,6 +60,9 @@
  *          bbb: source register
  *          ccc: address register
  *          ++++: ALU operators
+ *          oo: multiply/divide operators
+ *          ss: shift operators
+ *          ####: 4-bit immediate
  *          #####: 5-bit immediate
  *          ########: 8-bit immediate
  *          ################: 16-bit immediate
@@ -72,6 +78,16 @@
  *          - rol   rotate left
  *          - ror   rotate right
  *          
+ *      Multiply/divide operators (mdop), signed, only register operands:
+ *          - mul   multiply, the low 16 bits of the product
+ *          - div   divide, truncated toward zero
+ *          - mod   remainder, with the sign of the dividend
+ *          
+ *      Shift operators (shift), by 0-15 bits, a register count of 16 or more shifts every bit out:
+ *          - asl   arithmetic shift left, "asl <reg>" is the single bit ALU shift
+ *          - lsr   logical shift right, "lsr <reg>" is the single bit ALU shift
+ *          - asr   arithmetic shift right, "asr <reg>" is "asr <reg>,#1"
+ *          
  *      branch condition (brcond):
  *          - bra    always
  *          - bcc    carry clear
@@ -91,16 +107,160 @@
  *          - bsmi   minus - i.e. negative, not zero or positive
  *
  *      Note: Immediate values can also be defined symbols using the .define directive, e.g. "mov ax,0x1234" is the same instruction as "mov ax,foo" with ".define foo 0x1234"
+ *
+ *      Note: A branch or a relative subroutine call whose label is out of reach of the 8-bit offset is relaxed to a jmp or a jsr, see RelaxBranches()
  */
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "error.h"
+#include "message.h"
 #include "symtab.h"
 #include "asm16.h"
+#include "codegen.h"
 
 extern FILE* yyout;
 extern FILE *yyerfp;
+extern unsigned short cur_addr;
+extern int objOnly;
+extern struct Symbol *symtabHead;
+extern int keepLines;
+
+/*
+ *  The code is assembled in one pass into memory.  An identifier that has not
+ *  been defined yet when an instruction uses it gets a fixup, which is patched
+ *  once the whole file has been parsed, then the code is written out.  So does
+ *  a label, as it moves when a branch before it is relaxed, see RelaxBranches().
+ *
+ *  With -S the code is written as a relocatable object, see obj16.h.  Then a
+ *  label or a RAM address used by an instruction also gets a fixup, as does an
+ *  identifier that is never defined, and the fixup becomes a relocation for
+ *  ld16 to patch once it has placed the code and the RAM.
+ *
+ *  Each instruction also keeps its address and its input line, so that the
+ *  listing of -l and the symbol map of -m are written from the same pass.
+ */
+struct Code
+{
+    unsigned short instr;       // instruction word
+    unsigned short value16;     // second word of a two word instruction
+    unsigned short skip;        // the inverted branch before a relaxed conditional branch
+    unsigned char words;        // 1 or 2, 3 for a relaxed conditional branch, 0 if the instruction is in error
+    unsigned char grown;        // words added by relaxing a branch
+    unsigned short base;        // address as assembled
+    unsigned short addr;        // address once the branches are relaxed
+    int region;                 // counts the .org before the instruction
+    int line;                   // input line, see yylistline()
+};
+
+// a label, at the code that follows it
+struct CodeLabel
+{
+    struct Symbol *symbol;
+    unsigned short base;        // address as assembled
+    int index;                  // of the code that follows
+    int region;
+};
+
+// the address of a label or RAM allocation, or the value of a .define, in the listing
+struct ListValue
+{
+    struct Symbol *symbol;
+    int line;
+};
+
+struct Fixup
+{
+    struct Symbol *symbol;      // forward referenced identifier
+    int type;                   // identifier types allowed
+    int field;                  // instruction field to patch
+    int index;                  // code to patch
+    unsigned short addr;        // instruction address, for IP relative offsets
+    int lineno;                 // source line, for errors
+    int reloc;                  // left for ld16 to patch
+    struct Fixup *next;
+};
+
+static struct Code *code;
+static int codeCount;
+static int codeSize;
+
+static struct Fixup *fixupHead;
+static struct Fixup *fixupTail;
+
+static struct CodeLabel *labels;
+static int labelCount;
+static int labelSize;
+static int region;
+
+static struct ListValue *listValues;
+static int listValueCount;
+static int listValueSize;
+
+static struct Code *NewCode(unsigned short instr, unsigned short value16, int words)
+{
+    struct Code *newCode;
+
+    if (codeCount == codeSize)
+    {
+        codeSize = codeSize ? 2 * codeSize : 1024;
+        if (!(code = (struct Code *)realloc(code, codeSize * sizeof(struct Code))))
+        {
+            fatal("out of memory");
+        }
+    }
+    newCode = &code[codeCount++];
+    newCode->instr = instr;
+    newCode->value16 = value16;
+    newCode->words = words;
+    newCode->skip = 0;
+    newCode->grown = 0;
+    newCode->base = newCode->addr = cur_addr;
+    newCode->region = region;
+    newCode->line = keepLines ? yylistline() : 0;
+    return newCode;
+}
+
+void GenLabel(struct Symbol *label)
+{
+    if (labelCount == labelSize)
+    {
+        labelSize = labelSize ? 2 * labelSize : 1024;
+        if (!(labels = (struct CodeLabel *)realloc(labels, labelSize * sizeof(struct CodeLabel))))
+        {
+            fatal("out of memory");
+        }
+    }
+    labels[labelCount].symbol = label;
+    labels[labelCount].base = label->s_value;
+    labels[labelCount].index = codeCount;
+    labels[labelCount++].region = region;
+}
+
+// the code after a .org is not moved by a branch relaxed before it
+void GenOrigin()
+{
+    region++;
+}
+
+void ListValue(struct Symbol *symbol)
+{
+    if (!keepLines)
+    {
+        return;
+    }
+    if (listValueCount == listValueSize)
+    {
+        listValueSize = listValueSize ? 2 * listValueSize : 256;
+        if (!(listValues = (struct ListValue *)realloc(listValues, listValueSize * sizeof(struct ListValue))))
+        {
+            fatal("out of memory");
+        }
+    }
+    listValues[listValueCount].symbol = symbol;
+    listValues[listValueCount++].line = yylistline();
+}
 
 void GenRegCode(unsigned char opCode, unsigned char destReg, unsigned char aluOp, unsigned char srcReg, int isUnary)
 {
@@ -110,7 +270,39 @@ void GenRegCode(unsigned char opCode, unsigned char destReg, unsigned char aluOp
     instr |= (destReg   << DREG_SHIFT)      & DREG_MASK;
     instr |= (aluOp     << ALU_OP_SHIFT)    & ALU_OP_MASK;
     instr |= (srcReg    << SREG_SHIFT)      & SREG_MASK;
-    fprintf(yyout, "%04X\n", instr);
+    NewCode(instr, 0, 1);
+}
+
+void GenShiftCode(int shiftOp, unsigned char destReg, int count, int isImmediate)
+{
+    unsigned short instr = 0x0000;
+    
+    if (shiftOp < 0)
+    {
+        yyerror("Only asl, lsr and asr can shift by a count.");
+        GenErrorCode();
+        return;
+    }                
+    
+    // immediate count must fit in 4 bits
+    if (isImmediate && count > 0xf)
+    {
+        yyerror("Shift count is too large to fit in 4 bits.");
+        GenErrorCode();
+        return;
+    }                
+    instr |= (SHIFT_OPCODE  << OPCODE_SHIFT)    & OPCODE_MASK;
+    instr |= (destReg       << DREG_SHIFT)      & DREG_MASK;
+    instr |= (shiftOp       << SHIFT_OP_SHIFT)  & SHIFT_OP_MASK;
+    if (isImmediate)
+    {
+        instr |= SHIFT_IMMED_FLAG | (count & SHIFT_COUNT_MASK);
+    }
+    else
+    {
+        instr |= (count     << SREG_SHIFT)      & SREG_MASK;
+    }
+    NewCode(instr, 0, 1);
 }
 
 void GenImmed8Code(unsigned char opCode, unsigned char aluOp, unsigned char destReg, int immed8)
@@ -121,14 +313,14 @@ void GenImmed8Code(unsigned char opCode, unsigned char aluOp, unsigned char dest
     if (immed8 > 0xff)
     {
         yyerror("Immediate number is too large to fit in 8 bits.");
-        fprintf(yyout, "****\n");
+        GenErrorCode();
         return;
     }                
     instr |= (opCode    << OPCODE_SHIFT)        & OPCODE_MASK;
     instr |= (aluOp     << IMM8_ALU_OP_SHIFT)   & IMM8_ALU_OP_MASK;
     instr |= (destReg   << DREG_SHIFT)          & DREG_MASK;
     instr |= (immed8    << IMMED8_SHIFT)        & IMMED8_MASK;
-    fprintf(yyout, "%04X\n", instr);
+    NewCode(instr, 0, 1);
 }
 
 void GenZPCode(unsigned char opCode, unsigned char destReg, int zpAddr)
@@ -139,13 +331,13 @@ void GenZPCode(unsigned char opCode, unsigned char destReg, int zpAddr)
     if (zpAddr > 0xff)
     {
         yyerror("Immediate number is too large to fit in 8 bits.");
-        fprintf(yyout, "****\n");
+        GenErrorCode();
         return;
     }
     instr |= (opCode    << OPCODE_SHIFT)    & OPCODE_MASK;
     instr |= (destReg   << DREG_SHIFT)      & DREG_MASK;
     instr |= (zpAddr    << IMMED8_SHIFT)    & IMMED8_MASK;
-    fprintf(yyout, "%04X\n", instr);
+    NewCode(instr, 0, 1);
 }
 
 void GenIndexedCode(unsigned char opCode, unsigned char destReg, int index5, unsigned char srcReg)
@@ -156,14 +348,14 @@ void GenIndexedCode(unsigned char opCode, unsigned char destReg, int index5, uns
     if (index5 > 0x1f)
     {
         yyerror("The index is too large to fit in 5 bits.");
-        fprintf(yyout, "****\n");
+        GenErrorCode();
         return;
     }
     instr |= (opCode    << OPCODE_SHIFT)    & OPCODE_MASK;
     instr |= (destReg   << DREG_SHIFT)      & DREG_MASK;
     instr |= (index5    << INDEX5_SHIFT)    & INDEX5_MASK;
     instr |= (srcReg    << SREG_SHIFT)      & SREG_MASK;
-    fprintf(yyout, "%04X\n", instr);
+    NewCode(instr, 0, 1);
 }
 
 void GenCallCode(unsigned char opCode, unsigned char destReg, unsigned char addrReg, unsigned char srcReg)
@@ -174,7 +366,7 @@ void GenCallCode(unsigned char opCode, unsigned char destReg, unsigned char addr
     instr |= (destReg   << DREG_SHIFT)      & DREG_MASK;
     instr |= (addrReg   << AREG_SHIFT)      & AREG_MASK;
     instr |= (srcReg    << SREG_SHIFT)      & SREG_MASK;
-    fprintf(yyout, "%04X\n", instr);
+    NewCode(instr, 0, 1);
 }
 
 void GenDirectCode(unsigned char opCode, unsigned char destReg, unsigned char aluOp, unsigned char srcReg, int value16)
@@ -185,36 +377,572 @@ void GenDirectCode(unsigned char opCode, unsigned char destReg, unsigned char al
     if (value16 > 0xffff)
     {
         yyerror("The immediate value is too large to fit in 16 bits.");
-        fprintf(yyout, "****\n");
+        GenErrorCode();
         return;
     }                
     instr |= (opCode    << OPCODE_SHIFT)    & OPCODE_MASK;
     instr |= (destReg   << DREG_SHIFT)      & DREG_MASK;
     instr |= (aluOp     << ALU_OP_SHIFT)    & ALU_OP_MASK;
     instr |= (srcReg    << SREG_SHIFT)      & SREG_MASK;
-    fprintf(yyout, "%04X ", instr);
-    fprintf(yyout, "%04X\n", value16);
+    NewCode(instr, value16, 2);
 }
 
 void GenIPRelativeCode(unsigned char opCode, unsigned char condition, int offset)
 {
     unsigned short instr = 0x0000;
-        
-    if (offset > 0xff)
+
+    // the offset to a label is patched once the branches are relaxed
+    if (fixupTail && fixupTail->index == codeCount)
+    {
+        offset = 0;
+    }
+    if (offset < -0x80 || offset > 0x7f)
     {
         yyerror("The offset is too large to fit in 8 bits.");
-        fprintf(yyout, "****\n");
+        GenErrorCode();
         return;
     }
     instr |= (opCode    << OPCODE_SHIFT)    & OPCODE_MASK;
     instr |= (condition << BRCOND_SHIFT)    & BRCOND_MASK;
     instr |= (offset    << IMMED8_SHIFT)    & IMMED8_MASK;
-    fprintf(yyout, "%04X\n", instr);
+    NewCode(instr, 0, 1);
 }
 
 void GenErrorCode()
 {
-    fprintf(yyout, "****\n");
+    NewCode(0, 0, 0);
+}
+
+// a label or RAM address in an object is relative to where ld16 places it
+static int IsRelocatable(struct Symbol *symbol)
+{
+    return objOnly && (symbol->s_type & (ST_LABEL|ST_ZPRAM_ADDR|ST_RAM_ADDR));
+}
+
+/*
+ *  Check an identifier used by the next instruction generated, like chk_identifier(),
+ *  or record a fixup for the instruction if the identifier has not been defined yet
+ *  or is a label.  The instruction is then generated with the identifier's value
+ *  so far.  An IP relative offset to a label in the same object needs no
+ *  relocation.
+ */
+int FixupIdentifier(struct Symbol *symbol, int type, int field)
+{
+    struct Fixup *fixup;
+
+    if (symbol->s_type != ST_UNDEF && symbol->s_type != ST_LABEL && !IsRelocatable(symbol))
+    {
+        return chk_identifier(symbol, type);
+    }
+    if (symbol->s_type != ST_UNDEF && !chk_identifier(symbol, type))
+    {
+        return 0;
+    }
+
+    if (!(fixup = (struct Fixup *)calloc(1, sizeof(struct Fixup))))
+    {
+        fatal("out of memory");
+    }
+    fixup->symbol = symbol;
+    fixup->type = type;
+    fixup->field = field;
+    fixup->index = codeCount;
+    fixup->addr = cur_addr;
+    fixup->lineno = yyline();
+    if (fixupTail)
+    {
+        fixupTail->next = fixup;
+    }
+    else
+    {
+        fixupHead = fixup;
+    }
+    fixupTail = fixup;
+    return 1;
+}
+
+
+// place the code and the labels after the branches relaxed so far
+static void MoveCode()
+{
+    int i, j = 0, grown = 0, curRegion = 0;
+
+    for (i = 0; i <= codeCount; i++)
+    {
+        int codeRegion = i < codeCount ? code[i].region : region + 1;
+
+        // a label before a .org ends its region
+        for ( ; j < labelCount && labels[j].index == i && labels[j].region < codeRegion; j++)
+        {
+            labels[j].symbol->s_value = labels[j].base + (labels[j].region == curRegion ? grown : 0);
+        }
+        if (codeRegion != curRegion)
+        {
+            curRegion = codeRegion;
+            grown = 0;
+        }
+        for ( ; j < labelCount && labels[j].index == i; j++)
+        {
+            labels[j].symbol->s_value = labels[j].base + grown;
+        }
+        if (i < codeCount)
+        {
+            code[i].addr = code[i].base + grown;
+            grown += code[i].grown;
+        }
+    }
+}
+
+/*
+ *  Relax the branches, bra, bz, bsr etc., whose label is out of the reach of
+ *  the 8-bit offset.  Relaxing a branch moves the code after it, so the
+ *  branches are checked again until none is relaxed:
+ *
+ *      bra  far        ->  jmp  far
+ *      bsr  far        ->  jsr  far
+ *      bz   far        ->  bnz  +2
+ *                          jmp  far
+ *
+ *  An object does not know where ld16 places a label it imports, so a branch
+ *  to it is always relaxed.  Returns the branches relaxed.
+ */
+int RelaxBranches()
+{
+    struct Fixup *fixup;
+    int relaxed = 0, moved = 1;
+
+    while (moved)
+    {
+        MoveCode();
+        moved = 0;
+        for (fixup = fixupHead; fixup; fixup = fixup->next)
+        {
+            struct Code *relax = &code[fixup->index];
+            int offset = fixup->symbol->s_value - (relax->addr + 1);
+            int isCall = (relax->instr & OPCODE_MASK) >> OPCODE_SHIFT == IP_REL_CALL_OPCODE;
+            unsigned char condition = (relax->instr & BRCOND_MASK) >> BRCOND_SHIFT;
+
+            if (fixup->field != FIX_IP_RELATIVE || relax->words != 1 ||
+                !(fixup->symbol->s_type == ST_LABEL || (objOnly && fixup->symbol->s_type == ST_UNDEF)) ||
+                (fixup->symbol->s_type == ST_LABEL && offset >= -0x80 && offset <= 0x7f))
+            {
+                continue;
+            }
+
+            // as "jmp" and "jsr" are generated
+            relax->instr = isCall ?
+                (DIRECT_CALL_OPCODE << OPCODE_SHIFT) | ((REG_IP << DREG_SHIFT) & DREG_MASK) | ((REG_SP << SREG_SHIFT) & SREG_MASK) :
+                (DIRECT_JUMP_OPCODE << OPCODE_SHIFT) | ((REG_IP << DREG_SHIFT) & DREG_MASK) | ((MOV_ALU_OP << ALU_OP_SHIFT) & ALU_OP_MASK);
+            relax->value16 = 0;
+            relax->words = 2;
+            if (condition != BRCOND_ALLWAYS)
+            {
+                // the inverted condition branches over the jmp or jsr
+                relax->skip = (IP_REL_BRANCH_OPCODE << OPCODE_SHIFT) | ((condition ^ BRCOND_INVERT) << BRCOND_SHIFT) | 2;
+                relax->words = 3;
+            }
+            relax->grown = relax->words - 1;
+            fixup->field = FIX_VALUE16;
+            relaxed++;
+            moved = 1;
+        }
+    }
+
+    // the fixup of a relaxed conditional branch patches its jmp or jsr
+    for (fixup = fixupHead; fixup; fixup = fixup->next)
+    {
+        fixup->addr = code[fixup->index].addr + (code[fixup->index].words == 3);
+    }
+    return relaxed;
+}
+
+/*
+ *  Patch the forward references once all the identifiers are defined.  In an
+ *  object an identifier that is still undefined is imported from another
+ *  object and its references, like those to a relocatable symbol, are left
+ *  for ld16.
+ */
+void PatchFixups()
+{
+    struct Fixup *fixup;
+
+    for (fixup = fixupHead; fixup; fixup = fixup->next)
+    {
+        struct Code *fixCode = &code[fixup->index];
+        unsigned short words[2] = {fixCode->instr, fixCode->value16};
+        const char *err;
+
+        if (objOnly && (fixup->symbol->s_type == ST_UNDEF ||
+                        (IsRelocatable(fixup->symbol) && fixup->field != FIX_IP_RELATIVE)))
+        {
+            fixup->reloc = 1;
+            continue;
+        }
+
+        // errors are reported at the line of the instruction
+        yysetline(fixup->lineno);
+        if (!chk_identifier(fixup->symbol, fixup->type))
+        {
+            fixCode->words = 0;
+            continue;
+        }
+
+        if ((err = ObjPatch(words, fixup->field, fixup->symbol->s_value, fixup->addr)))
+        {
+            yyerror(err);
+            fixCode->words = 0;
+            continue;
+        }
+        fixCode->instr = words[0];
+        fixCode->value16 = words[1];
+    }
+    yysetline(0);
+}
+
+// write the assembled code, one line per instruction
+void WriteCode(FILE *fp)
+{
+    int i;
+
+    for (i = 0; i < codeCount; i++)
+    {
+        switch (code[i].words)
+        {
+            case 1:
+                fprintf(fp, "%04X\n", code[i].instr);
+                break;
+            case 2:
+                fprintf(fp, "%04X %04X\n", code[i].instr, code[i].value16);
+                break;
+            case 3:
+                fprintf(fp, "%04X\n%04X %04X\n", code[i].skip, code[i].instr, code[i].value16);
+                break;
+            default:
+                fprintf(fp, "****\n");
+                break;
+        }
+    }
+}
+
+/*
+ *  Write the listing, each input line after cpp with its source line number and
+ *  the address and the words of its instructions, once the fixups are patched:
+ *
+ *       12  F010  1800 F024  jmp loop
+ *
+ *  A label, a RAM allocation or a .define shows its value as the address.
+ */
+void WriteListing(FILE *fp)
+{
+    const char *text;
+    int line, lineno, i = 0, j = 0;
+
+    for (line = 0; (text = yylisttext(line, &lineno)); line++)
+    {
+        char number[8] = "";
+        int first = 1;
+
+        if (lineno)
+        {
+            snprintf(number, sizeof number, "%5d", lineno);
+        }
+        for ( ; i < codeCount && code[i].line <= line; i++)
+        {
+            switch (code[i].words)
+            {
+                case 1:
+                    fprintf(fp, "%5s  %04X  %04X       %s\n", number, code[i].addr, code[i].instr, first ? text : "");
+                    break;
+                case 2:
+                    fprintf(fp, "%5s  %04X  %04X %04X  %s\n", number, code[i].addr, code[i].instr, code[i].value16,
+                        first ? text : "");
+                    break;
+                case 3:
+                    fprintf(fp, "%5s  %04X  %04X       %s\n", number, code[i].addr, code[i].skip, first ? text : "");
+                    fprintf(fp, "%5s  %04X  %04X %04X\n", number, code[i].addr + 1, code[i].instr, code[i].value16);
+                    break;
+                default:
+                    fprintf(fp, "%5s  %04X  ****       %s\n", number, code[i].addr, first ? text : "");
+                    break;
+            }
+            first = 0;
+        }
+        for ( ; j < listValueCount && listValues[j].line <= line; j++)
+        {
+            if (first)
+            {
+                fprintf(fp, "%5s  %04X             %s\n", number, listValues[j].symbol->s_value, text);
+                first = 0;
+            }
+        }
+        if (first)
+        {
+            fprintf(fp, "%5s                    %s\n", number, text);
+        }
+    }
+}
+
+static int CompareSymbols(const void *a, const void *b)
+{
+    const struct Symbol *x = *(const struct Symbol **)a, *y = *(const struct Symbol **)b;
+
+    return x->s_value != y->s_value ? x->s_value - y->s_value : strcmp(x->s_name, y->s_name);
+}
+
+// the symbols of a type with a value from low up to high, sorted by value
+static int SortSymbols(struct Symbol **symbols, int type, int low, int high)
+{
+    struct Symbol *symbol;
+    int qty = 0;
+
+    for (symbol = symtabHead; symbol; symbol = symbol->s_next)
+    {
+        if (symbol->s_type == type && symbol->s_value >= low && symbol->s_value < high)
+        {
+            symbols[qty++] = symbol;
+        }
+    }
+    qsort(symbols, qty, sizeof symbols[0], CompareSymbols);
+    return qty;
+}
+
+// a RAM section and its allocations, with the words of each, heap storage is also a RAM address
+static void WriteRamMap(FILE *fp, struct Symbol **symbols, const char *name, int type, int first, int size)
+{
+    int i, qty = SortSymbols(symbols, type == ST_HEAP_ADDR ? ST_RAM_ADDR : type, first, first + size);
+
+    if (!size)
+    {
+        fprintf(fp, "%s 0 words\n", name);
+        return;
+    }
+    fprintf(fp, "%s 0x%04X-0x%04X %d words\n", name, first, first + size - 1, size);
+    for (i = 0; i < qty; i++)
+    {
+        int end = i + 1 < qty ? symbols[i + 1]->s_value : first + size;
+
+        fprintf(fp, "    0x%04X %-31s %5d\n", symbols[i]->s_value, symbols[i]->s_name, end - symbols[i]->s_value);
+    }
+}
+
+/*
+ *  Write the symbol map, the labels with the words of code up to the next
+ *  label, the ZP, RAM and heap allocations with their words and the .define
+ *  values.  The address lines are those of ld16 -m with the words added, so
+ *  prof16 -t reads either map.  In an object the addresses are those before
+ *  ld16 places it.
+ */
+void WriteMap(FILE *fp)
+{
+    struct Symbol **symbols, *symbol;
+    int *words;
+    int i, qty, symbolQty = 0, codeWords = 0, low = 0xffff, high = 0;
+
+    for (symbol = symtabHead; symbol; symbol = symbol->s_next)
+    {
+        symbolQty++;
+    }
+    symbols = (struct Symbol **)calloc(symbolQty + 1, sizeof(struct Symbol *));
+    words = (int *)calloc(symbolQty + 1, sizeof(int));
+    if (!symbols || !words)
+    {
+        fatal("out of memory");
+    }
+
+    // each instruction counts in the label at or before it
+    qty = SortSymbols(symbols, ST_LABEL, 0, 0x10000);
+    for (i = 0; i < codeCount; i++)
+    {
+        int lo = 0, hi = qty - 1, mid;
+
+        codeWords += code[i].words;
+        if (code[i].words)
+        {
+            low = code[i].addr < low ? code[i].addr : low;
+            high = code[i].addr + code[i].words - 1 > high ? code[i].addr + code[i].words - 1 : high;
+        }
+        if (!qty || code[i].addr < symbols[0]->s_value)
+        {
+            continue;
+        }
+        while (lo < hi)
+        {
+            mid = (lo + hi + 1) / 2;
+            if (symbols[mid]->s_value <= code[i].addr)
+                lo = mid;
+            else
+                hi = mid - 1;
+        }
+        words[lo] += code[i].words;
+    }
+
+    if (codeWords)
+    {
+        fprintf(fp, "code 0x%04X-0x%04X %d words\n", low, high, codeWords);
+    }
+    else
+    {
+        fprintf(fp, "code 0 words\n");
+    }
+    for (i = 0; i < qty; i++)
+    {
+        fprintf(fp, "    0x%04X %-31s %5d\n", symbols[i]->s_value, symbols[i]->s_name, words[i]);
+    }
+
+    WriteRamMap(fp, symbols, "zp", ST_ZPRAM_ADDR, FIRST_ZPRAM_ADDR, s_ram_size(ST_ZPRAM_ADDR));
+    WriteRamMap(fp, symbols, "ram", ST_RAM_ADDR, FIRST_RAM_ADDR, s_ram_size(ST_RAM_ADDR));
+    WriteRamMap(fp, symbols, "heap", ST_HEAP_ADDR, FIRST_HEAP_ADDR, s_ram_size(ST_HEAP_ADDR));
+
+    fprintf(fp, "defines\n");
+    for (symbol = symtabHead; symbol; symbol = symbol->s_next)
+    {
+        if (symbol->s_type == ST_ID)
+        {
+            fprintf(fp, "    .define %s 0x%04X\n", symbol->s_name, symbol->s_value);
+        }
+    }
+
+    // an object imports the identifiers it does not define
+    if (objOnly)
+    {
+        fprintf(fp, "imports\n");
+        for (symbol = symtabHead; symbol; symbol = symbol->s_next)
+        {
+            if (symbol->s_type == ST_UNDEF)
+            {
+                fprintf(fp, "    %s\n", symbol->s_name);
+            }
+        }
+    }
+
+    free(symbols);
+    free(words);
+}
+
+// the object section of a relocatable symbol and its value in that section
+static int SymbolSection(struct Symbol *symbol, unsigned short *value)
+{
+    switch (symbol->s_type)
+    {
+        case ST_LABEL:
+            *value = symbol->s_value;
+            return SEC_CODE;
+        case ST_ZPRAM_ADDR:
+            *value = symbol->s_value - FIRST_ZPRAM_ADDR;
+            return SEC_ZP;
+        case ST_RAM_ADDR:
+            // heap storage is also a RAM address
+            if (symbol->s_value >= FIRST_HEAP_ADDR)
+            {
+                *value = symbol->s_value - FIRST_HEAP_ADDR;
+                return SEC_HEAP;
+            }
+            *value = symbol->s_value - FIRST_RAM_ADDR;
+            return SEC_RAM;
+        default:
+            *value = 0;
+            return SEC_UNDEF;
+    }
+}
+
+/*
+ *  Write the code as a relocatable object, see obj16.h.  The labels and RAM
+ *  addresses are exported and the undefined identifiers imported, the .define
+ *  identifiers stay local.  Returns 0 if nothing is written due to errors.
+ */
+int WriteObject(FILE *fp)
+{
+    struct ObjHeader header = {OBJ16_MAGIC, OBJ16_VERSION};
+    struct Symbol *symbol;
+    struct Fixup *fixup;
+    int i;
+
+    for (i = 0; i < codeCount; i++)
+    {
+        header.codeWords += code[i].words;
+        if (!code[i].words)
+        {
+            return 0;
+        }
+    }
+
+    // number the symbols written
+    for (symbol = symtabHead; symbol; symbol = symbol->s_next)
+    {
+        if (symbol->s_type != ST_ID)
+        {
+            symbol->s_index = header.symbols++;
+            header.namesSize += strlen(symbol->s_name) + 1;
+        }
+    }
+    for (fixup = fixupHead; fixup; fixup = fixup->next)
+    {
+        header.relocs += fixup->reloc;
+    }
+    header.size[SEC_ZP] = s_ram_size(ST_ZPRAM_ADDR);
+    header.size[SEC_RAM] = s_ram_size(ST_RAM_ADDR);
+    header.size[SEC_HEAP] = s_ram_size(ST_HEAP_ADDR);
+
+    ObjPut32(fp, header.magic);
+    ObjPut16(fp, header.version);
+    ObjPut16(fp, header.codeWords);
+    for (i = 0; i < SEC_QTY; i++)
+    {
+        ObjPut16(fp, header.size[i]);
+    }
+    ObjPut16(fp, header.symbols);
+    ObjPut16(fp, header.relocs);
+    ObjPut32(fp, header.namesSize);
+
+    for (i = 0; i < codeCount; i++)
+    {
+        if (code[i].words == 3)
+        {
+            ObjPut16(fp, code[i].skip);
+        }
+        ObjPut16(fp, code[i].instr);
+        if (code[i].words >= 2)
+        {
+            ObjPut16(fp, code[i].value16);
+        }
+    }
+
+    header.namesSize = 0;
+    for (symbol = symtabHead; symbol; symbol = symbol->s_next)
+    {
+        if (symbol->s_type != ST_ID)
+        {
+            unsigned short value;
+            int section = SymbolSection(symbol, &value);
+
+            ObjPut32(fp, header.namesSize);
+            ObjPut16(fp, section);
+            ObjPut16(fp, symbol->s_type);
+            ObjPut16(fp, value);
+            header.namesSize += strlen(symbol->s_name) + 1;
+        }
+    }
+
+    for (fixup = fixupHead; fixup; fixup = fixup->next)
+    {
+        if (fixup->reloc)
+        {
+            ObjPut16(fp, fixup->addr);
+            ObjPut16(fp, fixup->field);
+            ObjPut16(fp, fixup->symbol->s_index);
+            ObjPut16(fp, fixup->type);
+        }
+    }
+
+    for (symbol = symtabHead; symbol; symbol = symbol->s_next)
+    {
+        if (symbol->s_type != ST_ID)
+        {
+            fwrite(symbol->s_name, 1, strlen(symbol->s_name) + 1, fp);
+        }
+    }
+
+    return 1;
 }
 
 // end of codegen.c
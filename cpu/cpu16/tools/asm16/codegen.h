@@ -3,12 +3,27 @@
  *
  */
 
-void GenRegCode(unsigned char opCode, unsigned char destReg, unsigned char aluOp, unsigned char srcReg, unsigned isUnary);
+void GenRegCode(unsigned char opCode, unsigned char destReg, unsigned char aluOp, unsigned char srcReg, int isUnary);
 void GenImmed8Code(unsigned char opCode, unsigned char aluOp, unsigned char destReg, int immed8);
 void GenZPCode(unsigned char opCode, unsigned char destReg, int immed8);
 void GenIndexedCode(unsigned char opCode, unsigned char destReg, int immed5, unsigned char srcReg);
 void GenCallCode(unsigned char opCode, unsigned char destReg, unsigned char addrReg, unsigned char srcReg);
 void GenDirectCode(unsigned char opCode, unsigned char destReg, unsigned char aluOp, unsigned char srcReg, int value16);
+void GenShiftCode(int shiftOp, unsigned char destReg, int count, int isImmediate);
 void GenIPRelativeCode(unsigned char opCode, unsigned char condition, int offset);
 void GenErrorCode();
+void GenLabel(struct Symbol *label);
+void GenOrigin();
+
+// instruction fields patched by fixups, FIX_IMMED8 etc.
+#include "obj16.h"
+
+int FixupIdentifier(struct Symbol *symbol, int type, int field);
+int RelaxBranches();
+void PatchFixups();
+void ListValue(struct Symbol *symbol);
+void WriteListing(FILE *fp);
+void WriteMap(FILE *fp);
+void WriteCode(FILE *fp);
+int WriteObject(FILE *fp);
 
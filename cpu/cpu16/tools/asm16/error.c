@@ -7,10 +7,16 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include "message.h"
 
 /*
  *  yywhere() -- input position for yyparse()
  *  yymark() -- get information from '# line file'
+ *  yyline() -- current input line number
+ *  yysetline() -- report errors at a saved line, e.g. when patching fixups
+ *  yylist() -- keep the text of each input line for the listing, see WriteListing()
+ *  yylistline() -- the input line of the instruction being reduced
+ *  yylisttext() -- the text of an input line kept by yylist()
  */
 
 extern char *yytext;    // current token
@@ -19,6 +25,38 @@ extern int yylineno;    // current input line number
 
 FILE *yyerfp = NULL;    // error stream
 static char *source;    // current input file name
+static int setLine;     // line set by yysetline(), 0 if none
+
+/*
+ *  The lexer passes every token, blank and comment to yylist() when there is a
+ *  listing, so each line is kept as it was read, after cpp.  A line is counted
+ *  here from 0 whatever its yylineno, as the "# line file" marks of cpp reset
+ *  yylineno.
+ */
+struct Line
+{
+    char *text;
+    int lineno;             // source line number, 0 for a "# line file" mark
+};
+
+int keepLines;              // set for a listing
+static struct Line *lines;
+static int lineCount;
+static int lineSize;
+static char *lineBuf;       // the line being read
+static int lineLen;
+static int lineBufSize;
+static int tokenLine[2];    // line of the token before the last and of the last token
+
+int yyline()
+{
+    return yylineno - (*yytext == '\n' || !*yytext);
+}
+
+void yysetline(int lineno)
+{
+    setLine = lineno;
+}
 
 /*
  *  position stamp
@@ -45,13 +83,22 @@ void yywhere()
             colon = 1;
         }
     }
+    if (setLine)
+    {
+        if (colon)
+        {
+            fputs(", ", yyerfp);
+        }
+        fprintf(yyerfp, "line %d: ", setLine);
+        return;
+    }
     if (yylineno > 0)
     {
         if (colon)
         {
             fputs(", ", yyerfp);
         }
-        fprintf(yyerfp, "line %d", yylineno - (*yytext == '\n' || !*yytext));
+        fprintf(yyerfp, "line %d", yyline());
         colon = 1;
     }
     if (*yytext)
@@ -94,6 +141,84 @@ void yymark()
     }
 }
 
+void yylist(const char *text, int len)
+{
+    int isMark = *text == '#' && text[len - 1] == '\n';
+
+    if (!keepLines)
+    {
+        return;
+    }
+
+    // not a blank, comment, newline or mark
+    if (!strchr(" \t;", *text) && text[len - 1] != '\n')
+    {
+        tokenLine[0] = tokenLine[1];
+        tokenLine[1] = lineCount;
+    }
+
+    if (lineLen + len + 1 > lineBufSize)
+    {
+        lineBufSize = 2 * (lineLen + len + 1) + 80;
+        if (!(lineBuf = (char *)realloc(lineBuf, lineBufSize)))
+        {
+            fatal("out of memory");
+        }
+    }
+    memcpy(lineBuf + lineLen, text, len);
+    lineLen += len;
+    lineBuf[lineLen] = '\0';
+
+    if (text[len - 1] == '\n')
+    {
+        if (lineCount == lineSize)
+        {
+            lineSize = lineSize ? 2 * lineSize : 1024;
+            if (!(lines = (struct Line *)realloc(lines, lineSize * sizeof(struct Line))))
+            {
+                fatal("out of memory");
+            }
+        }
+        lineBuf[lineLen - 1] = '\0';
+        if (!(lines[lineCount].text = strdup(lineBuf)))
+        {
+            fatal("out of memory");
+        }
+        lines[lineCount++].lineno = isMark ? 0 : yylineno;
+        lineLen = 0;
+    }
+}
+
+/*
+ *  The parser may have read the token after an instruction before reducing
+ *  it, then the instruction ends with the token before the last.
+ */
+int yylistline()
+{
+    extern int yychar;      // look ahead token, < 0 if none
+
+    return yychar < 0 ? tokenLine[1] : tokenLine[0];
+}
+
+/*
+ *  The text and the source line number of a line, NULL past the last line.
+ *  The last line may have no newline.
+ */
+const char *yylisttext(int line, int *lineno)
+{
+    if (line < lineCount)
+    {
+        *lineno = lines[line].lineno;
+        return lines[line].text;
+    }
+    if (line == lineCount && lineLen)
+    {
+        *lineno = yylineno;
+        return lineBuf;
+    }
+    return NULL;
+}
+
 void yyerror(const char *s)
 {
 	extern int yynerrs;     // total number of errors	
@@ -4,5 +4,10 @@
 
 void yywhere();
 void yymark();
+int yyline();
+void yysetline(int lineno);
+void yylist(const char *text, int len);
+int yylistline();
+const char *yylisttext(int line, int *lineno);
 void yyerror(const char *s);
 
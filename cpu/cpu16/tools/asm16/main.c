@@ -9,25 +9,30 @@
 #include <libgen.h>
 #include <getopt.h>
 #include "y.tab.h"
+#include "symtab.h"
+#include "asm16.h"
+#include "codegen.h"
 
 extern FILE* yyout;
 extern FILE *yyerfp;
+extern int yynerrs;
+extern int keepLines;
 
 // options
 static char *outfileName = 0;
 static char *infileName = 0;
+static char *listfileName = 0;
+static char *mapfileName = 0;
 int objOnly = 0;
 int emitVmCode = 0;
 int verbose = 0;
 
-// assembler pass
-int asm_pass;
 // TODO make this a command line option
 unsigned short cur_addr;
 
 static void ParseOptions(int argc, char* argv[])
 {
-	const char* optStr = "CD:I:PU:So:ivh";
+	const char* optStr = "CD:I:PU:So:l:m:ivh";
 	int opt;
 
 	while ((opt = getopt(argc, argv, optStr)) != -1)
@@ -42,23 +47,36 @@ static void ParseOptions(int argc, char* argv[])
 		    case 'U':
 		        break;
 		    
+			case 'S':
+				objOnly = 1;
+				break;
 			case 'o':
 				outfileName = optarg;
 				break;
+			case 'l':
+				listfileName = optarg;
+				keepLines = 1;
+				break;
+			case 'm':
+				mapfileName = optarg;
+				break;
 			case 'v':
 				verbose = 1;
 				break;
 			case 'h':
-				printf("usage: asm16 [-o <filename>] [-v] [-h]\n");
+				printf("usage: asm16 [-D<name>[=<value>]] [-I<dir>] [-S] [-o <filename>] [-l <filename>] [-m <filename>] [-v] [-h] <file>\n");
 				printf("\n");
 				printf("     options:\n");
-				printf("         -S:            compile to hasm object\n");
-				printf("         -o <filename>: set the output file name\n");
+				printf("         -D, -I, -U, -C, -P: passed to the C preprocessor\n");
+				printf("         -S:            assemble to a relocatable object for ld16, default <file>.obj\n");
+				printf("         -o <filename>: set the output file name, default <file>.bin\n");
+				printf("         -l <filename>: write a listing, the address, the words and the source of each line\n");
+				printf("         -m <filename>: write a symbol map of the labels, the RAM allocations and the .define values\n");
 				printf("         -v:            set verbose mode\n");
 				printf("         -h:            display this help\n");
 				exit(0);
 			default:
-				printf("usage: asm16 [-o <filename>] [-v] [-h]\n\n");
+				printf("usage: asm16 [-D<name>[=<value>]] [-I<dir>] [-S] [-o <filename>] [-l <filename>] [-m <filename>] [-v] [-h] <file>\n\n");
 				exit(-1);
 		}
 	}
@@ -86,7 +104,7 @@ int cpp(int argc, char** argv)
     
     for (i = 0, argp = argv; *++argp; )
     {
-        if (**argp == '-' && strchr("CDEIUP", (*argp)[i]))
+        if (**argp == '-' && strchr("CDEIUP", (*argp)[1]))
         {
             i += strlen(*argp) + 1;
         }
@@ -100,7 +118,7 @@ int cpp(int argc, char** argv)
     strcpy(cmd, CPP);
     for (argp = argv; *++argp; )
     {
-        if (**argp == '-' && strchr("CDEIUP", (*argp)[i]))
+        if (**argp == '-' && strchr("CDEIUP", (*argp)[1]))
         {
             strcat(cmd, " "), strcat(cmd, *argp);
         }
@@ -115,6 +133,29 @@ int cpp(int argc, char** argv)
     return i;
 }
 
+// write the listing or the map to a file
+static void WriteFile(const char *fileName, void (*write)(FILE *))
+{
+    FILE *fp;
+
+    if ((fp = fopen(fileName, "w")) == 0)
+    {
+        fprintf(stderr, "asm16: cannot open file %s\n", fileName);
+        exit(EXIT_FAILURE);
+    }
+    write(fp);
+    fclose(fp);
+}
+
+// remove the partial output after an error, and fail
+static void RemoveOutput()
+{
+    fprintf(stderr, "asm16: no %s written due to errors\n", objOnly ? "object" : "code");
+    fclose(yyout);
+    remove(outfileName);
+    exit(EXIT_FAILURE);
+}
+
 /*
  *  main() -- run C preprocessor then yyparse()
  */
@@ -141,7 +182,7 @@ int main(int argc, char** argv)
 	// parse the command line options
 	ParseOptions(argc, argv);
 
-    // default to the base name of the input file name with the extension changed to .bin
+    // default to the base name of the input file name with the extension changed to .bin or .obj
     if (!outfileName)
     {
         char *nextc;
@@ -150,7 +191,7 @@ int main(int argc, char** argv)
         for (nextc = name; *nextc != '.'; nextc++)
             ;
         *nextc = '\0';
-        strcat(name, ".bin");
+        strcat(name, objOnly ? ".obj" : ".bin");
         outfileName = name;    
     }
     
@@ -161,9 +202,6 @@ int main(int argc, char** argv)
         exit(EXIT_FAILURE);
     }
     
-    // run the first pass
-    asm_pass = 1;
-    
     // redirect infileName as stdin      
     if (infileName && !freopen(infileName, "r", stdin))
     {
@@ -177,27 +215,36 @@ int main(int argc, char** argv)
         perror("C preprocessor");
         exit(EXIT_FAILURE);
     }  
-    cur_addr = 0xf000;      
-    if (yyparse() == 0)
-    {    
-        // run the second pass if there were no errors or if there were errors and error recovery was possible
-        asm_pass = 2;
-        
-        // redirect infileName as stdin      
-        if (infileName && !freopen(infileName, "r", stdin))
-        {
-            perror(infileName);
-            exit(EXIT_FAILURE);
-        }
-        
-        // run the C preprocessor
-        if (cppflag && cpp(argc, argv))
-        {
-            perror("C preprocessor");
-            exit(EXIT_FAILURE);
-        }        
-        cur_addr = 0xf000;      
-        yyparse();
+    
+    // assemble in one pass, then relax the branches out of reach, patch the forward
+    // references and write the code, an object is assembled at 0 and placed by ld16
+    cur_addr = objOnly ? 0 : FIRST_ROM_ADDR;
+    if (yyparse() != 0)
+    {
+        RemoveOutput();
+    }
+    int relaxed = RelaxBranches();
+
+    if (verbose && relaxed)
+    {
+        printf("asm16: %d branch(es) relaxed to jmp or jsr\n", relaxed);
+    }
+    PatchFixups();
+    if (listfileName)
+    {
+        WriteFile(listfileName, WriteListing);
+    }
+    if (mapfileName)
+    {
+        WriteFile(mapfileName, WriteMap);
+    }
+    if (yynerrs || (objOnly && !WriteObject(yyout)))
+    {
+        RemoveOutput();
+    }
+    if (!objOnly)
+    {
+        WriteCode(yyout);
     }
 }
 
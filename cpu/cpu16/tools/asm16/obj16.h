@@ -0,0 +1,144 @@
+/*
+ *  obj16.h -- relocatable object format shared by asm16 and ld16
+ *
+ *  "asm16 -S" writes an object instead of a ROM image.  An object is a header
+ *  followed by its code words, symbols, relocations and the symbol names, all
+ *  stored as little endian 16-bit words except for the 32-bit magic and names
+ *  size.  A library is just objects concatenated, e.g. "cat *.obj > libasm.a",
+ *  and ld16 only links the library objects that define a symbol still needed.
+ *
+ *  The code of an object is assembled at address 0, its ZP, RAM and heap
+ *  storage is allocated from offset 0 of each region, and ld16 places each
+ *  region of each object after those of the objects linked before it.
+ *
+ *  Include asm16.h before this file.
+ */
+
+#ifndef OBJ16_H
+#define OBJ16_H
+
+#include <stdio.h>
+
+#define OBJ16_MAGIC         0x3631424f  // "OB16"
+#define OBJ16_VERSION       1
+
+// regions, ld16 places them from these addresses with these limits
+#define FIRST_ZPRAM_ADDR    0x00        // Zero Page indeces are allocated from 0x00 to 0xff
+#define ZPRAM_LENGTH        0x100
+
+#define FIRST_RAM_ADDR      0x0100      // RAM locations are allocated from 0x0100 to 0x03ff
+#define RAM_LENGTH          0x0300
+
+#define FIRST_HEAP_ADDR     0x0400      // heap locations are allocated from 0x0400 to 0x06ff
+#define HEAP_LENGTH         0x0300
+
+#define FIRST_PROFILE_ADDR  0x0700      // reserved for the cc16 -p block counters, 0x0700 to 0x07ff
+#define PROFILE_LENGTH      0x0100      // the stack grows downward from 0x0fff to 0x0800
+
+#define FIRST_ROM_ADDR      0xf000      // the code is linked from here by default
+
+// symbol sections
+#define SEC_UNDEF           0           // defined by another object
+#define SEC_ABS             1           // absolute value, e.g. a .define
+#define SEC_CODE            2           // label
+#define SEC_ZP              3           // .dz
+#define SEC_RAM             4           // .dw
+#define SEC_HEAP            5           // .ds
+#define SEC_QTY             6
+
+// instruction fields patched by fixups and relocations
+#define FIX_IMMED8          1           // 8-bit immediate or ZP address
+#define FIX_INDEX5          2           // 5-bit index
+#define FIX_VALUE16         3           // second word of a two word instruction
+#define FIX_IP_RELATIVE     4           // 8-bit IP relative offset
+
+struct ObjHeader
+{
+    unsigned long magic;
+    unsigned short version;
+    unsigned short codeWords;
+    unsigned short size[SEC_QTY];       // words of ZP, RAM and heap allocated
+    unsigned short symbols;
+    unsigned short relocs;
+    unsigned long namesSize;            // bytes of symbol names, each '\0' terminated
+};
+
+struct ObjSymbol
+{
+    unsigned long name;                 // offset in the names
+    unsigned short section;
+    unsigned short type;                // asm16 symbol type, e.g. ST_LABEL
+    unsigned short value;               // offset in the section
+};
+
+// the instruction at code word "offset" uses symbol "symbol", which must be one of "types"
+struct ObjReloc
+{
+    unsigned short offset;
+    unsigned short field;
+    unsigned short symbol;
+    unsigned short types;
+};
+
+static inline void ObjPut16(FILE *fp, unsigned value)
+{
+    putc(value & 0xff, fp);
+    putc((value >> 8) & 0xff, fp);
+}
+
+static inline void ObjPut32(FILE *fp, unsigned long value)
+{
+    ObjPut16(fp, value & 0xffff);
+    ObjPut16(fp, (value >> 16) & 0xffff);
+}
+
+// returns -1 at the end of the file
+static inline long ObjGet16(FILE *fp)
+{
+    int lo = getc(fp), hi = getc(fp);
+
+    return (lo == EOF || hi == EOF) ? -1 : (hi << 8) | lo;
+}
+
+static inline long long ObjGet32(FILE *fp)
+{
+    long lo = ObjGet16(fp), hi = ObjGet16(fp);
+
+    return (lo < 0 || hi < 0) ? -1 : ((long long)hi << 16) | lo;
+}
+
+/*
+ *  Patch a symbol's value into an instruction field.  "instr" points to the
+ *  instruction word, followed by the second word of a two word instruction,
+ *  and "addr" is the address of the instruction.  Returns NULL or the error.
+ */
+static inline const char *ObjPatch(unsigned short *instr, int field, int value, unsigned short addr)
+{
+    switch (field)
+    {
+        case FIX_IMMED8:
+            if (value > 0xff)
+                return "Immediate number is too large to fit in 8 bits.";
+            instr[0] = (instr[0] & ~IMMED8_MASK) | ((value << IMMED8_SHIFT) & IMMED8_MASK);
+            break;
+        case FIX_INDEX5:
+            if (value > 0x1f)
+                return "The index is too large to fit in 5 bits.";
+            instr[0] = (instr[0] & ~INDEX5_MASK) | ((value << INDEX5_SHIFT) & INDEX5_MASK);
+            break;
+        case FIX_VALUE16:
+            instr[1] = value;
+            break;
+        case FIX_IP_RELATIVE:
+            value -= addr + 1;
+            if (value < -0x80 || value > 0x7f)
+                return "The offset is too large to fit in 8 bits.";
+            instr[0] = (instr[0] & ~IMMED8_MASK) | ((value << IMMED8_SHIFT) & IMMED8_MASK);
+            break;
+        default:
+            return "bad relocation field";
+    }
+    return NULL;
+}
+
+#endif // OBJ16_H
@@ -25,7 +25,9 @@
 #ifndef APPEND_KEY_VALUE_ASM
 #define APPEND_KEY_VALUE_ASM
 
+#ifndef LD16
 #include <system16/beep.asm>
+#endif
 
 #define NEW_ENTRY   [bp+3]
 #define VALUE       [bp+4]
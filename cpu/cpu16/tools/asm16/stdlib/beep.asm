@@ -1,7 +1,11 @@
 #ifndef BEEP_ASM
 #define BEEP_ASM
 
+#include <system16/system16.asm>
+
+#ifndef LD16
 #include <system16/delayms.asm>
+#endif
 
 ;   Subroutine: _Beep
 ;
@@ -20,6 +20,8 @@
 #ifndef DISPLAY_ASM
 #define DISPLAY_ASM
 
+#include <system16/system16.asm>
+
 #define VALUE [bp+3]
 
 _Display:
@@ -0,0 +1,148 @@
+;   divmod.asm
+;
+;   Subroutine: _DivMod
+;
+;   Description: This function performs a 16-bit signed division and returns both the
+;   quotient and the remainder.  The magnitudes are divided by restoring division, one
+;   quotient bit per step from the most significant 1 bit of the dividend down.  The
+;   quotient is truncated toward zero and the remainder has the sign of the dividend, as
+;   in C.
+;   A zero divisor gives a zero quotient and the dividend as the remainder.
+;
+;   Synopsis: int _DivMod(int dividend, int divisor);
+;
+;   Args:
+;       dividend: the number divided by the divisor
+;       divisor: the number with which to divide the dividend
+;
+;   Return: quotient in ax, remainder in dx
+;
+;   Stack on entry:
+;     SP->
+;          retaddr
+;          divisor  (SP+2)
+;          dividend (SP+3)
+;
+;   Regs used: ax, bx, cx, dx, ep
+;
+;   C code:
+;       int DivMod(int dividend, int divisor)
+;       {
+;           unsigned n = dividend < 0 ? -dividend : dividend;
+;           unsigned d = divisor < 0 ? -divisor : divisor;
+;           unsigned quotient = 0, remainder = 0;
+;           int i;
+;
+;           if (d)
+;           {
+;               // shift the dividend into the remainder a bit at a time and subtract
+;               // the divisor whenever it fits, which makes that quotient bit a 1,
+;               // the steps for the leading zeros of the dividend are skipped
+;               for (i = 0; i < 16; i++)
+;               {
+;                   remainder = (remainder << 1) | (n >> 15);
+;                   n <<= 1;
+;                   quotient <<= 1;
+;                   if (remainder >= d)
+;                   {
+;                       remainder -= d;
+;                       quotient |= 1;
+;                   }
+;               }
+;           }
+;           else
+;           {
+;               remainder = n;
+;           }
+;
+;           if ((dividend ^ divisor) < 0)
+;               quotient = -quotient;
+;           if (dividend < 0)
+;               remainder = -remainder;
+;           dx = remainder;
+;           return quotient;
+;       }
+;
+
+#ifndef DIVMOD_ASM
+#define DIVMOD_ASM
+
+#define DIVISOR  [bp+3]
+#define DIVIDEND [bp+4]
+
+_DivMod:
+    push    bp                  ; setup the stack frame
+    mov     bp,sp
+    push    bx                  ; stash the context
+    push    cx
+    push    ep
+
+    mov     cx,DIVIDEND         ; load the magnitude of the dividend into cx
+    bpl     _DivMod_L1
+    mov     ax,cx
+    zero    cx
+    sub     cx,ax
+_DivMod_L1:
+    mov     dx,DIVISOR          ; load the magnitude of the divisor into dx
+    bpl     _DivMod_L2
+    mov     ax,dx
+    zero    dx
+    sub     dx,ax
+_DivMod_L2:
+    zero    ax                  ; clear the quotient
+    mov     bx,cx               ; a zero divisor leaves the dividend as the remainder
+    or      dx,#0
+    bz      _DivMod_Sign
+
+    zero    bx                  ; clear the remainder
+    mov     ep,#16              ; one step per quotient bit
+_DivMod_Skip:
+    asl     cx                  ; the leading zeros of the dividend are quotient zeros
+    bcs     _DivMod_Bit
+    dec     ep
+    bnz     _DivMod_Skip
+    bra     _DivMod_Sign
+_DivMod_Step:
+    asl     cx                  ; shift the next dividend bit into the remainder
+_DivMod_Bit:
+    rol     bx
+    asl     ax                  ; and make room for the next quotient bit
+    sub     bx,dx               ; does the divisor fit?
+    bcc     _DivMod_Fits
+    add     bx,dx               ; no, restore the remainder
+    dec     ep
+    bnz     _DivMod_Step
+    bra     _DivMod_Sign
+_DivMod_Fits:
+    inc     ax                  ; yes, the quotient bit is 1
+    dec     ep
+    bnz     _DivMod_Step
+
+_DivMod_Sign:
+    mov     cx,DIVIDEND         ; negate the quotient if the signs differ
+    mov     ep,DIVISOR
+    xor     cx,ep
+    bpl     _DivMod_L3
+    mov     cx,ax
+    zero    ax
+    sub     ax,cx
+_DivMod_L3:
+    mov     dx,bx               ; the remainder has the sign of the dividend
+    mov     cx,DIVIDEND
+    bpl     _DivMod_Return
+    zero    dx
+    sub     dx,bx
+
+_DivMod_Return:
+    pop     ep                  ; restore the context
+    pop     cx
+    pop     bx
+    mov     sp,bp               ; return from the subroutine
+    pop     bp
+    rts
+
+#undef DIVISOR
+#undef DIVIDEND
+
+#endif // DIVMOD_ASM
+
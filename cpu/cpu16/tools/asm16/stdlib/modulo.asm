@@ -1,9 +1,12 @@
 ;   modulo.asm
 ;
-;   Subroutine: _Modulo
+;   Subroutine: _Modulo, _ModuloR
 ;
 ;   Description: This function performs the modulo, i.e. "remainder" operation.
 ;
+;   _ModuloR is the same routine for the cc16 -r register calling convention, the
+;   dividend is passed in ax and the divisor in bx.
+;
 ;   Synopsis: int _Modulo(int dividend, int divisor);
 ;
 ;   Args:
@@ -18,42 +21,52 @@
 ;          divisor  (SP+2)
 ;          dividend (SP+3)
 ;
-;   Regs used: ax, bx, cx, dx
+;   Regs used: ax
+;
+;   C code:
+;       int Modulo(int dividend, int divisor)
+;       {
+;           DivMod(dividend, divisor);
+;           return dx;                              // the remainder
+;       }
 ;
-;   Algorighm used:
-;       mod(a,b) = (a - (b * (a / b)))
 
+#ifndef MODULO_ASM
+#define MODULO_ASM
+
+#ifndef LD16
+#include <system16/divmod.asm>
+#endif
 
 _Modulo:
-    push    bp          ; setup the stack frame
-    mov     bp,sp 
-    push    bx          ; stash the context
-    push    cx
+    push    bp                  ; setup the stack frame
+    mov     bp,sp
+    push    dx                  ; stash the context
+
+    mov     dx,[bp+4]           ; call _DivMod(dividend, divisor)
+    push    dx
+    mov     dx,[bp+3]
     push    dx
+    jsr     _DivMod
+    add     sp,#2
+    mov     ax,dx               ; ax = dividend % divisor
 
-    mov     bx,[bp+0x4]	; param a in bx
-    mov     cx,[bp+0x3]	; param b in cx
-
-    push    bx          ; call _Divide(bx,cx)
-    push    cx
-    jsr     _Divide
-    pop     dx
-    pop     dx          ; ax = (a / b)
-    
-    push    cx          ; call _Multiply(cx,ax)
-    push    ax
-    jsr     _Multiply
-    pop     dx
-    pop     dx          ; ax = (b * (a / b))
-    
-    sub     bx,ax       ; subtract
-    mov     ax,bx       ; ax = (a - (b * (a / b)))
-
-_Modulo_Return:
-    pop     dx          ; restore the context
-    pop     cx
-    pop     bx
-    mov     sp,bp       ; return from the subroutine
+    pop     dx                  ; restore the context
+    mov     sp,bp               ; return from the subroutine
     pop     bp
     rts
 
+_ModuloR:
+    push    dx                  ; stash the context
+
+    push    ax                  ; call _DivMod(dividend, divisor)
+    push    bx
+    jsr     _DivMod
+    add     sp,#2
+    mov     ax,dx               ; ax = dividend % divisor
+
+    pop     dx                  ; restore the context
+    rts
+
+#endif // MODULO_ASM
+
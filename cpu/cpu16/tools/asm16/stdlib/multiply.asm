@@ -1,8 +1,10 @@
 ;   multiply.asm
 ;
-;   Subroutine: _Multiply
+;   Subroutine: _Multiply, _MultiplyR
 ;
-;   Description: This function performs a 16-bit multiplication.
+;   Description: This function performs a 16-bit multiplication.  _MultiplyR is the
+;   same routine for the cc16 -r register calling convention, the args are passed in
+;   ax and bx instead of on the stack.
 ;
 ;   Synopsis: int _Multiply(int multiplier, int multiplicand);
 ;
@@ -18,40 +20,47 @@
 ;          multiplicand (SP+2)
 ;          multiplier   (SP+3)
 ;
+;   Regs on entry to _MultiplyR:
+;       ax: multiplier
+;       bx: multiplicand
+;
 ;   Regs used:  
 ;       ax: product
-;       bx: negate flag
 ;       cx: multiplier
 ;       dx: multiplicand
 ;
+;   The low 16 bits of a product are the same for signed and unsigned factors,
+;   so the multiplier is shifted out a bit at a time and the multiplicand, shifted
+;   up by as much, is added for each 1 bit.  It takes a step per significant bit
+;   of the multiplier, at most 16, so the factors are negated if the multiplier
+;   is negative and swapped if the multiplicand is smaller.
+;
 ;   C code:
 ;       int Multiply(int multiplier, int multiplicand)
 ;       {
+;           unsigned m;
 ;           int product = 0;
-;           int negate = 0;
 ;   
-;           // if either factor is zero return zero
-;           if (multiplier | multiplicand)
-;           { 
-;               // if the multiplier is negative flag it and negate the multiplier
-;               if (multiplier < 0)
-;               {
-;                   negate = !0;
-;                   multiplier = -multiplier;
-;               }
-;               
-;               // add the multiplicand to itself multiplier times
-;               while (multiplier)
-;               {
+;           if (multiplier < 0)
+;           {
+;               multiplier = -multiplier;
+;               multiplicand = -multiplicand;
+;           }
+;           if ((unsigned)multiplicand < (unsigned)multiplier)
+;           {
+;               m = multiplicand;
+;               multiplicand = multiplier;
+;           }
+;           else
+;           {
+;               m = multiplier;
+;           }
+;           while (m)
+;           {
+;               if (m & 1)
 ;                   product += multiplicand;
-;                   --multiplier;
-;               }
-;   
-;               // negate the product if necessary
-;               if (negate)
-;               {
-;                   product = -product;
-;               }    
+;               m >>= 1;
+;               multiplicand <<= 1;
 ;           }
 ;       
 ;           return product;
@@ -61,48 +70,53 @@
 #ifndef MULTIPLY_ASM
 #define MULTIPLY_ASM
 
+_MultiplyR:
+    push    bp                  ; setup the same stack frame as _Multiply
+    mov     bp,sp
+    push    cx                  ; stash the context
+    push    dx
+
+    mov     dx,bx               ; load the multiplicand into dx
+    mov     cx,ax               ; load the multiplier into cx
+    bra     _Multiply_Sign
+
 _Multiply:
     push    bp                  ; setup the stack frame
     mov     bp,sp 
-    push    bx                  ; stash the context
-    push    cx
+    push    cx                  ; stash the context
     push    dx
 
     mov     dx,[bp+3]           ; load the multiplicand into dx
     mov     cx,[bp+4]           ; load the multiplier into cx
-
-    zero    ax                  ; if either factor is zero return zero
-    or      dx,#0
-    bz      _Multiply_Return
-    or      cx,#0
-    bz      _Multiply_Return
-
-    zero    bx                  ; clear the negate flag
-    sub     cx,#0               ; if the multiplier is negative
-    bpl     _Multiply_Product
-    mov     bx,@0xffff          ; ... set negate flag
-    mov     ax,cx               ; ... negate the multiplier
-    zero    cx
-    sub     cx,ax
-    
+_Multiply_Sign:
+    bpl     _Multiply_Order
+    zero    ax                  ; negate both factors if the multiplier is negative
+    sub     ax,cx
+    mov     cx,ax
+    zero    ax
+    sub     ax,dx
+    mov     dx,ax
+_Multiply_Order:
+    mov     ax,dx               ; multiply by the smaller factor
+    sub     ax,cx
+    bcc     _Multiply_Product
+    mov     ax,dx
+    mov     dx,cx
+    mov     cx,ax
 _Multiply_Product:
+
     zero    ax                  ; clear the product
-_Multiply_L1:    
-    add     ax,dx               ; add the multiplicand to the product multiplier times
-    dec     cx
-    bz      _Multiply_NegateProduct
-    bra     _Multiply_L1
-    
-_Multiply_NegateProduct:
-    or      bx,#0               ; negate the product if necessary
-    bz      _Multiply_Return
-    sub     cx,ax
-    mov     ax,cx
+_Multiply_L1:
+    lsr     cx                  ; shift the next multiplier bit into carry
+    bcc     _Multiply_L2
+    add     ax,dx               ; add the multiplicand for a 1 bit
+_Multiply_L2:
+    asl     dx                  ; the next bit is worth twice as much
+    or      cx,#0               ; until the multiplier has no 1 bits left
+    bnz     _Multiply_L1
 
-_Multiply_Return:
     pop     dx                  ; restore the context
     pop     cx
-    pop     bx
     mov     sp,bp               ; return from the subroutine
     pop     bp
     rts
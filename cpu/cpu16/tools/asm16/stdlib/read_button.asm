@@ -16,7 +16,11 @@
 #ifndef READ_BUTTON_ASM
 #define READ_BUTTON_ASM
 
+#include <system16/system16.asm>
+
+#ifndef LD16
 #include <system16/beep.asm>
+#endif
 
 _ReadButton:
     push    bx
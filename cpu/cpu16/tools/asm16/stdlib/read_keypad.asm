@@ -16,7 +16,11 @@
 #ifndef READ_KEYPAD_ASM
 #define READ_KEYPAD_ASM
 
+#include <system16/system16.asm>
+
+#ifndef LD16
 #include <system16/beep.asm>
+#endif
 
 _ReadKeypad:
     push    bx
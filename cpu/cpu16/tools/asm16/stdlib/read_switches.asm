@@ -14,6 +14,8 @@
 #ifndef READ_SWITCHES_ASM
 #define READ_SWITCHES_ASM
 
+#include <system16/system16.asm>
+
 _ReadSwitches:
     mov     ax,SWITCH_REG   ; return the value of the switches
     rts    
@@ -18,6 +18,8 @@
 #ifndef SHOW_LEDS_ASM
 #define SHOW_LEDS_ASM
 
+#include <system16/system16.asm>
+
 #define VALUE [bp+3]
 
 _ShowLeds:
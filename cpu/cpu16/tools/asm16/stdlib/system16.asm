@@ -2,6 +2,9 @@
 ;
 ;   This contains the I/O register definitions for system16.
 
+#ifndef SYSTEM16_ASM
+#define SYSTEM16_ASM
+
 ; general I/O registers
 .define SWITCH_REG          0x2000
 .define BUTTON_REG          0x2002
@@ -93,4 +96,4 @@
 .define KEY_E               0x1E
 .define KEY_F               0x1F
 
-
+#endif // SYSTEM16_ASM
@@ -7,14 +7,65 @@
 #include "y.tab.h"
 #include "message.h"
 #include "symtab.h"
+#include "asm16.h"
+#include "obj16.h"
 
-extern int asm_pass;
 extern unsigned short cur_addr;
 
 struct Symbol* symbolTable;
 struct Symbol* symtabHead;
 struct Symbol* symtabTail;
 
+/*
+ *  The symbols are kept in definition order on the symtab list and are found
+ *  by name through an open addressing hash table with linear probing, which
+ *  is doubled when it gets half full.  Compiler output has thousands of labels,
+ *  so s_find() must not walk the list.
+ */
+static struct Symbol **hashTable;
+static unsigned hashSize;           // power of 2
+static unsigned hashCount;
+
+static unsigned hash(const char *name)
+{
+    unsigned h = 2166136261u;       // FNV-1a
+
+    while (*name)
+    {
+        h = (h ^ (unsigned char)*name++) * 16777619u;
+    }
+    return h;
+}
+
+// the slot holding name, or the empty slot where it belongs
+static struct Symbol **s_slot(const char *name)
+{
+    unsigned i = hash(name) & (hashSize - 1);
+
+    while (hashTable[i] && strcmp(hashTable[i]->s_name, name) != 0)
+    {
+        i = (i + 1) & (hashSize - 1);
+    }
+    return &hashTable[i];
+}
+
+static void s_grow()
+{
+    struct Symbol *ptr;
+
+    free(hashTable);
+    hashSize = hashSize ? 2 * hashSize : 1024;
+    hashTable = (struct Symbol **)calloc(hashSize, sizeof(struct Symbol *));
+    if (!hashTable)
+    {
+        fatal("out of memory for the symbol table");
+    }
+    for (ptr = symtabHead; ptr; ptr = ptr->s_next)
+    {
+        *s_slot(ptr->s_name) = ptr;
+    }
+}
+
 static char* strsave(const char* s)
 {
     char* cp = calloc(strlen(s)+1, 1);
@@ -30,9 +81,16 @@ static char* strsave(const char* s)
 struct Symbol *s_create(char *name)
 {
     struct Symbol *newSymbol = (struct Symbol *)NULL; 
+    struct Symbol **slot;
        
+    if (2 * (hashCount + 1) > hashSize)
+    {
+        s_grow();
+    }
+    
     // ensure the symbol is unique then create it
-    if (!s_find(name))
+    slot = s_slot(name);
+    if (!*slot)
     {
         newSymbol = (struct Symbol *)calloc(1, sizeof(struct Symbol));    
         if (newSymbol)
@@ -55,6 +113,8 @@ struct Symbol *s_create(char *name)
                 symtabTail->s_next = newSymbol;
                 symtabTail = newSymbol;
             }
+            *slot = newSymbol;
+            hashCount++;
         }
     }
      
@@ -63,18 +123,7 @@ struct Symbol *s_create(char *name)
 
 struct Symbol *s_find(const char *name)
 {
-    struct Symbol *ptr;
-    
-    // search symtab for name
-    for (ptr = symtabHead; ptr; ptr = ptr->s_next)
-    {
-        if (strcmp(ptr->s_name, name) == 0)
-        {
-            break;                
-        }
-    }
-   
-    return ptr;
+    return hashSize ? *s_slot(name) : (struct Symbol *)NULL;
 }
 
 // symbol table lookup used in lexer
@@ -141,36 +190,29 @@ int chk_identifier(struct Symbol *symbol, int type)
     return 1;
 }
 
-// RAM allocation
-
-#define FIRST_ZPRAM_ADDR    0x00    // Zero Page indeces are allocated from 0x00 to 0xff
-#define ZPRAM_LENGTH        0x100
+// RAM allocation, FIRST_ZPRAM_ADDR etc. are in obj16.h
 
-#define FIRST_RAM_ADDR      0x0100  // RAM locations are allocated from 0x0100 to 0x07ff
-#define RAM_LENGTH          0x0300
-
-#define FIRST_HEAP_ADDR     0x0400  // heap locations are allocated from 0x0800 to 0x0dff
-#define HEAP_LENGTH         0x0300
-
-// the stack resides in the range 0x0700 - 0x0FFF
+// the stack resides in the range 0x0800 - 0x0FFF, below it 0x0700 - 0x07FF is reserved
+// for the cc16 -p block counters, see FIRST_PROFILE_ADDR
 // the "sp" should be initialized to the end of RAM (0x0FFF) - the stack grows downward
 
+static unsigned short nextZPAddr = FIRST_ZPRAM_ADDR;
+static unsigned short nextRamAddr = FIRST_RAM_ADDR;
+static unsigned short nextHeapAddr = FIRST_HEAP_ADDR;
+
 int s_alloc_ram(struct Symbol *symbol, int type, int size)
 {
-    static unsigned short nextZPAddr = FIRST_ZPRAM_ADDR;
-    static unsigned short nextRamAddr = FIRST_RAM_ADDR;
-    static unsigned short nextHeapAddr = FIRST_HEAP_ADDR;
     int retval = 0;
 
     switch(type)
     {
         case ST_ZPRAM_ADDR:
             // the symbol represents an address which needs to be allocated from ZP RAM
-            if (nextZPAddr < FIRST_ZPRAM_ADDR + ZPRAM_LENGTH)
+            if (nextZPAddr + size <= FIRST_ZPRAM_ADDR + ZPRAM_LENGTH)
             {
                 if ((retval = s_define(symbol, ST_ZPRAM_ADDR, nextZPAddr)))
                 {
-                    nextZPAddr++;
+                    nextZPAddr += size;
                 }
             }
             else
@@ -180,11 +222,11 @@ int s_alloc_ram(struct Symbol *symbol, int type, int size)
             break;
         case ST_RAM_ADDR:
             // the symbol represents an address which needs to be allocated from non-ZP RAM
-            if (nextRamAddr < FIRST_RAM_ADDR + RAM_LENGTH)
+            if (nextRamAddr + size <= FIRST_RAM_ADDR + RAM_LENGTH)
             {
                 if ((retval = s_define(symbol, ST_RAM_ADDR, nextRamAddr)))
                 {
-                    nextRamAddr++;
+                    nextRamAddr += size;
                 }
             }
             else
@@ -194,7 +236,7 @@ int s_alloc_ram(struct Symbol *symbol, int type, int size)
             break;
         case ST_HEAP_ADDR:
             // the symbol represents a range of addresses which needs to be allocated from the heap
-            if (nextHeapAddr < FIRST_HEAP_ADDR + HEAP_LENGTH)
+            if (nextHeapAddr + size <= FIRST_HEAP_ADDR + HEAP_LENGTH)
             {
                 if ((retval = s_define(symbol, ST_RAM_ADDR, nextHeapAddr)))
                 {
@@ -211,5 +253,20 @@ int s_alloc_ram(struct Symbol *symbol, int type, int size)
     return retval;       
 }
 
+// words allocated so far
+int s_ram_size(int type)
+{
+    switch(type)
+    {
+        case ST_ZPRAM_ADDR:
+            return nextZPAddr - FIRST_ZPRAM_ADDR;
+        case ST_RAM_ADDR:
+            return nextRamAddr - FIRST_RAM_ADDR;
+        case ST_HEAP_ADDR:
+            return nextHeapAddr - FIRST_HEAP_ADDR;
+    }
+    return 0;
+}
+
 // end of symtab.c
 
@@ -14,6 +14,7 @@ struct Symbol
     const char*     s_name;
     int s_type;
     unsigned short  s_value;
+    unsigned short  s_index;    // object symbol number, see WriteObject()
     struct Symbol*  s_next;
 };
 
@@ -24,4 +25,5 @@ void s_lookup(int yylex);
 int s_define(struct Symbol *label, int type, unsigned value);
 int chk_identifier(struct Symbol *symbol, int type);
 int s_alloc_ram(struct Symbol *label, int type, int size);
+int s_ram_size(int type);
 
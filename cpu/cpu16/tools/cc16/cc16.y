@@ -326,6 +326,7 @@ statements
 statement
 	: expression sc/*';'*/
 	    {
+	        gen_discard();
 	        if (!is_void_expr)
 	        {
 	            //gen_pr(OP_POP, "clear stack for expression");
@@ -341,11 +342,11 @@ statement
 	| CONTINUE sc/*';'*/
 	    {gen_continue();}
 	| RETURN sc/*';'*/
-	    //{gen_pr(OP_RETURN, "RETURN from void fct");}
+	    {gen_leave();}
 	| RETURN expression sc/*';'*/
 	    {
 	        gen_pop(OP_POP_RET, "value to return");
-	        //gen_pr(OP_RETURN, "RETURN value from fct");
+	        gen_leave();
 	    }
 	| compound_statement
 	| if_prefix statement
@@ -431,6 +432,7 @@ binary
 	    {$$ = $<y_sym>1;}
 	| Identifier '(' rp/*')'*/
 	    {
+	        gen_args($1);
 	        gen_call($1, 0);
 	        if (TYPE($1) == VFUNC)
 	        {
@@ -440,6 +442,7 @@ binary
 	| Identifier '(' 
 	    {
 	        chk_func($1);
+	        gen_args($1);
 	    }
 	  argument_list rp/*')'*/
 	    {
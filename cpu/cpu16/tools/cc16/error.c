@@ -11,6 +11,7 @@
 /*
  *  yywhere() -- input position for yyparse()
  *  yymark() -- get information from '# line file'
+ *  yyfile() -- input file name without the quotes
  */
 
 extern char *yytext;    // current token
@@ -94,6 +95,28 @@ void yymark()
     }
 }
 
+const char *yyfile()
+{
+    extern char *infileName;
+    static char name[256];
+    const char *cp = source ? source : "";
+    int len = strlen(cp);
+
+    if (*cp == '"' && len >= 2)
+    {
+        ++cp;
+        len -= 2;
+    }
+    snprintf(name, sizeof name, "%.*s", len, cp);
+
+    // cpp reads the input file from stdin
+    if ((!*name || !strcmp(name, "<stdin>")) && infileName)
+    {
+        return infileName;
+    }
+    return name;
+}
+
 void yyerror(const char *s)
 {
 	extern int yynerrs;     // total number of errors	
@@ -4,5 +4,6 @@
 
 void yywhere();
 void yymark();
+const char *yyfile();
 void yyerror(const char *s);
 
@@ -13,6 +13,7 @@ extern FILE *yyout;
 extern int objOnly;
 extern int emitVmCode;
 extern int verbose;
+extern int regAbi;
 
 // assignment op modifier strings
 char* AluAssignOpStrs[15] =
@@ -40,6 +41,8 @@ static struct Bc_stack
     struct Bc_stack *bc_next;
 } *b_top,                       // head of break stack 
   *c_top;                       // head of continue stack
+
+static int return_label;        // the epilogue of the function, 0 until a return jumps to it
   
 char *gen_mod(struct Symtab *symbol)
 {
@@ -139,6 +142,16 @@ void gen_continue()
     gen_jump(OP_JUMP, top(c_top), "CONTINUE");
 }
 
+// a return leaves the function, gen_return places the epilogue it jumps to
+void gen_leave()
+{
+    if (!return_label)
+    {
+        return_label = new_label();
+    }
+    gen_jump(OP_JUMP, return_label, "RETURN");
+}
+
 void end_program()
 {
     // allocate global variables
@@ -151,31 +164,40 @@ void end_program()
 
 void gen_begin_prog()
 {
-    if (!objOnly)
+    if (emitVmCode)
     {
-        if (emitVmCode)
+        if (!objOnly)
         {
             fprintf(yyout, "\t%s\n", OP_BEGIN);
         }
-        else
-        {
-            GenBeginProg();
-        }
+    }
+    else
+    {
+        // an object has no runtime but its globals are still declared
+        GenBeginProg(!objOnly);
     }
 }
 
 void gen_end_prog()
 {
-    if (!objOnly)
+    if (emitVmCode)
     {
-        if (emitVmCode)
+        if (!objOnly)
         {
             fprintf(yyout, "\t%s\n", OP_END);
         }
-        else
-        {
-            GenEndProg();
-        }
+    }
+    else
+    {
+        GenEndProg();
+    }
+}
+
+void gen_global(struct Symtab *symbol)
+{
+    if (!emitVmCode)
+    {
+        GenGlobal(symbol->s_name, symbol->s_offset, symbol->s_size);
     }
 }
 
@@ -263,8 +285,22 @@ void gen_pop(const char *op, const char *comment)
     }
 }
 
+// discard the value of an expression statement, the VM code leaves it on the stack
+void gen_discard()
+{
+    if (!emitVmCode)
+    {
+        GenDiscard();
+    }
+}
+
 void gen_return(const char *op, const char *comment)
 {
+    if (return_label)
+    {
+        gen_label(return_label);
+        return_label = 0;
+    }
     if (emitVmCode)
     {
         fprintf(yyout, "\t%s\t\t\t;\t%s\n", op, comment);
@@ -304,6 +340,19 @@ int gen_label(int label)
     return label;
 }
 
+// before the arguments of a call are pushed, a call before the function is defined takes them on the stack
+void gen_args(struct Symtab *symbol)
+{
+    if (symbol->s_abi == ABI_NOT_SET)
+    {
+        symbol->s_abi = ABI_STACK;
+    }
+    if (!emitVmCode)
+    {
+        GenArgs(symbol->s_name, symbol->s_abi == ABI_STACK);
+    }
+}
+
 void gen_call(struct Symtab *symbol, int count)
 {
     chk_parm(symbol, count);
@@ -311,21 +360,22 @@ void gen_call(struct Symtab *symbol, int count)
     {
         //fprintf(yyout, "\t%s\t%d,%s\n", OP_CALL, count, symbol->s_name);
         fprintf(yyout, "\t%s\t%s\n", OP_CALL, symbol->s_name);
+        while (count-- > 0)
+        {
+            gen_pop(OP_POP_ARG, "discard argument");
+        }
+        if (symbol->s_type != VFUNC)
+        {
+            //gen_direct(OP_LOAD, MOD_GLOBAL, 0, "push result");
+            gen_direct(OP_LOAD, MOD_FCT, 0, "function retval");
+        }
     }
     else
     {
-        GenCall(symbol->s_name);
-    }
-    while (count-- > 0)
-    {
-        gen_pop(OP_POP_ARG, "discard argument");
-    }
-    if (symbol->s_type != VFUNC)
-    {
-        //gen_direct(OP_LOAD, MOD_GLOBAL, 0, "push result");
-        gen_direct(OP_LOAD, MOD_FCT, 0, "function retval");
+        // the call discards the arguments and loads the retval itself
+        GenCall(symbol->s_name, count, symbol->s_type != VFUNC, symbol->s_abi == ABI_REG && count <= REG_ARG_QTY);
     }
-    else
+    if (symbol->s_type == VFUNC)
     {
         is_void = 1;
     }
@@ -335,13 +385,17 @@ int gen_entry(struct Symtab *symbol)
 {
     int label = new_label();
     
+    if (symbol->s_abi == ABI_NOT_SET)
+    {
+        symbol->s_abi = regAbi && symbol->s_pnum > 0 && symbol->s_pnum <= REG_ARG_QTY ? ABI_REG : ABI_STACK;
+    }
     if (emitVmCode)
     {
         fprintf(yyout, "%s\t%s\t%s\n", OP_ENTRY, symbol->s_name, format_label(label));
     }
     else
     {
-        GenEntry(symbol->s_name, format_label(label));
+        GenEntry(symbol->s_name, format_label(label), symbol->s_pnum, symbol->s_abi == ABI_REG);
     }
     
     return label;
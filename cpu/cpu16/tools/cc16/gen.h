@@ -88,6 +88,7 @@ char* AluAssignOpStrs[15];
 
 void gen_begin_prog();
 void gen_end_prog();
+void gen_global(struct Symtab *symbol);
 void gen_alu(const char *mod, const char *comment);
 void gen_load_immed(const char *constant);
 char *gen_mod(struct Symtab *symbol);
@@ -96,6 +97,7 @@ void gen_indirect(const char *op, const char *mod, int val, const char *comment,
 void gen_pointer(const char *op, const char *mod, int val, const char *comment, int is_rhs);
 void gen_reference(const char *op, const char *mod, int val, const char *comment);
 void gen_pop(const char *op, const char *comment);
+void gen_discard();
 void gen_return(const char *op, const char *comment);
 int gen_jump(const char *op, int label, const char *comment);
 int new_label();
@@ -106,6 +108,8 @@ void pop_break();
 void pop_continue();
 void gen_break();
 void gen_continue();
+void gen_leave();
+void gen_args(struct Symtab *symbol);
 void gen_call(struct Symtab *symbol, int count);
 int gen_entry(struct Symtab *symbol);
 void fix_entry(struct Symtab *symbol, int label);
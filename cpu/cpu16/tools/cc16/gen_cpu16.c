@@ -11,6 +11,41 @@
  *      - references
  *      - functions
  *
+ *  The abstract code generator is a stack machine.  Rather than pushing every
+ *  value on the CPU stack, the values are kept on a compile-time expression
+ *  stack of operands.  A constant or a variable is not loaded until it is used,
+ *  so it can be the source of an instruction, e.g. "add ax,#1", and every other
+ *  value is kept in a register, ax-dx.  When they are all taken, the value at
+ *  the bottom of the expression stack is spilled, i.e. pushed on the CPU stack.
+ *  Everything is spilled before a call, where the arguments must be on the CPU
+ *  stack, and at a label or a jump, so that the stack is the same on every path.
+ *
+ *  With -r a function with one or two params that is defined before it is called,
+ *  i.e. not an external routine, takes them in ax and bx, and keeps them there,
+ *  i.e. they are pinned and only the other registers hold values.  A
+ *  call saves the pinned params on the CPU stack and restores them after.  The
+ *  body of a function is buffered until its end, when it is known whether it has
+ *  locals or stack params, so a function without either has no stack frame.
+ *
+ *  A return loads its value into ax and jumps to the epilogue at the end of the
+ *  function, as in C, so no code runs after it and a param pinned in ax can be
+ *  given up for the retval.
+ *
+ *  A global is the asm16 symbol G_<name>, which is declared with .dz, .dw or .ds
+ *  once the whole program is compiled and its uses are counted, see PlaceGlobals().
+ *  So the program is buffered too.  asm16 uses the one word ZP format for a load or
+ *  store of a .dz symbol, so the code is the same wherever a global is placed.
+ *
+ *  With -n a call of a leaf function without a stack frame whose body is at most
+ *  that many instructions is replaced by a copy of the body, with its labels
+ *  renamed, and so is a call of one of the short libasm I/O routines.  The
+ *  function bodies are buffered as for -r, so a function with no params and no
+ *  locals has no stack frame either.
+ *
+ *  With -p each basic block, i.e. a function entry, a label and the fall through
+ *  of a conditional jump, increments a 32-bit counter at PROFILE_BASE.  The
+ *  comment before the increment names the block, its function and its source
+ *  line, which is how prof16 maps a RAM dump of the counters back to the C code.
  */
 
 #include <stdio.h>
@@ -20,195 +55,1158 @@
 #include "symtab.h"
 #include "gen.h"
 #include "gen_cpu16.h"
+#include "error.h"
 
 // output file as defined in the parser
 extern FILE *yyout;
 
+// generate code for a CPU16 without the multiply/divide unit and the barrel shifter
+extern int baseCpu16;
+
+// pass up to REG_ARG_QTY arguments in registers
+extern int regAbi;
+
+// words of the ZP for the globals
+extern int zpWords;
+
+// instructions of the largest function body expanded in place of a call
+extern int inlineInstrs;
+
+// count the runs of each basic block
+extern int profile;
+
+extern int yylineno;
+
+extern int verbose;
+
 char *curFileName;
 char *curFctName;
 int labelId = 0;
 int returnId = 0;
 unsigned curLocalVarQty;
 
+static void ResetExpr();
+static void InlineReport();
+static void CallFct(const char *fctname, int argQty, int hasRetval, int isRegCall, int isSaved);
+
 #define STACK_BASE 0x0fff
+
+// the -p block counters, two words each, are in the region reserved for them
+// between the heap and the stack, see FIRST_PROFILE_ADDR in obj16.h, and its
+// last two words are a guard, cleared at the start, which prof16 checks for a
+// stack that overflowed into the counters
+#define PROFILE_BASE    0x0700
+#define PROFILE_BLOCKS  127
+#define PROFILE_GUARD   (PROFILE_BASE + 2 * PROFILE_BLOCKS)
+
+static int profileQty;
+static int profileLost;         // blocks past PROFILE_BLOCKS
 #define FRAME_BASE 0
-// the global base is implicitly 0
 
-void GenBeginProg()
+// the RAM region of asm16 and ld16 for .dw, see obj16.h, the heap is for .ds
+#define RAM_WORDS   0x300
+#define HEAP_WORDS  0x300
+
+static int pinQty;              // params of the current function pinned in ax and bx
+static int needFrame;           // the current function has stack params
+static char frameSymbol[16];    // the .define of its locals count
+static FILE *fctOut;            // the output file while a function body is buffered
+static char *fctBuf;
+static size_t fctBufSize;
+
+// a global variable
+struct Global
 {
-    fprintf(yyout, "\n; begin program\n");
-    
-	// set the initial stack base and frame pointer
-	fprintf(yyout, "; initialize the runtime\n");
-	fprintf(yyout, "    mov     sp,@0x%04x\n", STACK_BASE);
-	fprintf(yyout, "    zero    bp\n");
-	fprintf(yyout, "    jmp     main\n\n");
-	fprintf(yyout, "; define all register definitions and return codes\n");
-	fprintf(yyout, "#include <system16/system16.asm>\n\n");
-	fprintf(yyout, "; insert all libasm code\n");
-	fprintf(yyout, "#include <system16/libasm.asm>\n\n");
+    char name[40];              // asm16 symbol, G_<name>
+    int offset;                 // its g_offset, which identifies it
+    int size;                   // 0 for a scalar, the words of an array
+    int uses;                   // loads and stores, which are a word shorter in the ZP
+    char init[32];              // initial value, set by the runtime before main()
+    const char *region;         // .dz, .dw or .ds
+};
+
+static struct Global *globals;
+static int globalQty;
+static int globalSize;
+static int inFct;               // not at file scope
+static int hasRuntime;          // a program rather than an object
+static FILE *progOut;           // the output file while the program is buffered
+static char *progBuf;
+static size_t progBufSize;
+
+void GenBeginProg(int isProgram)
+{
+    // the program is buffered until its globals are placed
+    hasRuntime = isProgram;
+    progOut = yyout;
+    if (!(yyout = open_memstream(&progBuf, &progBufSize)))
+    {
+        fatal("cannot buffer the program");
+    }
+}
+
+void GenGlobal(const char *name, int offset, int size)
+{
+    struct Global *global;
+
+    if (globalQty == globalSize)
+    {
+        globalSize = globalSize ? 2 * globalSize : 64;
+        if (!(globals = (struct Global *)realloc(globals, globalSize * sizeof(struct Global))))
+        {
+            fatal("out of memory");
+        }
+    }
+    global = &globals[globalQty++];
+    memset(global, 0, sizeof *global);
+    snprintf(global->name, sizeof global->name, "G_%s", name);
+    global->offset = offset;
+    global->size = size;
+}
+
+static struct Global *FindGlobal(int offset)
+{
+    int i;
+
+    for (i = 0; i < globalQty; i++)
+    {
+        if (globals[i].offset == offset)
+        {
+            return &globals[i];
+        }
+    }
+    bug("global at offset %d", offset);
+    return NULL;
+}
+
+// the most used first, then in the order declared
+static int CompareUses(const void *a, const void *b)
+{
+    const struct Global *x = *(const struct Global **)a;
+    const struct Global *y = *(const struct Global **)b;
+
+    return x->uses != y->uses ? y->uses - x->uses : x->offset - y->offset;
+}
+
+// the region a global fits in, ZP first
+static void Place(struct Global *global, int *zp, int *ram, int *heap)
+{
+    int words = global->size ? global->size : 1;
+
+    if (*zp + words <= zpWords)
+    {
+        global->region = ".dz";
+        *zp += words;
+    }
+    else if (*ram + words <= RAM_WORDS)
+    {
+        global->region = ".dw";
+        *ram += words;
+    }
+    else
+    {
+        global->region = ".ds";
+        *heap += words;
+    }
+}
+
+/*
+ *  Place the globals, in the ZP with .dz, in RAM with .dw or in the heap with .ds.
+ *  The scalars with the most uses get the ZP, then the arrays get what is left of
+ *  it.  asm16 allocates their addresses in the order declared, or ld16 for an
+ *  object.  An array grows downward like the stack so its symbol is its last word,
+ *  which is allocated just after the rest of it as GL_<name>.
+ */
+static void PlaceGlobals()
+{
+    struct Global **order;
+    int i, zp = 0, ram = 0, heap = 0;
+
+    if (!(order = (struct Global **)malloc((globalQty + 1) * sizeof(struct Global *))))
+    {
+        fatal("out of memory");
+    }
+    for (i = 0; i < globalQty; i++)
+    {
+        order[i] = &globals[i];
+    }
+    qsort(order, globalQty, sizeof *order, CompareUses);
+    for (i = 0; i < globalQty; i++)
+    {
+        if (!order[i]->size)
+        {
+            Place(order[i], &zp, &ram, &heap);
+        }
+    }
+    for (i = 0; i < globalQty; i++)
+    {
+        if (globals[i].size)
+        {
+            Place(&globals[i], &zp, &ram, &heap);
+        }
+    }
+    free(order);
+    if (heap > HEAP_WORDS)
+    {
+        fatal("the globals need %d words of heap, more than the %d there are", heap, HEAP_WORDS);
+    }
+
+    fprintf(yyout, "\n; globals\n");
+    for (i = 0; i < globalQty; i++)
+    {
+        struct Global *global = &globals[i];
+
+        if (global->size > 1)
+        {
+            fprintf(yyout, "    %s     GL_%s %d\n", global->region, global->name + 2, global->size - 1);
+        }
+        if (strcmp(global->region, ".ds"))
+        {
+            fprintf(yyout, "    %s     %s\t; %d use(s)\n", global->region, global->name, global->uses);
+        }
+        else
+        {
+            fprintf(yyout, "    .ds     %s 1\t; %d use(s)\n", global->name, global->uses);
+        }
+    }
+
+    if (verbose)
+    {
+        fprintf(stderr, "globals: zp %d/%d, ram %d/%d, heap %d/%d words\n",
+            zp, zpWords, ram, RAM_WORDS, heap, HEAP_WORDS);
+        for (i = 0; i < globalQty; i++)
+        {
+            fprintf(stderr, "    %s %-24s %5d word(s) %5d use(s)\n", globals[i].region, globals[i].name + 2,
+                globals[i].size ? globals[i].size : 1, globals[i].uses);
+        }
+    }
 }
 
 void GenEndProg()
 {
+    int i;
+
+    fclose(yyout);
+    yyout = progOut;
+    PlaceGlobals();
+
+    if (hasRuntime)
+    {
+        fprintf(yyout, "\n; begin program\n");
+        fprintf(yyout, "__Start:\n");         // so a profile can name the start-up code
+
+        // set the initial stack base and frame pointer
+        fprintf(yyout, "; initialize the runtime\n");
+        fprintf(yyout, "    mov     sp,@0x%04x\n", STACK_BASE);
+        fprintf(yyout, "    zero    bp\n");
+        for (i = 0; i < globalQty; i++)
+        {
+            if (globals[i].init[0])
+            {
+                fprintf(yyout, "    mov     ax,%s\n", globals[i].init);
+                fprintf(yyout, "    mov     %s,ax\n", globals[i].name);
+            }
+        }
+        if (profileQty)
+        {
+            fprintf(yyout, "; clear the profile counters\n");
+            fprintf(yyout, "    mov     bx,@0x%04x\n", PROFILE_BASE);
+            fprintf(yyout, "    mov     cx,@%d\n", 2 * profileQty);
+            fprintf(yyout, "    zero    dx\n");
+            fprintf(yyout, "_PG_Clear:\n");
+            fprintf(yyout, "    mov     [bx],dx\n");
+            fprintf(yyout, "    inc     bx\n");
+            fprintf(yyout, "    dec     cx\n");
+            fprintf(yyout, "    bnz     _PG_Clear\n");
+            fprintf(yyout, "    mov     0x%04x,dx\n", PROFILE_GUARD);
+            fprintf(yyout, "    mov     0x%04x,dx\n", PROFILE_GUARD + 1);
+        }
+        fprintf(yyout, "    bra     main\n\n");     // asm16 relaxes a branch out of reach to a jmp
+        fprintf(yyout, "; define all register definitions and return codes\n");
+        fprintf(yyout, "#include <system16/system16.asm>\n\n");
+        fprintf(yyout, "; insert all libasm code, unless ld16 links the routines called from libasm.a\n");
+        fprintf(yyout, "#ifndef LD16\n");
+        fprintf(yyout, "#include <system16/libasm.asm>\n");
+        fprintf(yyout, "#endif\n\n");
+    }
+
+    fputs(progBuf, yyout);
+    free(progBuf);
+    if (verbose)
+    {
+        InlineReport();
+        if (profileQty)
+        {
+            fprintf(stderr, "profile: %d block counter(s) at 0x%04x, %d block(s) not counted\n",
+                profileQty, PROFILE_BASE, profileLost);
+        }
+    }
+
+    if (!hasRuntime)
+    {
+        return;
+    }
     fprintf(yyout, "\n; end program\n");
 
     fprintf(yyout, "__Exit:\n");
     fprintf(yyout, "    bra    __Exit\n\n");
 }
 
+/*
+ *  Count a run of the basic block that starts here, dx is free at the start of
+ *  a block as the pinned params are in ax and bx and a retval is in ax.  The
+ *  high word is only incremented when the low one wraps around.
+ */
+static void GenProfile()
+{
+    int addr = PROFILE_BASE + 2 * profileQty;
+
+    if (!profile || !inFct)
+    {
+        return;
+    }
+    if (profileQty == PROFILE_BLOCKS)
+    {
+        if (!profileLost++)
+        {
+            warning("more than %d blocks to profile, the rest are not counted", PROFILE_BLOCKS);
+        }
+        return;
+    }
+
+    fprintf(yyout, "; profile block %d in %s at %s:%d\n", profileQty, curFctName, yyfile(), yylineno);
+    fprintf(yyout, "    mov     dx,0x%04x\n", addr);
+    fprintf(yyout, "    inc     dx\n");
+    fprintf(yyout, "    mov     0x%04x,dx\n", addr);
+    fprintf(yyout, "    bnz     _PG%d\n", profileQty);
+    fprintf(yyout, "    mov     dx,0x%04x\n", addr + 1);
+    fprintf(yyout, "    inc     dx\n");
+    fprintf(yyout, "    mov     0x%04x,dx\n", addr + 1);
+    fprintf(yyout, "_PG%d:\n", profileQty);
+    profileQty++;
+}
+
 // create the stack frame: push current BP, move SP to BP, then adjust SP past local variables
-void GenEntry(const char *fctname, const char *symbol)
+static void GenFrame(const char *symbol)
+{
+    fprintf(yyout, "    push    bp\n");
+    fprintf(yyout, "    mov     bp,sp\n");
+    fprintf(yyout, "    sub     sp,@%s\n", symbol);
+}
+
+void GenEntry(const char *fctname, const char *symbol, int paramQty, int isRegAbi)
 {    
     fprintf(yyout, "\n; fct entry\n");
 
     curFctName = (char *)fctname;    
+    inFct = 1;
     fprintf(yyout, "%s:\n", fctname);
-    fprintf(yyout, "    push    bp\n");
-    fprintf(yyout, "    mov     bp,sp\n");
-    fprintf(yyout, "    sub     sp,@%s\n", symbol);
+    if (regAbi || inlineInstrs)
+    {
+        // GenReturn creates the stack frame if the function turns out to need one
+        pinQty = isRegAbi ? paramQty : 0;
+        needFrame = paramQty > pinQty;
+        snprintf(frameSymbol, sizeof frameSymbol, "%s", symbol);
+        fctOut = yyout;
+        if (!(yyout = open_memstream(&fctBuf, &fctBufSize)))
+        {
+            fatal("cannot buffer function %s", fctname);
+        }
+    }
+    else
+    {
+        needFrame = 1;
+        GenFrame(symbol);
+    }
+    ResetExpr();
+    GenProfile();
+}
+
+// the expression stack
+enum OperandKind
+{
+    OPND_STACK,                 // spilled on the CPU stack
+    OPND_REG,                   // in reg
+    OPND_CONST,                 // constant, not loaded yet
+    OPND_VAR,                   // scalar variable, not loaded yet
+    OPND_MEM                    // the word that reg points to, not loaded yet
+};
+
+struct Operand
+{
+    enum OperandKind kind;
+    int reg;                    // OPND_REG and OPND_MEM
+    int value;                  // OPND_CONST
+    char text[16];              // OPND_CONST as written
+    const char *vartype;        // OPND_VAR
+    int offset;
+    char name[32];
+};
+
+#define EXPR_STACK_SIZE 64
+#define REG_QTY         4       // ax, bx, cx and dx hold the values
+#define REG_AX          0       // function retvals are in ax
+#define SHIFT_UNROLL_MAX 4      // without the barrel shifter a shift by a constant up to this is unrolled
+
+static const char *regNames[REG_QTY] = {"ax", "bx", "cx", "dx"};
+static int regBusy[REG_QTY];
+
+static struct Operand exprStack[EXPR_STACK_SIZE];
+static int exprDepth;
+
+// for each call being generated, whether GenArgs saved the pinned params under its args
+static int callSaved[EXPR_STACK_SIZE];
+static int callDepth;
+
+// free all registers but those of the pinned params
+static void FreeRegs()
+{
+    memset(regBusy, 0, sizeof regBusy);
+    memset(regBusy, 1, pinQty * sizeof regBusy[0]);
+}
+
+// forget the expression stack, e.g. once the stack frame is reset
+static void ResetExpr()
+{
+    FreeRegs();
+    exprDepth = 0;
+}
+
+// the register that param offset is pinned in, the first param is in ax
+static int PinnedReg(const char *vartype, int offset)
+{
+    return pinQty && !strcmp(vartype, "par") ? pinQty - 1 - offset : -1;
+}
+
+// push the pinned params to save them across a call
+static void SavePinned()
+{
+    int reg;
+
+    for (reg = 0; reg < pinQty; reg++)
+    {
+        fprintf(yyout, "    push    %s\n", regNames[reg]);
+    }
+}
+
+static void RestorePinned()
+{
+    int reg;
+
+    for (reg = pinQty - 1; reg >= 0; reg--)
+    {
+        fprintf(yyout, "    pop     %s\n", regNames[reg]);
+    }
+}
+
+static int IsLazy(struct Operand *op)
+{
+    return op->kind == OPND_CONST || op->kind == OPND_VAR || op->kind == OPND_MEM;
+}
+
+static void FreeOperand(struct Operand *op)
+{
+    if (op->kind == OPND_REG || op->kind == OPND_MEM)
+    {
+        regBusy[op->reg] = 0;
+    }
+}
+
+// load a variable into a register based on its type
+static void GenLoadVar(int reg, const char *vartype, int offset, const char *globalName)
+{
+    if (!strcmp(vartype, "gbl"))
+    {
+        // asm16 uses ZP addressing if the global is placed in the ZP
+        FindGlobal(offset)->uses++;
+        fprintf(yyout, "    mov     %s,%s\t; global %s\n", regNames[reg], FindGlobal(offset)->name, globalName);
+    }
+    else if (PinnedReg(vartype, offset) >= 0)
+    {
+        if (PinnedReg(vartype, offset) != reg)
+        {
+            fprintf(yyout, "    mov     %s,%s\t; param %s\n", regNames[reg], regNames[PinnedReg(vartype, offset)], globalName);
+        }
+    }
+    else if (!strcmp(vartype, "par"))
+    {
+        // parameter n is at BP+n+3 and can be accessed with a single 5-bit offset instruction
+        fprintf(yyout, "    mov     %s,[bp+0x%x]\t; param %s\n", regNames[reg], (offset+3) & 0x1f, globalName);
+    }
+    else if (!strcmp(vartype, "lcl"))
+    {
+        // local variable n is at BP-n (n is offset)
+        fprintf(yyout, "    mov     %s,[bp+0x%x]\t; local %s\n", regNames[reg], (-offset) & 0x1f, globalName);
+    }
+}
+
+// store a value from a register based on its type
+static void GenStoreVar(int reg, const char *vartype, int offset, const char *globalName)
+{
+    if (!strcmp(vartype, "gbl"))
+    {
+        // asm16 uses ZP addressing if the global is placed in the ZP
+        FindGlobal(offset)->uses++;
+        fprintf(yyout, "    mov     %s,%s\t; global %s\n", FindGlobal(offset)->name, regNames[reg], globalName);
+    }
+    else if (PinnedReg(vartype, offset) >= 0)
+    {
+        fprintf(yyout, "    mov     %s,%s\t; param %s\n", regNames[PinnedReg(vartype, offset)], regNames[reg], globalName);
+    }
+    else if (!strcmp(vartype, "par"))
+    {
+        // parameter n is at BP+n+3 and can be accessed with a single 5-bit offset instruction
+        fprintf(yyout, "    mov     [bp+0x%x],%s\t; param %s\n", (offset+3) & 0x1f, regNames[reg], globalName);
+    }
+    else if (!strcmp(vartype, "lcl"))
+    {
+        // local variable n is at BP-n (n is offset)
+        fprintf(yyout, "    mov     [bp+0x%x],%s\t; local %s\n", (-offset) & 0x1f, regNames[reg], globalName);
+    }
+}
+
+// load an operand into reg, which sets the flags
+static void LoadOperand(struct Operand *op, int reg)
+{
+    switch (op->kind)
+    {
+        case OPND_STACK:
+            fprintf(yyout, "    pop     %s\n", regNames[reg]);
+            break;
+        case OPND_REG:
+            if (op->reg != reg)
+            {
+                fprintf(yyout, "    mov     %s,%s\n", regNames[reg], regNames[op->reg]);
+                regBusy[op->reg] = 0;
+            }
+            break;
+        case OPND_CONST:
+            if (op->value >= 0 && op->value <= 0xff)
+                fprintf(yyout, "    mov     %s,#%d\n", regNames[reg], op->value);
+            else
+                fprintf(yyout, "    mov     %s,@%s\n", regNames[reg], op->text);
+            break;
+        case OPND_VAR:
+            GenLoadVar(reg, op->vartype, op->offset, op->name);
+            break;
+        case OPND_MEM:
+            fprintf(yyout, "    mov     %s,[%s]\n", regNames[reg], regNames[op->reg]);
+            if (op->reg != reg)
+            {
+                regBusy[op->reg] = 0;
+            }
+            break;
+    }
+    regBusy[reg] = 1;
+    op->kind = OPND_REG;
+    op->reg = reg;
+}
+
+static int AllocReg();
+
+/*
+ *  Load an operand into a register unless it is in one already.  Returns 1 if
+ *  it was loaded, i.e. the flags reflect its value.
+ */
+static int ToReg(struct Operand *op)
+{
+    switch (op->kind)
+    {
+        case OPND_REG:
+            return 0;
+        case OPND_MEM:
+            LoadOperand(op, op->reg);
+            return 1;
+        default:
+            LoadOperand(op, AllocReg());
+            return 1;
+    }
+}
+
+// push the bottom register value on the CPU stack, the values below it are there already
+static void Spill()
+{
+    int i;
+
+    for (i = 0; i < exprDepth && exprStack[i].kind == OPND_STACK; i++)
+        ;
+    if (i == exprDepth)
+    {
+        bug("no register to spill");
+    }
+    ToReg(&exprStack[i]);
+    fprintf(yyout, "    push    %s\n", regNames[exprStack[i].reg]);
+    regBusy[exprStack[i].reg] = 0;
+    exprStack[i].kind = OPND_STACK;
+}
+
+static int AllocReg()
+{
+    int reg;
+
+    for (;;)
+    {
+        for (reg = 0; reg < REG_QTY; reg++)
+        {
+            if (!regBusy[reg])
+            {
+                regBusy[reg] = 1;
+                return reg;
+            }
+        }
+        Spill();
+    }
+}
+
+// whether AllocReg can get a register, i.e. one is free or the value that Spill pushes holds one
+static int CanAllocReg()
+{
+    int i;
+
+    for (i = 0; i < REG_QTY; i++)
+    {
+        if (!regBusy[i])
+        {
+            return 1;
+        }
+    }
+    for (i = 0; i < exprDepth && exprStack[i].kind == OPND_STACK; i++)
+        ;
+    return i < exprDepth && (exprStack[i].kind == OPND_REG || exprStack[i].kind == OPND_MEM);
+}
+
+// push the whole expression stack on the CPU stack, e.g. for a call
+static void SpillAll()
+{
+    while (exprDepth && exprStack[exprDepth - 1].kind != OPND_STACK)
+    {
+        Spill();
+    }
+}
+
+/*
+ *  Only the top of the expression stack may be an operand that has not been
+ *  loaded yet, so it is loaded before another operand is pushed on it.  That
+ *  keeps a variable from being read after a later store to it.  The exception
+ *  is a run of constants, which are left for GenAlu to fold, and are loaded
+ *  bottom-up once anything else is pushed on them.
+ */
+static void PushOperand(struct Operand *op)
+{
+    int i;
+
+    if (exprDepth == EXPR_STACK_SIZE)
+    {
+        fatal("expression too complex");
+    }
+    if (exprDepth && IsLazy(&exprStack[exprDepth - 1]) &&
+        !(op->kind == OPND_CONST && exprStack[exprDepth - 1].kind == OPND_CONST))
+    {
+        for (i = exprDepth - 1; i > 0 && exprStack[i - 1].kind == OPND_CONST; i--)
+            ;
+        for (; i < exprDepth; i++)
+        {
+            ToReg(&exprStack[i]);
+        }
+    }
+    exprStack[exprDepth++] = *op;
+}
+
+static void PushConst(int value)
+{
+    struct Operand op = {OPND_CONST};
+
+    op.value = value & 0xffff;
+    snprintf(op.text, sizeof op.text, "0x%04x", op.value);
+    PushOperand(&op);
+}
+
+static void PushReg(int reg, enum OperandKind kind)
+{
+    struct Operand op = {kind, reg};
+
+    PushOperand(&op);
+}
+
+// returns 0 if the expression stack is empty
+static int PopOperand(struct Operand *op)
+{
+    if (!exprDepth)
+    {
+        return 0;
+    }
+    *op = exprStack[--exprDepth];
+    return 1;
+}
+
+/*
+ *  The source operand of a binop instruction, "binop reg,<source>".  A constant
+ *  is an immediate, a global is a direct address, and a pointer dereference is
+ *  register indirect, anything else is loaded into a register first.
+ */
+static const char *Source(struct Operand *op)
+{
+    static char text[128];
+
+    switch (op->kind)
+    {
+        case OPND_CONST:
+            if (op->value >= 0 && op->value <= 0xff)
+                sprintf(text, "#%d", op->value);
+            else
+                sprintf(text, "@%s", op->text);
+            return text;
+        case OPND_VAR:
+            if (!strcmp(op->vartype, "gbl"))
+            {
+                sprintf(text, "%s\t; global %s", FindGlobal(op->offset)->name, op->name);
+                return text;
+            }
+            if (PinnedReg(op->vartype, op->offset) >= 0)
+            {
+                return regNames[PinnedReg(op->vartype, op->offset)];
+            }
+            break;
+        case OPND_MEM:
+            sprintf(text, "[%s]", regNames[op->reg]);
+            return text;
+        default:
+            break;
+    }
+    ToReg(op);
+    return regNames[op->reg];
+}
+
+// make reg free for a specific use, moving the value it holds to another register
+static void ClaimReg(int reg)
+{
+    int i;
+
+    if (!regBusy[reg])
+    {
+        return;
+    }
+    for (i = 0; i < exprDepth; i++)
+    {
+        struct Operand *op = &exprStack[i];
+
+        if ((op->kind == OPND_REG || op->kind == OPND_MEM) && op->reg == reg)
+        {
+            int newReg = AllocReg();
+
+            fprintf(yyout, "    mov     %s,%s\n", regNames[newReg], regNames[reg]);
+            op->reg = newReg;
+            regBusy[reg] = 0;
+            return;
+        }
+    }
+    bug("ClaimReg");
+}
+
+// log2 of a power of two from 2 to 0x4000, otherwise 0
+static int Log2(int value)
+{
+    int n;
+
+    for (n = 1; n < 15; n++)
+    {
+        if (value == 1 << n)
+        {
+            return n;
+        }
+    }
+    return 0;
+}
+
+/*
+ *  Evaluate an operator on the constants at the top of the expression stack.
+ *  Returns 0 if the operands are not constants or the operator is not folded,
+ *  e.g. a division by zero, which is left for run time.  The relational
+ *  operators test the 16-bit difference the same way the code generated for
+ *  them does.
+ */
+static int FoldConstants(const char *mod)
+{
+    int unary = !strcmp(mod, ALU_NOT) || !strcmp(mod, ALU_INV) || !strcmp(mod, ALU_NEG);
+    int x, y, result;
+    short diff;
+
+    if (exprDepth < 2 - unary || exprStack[exprDepth - 1].kind != OPND_CONST ||
+        (!unary && exprStack[exprDepth - 2].kind != OPND_CONST))
+    {
+        return 0;
+    }
+    y = (short)exprStack[exprDepth - 1].value;
+    x = unary ? y : (short)exprStack[exprDepth - 2].value;
+    diff = x - y;
+
+    if      (!strcmp(mod, ALU_ADD))     result = x + y;
+    else if (!strcmp(mod, ALU_SUB))     result = x - y;
+    else if (!strcmp(mod, ALU_MUL))     result = x * y;
+    else if (!strcmp(mod, ALU_DIV) && y) result = x / y;
+    else if (!strcmp(mod, ALU_MOD) && y) result = x % y;
+    else if (!strcmp(mod, ALU_AND))     result = x & y;
+    else if (!strcmp(mod, ALU_OR))      result = x | y;
+    else if (!strcmp(mod, ALU_XOR))     result = x ^ y;
+    else if (!strcmp(mod, ALU_SL))      result = y & ~0xf ? 0 : x << y;
+    else if (!strcmp(mod, ALU_SR))      result = y & ~0xf ? 0 : (x & 0xffff) >> y;      // lsr
+    else if (!strcmp(mod, ALU_LAND))    result = x && y;
+    else if (!strcmp(mod, ALU_LOR))     result = x || y;
+    else if (!strcmp(mod, ALU_EQ))      result = diff == 0;
+    else if (!strcmp(mod, ALU_NE))      result = diff != 0;
+    else if (!strcmp(mod, ALU_GT))      result = diff > 0;
+    else if (!strcmp(mod, ALU_GE))      result = diff >= 0;
+    else if (!strcmp(mod, ALU_LT))      result = diff < 0;
+    else if (!strcmp(mod, ALU_LE))      result = diff <= 0;
+    else if (!strcmp(mod, ALU_NOT))     result = !x;
+    else if (!strcmp(mod, ALU_INV))     result = ~x;
+    else if (!strcmp(mod, ALU_NEG))     result = -x;
+    else
+    {
+        return 0;
+    }
+
+    exprDepth -= 2 - unary;
+    PushConst(result);
+    return 1;
+}
+
+// shift a register by a constant count, without the barrel shifter a short shift is unrolled
+static void GenShiftConst(int reg, const char *shift, int count)
+{
+    int counter;
+
+    if (!baseCpu16 && count > 1)
+    {
+        fprintf(yyout, "    %s     %s,#%d\n", shift, regNames[reg], count);
+        return;
+    }
+    if (count <= SHIFT_UNROLL_MAX)
+    {
+        while (count--)
+        {
+            fprintf(yyout, "    %s     %s\n", shift, regNames[reg]);
+        }
+        return;
+    }
+    counter = AllocReg();
+    fprintf(yyout, "    mov     %s,#%d\n", regNames[counter], count);
+    fprintf(yyout, "LT%d:\n", ++labelId);
+    fprintf(yyout, "    %s     %s\n", shift, regNames[reg]);
+    fprintf(yyout, "    dec     %s\n", regNames[counter]);
+    fprintf(yyout, "    bnz     LT%d\n", labelId);
+    regBusy[counter] = 0;
+}
+
+/*
+ *  Signed division or remainder by 2^n, which is a shift or a mask of the
+ *  magnitude.  The result has the sign of the dividend as _Divide and _Modulo
+ *  give it, i.e. the quotient is truncated toward zero.
+ */
+static void GenSignedPow2(struct Operand *x, int n, int isMod)
+{
+    int id, magnitude;
+    char mask[8];
+
+    sprintf(mask, n <= 8 ? "#%d" : "@0x%04x", (1 << n) - 1);
+    if (!ToReg(x))
+    {
+        fprintf(yyout, "    or      %s,#0\n", regNames[x->reg]);
+    }
+    id = ++labelId;
+    magnitude = AllocReg();
+    fprintf(yyout, "    bpl     LZ%d\n", id);
+    fprintf(yyout, "    zero    %s\n", regNames[magnitude]);         // negative so work on -x
+    fprintf(yyout, "    sub     %s,%s\n", regNames[magnitude], regNames[x->reg]);
+    if (isMod)
+        fprintf(yyout, "    and     %s,%s\n", regNames[magnitude], mask);
+    else
+        GenShiftConst(magnitude, "lsr", n);
+    fprintf(yyout, "    zero    %s\n", regNames[x->reg]);
+    fprintf(yyout, "    sub     %s,%s\n", regNames[x->reg], regNames[magnitude]);
+    fprintf(yyout, "    bra     LT%d\n", id);
+    fprintf(yyout, "LZ%d:\n", id);
+    if (isMod)
+        fprintf(yyout, "    and     %s,%s\n", regNames[x->reg], mask);
+    else
+        GenShiftConst(x->reg, "lsr", n);
+    fprintf(yyout, "LT%d:\n", id);
+    regBusy[magnitude] = 0;
+}
+
+/*
+ *  Strength reduction of a binary operator with a constant right operand, e.g.
+ *  "x * 8" is "x << 3" and "x + 0" is x.  Returns 0 if the operator is not
+ *  reduced.
+ */
+static int ReduceConstant(const char *mod)
+{
+    struct Operand x, y;
+    int c, n;
+
+    if (exprDepth < 2 || exprStack[exprDepth - 1].kind != OPND_CONST)
+    {
+        return 0;
+    }
+    c = exprStack[exprDepth - 1].value & 0xffff;
+    n = Log2(c);
+
+    // the identities leave x as it is
+    if ((c == 0 && (!strcmp(mod, ALU_ADD) || !strcmp(mod, ALU_SUB) || !strcmp(mod, ALU_OR) ||
+                    !strcmp(mod, ALU_XOR) || !strcmp(mod, ALU_SL) || !strcmp(mod, ALU_SR))) ||
+        (c == 1 && (!strcmp(mod, ALU_MUL) || !strcmp(mod, ALU_DIV))) ||
+        (c == 0xffff && !strcmp(mod, ALU_AND)))
+    {
+        exprDepth--;
+        return 1;
+    }
+    
+    // and these are zero
+    if ((c == 0 && (!strcmp(mod, ALU_MUL) || !strcmp(mod, ALU_AND))) ||
+        (c == 1 && !strcmp(mod, ALU_MOD)) ||
+        (c >= 16 && (!strcmp(mod, ALU_SL) || !strcmp(mod, ALU_SR))))
+    {
+        PopOperand(&y);
+        PopOperand(&x);
+        FreeOperand(&x);
+        PushConst(0);
+        return 1;
+    }
+
+    if ((n && (!strcmp(mod, ALU_MUL) || !strcmp(mod, ALU_DIV) || !strcmp(mod, ALU_MOD))) ||
+        !strcmp(mod, ALU_SL) || !strcmp(mod, ALU_SR))
+    {
+        fprintf(yyout, "\n; operator %s by constant\n", mod);
+        PopOperand(&y);
+        PopOperand(&x);
+        if (!strcmp(mod, ALU_MUL))
+        {
+            ToReg(&x);
+            GenShiftConst(x.reg, "asl", n);                     // x * 2^n = x << n
+        }
+        else if (!strcmp(mod, ALU_DIV) || !strcmp(mod, ALU_MOD))
+        {
+            GenSignedPow2(&x, n, !strcmp(mod, ALU_MOD));
+        }
+        else
+        {
+            ToReg(&x);
+            GenShiftConst(x.reg, strcmp(mod, ALU_SL) ? "lsr" : "asl", c);
+        }
+        PushReg(x.reg, OPND_REG);
+        return 1;
+    }
+    return 0;
 }
 
 // C operator code generation
 void GenAlu(const char *mod, const char *comment)
 {
+    struct Operand x, y;
+    int result;
+
+    // constant expressions are evaluated here, and some operators with a constant are simpler
+    if (FoldConstants(mod) || ReduceConstant(mod))
+    {
+        return;
+    }
+    
     fprintf(yyout, "\n; operator %s\n", comment);
 
     // FIXME: break out ALU generation into binary and unary operators
     // binary operators    
 	if (
 	    !strcmp(mod, "+") || !strcmp(mod, "-") || // !strcmp(mod, "++") || !strcmp(mod, "--")
-	    !strcmp(mod, "&&") || !strcmp(mod, "||") ||
-	    !strcmp(mod, "&") || !strcmp(mod, "|")  || !strcmp(mod, "^") || !strcmp(mod, "<<") || !strcmp(mod, ">>")
+	    !strcmp(mod, "&") || !strcmp(mod, "|")  || !strcmp(mod, "^")
 	)
 	{
-		fprintf(yyout, "    pop     bx\n");                      // pop x and y
-		fprintf(yyout, "    pop     ax\n");
+	    const char *src;
+
+		PopOperand(&y);                                          // y is above x if both were spilled
+		PopOperand(&x);
+		src = Source(&y);
+		ToReg(&x);
 		
 		// arithmetic operators
 		if (     !strcmp(mod, "+"))
 		{
-			fprintf(yyout, "    add     ax,bx\n");               // x + y
+			fprintf(yyout, "    add     %s,%s\n", regNames[x.reg], src);     // x + y
 		}
 		else if (!strcmp(mod, "-"))
 		{
-			fprintf(yyout, "    sub     ax,bx\n");               // x - y
+			fprintf(yyout, "    sub     %s,%s\n", regNames[x.reg], src);     // x - y
 		}
 		
-		// logical operators
-		else if (!strcmp(mod, "&&"))
-		{
-			fprintf(yyout, "    zero    cx\n");                  // assume result is false
-			fprintf(yyout, "    or      ax,#0\n");               // if ax is false exit
-		    fprintf(yyout, "    bz      LT%d\n", ++labelId);
-			fprintf(yyout, "    or      bx,#0\n");               // if bx is false exit
-		    fprintf(yyout, "    bz      LT%d\n", labelId);
-			fprintf(yyout, "    mov     cx,#1\n");               // result is true iff both are true
-		    fprintf(yyout, "LT%d:\n", labelId);
-			fprintf(yyout, "    mov     ax,cx\n");               // load ax with result
-		}
-		else if (!strcmp(mod, "||"))
-		{
-			fprintf(yyout, "    zero    cx\n");                  // assume result is false
-			fprintf(yyout, "    or      ax,bx\n");               // result is false iff both are false so exit
-		    fprintf(yyout, "    bz      LT%d\n", ++labelId);
-			fprintf(yyout, "    mov     cx,#1\n");               // otherwise flag true
-		    fprintf(yyout, "LT%d:\n", labelId);
-			fprintf(yyout, "    mov     ax,cx\n");               // load ax with result
-		}
-				
 		// bitwise operators
 		else if (!strcmp(mod, "&"))
 		{
-			fprintf(yyout, "    and     ax,bx\n");               // x & y
+			fprintf(yyout, "    and     %s,%s\n", regNames[x.reg], src);     // x & y
 		}
-		
 		else if (!strcmp(mod, "|"))
 		{
-			fprintf(yyout, "    or      ax,bx\n");               // x | y
+			fprintf(yyout, "    or      %s,%s\n", regNames[x.reg], src);     // x | y
 		}
 		else if (!strcmp(mod, "^"))
 		{
-			fprintf(yyout, "    xor     ax,bx\n");               // x ^ y
+			fprintf(yyout, "    xor     %s,%s\n", regNames[x.reg], src);     // x ^ y
 		}
-		else if (!strcmp(mod, "<<"))
+		FreeOperand(&y);
+		PushReg(x.reg, OPND_REG);                                // the result replaces x
+	}
+	
+	// logical operators
+	else if (!strcmp(mod, "&&") || !strcmp(mod, "||"))
+	{
+	    const char *src;
+
+	    // the result replaces x, so they take no register besides those of x and y
+		PopOperand(&y);
+		PopOperand(&x);
+		src = Source(&y);
+		if (!strcmp(mod, "&&"))
 		{
-		    fprintf(yyout, "LT%d:\n", ++labelId);               // x << y
-			fprintf(yyout, "    asl     ax\n");
-			fprintf(yyout, "    dec     bx\n");
-		    fprintf(yyout, "    bnz     LT%d\n", labelId);
+		    if (!ToReg(&x))
+		    {
+			    fprintf(yyout, "    or      %s,#0\n", regNames[x.reg]);       // if x is false it is the result
+		    }
+		    fprintf(yyout, "    bz      LT%d\n", ++labelId);
+			fprintf(yyout, "    mov     %s,%s\n", regNames[x.reg], src);      // if y is false it is the result
+		    fprintf(yyout, "    bz      LT%d\n", labelId);
+		}
+		else
+		{
+		    ToReg(&x);
+			fprintf(yyout, "    or      %s,%s\n", regNames[x.reg], src);      // result is false iff both are false
+		    fprintf(yyout, "    bz      LT%d\n", ++labelId);
 		}
-		else if (!strcmp(mod, ">>"))
+		fprintf(yyout, "    mov     %s,#1\n", regNames[x.reg]);               // otherwise flag true
+		fprintf(yyout, "LT%d:\n", labelId);
+		FreeOperand(&y);
+		PushReg(x.reg, OPND_REG);
+	}
+	
+	// shift operators
+	else if (!strcmp(mod, "<<") || !strcmp(mod, ">>"))
+	{
+	    const char *shift = strcmp(mod, "<<") ? "lsr" : "asl";
+
+		PopOperand(&y);
+		PopOperand(&x);
+		if (!baseCpu16)
+		{
+		    // the barrel shifter shifts by the count register, 16 or more shifts out every bit
+		    ToReg(&y);
+		    ToReg(&x);
+		    fprintf(yyout, "    %s     %s,%s\n", shift, regNames[x.reg], regNames[y.reg]);
+		}
+		else
 		{
-		    fprintf(yyout, "LT%d:\n", ++labelId);               // x >> y
-			fprintf(yyout, "    lsr     ax\n");
-			fprintf(yyout, "    dec     bx\n");
+		    // the shift count is counted down, a 0 count skips the loop
+		    ToReg(&x);
+		    if (!ToReg(&y))
+		    {
+		        fprintf(yyout, "    or      %s,#0\n", regNames[y.reg]);
+		    }
+		    fprintf(yyout, "    bz      LZ%d\n", ++labelId);
+		    fprintf(yyout, "LT%d:\n", labelId);
+		    fprintf(yyout, "    %s     %s\n", shift, regNames[x.reg]);
+		    fprintf(yyout, "    dec     %s\n", regNames[y.reg]);
 		    fprintf(yyout, "    bnz     LT%d\n", labelId);
+		    fprintf(yyout, "LZ%d:\n", labelId);
 		}
-		fprintf(yyout, "    push     ax\n");                     // push the result
+		FreeOperand(&y);
+		PushReg(x.reg, OPND_REG);
+	}
+	else if ((!strcmp(mod, "*") || !strcmp(mod, "/") || !strcmp(mod, "%")) && !baseCpu16)
+	{
+	    const char *op = !strcmp(mod, "*") ? "mul" : !strcmp(mod, "/") ? "div" : "mod";
+
+	    // the multiply/divide unit only takes register operands
+		PopOperand(&y);
+		PopOperand(&x);
+		ToReg(&y);
+		ToReg(&x);
+		fprintf(yyout, "    %s     %s,%s\n", op, regNames[x.reg], regNames[y.reg]);  // x <op> y
+		FreeOperand(&y);
+		PushReg(x.reg, OPND_REG);
 	}
 	else if (!strcmp(mod, "*") || !strcmp(mod, "/") || !strcmp(mod, "%"))
 	{
 	    // these are well-known functions that reside in libasm and must be called
 	    // the same way the parser would do so
 	    // NOTE: add any other non-intrinsic operator functions here the same way, e.g. mod (%)
+		// with -r call the variants that take x in ax and y in bx
 		if (!strcmp(mod, "*"))
 		{
-            GenCall("_Multiply");                               // TOS = x * y
+            CallFct(regAbi ? "_MultiplyR" : "_Multiply", 2, 1, regAbi, 0);  // TOS = x * y
 		}
 		else if (!strcmp(mod, "/"))
 		{
-            GenCall("_Divide");                                 // TOS = x / y
+            CallFct(regAbi ? "_DivideR" : "_Divide", 2, 1, regAbi, 0);  // TOS = x / y
 		}
 		else if (!strcmp(mod, "%"))
 		{
-            GenCall("_Modulo");                                 // TOS = x % y
+            CallFct(regAbi ? "_ModuloR" : "_Modulo", 2, 1, regAbi, 0);  // TOS = x % y
 		}
-        GenPop(OP_POP_ARG, "discard argument");                 // adjust the stack
-        GenPop(OP_POP_ARG, "discard argument");
-        GenDirect(OP_LOAD, MOD_FCT, 0, "function retval");      // load the return value
     }
     
     // logical operator
 	else if (!strcmp(mod, "!"))
 	{
 	    // replace TOS with its logical inverse
-		fprintf(yyout, "    mov     bx,#1\n");                  // assume result is true
-		fprintf(yyout, "    pop     ax\n");                     // check for 0 (x ^ 0 = 0 iff x is 0)
-		fprintf(yyout, "    xor     ax,#0\n");
+		PopOperand(&x);
+		ToReg(&x);
+		result = AllocReg();
+		fprintf(yyout, "    mov     %s,#1\n", regNames[result]);  // assume result is true
+		fprintf(yyout, "    xor     %s,#0\n", regNames[x.reg]);   // check for 0 (x ^ 0 = 0 iff x is 0)
 		fprintf(yyout, "    bz      LT%d\n", ++labelId);        // if x is not 0 make it 0
-		fprintf(yyout, "    zero    bx\n");             
+		fprintf(yyout, "    zero    %s\n", regNames[result]);             
 		fprintf(yyout, "LT%d:\n", labelId);
-        fprintf(yyout, "    mov     ax,bx\n");
-        fprintf(yyout, "    push    ax\n");
+		FreeOperand(&x);
+		PushReg(result, OPND_REG);
 	}
 	
 	// bitwise operator
 	else if (!strcmp(mod, "~"))
 	{
 	    // replace TOS with its bitwise complement
-        fprintf(yyout, "    pop     ax\n");                     // ~x := x ^ 0xffff
-        fprintf(yyout, "    xor     ax,@0xffff\n");
-        fprintf(yyout, "    push    ax\n");
+		PopOperand(&x);
+		ToReg(&x);
+        fprintf(yyout, "    xor     %s,@0xffff\n", regNames[x.reg]);     // ~x := x ^ 0xffff
+		PushReg(x.reg, OPND_REG);
 	}
 	else if (!strcmp(mod, ALU_NEG)) // "-"
 	{
 	    // replace TOS with its negative value
-        fprintf(yyout, "    zero    ax\n");                     // -x := 0 - x
-        fprintf(yyout, "    pop     bx\n");
-        fprintf(yyout, "    sub     ax,bx\n");
-        fprintf(yyout, "    push    ax\n");
-		
+	    const char *src;
+
+		PopOperand(&x);
+		src = Source(&x);
+		result = AllocReg();
+        fprintf(yyout, "    zero    %s\n", regNames[result]);            // -x := 0 - x
+        fprintf(yyout, "    sub     %s,%s\n", regNames[result], src);
+		FreeOperand(&x);
+		PushReg(result, OPND_REG);
 	}
 	
 	// relational operators
 	else if (!strcmp(mod, "==") || !strcmp(mod, "!=") || !strcmp(mod, ">") || !strcmp(mod, ">=") || 
 	         !strcmp(mod, "<") || !strcmp(mod, "<="))
 	{
-		fprintf(yyout, "    mov     cx,#1\n");                  // assume result is true
-		fprintf(yyout, "    pop     bx\n");                     // pop y
-		fprintf(yyout, "    pop     ax\n");                     // pop x
-		fprintf(yyout, "    sub     ax,bx\n");                  // make the logical comparison (x-y)
+	    const char *src;
+
+		PopOperand(&y);
+		PopOperand(&x);
+		src = Source(&y);
+		ToReg(&x);
+
+		// with the params pinned there may be no register left for the result, then it replaces x
+		result = CanAllocReg() ? AllocReg() : x.reg;
+		if (result != x.reg)
+		{
+		    fprintf(yyout, "    mov     %s,#1\n", regNames[result]);      // assume result is true
+		}
+		fprintf(yyout, "    sub     %s,%s\n", regNames[x.reg], src);      // make the logical comparison (x-y)
 		if (!strcmp(mod, "=="))
 		{
 		    fprintf(yyout, "    bz      LT%d\n", ++labelId);    // x == y
@@ -235,245 +1233,758 @@ void GenAlu(const char *mod, const char *comment)
 		{
 		    fprintf(yyout, "    bmi     LT%d\n", ++labelId);    // x < y || x == y
 		    fprintf(yyout, "    bz      LT%d\n", labelId);
-		}
-		fprintf(yyout, "    zero    cx\n");                     // truth is disproven so make result false
-		fprintf(yyout, "LT%d:\n", labelId);
-        fprintf(yyout, "    push    cx\n");
-	}
-	else
-	{
-		fprintf(yyout, "illegal operator\n");
-	}
-}
-
-// load the address of a variable into BX based on its type
-static void GenAccessVar(const char *vartype, int offset, const char *globalName)
-{
-    if (!strcmp(vartype, "gbl"))
-    {
-        // globals reside in lowest memory at offset from zero so use direct address mode
-        fprintf(yyout, "    mov     bx,@0x%02x\t; global %s\n", offset, globalName);
-    }
-    else if (!strcmp(vartype, "par"))
-    {
-        // parameter n is at BP+n+3
-        fprintf(yyout, "    mov     bx,bp\t; param %s\n", globalName);
-        fprintf(yyout, "    add     bx,@%d\n", offset + 3);
-    }
-    else if (!strcmp(vartype, "lcl"))
-    {
-        // local variable n is at BP-n (n is offset)
-        fprintf(yyout, "    mov     bx,bp\t; local %s\n", globalName);
-        fprintf(yyout, "    sub     bx,@%d\n", offset);
-    }
+		}
+		fprintf(yyout, "    zero    %s\n", regNames[result]);             // truth is disproven so make result false
+		if (result == x.reg)
+		{
+		    fprintf(yyout, "    bra     LE%d\n", labelId);
+		    fprintf(yyout, "LT%d:\n", labelId);
+		    fprintf(yyout, "    mov     %s,#1\n", regNames[result]);
+		    fprintf(yyout, "LE%d:\n", labelId);
+		}
+		else
+		{
+		    fprintf(yyout, "LT%d:\n", labelId);
+		    FreeOperand(&x);
+		}
+		FreeOperand(&y);
+		PushReg(result, OPND_REG);
+	}
+	else
+	{
+		fprintf(yyout, "illegal operator\n");
+	}
 }
 
-// load a variable into AX based on its type
-static void GenLoadVar(const char *vartype, int offset, const char *globalName)
+// load the address of a variable into a register based on its type
+static void GenAccessVar(int reg, const char *vartype, int offset, const char *globalName)
 {
     if (!strcmp(vartype, "gbl"))
     {
-        // use ZP addressing with offset (0x00-0xff) for globals
-        fprintf(yyout, "    mov     ax,[#0x%02x]\t; global %s\n", offset, globalName);
-    }
-    else if (!strcmp(vartype, "par"))
-    {
-        // parameter n is at BP+n+3 and can be accessed with a single 5-bit offset instruction
-        fprintf(yyout, "    mov     ax,[bp+0x%x]\t; param %s\n", (offset+3) & 0x1f, globalName);
-    }
-    else if (!strcmp(vartype, "lcl"))
-    {
-        // local variable n is at BP-n (n is offset)
-        fprintf(yyout, "    mov     ax,[bp+0x%x]\t; local %s\n", (-offset) & 0x1f, globalName);
+        // the address of the global, the last word of an array
+        fprintf(yyout, "    mov     %s,@%s\t; global %s\n", regNames[reg], FindGlobal(offset)->name, globalName);
     }
-}
-
-// store a value from AX based on its type
-static void GenStoreVar(const char *vartype, int offset, const char *globalName)
-{
-    if (!strcmp(vartype, "gbl"))
+    else if (PinnedReg(vartype, offset) >= 0)
     {
-        // use ZP addressing with offset (0x00-0xff) for globals
-        fprintf(yyout, "    mov     [#0x%02x],ax\t; global %s\n", offset, globalName);
+        error("the address of register param %s cannot be taken, compile without -r", globalName);
     }
     else if (!strcmp(vartype, "par"))
     {
-        // parameter n is at BP+n+3 and can be accessed with a single 5-bit offset instruction
-        fprintf(yyout, "    mov     [bp+0x%x],ax\t; param %s\n", (offset+3) & 0x1f, globalName); // access the var offset from the BP
+        // parameter n is at BP+n+3
+        fprintf(yyout, "    mov     %s,bp\t; param %s\n", regNames[reg], globalName);
+        fprintf(yyout, "    add     %s,#%d\n", regNames[reg], offset + 3);
     }
     else if (!strcmp(vartype, "lcl"))
     {
         // local variable n is at BP-n (n is offset)
-        fprintf(yyout, "    mov     [bp+0x%x],ax\t; local %s\n", (-offset) & 0x1f, globalName); // access the var offset from the BP
+        fprintf(yyout, "    mov     %s,bp\t; local %s\n", regNames[reg], globalName);
+        fprintf(yyout, "    sub     %s,#%d\n", regNames[reg], offset);
     }
 }
 
 void GenLoadImmed(const char *constant)
 {
-    fprintf(yyout, "\n; load immed\n");
+    struct Operand op = {OPND_CONST};
 
-    fprintf(yyout, "    mov     ax,@%s\n", constant);     // push constant
-    fprintf(yyout, "    push    ax\n");
+    // the constant is loaded when it is used, if it fits in 8 bits it can be an immediate source
+    op.value = strtol(constant, NULL, strncmp(constant, "0x", 2) && strncmp(constant, "0X", 2) ? 10 : 16);
+    snprintf(op.text, sizeof op.text, "%s", constant);
+    PushOperand(&op);
 }
 
 // direct variable code generation
 void GenDirect(const char *op, const char *vartype, int offset, const char *globalName)
 {
+    struct Operand value;
+
     if (!strcmp(op, OP_LOAD))
     {
-        fprintf(yyout, "\n; load direct\n");
-        
-        // load a variable by type and push it (function retvals don't need to be loaded)
-        GenLoadVar(vartype, offset, globalName);
-        fprintf(yyout, "    push    ax\n");
+        // the variable is loaded when it is used, function retvals are pushed by the call
+        struct Operand var = {OPND_VAR};
+
+        var.vartype = vartype;
+        var.offset = offset;
+        snprintf(var.name, sizeof var.name, "%s", globalName);
+        PushOperand(&var);
+    }
+    else if (!strcmp(op, OP_STORE) && !inFct)
+    {
+        // a global initializer is a constant, which the runtime stores before main() is called
+        if (PopOperand(&value))
+        {
+            snprintf(FindGlobal(offset)->init, sizeof FindGlobal(offset)->init,
+                value.value >= 0 && value.value <= 0xff ? "#%s" : "@%s", value.text);
+            if (!hasRuntime)
+            {
+                warning("global %s is only initialized by the runtime, compile without -S", globalName);
+            }
+        }
     }
     else if (!strcmp(op, OP_STORE))
     {
         fprintf(yyout, "\n; store direct\n");
 
-        // pop a variable and store it based on its type
-        fprintf(yyout, "    pop     ax\n");
-        GenStoreVar(vartype, offset, globalName);
+        // pop a value and store it based on the variable type
+        if (PopOperand(&value))
+        {
+            ToReg(&value);
+            GenStoreVar(value.reg, vartype, offset, globalName);
+            FreeOperand(&value);
+        }
     }
 }
 
 // array code generation
 void GenIndirect(const char *op, const char *vartype, int offset, const char *globalName, int is_rhs)
 {
+    struct Operand index, value, address;
+    const char *src;
+    int reg;
+
     if (!strcmp(op, OP_LOAD))
     {
         fprintf(yyout, "\n; load indirect\n");
 
         // replace the array index at TOS with the base address - index (stack grows downward)   
-        GenAccessVar(vartype, offset, globalName);
+        PopOperand(&index);
+        src = Source(&index);
+        reg = AllocReg();
         if (!strcmp(vartype, "par"))
         {
-            // deref the address for param variables
-            fprintf(yyout, "    mov     bx,[bx]\n");
+            // the param variable holds the address
+            GenLoadVar(reg, vartype, offset, globalName);
         }
-
-        // subtract the index from the base address to get the EA
-        fprintf(yyout, "    pop     ax\n");             
-        fprintf(yyout, "    sub     bx,ax\n");
-        if (is_rhs)
+        else
         {
-            // for RHS dereference the EA to get the actual value
-            fprintf(yyout, "    mov     bx,[bx]\n");
+            GenAccessVar(reg, vartype, offset, globalName);
         }
-        fprintf(yyout, "    push    bx\n");
+
+        // subtract the index from the base address to get the EA
+        fprintf(yyout, "    sub     %s,%s\n", regNames[reg], src);
+        FreeOperand(&index);
+
+        // for RHS the EA is dereferenced when the value is used
+        PushReg(reg, is_rhs ? OPND_MEM : OPND_REG);
     }
     else if (!strcmp(op, OP_STORE))
     {
         fprintf(yyout, "\n; store indirect\n");
 
-        // simply pop the value first and then the address and store the value indirectly to the address
-        fprintf(yyout, "    pop     ax\n");
-        fprintf(yyout, "    pop     bx\n");
-        fprintf(yyout, "    mov     [bx],ax\n");
+        // pop the value and then the address and store the value indirectly to the address
+        PopOperand(&value);
+        PopOperand(&address);
+        ToReg(&value);
+        ToReg(&address);
+        fprintf(yyout, "    mov     [%s],%s\n", regNames[address.reg], regNames[value.reg]);
+        FreeOperand(&value);
+        FreeOperand(&address);
     }
 }
 
 // pointer code generation
 void GenPointer(const char *op, const char *vartype, int offset, const char *globalName, int is_rhs)
 {
+    struct Operand value, address;
+    int reg;
+
     if (!strcmp(op, OP_LOAD))
     {
         fprintf(yyout, "\n; load pointer\n");
 
-        // load the variable by type then push it
-        GenLoadVar(vartype, offset, globalName);
-        if (is_rhs)
-        {
-            // dereference to get the actual value for RHS
-            fprintf(yyout, "    mov     ax,[ax]\n");
-        }
-        fprintf(yyout, "    push    ax\n");
+        // load the pointer, for RHS it is dereferenced when the value is used
+        reg = AllocReg();
+        GenLoadVar(reg, vartype, offset, globalName);
+        PushReg(reg, is_rhs ? OPND_MEM : OPND_REG);
     }
     else if (!strcmp(op, OP_STORE))
     {
         fprintf(yyout, "\n; store pointer\n");
         
         // both the value and the pointer are on the stack so pop them and store the value indirectly thru the pointer
-        fprintf(yyout, "    pop     ax\n");
-        fprintf(yyout, "    pop     bx\n");
-        fprintf(yyout, "    mov     [bx],ax\n");
+        PopOperand(&value);
+        PopOperand(&address);
+        ToReg(&value);
+        ToReg(&address);
+        fprintf(yyout, "    mov     [%s],%s\n", regNames[address.reg], regNames[value.reg]);
+        FreeOperand(&value);
+        FreeOperand(&address);
     }
 }
 
 // reference (i.e. pointer dereference) code generation
 void GenReference(const char *op, const char *vartype, int offset, const char *globalName)
 {
+    int reg;
+
     if (!strcmp(op, OP_LOAD))
     {
         fprintf(yyout, "\n; load reference\n");
 
-        // get the address of the variable by type then push it, no need to dereference
-        GenAccessVar(vartype, offset, globalName);
-        fprintf(yyout, "    push    bx\n");
+        // get the address of the variable by type, no need to dereference
+        reg = AllocReg();
+        GenAccessVar(reg, vartype, offset, globalName);
+        PushReg(reg, OPND_REG);
+    }
+}
+
+// the register an arg is in, if any
+static int ArgReg(struct Operand *op)
+{
+    if (op->kind == OPND_REG)
+    {
+        return op->reg;
+    }
+    if (op->kind == OPND_VAR)
+    {
+        return PinnedReg(op->vartype, op->offset);
+    }
+    return -1;
+}
+
+/*
+ *  Load the args into ax and bx.  An arg is not loaded while its register is
+ *  the source of the other one, and if they are swapped one is moved aside.
+ */
+static void MoveArgs(struct Operand *args, int argQty)
+{
+    int loaded[REG_ARG_QTY] = {0};
+    int moved = 0, progress, reg, u;
+
+    while (moved < argQty)
+    {
+        progress = 0;
+        for (reg = 0; reg < argQty; reg++)
+        {
+            for (u = 0; u < argQty && (loaded[u] || u == reg || ArgReg(&args[u]) != reg); u++)
+                ;
+            if (!loaded[reg] && u == argQty)
+            {
+                LoadOperand(&args[reg], reg);
+                loaded[reg] = progress = 1;
+                moved++;
+            }
+        }
+        if (!progress)
+        {
+            for (reg = REG_ARG_QTY; regBusy[reg]; reg++)
+                ;
+            fprintf(yyout, "    mov     %s,%s\n", regNames[reg], regNames[ArgReg(&args[0])]);
+            regBusy[reg] = 1;
+            args[0].kind = OPND_REG;
+            args[0].reg = reg;
+        }
+    }
+}
+
+// a function whose body is expanded in place of a call
+struct Inline
+{
+    char name[40];
+    char *body;                 // without the return
+    int instrs;
+    int sites;                  // calls expanded
+};
+
+static struct Inline *inlines;
+static int inlineQty;
+static int inlineSize;
+static int inlineId;            // copies made, for the labels
+
+static void InlineShowLeds(int reg)
+{
+    fprintf(yyout, "    mov     LED_REG,%s\n", regNames[reg]);
+}
+
+static void InlineReadSwitches(int reg)
+{
+    fprintf(yyout, "    mov     %s,SWITCH_REG\n", regNames[reg]);
+}
+
+// a nibble per display, from the high one
+static void InlineDisplay(int reg)
+{
+    int nibble = AllocReg();
+    int shift;
+
+    for (shift = 12; shift > 0; shift -= 4)
+    {
+        fprintf(yyout, "    mov     %s,%s\n", regNames[nibble], regNames[reg]);
+        GenShiftConst(nibble, "lsr", shift);
+        if (shift < 12)
+        {
+            fprintf(yyout, "    and     %s,#15\n", regNames[nibble]);
+        }
+        fprintf(yyout, "    mov     DISPLAY%d_REG,%s\n", 4 - shift / 4, regNames[nibble]);
+    }
+    fprintf(yyout, "    and     %s,#15\n", regNames[reg]);
+    fprintf(yyout, "    mov     DISPLAY4_REG,%s\n", regNames[reg]);
+    regBusy[nibble] = 0;
+}
+
+// the libasm routines expanded in place of a call, reg holds the arg or gets the retval
+static struct LibInline
+{
+    const char *name;
+    int argQty;
+    int hasRetval;
+    int instrs;
+    int regs;                   // the registers it needs, e.g. a shift loop counter with -s
+    void (*gen)(int reg);
+    int sites;
+} libInlines[] =
+{
+    {"_ShowLeds",       1,  0,  1,  1,  InlineShowLeds},
+    {"_ReadSwitches",   0,  1,  1,  1,  InlineReadSwitches},
+    {"_Display",        1,  0,  13, 3,  InlineDisplay},
+};
+
+#define LIB_INLINE_QTY ((int)(sizeof libInlines / sizeof libInlines[0]))
+
+static struct LibInline *FindLibInline(const char *fctname)
+{
+    int i;
+
+    for (i = 0; i < LIB_INLINE_QTY; i++)
+    {
+        if (!strcmp(libInlines[i].name, fctname) && libInlines[i].instrs <= inlineInstrs &&
+            libInlines[i].regs <= REG_QTY - pinQty)
+        {
+            return &libInlines[i];
+        }
+    }
+    return NULL;
+}
+
+static struct Inline *FindInline(const char *fctname)
+{
+    int i;
+
+    for (i = 0; i < inlineQty; i++)
+    {
+        if (!strcmp(inlines[i].name, fctname))
+        {
+            return &inlines[i];
+        }
+    }
+    return NULL;
+}
+
+// the instructions of an assembly text, i.e. the indented lines
+static int CountInstrs(const char *text)
+{
+    int instrs = 0;
+
+    for (; text; text = strchr(text, '\n'))
+    {
+        text += *text == '\n';
+        instrs += !strncmp(text, "    ", 4) && text[4] >= 'a' && text[4] <= 'z';
+    }
+    return instrs;
+}
+
+// keep the body of a function for -n if it is a leaf without a stack frame and small enough
+static void KeepInline(const char *fctname, const char *body)
+{
+    struct Inline *fct;
+    int instrs = CountInstrs(body);
+
+    if (instrs > inlineInstrs || strstr(body, "jsr") || strstr(body, "bsr") || !strcmp(fctname, "main"))
+    {
+        return;
+    }
+    if (inlineQty == inlineSize)
+    {
+        inlineSize = inlineSize ? 2 * inlineSize : 16;
+        if (!(inlines = (struct Inline *)realloc(inlines, inlineSize * sizeof(struct Inline))))
+        {
+            fatal("out of memory");
+        }
+    }
+    fct = &inlines[inlineQty++];
+    snprintf(fct->name, sizeof fct->name, "%s", fctname);
+    if (!(fct->body = strdup(body)))
+    {
+        fatal("out of memory");
+    }
+    fct->instrs = instrs;
+    fct->sites = 0;
+}
+
+// whether the body defines the label of len chars at name
+static int IsBodyLabel(const char *body, const char *name, int len)
+{
+    const char *line;
+
+    for (line = body; line; line = strchr(line, '\n'))
+    {
+        line += *line == '\n';
+        if (!strncmp(line, name, len) && line[len] == ':')
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// copy the body of a function in place of a call, each of its labels gets the suffix _I<copy>
+static void CopyInline(struct Inline *fct)
+{
+    const char *c = fct->body;
+    int len;
+
+    inlineId++;
+    fprintf(yyout, "; inline %s\n", fct->name);
+    while (*c)
+    {
+        if (*c == ';')
+        {
+            // a comment is copied as is
+            len = strcspn(c, "\n");
+            fwrite(c, 1, len, yyout);
+            c += len;
+        }
+        else if ((*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') || *c == '_')
+        {
+            len = strspn(c, "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_0123456789");
+            fwrite(c, 1, len, yyout);
+            if (IsBodyLabel(fct->body, c, len))
+            {
+                fprintf(yyout, "_I%d", inlineId);
+            }
+            c += len;
+        }
+        else
+        {
+            putc(*c++, yyout);
+        }
+    }
+    fct->sites++;
+}
+
+// call a function, or expand it in place
+static void GenJsr(const char *fctname)
+{
+    struct Inline *fct = FindInline(fctname);
+
+    if (fct)
+    {
+        CopyInline(fct);
+    }
+    else
+    {
+        fprintf(yyout, "    bsr     %s\n", fctname);    // call function, a jsr if asm16 relaxes it
+    }
+}
+
+static void InlineReport()
+{
+    int i;
+
+    for (i = 0; i < inlineQty; i++)
+    {
+        if (inlines[i].sites)
+        {
+            fprintf(stderr, "inlined %s, %d instruction(s), at %d call site(s)\n",
+                inlines[i].name, inlines[i].instrs, inlines[i].sites);
+        }
+    }
+    for (i = 0; i < LIB_INLINE_QTY; i++)
+    {
+        if (libInlines[i].sites)
+        {
+            fprintf(stderr, "inlined %s, %d instruction(s), at %d call site(s)\n",
+                libInlines[i].name, libInlines[i].instrs, libInlines[i].sites);
+        }
     }
 }
 
-// function code generation
-void GenCall(const char *fctname)
+/*
+ *  Function code generation.  The arguments and any other values are passed on the
+ *  stack, or for a register call up to REG_ARG_QTY args are passed in ax and bx.  The args are
+ *  discarded and the retval, which is in ax, is pushed on the expression stack.
+ */
+static void CallFct(const char *fctname, int argQty, int hasRetval, int isRegCall, int isSaved)
 {
+    int base = exprDepth - argQty;
+    int i, reg;
+
     fprintf(yyout, "\n; call\n");
 
-    fprintf(yyout, "    jsr     %s\n", fctname);        // call function
+    if (isRegCall)
+    {
+        // push the values under the args, and take any args off the CPU stack
+        while (base > 0 && exprStack[base - 1].kind != OPND_STACK)
+        {
+            Spill();
+        }
+        for (i = exprDepth - 1; i >= base; i--)
+        {
+            if (exprStack[i].kind == OPND_STACK)
+            {
+                LoadOperand(&exprStack[i], AllocReg());
+            }
+            else if (exprStack[i].kind == OPND_MEM)
+            {
+                ToReg(&exprStack[i]);
+            }
+        }
+
+        // the args are off the CPU stack, so the params are saved on it now
+        SavePinned();
+        isSaved = 1;
+        MoveArgs(&exprStack[base], argQty);
+        exprDepth = base;
+        GenJsr(fctname);
+    }
+    else
+    {
+        SpillAll();
+        GenJsr(fctname);
+        while (argQty-- > 0)
+        {
+            GenPop(OP_POP_ARG, "discard argument");
+        }
+    }
+
+    // the callee is free to use every register, so the pinned params are restored
+    FreeRegs();
+    reg = REG_AX;
+    if (hasRetval && pinQty)
+    {
+        reg = AllocReg();
+        fprintf(yyout, "    mov     %s,%s\n", regNames[reg], regNames[REG_AX]);
+    }
+    if (isSaved)
+    {
+        RestorePinned();
+    }
+    if (hasRetval)
+    {
+        regBusy[reg] = 1;
+        PushReg(reg, OPND_REG);
+    }
+}
+
+/*
+ *  Called before the args of a call are evaluated.  A stack arg would be pushed
+ *  on the pinned params if they were saved at the call, so for a function that
+ *  takes its args on the stack they are saved here first.
+ */
+void GenArgs(const char *fctname, int isStackCall)
+{
+    int isSaved = pinQty && isStackCall && !FindLibInline(fctname);
+
+    if (callDepth == EXPR_STACK_SIZE)
+    {
+        fatal("expression too complex");
+    }
+    callSaved[callDepth++] = isSaved;
+    if (isSaved)
+    {
+        SpillAll();
+        SavePinned();
+    }
+}
+
+void GenCall(const char *fctname, int argQty, int hasRetval, int isRegCall)
+{
+    struct LibInline *lib = FindLibInline(fctname);
+    struct Operand arg;
+    int reg;
+
+    callDepth--;
+    if (!lib)
+    {
+        CallFct(fctname, argQty, hasRetval, isRegCall, callSaved[callDepth]);
+        return;
+    }
+
+    // a libasm routine expanded in place
+    if (argQty != lib->argQty)
+    {
+        error("%s takes %d argument(s)", fctname, lib->argQty);
+        return;
+    }
+    fprintf(yyout, "\n; inline %s\n", fctname);
+    if (argQty)
+    {
+        PopOperand(&arg);
+        ToReg(&arg);
+        reg = arg.reg;
+    }
+    else
+    {
+        reg = AllocReg();
+    }
+    lib->gen(reg);
+    lib->sites++;
+    if (hasRetval && lib->hasRetval)
+    {
+        PushReg(reg, OPND_REG);
+    }
+    else
+    {
+        regBusy[reg] = 0;
+        if (hasRetval)
+        {
+            // the discarded retval of a void routine
+            GenLoadImmed("0");
+        }
+    }
 }
+
+/*
+ *  Discard the value on top of the expression stack, or load the return value
+ *  into ax.
+ */
 void GenPop(const char *op, const char *comment)
 {
-    fprintf(yyout, "\n; pop\n");
-        
+    struct Operand value;
+
+    if (!PopOperand(&value))
+    {
+        return;
+    }
     if (!strcmp(op, OP_POP_RET))
     {
-	    fprintf(yyout, "    pop     ax ; %s\n", comment);
+        fprintf(yyout, "\n; pop\n");
+        // a param pinned in ax is given up for the retval, the return jumps to the epilogue
+        if (!(value.kind == OPND_REG && value.reg == REG_AX))
+        {
+            if (!pinQty)
+            {
+                ClaimReg(REG_AX);
+            }
+            if (value.kind == OPND_MEM && value.reg != REG_AX)
+            {
+                regBusy[value.reg] = 0;
+            }
+            LoadOperand(&value, REG_AX);
+            fprintf(yyout, "\t\t; %s\n", comment);
+        }
+        if (!pinQty)
+        {
+            FreeOperand(&value);
+        }
     }
     else if (!strcmp(op, OP_POP_ARG))
     {
-	    fprintf(yyout, "    pop     bx ; %s\n", comment);
+        if (value.kind == OPND_STACK)
+        {
+            fprintf(yyout, "    add     sp,#1 ; %s\n", comment);
+        }
+        FreeOperand(&value);
     }
 }    
+
+// discard what is left of an expression statement, e.g. the value of a function called
+void GenDiscard()
+{
+    int words = 0;
+
+    while (exprDepth)
+    {
+        struct Operand *op = &exprStack[--exprDepth];
+
+        words += op->kind == OPND_STACK;
+        FreeOperand(op);
+    }
+    if (words)
+    {
+        fprintf(yyout, "    add     sp,#%d ; discard expression\n", words);
+    }
+}
+
 void GenReturn(const char *op, const char *comment)
 {
     if (!strcmp(op, OP_RETURN))
     {
+        if (regAbi || inlineInstrs)
+        {
+            // the buffered body follows the stack frame, if it has locals or stack params
+            fclose(yyout);
+            yyout = fctOut;
+            needFrame |= l_max > 0;
+            if (needFrame)
+            {
+                GenFrame(frameSymbol);
+            }
+            else if (inlineInstrs)
+            {
+                KeepInline(curFctName, fctBuf);
+            }
+            fputs(fctBuf, yyout);
+            free(fctBuf);
+            pinQty = 0;
+        }
+        inFct = 0;
+
         fprintf(yyout, "\n; return\n");
         
-        if (!strcmp(curFctName, "main"))
+        // the stack frame is about to be removed and the expression stack with it
+        ResetExpr();
+        if (needFrame)
         {
-            // this is unnecessary but included to easily ensure that the stack is cleaned up by the end of main
             fprintf(yyout, "    mov     sp,bp\n");      // move BP to SP to remove local vars
             fprintf(yyout, "    pop     bp\n");         // restore old BP
-            fprintf(yyout, "    jmp    __Exit\n");      // for main() jump to the end of the program -- essentially "exit"
+        }
+        if (!strcmp(curFctName, "main"))
+        {
+            // the frame removal is unnecessary but included to easily ensure that the stack is cleaned up by the end of main
+            fprintf(yyout, "    bra    __Exit\n");      // for main() jump to the end of the program -- essentially "exit"
         }
         else
         {
-            fprintf(yyout, "    mov     sp,bp\n");      // move BP to SP to remove local vars
-            fprintf(yyout, "    pop     bp\n");         // restore old BP
             fprintf(yyout, "    rts\n");                // return from subroutine
         }
     }
 }
 void GenJump(const char *op, const char *label, const char *comment)
 {
-    if (!strcmp(op, OP_JUMPZ))
+    struct Operand value;
+
+    if (!strcmp(op, OP_JUMPZ) && exprDepth && exprStack[exprDepth - 1].kind == OPND_CONST)
+    {
+        fprintf(yyout, "\n; jumpz\t%s on a constant\n", comment);
+
+        // the branch is either always or never taken, e.g. "while (1)"
+        PopOperand(&value);
+        SpillAll();
+        if (!value.value)
+        {
+            fprintf(yyout, "    bra     %s\n", label);
+        }
+    }
+    else if (!strcmp(op, OP_JUMPZ))
     {
         fprintf(yyout, "\n; jumpz\t%s\n", comment);
         
-        fprintf(yyout, "    pop     ax\n");             // pop the logical value and jump if it's a false, i.e. zero
-        fprintf(yyout, "    or      ax,#0\n");
+        // jump if the logical value is false, i.e. zero, the load of a value sets the flags
+        if (PopOperand(&value))
+        {
+            SpillAll();
+            if (!ToReg(&value))
+            {
+                fprintf(yyout, "    or      %s,#0\n", regNames[value.reg]);
+            }
+            FreeOperand(&value);
+        }
         fprintf(yyout, "    bz      %s\n", label);
+        GenProfile();
     }
     else
     {
         fprintf(yyout, "\n; jump\t%s\n", comment);
         
+        SpillAll();
         fprintf(yyout, "    bra     %s\n", label);      // explicit jump
     }
 }
 void GenLabel(const char *label)
 {
+    SpillAll();
     fprintf(yyout, "%s:\n", label);
+    GenProfile();
 }
 
 // value definition code generation
@@ -483,4 +1994,3 @@ void GenEqu(const char *symbol, int value)
 }
 
 // end of gen_cpu16.c
-
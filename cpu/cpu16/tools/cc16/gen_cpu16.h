@@ -2,10 +2,15 @@
  *  gen_hack.h - code generator definitions
  */
 
-void GenBeginProg();
+void GenBeginProg(int isProgram);
 void GenEndProg();
-void GenCall(const char *fctname);
-void GenEntry(const char *fctname, const char *symbol);
+void GenGlobal(const char *name, int offset, int size);
+// with -r the args of a call with up to this many are passed in ax and bx
+#define REG_ARG_QTY 2
+
+void GenArgs(const char *fctname, int isStackCall);
+void GenCall(const char *fctname, int argQty, int hasRetval, int isRegCall);
+void GenEntry(const char *fctname, const char *symbol, int paramQty, int isRegAbi);
 void GenAlu(const char *mod, const char *comment);
 void GenLoadImmed(const char *constant);
 void GenDirect(const char *op, const char *vartype, int offset, const char *globalName);
@@ -13,6 +18,7 @@ void GenIndirect(const char *op, const char *vartype, int offset, const char *gl
 void GenPointer(const char *op, const char *vartype, int offset, const char *globalName, int is_rhs);
 void GenReference(const char *op, const char *vartype, int offset, const char *globalName);
 void GenPop(const char *op, const char *comment);
+void GenDiscard();
 void GenReturn(const char *op, const char *comment);
 void GenJump(const char *op, const char *label, const char *comment);
 void GenLabel(const char *label);
@@ -9,20 +9,27 @@
 #include <libgen.h>
 #include <getopt.h>
 #include "y.tab.h"
+#include "peephole.h"
 
 extern FILE* yyout;
 extern FILE *yyerfp;
 
 // options
 static char *outfileName = 0;
-static char *infileName = 0;
+char *infileName = 0;
 int objOnly = 0;
 int emitVmCode = 0;
+int optimize = 0;
+int baseCpu16 = 0;
+int regAbi = 0;
+int zpWords = 0x100;
+int inlineInstrs = 0;
+int profile = 0;
 int verbose = 0;
 
 static void ParseOptions(int argc, char* argv[])
 {
-	const char* optStr = "CD:I:PU:So:ivh";
+	const char* optStr = "CD:I:PU:So:iOsrz:n:pvh";
 	int opt;
 
 	while ((opt = getopt(argc, argv, optStr)) != -1)
@@ -46,20 +53,49 @@ static void ParseOptions(int argc, char* argv[])
 			case 'i':
 				emitVmCode = 1;
 				break;
+			case 'O':
+				optimize = 1;
+				break;
+			case 's':
+				baseCpu16 = 1;
+				break;
+			case 'r':
+				regAbi = 1;
+				break;
+			case 'z':
+				zpWords = atoi(optarg);
+				break;
+			case 'n':
+				inlineInstrs = atoi(optarg);
+				break;
+			case 'p':
+				profile = 1;
+				break;
 			case 'v':
 				verbose = 1;
 				break;
 			case 'h':
-				printf("usage: hcc [CDIPU] [-S] [-o <filename>] [-v] [-h]\n");
+				printf("usage: hcc [CDIPU] [-S] [-o <filename>] [-O] [-s] [-r] [-z <words>] [-n <instrs>] [-p] [-v] [-h]\n");
 				printf("\n");
 				printf("     options:\n");
 				printf("         -S:            compile to asm object\n");
 				printf("         -o <filename>: set the output file name\n");
-				printf("         -v:            set verbose mode\n");
+				printf("         -O:            run the peephole optimizer on the output\n");
+				printf("         -s:            generate code for a CPU16 without the multiply/divide unit and the barrel shifter,\n");
+				printf("                        i.e. call the libasm routines for * / %% and shift a bit at a time\n");
+				printf("         -r:            pass up to two arguments in ax and bx instead of on the stack,\n");
+				printf("                        and leave out the stack frame of a function that needs none\n");
+				printf("         -z <words>:    place at most this many of the most used globals in the ZP, default 256\n");
+				printf("         -n <instrs>:   expand a call of a leaf function, or of a libasm I/O routine, of at most\n");
+				printf("                        this many instructions in place\n");
+				printf("         -p:            count the runs of each basic block in RAM at 0x0700-0x07ff, which is\n");
+				printf("                        reserved for them below the stack at 0x0800-0x0fff, see prof16 for the report\n");
+				printf("         -v:            set verbose mode, report where the globals are placed and the inlined calls,\n");
+				printf("                        and with -O the peephole rule hits\n");
 				printf("         -h:            display this help\n");
 				exit(0);
 			default:
-				printf("usage: hcc [CDIPU] [-S]  [-o <filename>] [-v] [-h]\n");
+				printf("usage: hcc [CDIPU] [-S]  [-o <filename>] [-O] [-s] [-r] [-z <words>] [-n <instrs>] [-p] [-v] [-h]\n");
 				exit(-1);
 		}
 	}
@@ -122,6 +158,8 @@ int cpp(int argc, char** argv)
 int main(int argc, char** argv)
 {
     char name[80];
+    FILE *outfile;
+    int status;
     
     // default output file to stdout
     yyout = stdout;
@@ -177,14 +215,41 @@ int main(int argc, char** argv)
     }
     
     // open the output file
-    if ((yyout = fopen(outfileName, "w")) == 0)
+    if ((outfile = fopen(outfileName, "w")) == 0)
     {
         fprintf(stderr, "hcc: cannot open file %s\n", outfileName);
         exit(EXIT_FAILURE);
     }
     
+    // the peephole optimizer needs the whole output so generate the code to a temp file
+    if (!optimize)
+    {
+        yyout = outfile;
+    }
+    else if ((yyout = tmpfile()) == 0)
+    {
+        perror("hcc: temp file");
+        exit(EXIT_FAILURE);
+    }
+    
     // run the parser
-    return yyparse();
+    status = yyparse();
+    
+    if (optimize)
+    {
+        rewind(yyout);
+        if (!Peephole(yyout, outfile))
+        {
+            fprintf(stderr, "hcc: cannot write file %s\n", outfileName);
+            exit(EXIT_FAILURE);
+        }
+        if (verbose)
+        {
+            PeepholeReport(stderr);
+        }
+    }
+    
+    return status;
 }
 
 // end of main.c
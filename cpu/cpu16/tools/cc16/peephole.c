@@ -0,0 +1,560 @@
+/*
+ *  peephole.c -- peephole optimizer for the cc16 assembly output
+ *
+ *  The code generator emits the assembly one C operator at a time, which leaves
+ *  redundant instructions at the seams, e.g. a spill that is popped right away
+ *  or a zero test of a value that just set the flags.  The optimizer reads the
+ *  whole assembly file, replaces the instruction sequences that match a rule in
+ *  the rule table, and repeats until no rule matches.
+ *
+ *  A rule pattern is written like the instructions, with the operand spaces
+ *  removed, and %0-%9 match any text up to the next character of the pattern.
+ *  A variable that appears twice must match the same text both times.  Only
+ *  instructions and labels are matched, comment lines are skipped over, and
+ *  any other line, e.g. a directive, ends the sequence.
+ *
+ *  The flags are only tested by the conditional branches right after the
+ *  instruction that set them, and ax-dx are only live until they are written,
+ *  so a rule that drops an instruction which sets the flags or writes a register
+ *  checks that nothing after it reads them.  A label or a jump ends the check,
+ *  i.e. the flags and the registers are live there.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "message.h"
+#include "peephole.h"
+
+#define MAX_LINE        256
+#define MAX_PATTERN     4
+#define VAR_QTY         10
+#define VAR_LEN         64
+
+// line kinds
+#define LINE_COMMENT    0       // blank or comment only, skipped by the patterns
+#define LINE_INSTR      1
+#define LINE_LABEL      2
+#define LINE_OTHER      3       // e.g. a directive, ends a pattern
+
+struct Line
+{
+    char *text;                 // as written, without the newline
+    int kind;
+    char instr[MAX_LINE];       // "op dst,src" without spaces, or "label:"
+    char op[8];
+    char dst[MAX_LINE];
+    char src[MAX_LINE];
+    int deleted;
+};
+
+static struct Line *lines;
+static int lineQty;
+
+typedef int (*RuleCheck)(char vars[][VAR_LEN], int next);
+
+struct Rule
+{
+    const char *name;
+    const char *pattern[MAX_PATTERN];
+    const char *replace[MAX_PATTERN];
+    RuleCheck check;            // extra condition, 0 if none
+    int hits;
+};
+
+static int instrsIn, instrsOut;
+
+static const char *const tempRegs[] = {"ax", "bx", "cx", "dx", 0};
+static const char *const allRegs[] = {"ax", "bx", "cx", "dx", "ep", "bp", "sp", 0};
+static const char *const flagOps[] =
+{
+    "mov", "add", "sub", "and", "or", "xor", "adc", "sbb",
+    "zero", "inc", "dec", "asl", "lsr", "rol", "ror", "pop",
+    "mul", "div", "mod", "asr", 0
+};
+static const char *const unaryFlagOps[] = {"zero", "inc", "dec", "asl", "lsr", "rol", "ror", "pop", 0};
+static const char *const sourceOps[] = {"add", "sub", "and", "or", "xor", "adc", "sbb", 0};
+static const char *const testOps[] = {"or", "xor", 0};
+static const char *const identityOps[] = {"add", "sub", "or", "xor", 0};
+
+static int InSet(const char *s, const char *const set[])
+{
+    for (; *set; set++)
+    {
+        if (!strcmp(s, *set))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// is the register name a word of the operand text
+static int UsesReg(const char *text, const char *reg)
+{
+    const char *s;
+    size_t len = strlen(reg);
+
+    for (s = text; (s = strstr(s, reg)); s += len)
+    {
+        int before = s == text ? 0 : s[-1];
+        int after = s[len];
+
+        if (!(before == '_' || (before >= 'a' && before <= 'z') || (before >= '0' && before <= '9')) &&
+            !(after == '_' || (after >= 'a' && after <= 'z') || (after >= '0' && after <= '9')))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int IsNumber(const char *s, long *value)
+{
+    char *end;
+
+    *value = strtol(s, &end, 0);
+    return *s && !*end;
+}
+
+static int IsControl(struct Line *l)
+{
+    return l->op[0] == 'b' || !strcmp(l->op, "jsr") || !strcmp(l->op, "jmp") || !strcmp(l->op, "rts");
+}
+
+static int SetsFlags(struct Line *l)
+{
+    return InSet(l->op, flagOps) && InSet(l->dst, allRegs);
+}
+
+static int ReadsReg(struct Line *l, const char *reg)
+{
+    if (UsesReg(l->src, reg) || (l->dst[0] == '[' && UsesReg(l->dst, reg)))
+    {
+        return 1;
+    }
+    return !strcmp(l->dst, reg) && strcmp(l->op, "mov") && strcmp(l->op, "pop") && strcmp(l->op, "zero");
+}
+
+static int WritesReg(struct Line *l, const char *reg)
+{
+    return !strcmp(l->dst, reg) && (!strcmp(l->op, "mov") || !strcmp(l->op, "pop") || !strcmp(l->op, "zero"));
+}
+
+// are the flags set again before anything can test them
+static int FlagsDead(int i)
+{
+    for (; i < lineQty; i++)
+    {
+        struct Line *l = &lines[i];
+
+        if (l->deleted || l->kind == LINE_COMMENT)
+        {
+            continue;
+        }
+        if (l->kind != LINE_INSTR || IsControl(l))
+        {
+            return 0;
+        }
+        if (SetsFlags(l))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// is the register written again before anything can read it
+static int RegDead(const char *reg, int i)
+{
+    for (; i < lineQty; i++)
+    {
+        struct Line *l = &lines[i];
+
+        if (l->deleted || l->kind == LINE_COMMENT)
+        {
+            continue;
+        }
+        if (l->kind != LINE_INSTR || ReadsReg(l, reg))
+        {
+            return 0;
+        }
+        if (WritesReg(l, reg))
+        {
+            return 1;
+        }
+        if (IsControl(l))
+        {
+            return 0;
+        }
+    }
+    return 0;
+}
+
+// a source operand that any binop accepts, i.e. a register, [reg] or an immediate
+static int IsBinopSource(const char *s)
+{
+    char reg[VAR_LEN];
+    size_t len = strlen(s);
+
+    if (s[0] == '#' || s[0] == '@' || InSet(s, allRegs))
+    {
+        return 1;
+    }
+    if (s[0] == '[' && len > 2 && len < sizeof reg && s[len - 1] == ']')
+    {
+        strcpy(reg, s + 1);
+        reg[len - 2] = '\0';
+        return InSet(reg, allRegs);
+    }
+    return 0;
+}
+
+// a direct address, e.g. a global, rather than a register, [reg] or an immediate
+static int IsDirect(const char *s)
+{
+    return s[0] != '[' && s[0] != '#' && s[0] != '@' && !InSet(s, allRegs);
+}
+
+// rule checks
+static int CheckFlagsDead(char vars[][VAR_LEN], int next)
+{
+    return FlagsDead(next);
+}
+
+static int CheckPushPop(char vars[][VAR_LEN], int next)
+{
+    return InSet(vars[1], allRegs) && InSet(vars[2], allRegs);
+}
+
+static int CheckReload(char vars[][VAR_LEN], int next)
+{
+    return InSet(vars[2], allRegs) && FlagsDead(next);
+}
+
+static int CheckStoreBack(char vars[][VAR_LEN], int next)
+{
+    return InSet(vars[2], allRegs) && !UsesReg(vars[1], vars[2]);
+}
+
+static int CheckDirectReload(char vars[][VAR_LEN], int next)
+{
+    return IsDirect(vars[1]) && InSet(vars[2], allRegs) && FlagsDead(next);
+}
+
+static int CheckDirectStoreBack(char vars[][VAR_LEN], int next)
+{
+    return IsDirect(vars[1]) && InSet(vars[2], allRegs);
+}
+
+static int CheckSum(char vars[][VAR_LEN], int next)
+{
+    long x, y;
+
+    if (!IsNumber(vars[2], &x) || !IsNumber(vars[3], &y) || x < 0 || y < 0 || x + y > 0xff)
+    {
+        return 0;
+    }
+    sprintf(vars[9], "%ld", x + y);
+    return 1;
+}
+
+static int CheckIdentity(char vars[][VAR_LEN], int next)
+{
+    return InSet(vars[0], identityOps) && InSet(vars[1], allRegs) && FlagsDead(next);
+}
+
+static int CheckTest(char vars[][VAR_LEN], int next)
+{
+    return InSet(vars[0], flagOps) && InSet(vars[1], allRegs) && InSet(vars[8], testOps);
+}
+
+static int CheckUnaryTest(char vars[][VAR_LEN], int next)
+{
+    return InSet(vars[0], unaryFlagOps) && InSet(vars[1], allRegs) && InSet(vars[8], testOps);
+}
+
+static int CheckMove(char vars[][VAR_LEN], int next)
+{
+    return InSet(vars[1], tempRegs) && InSet(vars[3], allRegs) && strcmp(vars[1], vars[3]) &&
+           RegDead(vars[1], next);
+}
+
+static int CheckSource(char vars[][VAR_LEN], int next)
+{
+    return InSet(vars[0], sourceOps) && IsBinopSource(vars[2]) && CheckMove(vars, next);
+}
+
+// the rule table, the rules are tried in order at each line
+static struct Rule rules[] =
+{
+    {"push/pop of the same register",   {"push %1", "pop %1"},              {0},                    CheckFlagsDead},
+    {"push/pop to a register move",     {"push %1", "pop %2"},              {"mov %2,%1"},          CheckPushPop},
+    {"move to itself",                  {"mov %1,%1"},                      {0},                    CheckFlagsDead},
+    {"reload of a stored register",     {"mov [%1],%2", "mov %2,[%1]"},     {"mov [%1],%2"},        CheckReload},
+    {"store of a loaded register",      {"mov %2,[%1]", "mov [%1],%2"},     {"mov %2,[%1]"},        CheckStoreBack},
+    {"reload of a stored global",       {"mov %1,%2", "mov %2,%1"},         {"mov %1,%2"},          CheckDirectReload},
+    {"store of a loaded global",        {"mov %2,%1", "mov %1,%2"},         {"mov %2,%1"},          CheckDirectStoreBack},
+    {"add of two immediates",           {"add %1,#%2", "add %1,#%3"},       {"add %1,#%9"},         CheckSum},
+    {"sub of two immediates",           {"sub %1,#%2", "sub %1,#%3"},       {"sub %1,#%9"},         CheckSum},
+    {"identity immediate",              {"%0 %1,#0"},                       {0},                    CheckIdentity},
+    {"zero test after a binop",         {"%0 %1,%2", "%8 %1,#0"},           {"%0 %1,%2"},           CheckTest},
+    {"zero test after a unop",          {"%0 %1", "%8 %1,#0"},              {"%0 %1"},              CheckUnaryTest},
+    {"branch to the next line",         {"bra %1", "%1:"},                  {"%1:"},                0},
+    {"jump to the next line",           {"jmp %1", "%1:"},                  {"%1:"},                0},
+    {"move thru a dead register",       {"mov %1,%2", "mov %3,%1"},         {"mov %3,%2"},          CheckMove},
+    {"source thru a dead register",     {"mov %1,%2", "%0 %3,%1"},          {"%0 %3,%2"},           CheckSource},
+};
+
+#define RULE_QTY ((int)(sizeof rules / sizeof rules[0]))
+
+// split a line into its instruction fields
+static void ParseLine(struct Line *l)
+{
+    const char *s = l->text;
+    char *d, *comma;
+
+    l->instr[0] = l->op[0] = l->dst[0] = l->src[0] = '\0';
+    if (*s == ' ' || *s == '\t')
+    {
+        while (*s == ' ' || *s == '\t')
+            s++;
+        if (!*s || *s == ';')
+        {
+            l->kind = LINE_COMMENT;
+            return;
+        }
+        l->kind = LINE_INSTR;
+        for (d = l->op; *s && *s != ' ' && *s != '\t' && *s != ';' && d < l->op + sizeof l->op - 1; )
+            *d++ = *s++;
+        *d = '\0';
+        for (d = l->dst; *s && *s != ';' && d < l->dst + sizeof l->dst - 1; s++)
+        {
+            if (*s != ' ' && *s != '\t')
+                *d++ = *s;
+        }
+        *d = '\0';
+        if ((comma = strchr(l->dst, ',')))
+        {
+            strcpy(l->src, comma + 1);
+            *comma = '\0';
+        }
+        snprintf(l->instr, sizeof l->instr, l->src[0] ? "%s %s,%s" : l->dst[0] ? "%s %s" : "%s",
+                 l->op, l->dst, l->src);
+    }
+    else if (!*s || *s == ';')
+    {
+        l->kind = LINE_COMMENT;
+    }
+    else
+    {
+        size_t len = strcspn(s, ": \t;");
+
+        l->kind = s[len] == ':' && len < sizeof l->instr - 1 ? LINE_LABEL : LINE_OTHER;
+        if (l->kind == LINE_LABEL)
+        {
+            memcpy(l->instr, s, len + 1);
+            l->instr[len + 1] = '\0';
+        }
+    }
+}
+
+static int ReadLines(FILE *in)
+{
+    char buf[MAX_LINE];
+    int size = 0;
+
+    lineQty = 0;
+    while (fgets(buf, sizeof buf, in))
+    {
+        buf[strcspn(buf, "\r\n")] = '\0';
+        if (lineQty == size)
+        {
+            size = size ? size * 2 : 1024;
+            if (!(lines = realloc(lines, size * sizeof *lines)))
+            {
+                fatal("out of memory");
+            }
+        }
+        lines[lineQty].text = strdup(buf);
+        lines[lineQty].deleted = 0;
+        ParseLine(&lines[lineQty]);
+        instrsIn += lines[lineQty].kind == LINE_INSTR;
+        lineQty++;
+    }
+    return !ferror(in);
+}
+
+// match one instruction against a pattern, binding the unbound variables
+static int MatchLine(const char *pat, const char *text, char vars[][VAR_LEN])
+{
+    while (*pat)
+    {
+        if (*pat == '%')
+        {
+            char *var = vars[pat[1] - '0'];
+            size_t len;
+
+            pat += 2;
+            if (*var)
+            {
+                len = strlen(var);
+                if (strncmp(text, var, len))
+                {
+                    return 0;
+                }
+            }
+            else
+            {
+                // the variable ends at the next pattern character
+                for (len = 0; text[len] && text[len] != *pat; len++)
+                    ;
+                if (!len || len >= VAR_LEN)
+                {
+                    return 0;
+                }
+                memcpy(var, text, len);
+                var[len] = '\0';
+            }
+            text += len;
+        }
+        else if (*pat++ != *text++)
+        {
+            return 0;
+        }
+    }
+    return !*text;
+}
+
+// write a replacement instruction in the generator's layout, keeping the comment of the line it replaces
+static void ReplaceLine(struct Line *l, const char *pat, char vars[][VAR_LEN])
+{
+    char instr[MAX_LINE], text[MAX_LINE * 2], *d = instr;
+    const char *comment = l->kind == LINE_INSTR ? strchr(l->text, ';') : 0;
+    size_t opLen;
+
+    for (; *pat && d < instr + sizeof instr - VAR_LEN; pat++)
+    {
+        if (*pat == '%')
+        {
+            d += sprintf(d, "%s", vars[*++pat - '0']);
+        }
+        else
+        {
+            *d++ = *pat;
+        }
+    }
+    *d = '\0';
+    if (instr[strlen(instr) - 1] == ':')
+    {
+        strcpy(text, instr);
+    }
+    else
+    {
+        opLen = strcspn(instr, " ");
+        snprintf(text, sizeof text, "    %-8.*s%s%s%s", (int)opLen, instr, instr + opLen + (instr[opLen] != 0),
+                 comment ? "\t" : "", comment ? comment : "");
+    }
+    free(l->text);
+    l->text = strdup(text);
+    ParseLine(l);
+}
+
+// try a rule at line i, returns 1 if it was applied
+static int ApplyRule(struct Rule *rule, int i)
+{
+    char vars[VAR_QTY][VAR_LEN];
+    int matched[MAX_PATTERN];
+    int n, j;
+
+    memset(vars, 0, sizeof vars);
+    for (n = 0; n < MAX_PATTERN && rule->pattern[n]; n++, i++)
+    {
+        while (i < lineQty && (lines[i].deleted || lines[i].kind == LINE_COMMENT))
+            i++;
+        if (i == lineQty || lines[i].kind == LINE_OTHER || !MatchLine(rule->pattern[n], lines[i].instr, vars))
+        {
+            return 0;
+        }
+        matched[n] = i;
+    }
+    if (rule->check && !rule->check(vars, i))
+    {
+        return 0;
+    }
+
+    // replace the matched lines in order and delete the rest
+    for (j = 0; j < n; j++)
+    {
+        if (j < MAX_PATTERN && rule->replace[j])
+        {
+            ReplaceLine(&lines[matched[j]], rule->replace[j], vars);
+        }
+        else
+        {
+            lines[matched[j]].deleted = 1;
+        }
+    }
+    rule->hits++;
+    return 1;
+}
+
+/*
+ *  Optimize the assembly read from in and write it to out.  Returns 0 if a
+ *  file cannot be read or written.
+ */
+int Peephole(FILE *in, FILE *out)
+{
+    int changed, i, r;
+
+    if (!ReadLines(in))
+    {
+        return 0;
+    }
+
+    do
+    {
+        changed = 0;
+        for (i = 0; i < lineQty; i++)
+        {
+            if (lines[i].deleted || lines[i].kind == LINE_COMMENT || lines[i].kind == LINE_OTHER)
+            {
+                continue;
+            }
+            for (r = 0; r < RULE_QTY; r++)
+            {
+                if (ApplyRule(&rules[r], i))
+                {
+                    changed = 1;
+                    break;
+                }
+            }
+        }
+    } while (changed);
+
+    for (i = 0; i < lineQty; i++)
+    {
+        if (!lines[i].deleted)
+        {
+            fprintf(out, "%s\n", lines[i].text);
+            instrsOut += lines[i].kind == LINE_INSTR;
+        }
+        free(lines[i].text);
+    }
+    lineQty = 0;
+    return !ferror(out);
+}
+
+// how often each rule was applied
+void PeepholeReport(FILE *fp)
+{
+    int r;
+
+    fprintf(fp, "peephole: %d instructions in, %d out\n", instrsIn, instrsOut);
+    for (r = 0; r < RULE_QTY; r++)
+    {
+        fprintf(fp, "    %-34s %5d\n", rules[r].name, rules[r].hits);
+    }
+}
+
+// end of peephole.c
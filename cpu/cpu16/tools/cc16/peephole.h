@@ -0,0 +1,15 @@
+/*
+ *  peephole.h -- peephole optimizer for the cc16 assembly output
+ */
+
+#ifndef PEEPHOLE_H
+#define PEEPHOLE_H
+
+#include <stdio.h>
+
+int Peephole(FILE *in, FILE *out);
+void PeepholeReport(FILE *fp);
+
+#endif // PEEPHOLE_H
+
+// end of peephole.h
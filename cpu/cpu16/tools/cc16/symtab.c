@@ -6,6 +6,7 @@
 #include <string.h>
 #include "y.tab.h"
 #include "symtab.h"
+#include "gen.h"
 #include "message.h"
 
 extern YYSTYPE yylval;
@@ -43,6 +44,86 @@ static char* strsave(const char* s)
     
     return (char*)NULL;
 }
+
+/*
+ *  Names are interned in an open addressing hash table with linear probing,
+ *  which is doubled when it gets half full.  Each name heads the list of the
+ *  symtab entries with that name, s_same, in the order s_find() searched the
+ *  symtab chain: innermost block first, globals moved by s_move() last.
+ */
+struct Name
+{
+    char *n_name;
+    struct Symtab *n_symbols;
+};
+
+static struct Name **names;
+static unsigned nameSize;           // power of 2
+static unsigned nameCount;
+
+static unsigned hash(const char *name)
+{
+    unsigned h = 2166136261u;       // FNV-1a
+
+    while (*name)
+        h = (h ^ (unsigned char)*name++) * 16777619u;
+    return h;
+}
+
+// the slot holding name, or the empty slot where it belongs
+static struct Name **n_slot(const char *name)
+{
+    unsigned i = hash(name) & (nameSize - 1);
+
+    while (names[i] && strcmp(names[i]->n_name, name) != 0)
+        i = (i + 1) & (nameSize - 1);
+    return &names[i];
+}
+
+static struct Name *n_find(const char *name)
+{
+    return nameSize ? *n_slot(name) : (struct Name *)NULL;
+}
+
+static struct Name *n_intern(const char *name)
+{
+    struct Name **slot;
+
+    if (2 * (nameCount + 1) > nameSize)
+    {
+        struct Name **old = names;
+        unsigned i, oldSize = nameSize;
+
+        nameSize = nameSize ? 2 * nameSize : 256;
+        if (!(names = (struct Name **)calloc(nameSize, sizeof(struct Name *))))
+            fatal("out of memory for the symbol table");
+        for (i = 0; i < oldSize; i++)
+            if (old[i])
+                *n_slot(old[i]->n_name) = old[i];
+        free(old);
+    }
+
+    slot = n_slot(name);
+    if (!*slot)
+    {
+        if (!(*slot = (struct Name *)calloc(1, sizeof(struct Name))) || !((*slot)->n_name = strsave(name)))
+            fatal("out of memory for the symbol table");
+        nameCount++;
+    }
+    return *slot;
+}
+
+// unlink a symbol from the list of its name
+static void n_unlink(struct Symtab *symbol)
+{
+    struct Symtab **link;
+
+    for (link = &n_find(symbol->s_name)->n_symbols; *link != symbol; link = &(*link)->s_same)
+        if (!*link)
+            bug("n_unlink");
+    *link = symbol->s_same;
+    symbol->s_same = (struct Symtab *)NULL;
+}
   
 static struct Symtab *s_create(const char *name)
 {
@@ -50,9 +131,13 @@ static struct Symtab *s_create(const char *name)
     
     if (newEntry)
     {
+        struct Name *interned = n_intern(name);
+
         newEntry->s_next = s_lcl->s_next;
         s_lcl->s_next = newEntry;
-        newEntry->s_name = strsave(name);
+        newEntry->s_name = interned->n_name;
+        newEntry->s_same = interned->n_symbols;
+        interned->n_symbols = newEntry;
         newEntry->s_type = UDEC;
         newEntry->s_blknum = 0;
         newEntry->s_pnum = NOT_SET;
@@ -63,7 +148,7 @@ static struct Symtab *s_create(const char *name)
 
 static int s_move(struct Symtab *symbol)
 {
-    struct Symtab *ptr;
+    struct Symtab *ptr, **link;
     
     // find desired entry in symtab chain
     for (ptr = s_lcl; ptr->s_next != symbol; ptr = ptr->s_next)
@@ -75,6 +160,12 @@ static int s_move(struct Symtab *symbol)
     s_gbl->s_next = symbol;
     s_gbl = symbol;
     s_gbl->s_next = (struct Symtab *)NULL;
+
+    // likewise it is the last of its name
+    n_unlink(symbol);
+    for (link = &n_find(symbol->s_name)->n_symbols; *link; link = &(*link)->s_same)
+        ;
+    *link = symbol;
     
     return 0;       
 }
@@ -110,7 +201,7 @@ void blk_pop()
 #endif 
         if (ptr->s_type == UFUNC)
             warning("undefined function %s", ptr->s_name);
-        free(ptr->s_name);
+        n_unlink(ptr);
         s_lcl->s_next = ptr->s_next;
         free(ptr);
     }
@@ -139,20 +230,9 @@ void s_lookup(int yylex)
 
 struct Symtab *s_find(const char *name)
 {
-    struct Symtab *ptr;
-    
-    // search symtab until match of end of symtab chain
-    for (ptr = s_lcl->s_next; ptr; ptr = ptr->s_next)
-    {
-        if (!ptr->s_name)
-            bug("s_find");
-        else
-            if (strcmp(ptr->s_name, name) == 0)
-                return ptr;
-                
-    }
-   
-    return (struct Symtab *)NULL;
+    struct Name *interned = n_find(name);
+
+    return interned ? interned->n_symbols : (struct Symtab *)NULL;
 }
 
 struct Symtab *link_parm(struct Symtab *symbol, struct Symtab *next)
@@ -344,6 +424,7 @@ void all_var(struct Symtab *symbol, int size, int refLevel)
                 g_offset += symbol->s_size;
                 symbol->s_offset = g_offset - 1;
             }
+            gen_global(symbol);
             break;
         case 0:
             bug("all_var");
@@ -4,7 +4,7 @@
 
 struct Symtab
 {
-    char   *s_name;             // name
+    char   *s_name;             // interned name
     int     s_type;             // symbol type
     int     s_blknum;           // static block depth
     union 
@@ -15,7 +15,9 @@ struct Symtab
     int     s_offset;           // symbol definition   
     int     s_size;             // size of the variable, 1 for normal vars, n for arrays
     int     s_ref_level;        // reference level, 0 for scalars, +1 for each pointer level
+    int     s_abi;              // calling convention of a function
     struct Symtab *s_next;      // next entry
+    struct Symtab *s_same;      // next entry with the same name, outer scopes last
 };
 
 #define s_pnum  s__.s__num      // count of parameters
@@ -30,6 +32,11 @@ struct Symtab
 #define VAR     4               // declared variable
 #define PARM    5               // undeclared parameter
 
+// s_abi values, with -r a function that is defined before it is called takes its args in registers
+#define ABI_NOT_SET 0           // not defined or called yet
+#define ABI_STACK   1           // args on the stack
+#define ABI_REG     2           // up to REG_ARG_QTY args in ax and bx
+
 // s_type string values
 #define SYMmap   "udecl", "fct", "vfct", "udef fct", "var", "parm"
 
@@ -0,0 +1,151 @@
+/*
+ *  call test, the same results with and without -r, i.e. args in registers
+ *
+ *  Test passes if:
+ *      - LEDs: 0011 1111 1111 1111
+ */
+
+#include <system16/system16.h>
+#include <system16/fputw.c>
+
+int g;
+
+// a leaf, the params are compared and changed
+int Gcd(int a, int b)
+{
+    while (a != b)
+    {
+        if (a > b)
+            a = a - b;
+        else
+            b = b - a;
+    }
+    return a;
+}
+
+// recursive, the param is needed after the call
+int Fact(int n)
+{
+    if (n > 1)
+        return n * Fact(n - 1);
+    else
+        return 1;
+}
+
+int Sub(int a, int b)
+{
+    return a - b;
+}
+
+// the args are in each other's registers
+int Swap(int a, int b)
+{
+    return Sub(b, a);
+}
+
+// stack args
+int Add3(int a, int b, int c)
+{
+    return a + b + c;
+}
+
+// a call with stack args and a call with register args among them
+int Sum(int a, int b)
+{
+    return Add3(a, b, Sub(a, b)) + a;
+}
+
+// the param is changed before the call
+int Dec(int a)
+{
+    a = a - 1;
+    return Sub(a, 1) + a;
+}
+
+// more values than free registers
+int Cmp(int a, int b)
+{
+    return ((a + 1) < (b + 1)) + ((a + 2) > (b - 1)) + ((a - b) == (b - a));
+}
+
+// a local
+int Twice(int a)
+{
+    int t;
+
+    t = a + a;
+    return t;
+}
+
+void SetG(int v)
+{
+    g = v;
+}
+
+int Both(int a, int b)
+{
+    return (a && b) + (a || b);
+}
+
+// an early return leaves before the param in ax is read
+int Early(int a, int b)
+{
+    if (b)
+        return 1;
+    return a + 5;
+}
+
+// a return leaves the loop, which reads the param in ax on each pass
+int Find(int a, int b)
+{
+    while (a < b)
+    {
+        a = a + 1;
+        if (a == 4)
+            return 7;
+    }
+    return 0;
+}
+
+int main()
+{
+    int results = 0;
+
+    if (Gcd(36, 54) == 18)
+	    results = results | 0x0001;
+    if (Fact(7) == 5040)
+	    results = results | 0x0002;
+    if (Swap(3, 10) == 7)
+	    results = results | 0x0004;
+    if (Sum(9, 4) == 27)
+	    results = results | 0x0008;
+    if (Dec(20) == 37)
+	    results = results | 0x0010;
+    if (Cmp(3, 5) == 2)
+	    results = results | 0x0020;
+    if (Cmp(4, 4) == 2)
+	    results = results | 0x0040;
+    if (Twice(-6) == -12)
+	    results = results | 0x0080;
+    SetG(0x5a5a);
+    if (g == 0x5a5a)
+	    results = results | 0x0100;
+    if (Both(2, 0) == 1)
+	    results = results | 0x0200;
+    if (Both(0, 0) + Both(1, 3) == 2)
+	    results = results | 0x0400;
+    if (Later(Fact(3)) == 7)
+	    results = results | 0x0800;
+    if (Early(3, 1) == 1 && Early(3, 0) == 8)
+	    results = results | 0x1000;
+    if (Find(1, 6) == 7 && Find(5, 6) == 0)
+	    results = results | 0x2000;
+
+    _ShowLeds(results);
+}
+
+// called before it is defined, so its arg is on the stack
+int Later(int a)
+{
+    return a + 1;
+}
@@ -0,0 +1,60 @@
+/*
+ *  global test, initialized globals and more globals than fit in the ZP, also
+ *  compile with -z 0 so that every global is in RAM or the heap
+ *
+ *  Test passes if:
+ *      - LEDs: 0000 0000 0011 1111
+ */
+
+#include <system16/system16.h>
+
+int hot = 3;
+int big[300];
+int cold = 0x1234;
+int table[200];
+int *p;
+int n;
+
+int main()
+{
+    int results = 0;
+
+    if (hot == 3 && cold == 0x1234)
+        results = results | 0x0001;
+
+    n = 0;
+    while (n < 300)
+    {
+        big[n] = n + hot;
+        n = n + 1;
+    }
+    if (big[0] == 3 && big[299] == 302)
+        results = results | 0x0002;
+
+    n = 0;
+    while (n < 200)
+    {
+        table[n] = big[n] + big[n + 1];
+        n = n + 1;
+    }
+    if (table[0] == 7 && table[199] == 405)
+        results = results | 0x0004;
+
+    // the globals do not overlap
+    if (big[299] == 302 && cold == 0x1234 && hot == 3)
+        results = results | 0x0008;
+
+    // a pointer to a global
+    p = &cold;
+    *p = *p + 1;
+    if (cold == 0x1235)
+        results = results | 0x0010;
+
+    // an array grows downward
+    p = table;
+    p = p - 1;
+    if (*p == table[1])
+        results = results | 0x0020;
+
+    _ShowLeds(results);
+}
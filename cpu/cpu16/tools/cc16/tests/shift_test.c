@@ -0,0 +1,69 @@
+/*
+ *  shift test, the shift counts are variables so that the shifts are not folded
+ *
+ *  Test passes if:
+ *      - LEDs: 0000 0000 1111 1111
+ */
+
+#include <system16/system16.h>
+#include <system16/fputw.c>
+
+int main()
+{
+    int results = 0;
+    int x;
+    int n;
+    int i;
+    int y;
+
+    x = 0x1234;
+    n = 0;
+    if ((x << n) == 0x1234)
+	    results = results | 0x0001;
+    if ((x >> n) == 0x1234)
+	    results = results | 0x0002;
+    n = 15;
+    if ((1 << n) == 0x8000)
+	    results = results | 0x0004;
+    if ((0x8000 >> n) == 1)
+	    results = results | 0x0008;
+    n = 16;
+    if ((x << n) == 0)
+	    results = results | 0x0010;
+
+    // reverse the bits
+    y = 0;
+    i = 0;
+    while (i < 16)
+    {
+        y = y | (((x >> i) & 1) << (15 - i));
+        i = i + 1;
+    }
+    if (y == 0x2c48)
+	    results = results | 0x0020;
+
+    // count the bits
+    x = 0xf0f1;
+    y = 0;
+    i = 0;
+    while (i < 16)
+    {
+        y = y + ((x >> i) & 1);
+        i = i + 1;
+    }
+    if (y == 9)
+	    results = results | 0x0040;
+
+    // set every bit
+    y = 0;
+    i = 0;
+    while (i < 16)
+    {
+        y = y | (1 << i);
+        i = i + 1;
+    }
+    if (y == -1)
+	    results = results | 0x0080;
+
+    fputw(results, OP_LEDS);
+}
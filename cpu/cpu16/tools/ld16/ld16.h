@@ -0,0 +1,44 @@
+/*
+ *  ld16.h -- definitions for ld16, the asm16 object linker
+ *
+ *  ld16 links the objects written by "asm16 -S" into a ROM image.  All the
+ *  objects named on the command line are linked, in order, and a library
+ *  object is linked only if it defines a symbol that is still undefined, so
+ *  a program only carries the stdlib routines it calls.
+ */
+
+#ifndef LD16_H
+#define LD16_H
+
+#include <stdio.h>
+#include "../asm16/asm16.h"
+#include "../asm16/symtab.h"
+#include "../asm16/obj16.h"
+
+#define ROM_END             0x10000     // the code must end by here
+
+struct Module
+{
+    char *fileName;                     // object file or library
+    int member;                         // object number in a library
+    struct ObjHeader header;
+    unsigned short *code;
+    struct ObjSymbol *symbols;
+    struct ObjReloc *relocs;
+    char *names;
+    int linked;
+    unsigned short base[SEC_QTY];       // where each region is placed
+    struct Module *next;
+};
+
+int ReadObjects(const char *fileName, int isLibrary);
+int Link(unsigned short codeBase);
+int WriteRom(FILE *fp);
+int WriteRaw(FILE *fp);
+void WriteMap(FILE *fp);
+
+extern int verbose;
+
+#endif // LD16_H
+
+// end of ld16.h
@@ -0,0 +1,528 @@
+/*
+ *  link.c -- read, place and relocate the asm16 objects
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ld16.h"
+
+static struct Module *objects;          // named on the command line, always linked
+static struct Module *objectsTail;
+static struct Module *library;          // library members, linked on demand
+static struct Module *libraryTail;
+
+static struct Module **linkOrder;       // the linked modules in the order they are placed
+static int linkCount;
+
+static unsigned short codeStart;
+static unsigned short codeEnd;
+
+/*
+ *  The global symbols, i.e. the symbols a module exports, are found by name
+ *  through an open addressing hash table like the asm16 symbol table.  The
+ *  library symbols have their own table to find the member defining a symbol.
+ */
+struct Global
+{
+    const char *name;
+    struct Module *module;
+    int symbol;
+};
+
+struct GlobalTable
+{
+    struct Global *slots;
+    unsigned size;                      // power of 2
+    unsigned count;
+};
+
+static struct GlobalTable globals;
+static struct GlobalTable libraryGlobals;
+
+static unsigned hash(const char *name)
+{
+    unsigned h = 2166136261u;           // FNV-1a
+
+    while (*name)
+    {
+        h = (h ^ (unsigned char)*name++) * 16777619u;
+    }
+    return h;
+}
+
+static struct Global *g_slot(struct GlobalTable *table, const char *name)
+{
+    unsigned i = hash(name) & (table->size - 1);
+
+    while (table->slots[i].name && strcmp(table->slots[i].name, name) != 0)
+    {
+        i = (i + 1) & (table->size - 1);
+    }
+    return &table->slots[i];
+}
+
+static struct Global *g_find(struct GlobalTable *table, const char *name)
+{
+    struct Global *global;
+
+    if (!table->size)
+    {
+        return NULL;
+    }
+    global = g_slot(table, name);
+    return global->name ? global : NULL;
+}
+
+static void g_grow(struct GlobalTable *table)
+{
+    struct Global *old = table->slots;
+    unsigned oldSize = table->size, i;
+
+    table->size = table->size ? 2 * table->size : 1024;
+    if (!(table->slots = (struct Global *)calloc(table->size, sizeof(struct Global))))
+    {
+        fprintf(stderr, "ld16: out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    for (i = 0; i < oldSize; i++)
+    {
+        if (old[i].name)
+        {
+            *g_slot(table, old[i].name) = old[i];
+        }
+    }
+    free(old);
+}
+
+// returns the global already defined by that name, or NULL once it is added
+static struct Global *g_add(struct GlobalTable *table, const char *name, struct Module *module, int symbol)
+{
+    struct Global *global;
+
+    if (2 * (table->count + 1) > table->size)
+    {
+        g_grow(table);
+    }
+    global = g_slot(table, name);
+    if (global->name)
+    {
+        return global;
+    }
+    global->name = name;
+    global->module = module;
+    global->symbol = symbol;
+    table->count++;
+    return NULL;
+}
+
+static const char *SymbolName(struct Module *module, int symbol)
+{
+    return module->names + module->symbols[symbol].name;
+}
+
+static void *Alloc(size_t count, size_t size)
+{
+    void *ptr = calloc(count ? count : 1, size);
+
+    if (!ptr)
+    {
+        fprintf(stderr, "ld16: out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
+
+// read the object at the file position, returns NULL at the end of the file
+static struct Module *ReadObject(FILE *fp, const char *fileName, int member)
+{
+    struct Module *module;
+    struct ObjHeader *header;
+    long long magic;
+    int i;
+
+    if ((magic = ObjGet32(fp)) < 0)
+    {
+        return NULL;
+    }
+
+    module = (struct Module *)Alloc(1, sizeof(struct Module));
+    module->fileName = strdup(fileName);
+    module->member = member;
+    header = &module->header;
+    header->magic = magic;
+    header->version = ObjGet16(fp);
+    header->codeWords = ObjGet16(fp);
+    for (i = 0; i < SEC_QTY; i++)
+    {
+        header->size[i] = ObjGet16(fp);
+    }
+    header->symbols = ObjGet16(fp);
+    header->relocs = ObjGet16(fp);
+    header->namesSize = ObjGet32(fp);
+    if (header->magic != OBJ16_MAGIC || header->version != OBJ16_VERSION)
+    {
+        fprintf(stderr, "ld16: %s: not an asm16 object\n", fileName);
+        exit(EXIT_FAILURE);
+    }
+
+    module->code = (unsigned short *)Alloc(header->codeWords + 1, sizeof(unsigned short));
+    for (i = 0; i < header->codeWords; i++)
+    {
+        module->code[i] = ObjGet16(fp);
+    }
+
+    module->symbols = (struct ObjSymbol *)Alloc(header->symbols, sizeof(struct ObjSymbol));
+    for (i = 0; i < header->symbols; i++)
+    {
+        module->symbols[i].name = ObjGet32(fp);
+        module->symbols[i].section = ObjGet16(fp);
+        module->symbols[i].type = ObjGet16(fp);
+        module->symbols[i].value = ObjGet16(fp);
+    }
+
+    module->relocs = (struct ObjReloc *)Alloc(header->relocs, sizeof(struct ObjReloc));
+    for (i = 0; i < header->relocs; i++)
+    {
+        module->relocs[i].offset = ObjGet16(fp);
+        module->relocs[i].field = ObjGet16(fp);
+        module->relocs[i].symbol = ObjGet16(fp);
+        module->relocs[i].types = ObjGet16(fp);
+    }
+
+    module->names = (char *)Alloc(header->namesSize + 1, 1);
+    if (fread(module->names, 1, header->namesSize, fp) != header->namesSize)
+    {
+        fprintf(stderr, "ld16: %s: truncated object\n", fileName);
+        exit(EXIT_FAILURE);
+    }
+
+    // check the indeces so a bad object cannot take the linker down
+    for (i = 0; i < header->symbols; i++)
+    {
+        if (module->symbols[i].name >= header->namesSize || module->symbols[i].section >= SEC_QTY)
+        {
+            fprintf(stderr, "ld16: %s: bad symbol\n", fileName);
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (i = 0; i < header->relocs; i++)
+    {
+        if (module->relocs[i].symbol >= header->symbols ||
+            module->relocs[i].offset + (module->relocs[i].field == FIX_VALUE16) >= header->codeWords)
+        {
+            fprintf(stderr, "ld16: %s: bad relocation\n", fileName);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    return module;
+}
+
+/*
+ *  Read an object, or all the objects of a library.  The exports of a library
+ *  object are indexed for Link(), the first member defining a symbol wins.
+ */
+int ReadObjects(const char *fileName, int isLibrary)
+{
+    struct Module *module;
+    FILE *fp;
+    int member = 0;
+
+    if (!(fp = fopen(fileName, "rb")))
+    {
+        perror(fileName);
+        return 0;
+    }
+
+    while ((module = ReadObject(fp, fileName, isLibrary ? member + 1 : 0)))
+    {
+        member++;
+        if (isLibrary)
+        {
+            int i;
+
+            for (i = 0; i < module->header.symbols; i++)
+            {
+                if (module->symbols[i].section != SEC_UNDEF)
+                {
+                    g_add(&libraryGlobals, SymbolName(module, i), module, i);
+                }
+            }
+            if (libraryTail)
+                libraryTail->next = module;
+            else
+                library = module;
+            libraryTail = module;
+        }
+        else
+        {
+            if (objectsTail)
+                objectsTail->next = module;
+            else
+                objects = module;
+            objectsTail = module;
+            if (member > 1)
+            {
+                fprintf(stderr, "ld16: %s: more than one object, use it as a library\n", fileName);
+                fclose(fp);
+                return 0;
+            }
+        }
+    }
+
+    fclose(fp);
+    if (!member)
+    {
+        fprintf(stderr, "ld16: %s: empty file\n", fileName);
+        return 0;
+    }
+    return 1;
+}
+
+static void ModuleName(struct Module *module, char *name, size_t size)
+{
+    if (module->member)
+        snprintf(name, size, "%s(%d)", module->fileName, module->member);
+    else
+        snprintf(name, size, "%s", module->fileName);
+}
+
+// link a module and export its symbols, returns 0 for duplicate symbols
+static int AddModule(struct Module *module)
+{
+    int i, ok = 1;
+
+    module->linked = 1;
+    linkOrder = (struct Module **)realloc(linkOrder, (linkCount + 1) * sizeof(struct Module *));
+    if (!linkOrder)
+    {
+        fprintf(stderr, "ld16: out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    linkOrder[linkCount++] = module;
+
+    for (i = 0; i < module->header.symbols; i++)
+    {
+        struct Global *dup;
+
+        if (module->symbols[i].section != SEC_UNDEF &&
+            (dup = g_add(&globals, SymbolName(module, i), module, i)))
+        {
+            char first[256], second[256];
+
+            ModuleName(dup->module, first, sizeof first);
+            ModuleName(module, second, sizeof second);
+            fprintf(stderr, "ld16: %s is defined in %s and in %s\n", dup->name, first, second);
+            ok = 0;
+        }
+    }
+    return ok;
+}
+
+// place a region of every linked module after that of the modules before it
+static int Place(int section, unsigned first, unsigned length, const char *region)
+{
+    unsigned next = first;
+    int i;
+
+    for (i = 0; i < linkCount; i++)
+    {
+        linkOrder[i]->base[section] = next;
+        next += linkOrder[i]->header.size[section];
+    }
+    if (next > first + length)
+    {
+        fprintf(stderr, "ld16: the %s needs 0x%04X words, only 0x%04X are available\n", region, next - first, length);
+        return 0;
+    }
+    return 1;
+}
+
+// the linked address of a symbol, or -1 if it is undefined
+static int Resolve(struct Module *module, int symbol, int *type)
+{
+    struct ObjSymbol *sym = &module->symbols[symbol];
+
+    if (sym->section == SEC_UNDEF)
+    {
+        struct Global *global = g_find(&globals, SymbolName(module, symbol));
+
+        if (!global)
+        {
+            return -1;
+        }
+        module = global->module;
+        sym = &module->symbols[global->symbol];
+    }
+    *type = sym->type;
+    return sym->section == SEC_ABS ? sym->value : module->base[sym->section] + sym->value;
+}
+
+static const char *TypeName(int types)
+{
+    switch (types)
+    {
+        case ST_ID:         return "an ID";
+        case ST_LABEL:      return "a label";
+        case ST_ZPRAM_ADDR: return "a zero page RAM offset";
+        case ST_RAM_ADDR:   return "a RAM address";
+        default:            return "an ID, label or RAM address";
+    }
+}
+
+/*
+ *  Link the command line objects and the library objects they need, place the
+ *  code from codeBase and the ZP, RAM and heap in their regions, then patch
+ *  the relocations.  Returns 0 if there are any errors.
+ */
+int Link(unsigned short codeBase)
+{
+    struct Module *module;
+    int i, j, ok = 1;
+    unsigned next;
+
+    if (!objects)
+    {
+        fprintf(stderr, "ld16: no objects to link\n");
+        return 0;
+    }
+
+    // the imports of each module linked may pull in more library modules
+    for (module = objects; module; module = module->next)
+    {
+        ok &= AddModule(module);
+    }
+    for (i = 0; i < linkCount; i++)
+    {
+        module = linkOrder[i];
+        for (j = 0; j < module->header.symbols; j++)
+        {
+            struct Global *global;
+            const char *name = SymbolName(module, j);
+
+            if (module->symbols[j].section == SEC_UNDEF && !g_find(&globals, name) &&
+                (global = g_find(&libraryGlobals, name)) && !global->module->linked)
+            {
+                ok &= AddModule(global->module);
+            }
+        }
+    }
+
+    // place the code and the RAM
+    codeStart = codeBase;
+    next = codeBase;
+    for (i = 0; i < linkCount; i++)
+    {
+        linkOrder[i]->base[SEC_CODE] = next;
+        next += linkOrder[i]->header.codeWords;
+    }
+    if (next > ROM_END)
+    {
+        fprintf(stderr, "ld16: the code needs 0x%04X words, only 0x%04X are available from 0x%04X\n",
+            next - codeBase, ROM_END - codeBase, codeBase);
+        return 0;
+    }
+    codeEnd = next;
+    ok &= Place(SEC_ZP, FIRST_ZPRAM_ADDR, ZPRAM_LENGTH, "zero page");
+    ok &= Place(SEC_RAM, FIRST_RAM_ADDR, RAM_LENGTH, "RAM");
+    ok &= Place(SEC_HEAP, FIRST_HEAP_ADDR, HEAP_LENGTH, "heap");
+
+    // patch the relocations
+    for (i = 0; i < linkCount; i++)
+    {
+        char name[256];
+
+        module = linkOrder[i];
+        ModuleName(module, name, sizeof name);
+        for (j = 0; j < module->header.relocs; j++)
+        {
+            struct ObjReloc *reloc = &module->relocs[j];
+            const char *symName = SymbolName(module, reloc->symbol);
+            const char *err;
+            int type, value;
+
+            if ((value = Resolve(module, reloc->symbol, &type)) < 0)
+            {
+                fprintf(stderr, "ld16: %s: %s is undefined\n", name, symName);
+                ok = 0;
+                continue;
+            }
+            if (!(type & reloc->types))
+            {
+                fprintf(stderr, "ld16: %s: %s has not been defined as %s\n", name, symName, TypeName(reloc->types));
+                ok = 0;
+                continue;
+            }
+            if ((err = ObjPatch(&module->code[reloc->offset], reloc->field, value,
+                                module->base[SEC_CODE] + reloc->offset)))
+            {
+                fprintf(stderr, "ld16: %s: %s at 0x%04X: %s\n", name, symName,
+                    module->base[SEC_CODE] + reloc->offset, err);
+                ok = 0;
+            }
+        }
+    }
+
+    return ok;
+}
+
+// write the code in the rom.bin format, one hex word per line for $readmemh
+int WriteRom(FILE *fp)
+{
+    int i, j;
+
+    for (i = 0; i < linkCount; i++)
+    {
+        for (j = 0; j < linkOrder[i]->header.codeWords; j++)
+        {
+            fprintf(fp, "%04X\n", linkOrder[i]->code[j]);
+        }
+    }
+    return !ferror(fp);
+}
+
+// write the code as raw big endian words, e.g. for a flash programmer
+int WriteRaw(FILE *fp)
+{
+    int i, j;
+
+    for (i = 0; i < linkCount; i++)
+    {
+        for (j = 0; j < linkOrder[i]->header.codeWords; j++)
+        {
+            putc(linkOrder[i]->code[j] >> 8, fp);
+            putc(linkOrder[i]->code[j] & 0xff, fp);
+        }
+    }
+    return !ferror(fp);
+}
+
+// where each module and each global symbol ended up
+void WriteMap(FILE *fp)
+{
+    int i, j;
+
+    fprintf(fp, "code 0x%04X-0x%04X\n", codeStart, codeEnd - 1);
+    for (i = 0; i < linkCount; i++)
+    {
+        struct Module *module = linkOrder[i];
+        char name[256];
+
+        ModuleName(module, name, sizeof name);
+        fprintf(fp, "%-32s code 0x%04X %5d words, zp 0x%02X, ram 0x%04X, heap 0x%04X\n", name,
+            module->base[SEC_CODE], module->header.codeWords,
+            module->base[SEC_ZP], module->base[SEC_RAM], module->base[SEC_HEAP]);
+        for (j = 0; j < module->header.symbols; j++)
+        {
+            int type, value;
+
+            if (module->symbols[j].section != SEC_UNDEF && (value = Resolve(module, j, &type)) >= 0)
+            {
+                fprintf(fp, "    0x%04X %s\n", value, SymbolName(module, j));
+            }
+        }
+    }
+}
+
+// end of link.c
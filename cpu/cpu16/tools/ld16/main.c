@@ -0,0 +1,169 @@
+/*
+ * main function for ld16
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include "ld16.h"
+
+#ifndef LIB_DIR
+#   define LIB_DIR "/usr/local/lib/system16"
+#endif
+
+#define MAX_LIB_DIRS 16
+
+// options
+static char *outfileName = "rom.bin";
+static char *rawFileName = 0;
+static char *mapFileName = 0;
+static unsigned short codeBase = FIRST_ROM_ADDR;
+static const char *libDirs[MAX_LIB_DIRS];
+static int libDirCount;
+int verbose = 0;
+
+static void Usage(FILE *fp)
+{
+    fprintf(fp, "usage: ld16 [-o <rom file>] [-r <raw file>] [-m <map file>] [-b <base>] [-L <dir>] [-v] [-h] <object>... [-l <name>]...\n");
+}
+
+// find lib<name>.a in the -L directories then in the installed library directory
+static int ReadLibrary(const char *name)
+{
+    char path[1024];
+    FILE *fp;
+    int i;
+
+    libDirs[libDirCount] = LIB_DIR;
+    for (i = 0; i <= libDirCount; i++)
+    {
+        snprintf(path, sizeof path, "%s/lib%s.a", libDirs[i], name);
+        if ((fp = fopen(path, "rb")))
+        {
+            fclose(fp);
+            return ReadObjects(path, 1);
+        }
+    }
+    fprintf(stderr, "ld16: cannot find library lib%s.a\n", name);
+    return 0;
+}
+
+/*
+ *  The objects and libraries are read in command line order, the objects are
+ *  placed in that order followed by the library objects as they are needed.
+ *  A file name ending in .a is read as a library too.
+ */
+static int ParseOptions(int argc, char* argv[])
+{
+	const char* optStr = "-o:r:m:b:l:L:vh";
+	int opt, ok = 1;
+	size_t len;
+
+	while ((opt = getopt(argc, argv, optStr)) != -1)
+	{
+		switch (opt)
+		{
+			case 1:
+				len = strlen(optarg);
+				ok &= ReadObjects(optarg, len > 2 && strcmp(optarg + len - 2, ".a") == 0);
+				break;
+			case 'o':
+				outfileName = optarg;
+				break;
+			case 'r':
+				rawFileName = optarg;
+				break;
+			case 'm':
+				mapFileName = optarg;
+				break;
+			case 'b':
+				codeBase = strtoul(optarg, NULL, 0);
+				break;
+			case 'l':
+				ok &= ReadLibrary(optarg);
+				break;
+			case 'L':
+				if (libDirCount == MAX_LIB_DIRS - 1)
+				{
+					fprintf(stderr, "ld16: too many library directories\n");
+					exit(EXIT_FAILURE);
+				}
+				libDirs[libDirCount++] = optarg;
+				break;
+			case 'v':
+				verbose = 1;
+				break;
+			case 'h':
+				Usage(stdout);
+				printf("\n");
+				printf("     options:\n");
+				printf("         -o <rom file>: set the ROM image file name, default rom.bin\n");
+				printf("         -r <raw file>: also write the code as raw big endian words\n");
+				printf("         -m <map file>: write where each object and symbol was placed\n");
+				printf("         -b <base>:     set the code address (default 0x%04X)\n", FIRST_ROM_ADDR);
+				printf("         -l <name>:     link the objects needed from library lib<name>.a\n");
+				printf("         -L <dir>:      search dir for the libraries before %s,\n", LIB_DIR);
+				printf("                        give it before the -l options\n");
+				printf("         -v:            set verbose mode\n");
+				printf("         -h:            display this help\n");
+				printf("\n");
+				printf("     The objects are written by \"asm16 -S\" and a library is objects concatenated.\n");
+				exit(0);
+			default:
+				Usage(stdout);
+				exit(-1);
+		}
+	}
+
+	return ok;
+}
+
+static int Write(const char *fileName, int (*writer)(FILE *fp), const char *mode)
+{
+    FILE *fp;
+    int ok;
+
+    if (!(fp = fopen(fileName, mode)))
+    {
+        perror(fileName);
+        return 0;
+    }
+    ok = writer(fp);
+    ok &= fclose(fp) == 0;
+    if (!ok)
+    {
+        fprintf(stderr, "ld16: cannot write %s\n", fileName);
+    }
+    return ok;
+}
+
+static int WriteMapFile(FILE *fp)
+{
+    WriteMap(fp);
+    return !ferror(fp);
+}
+
+int main(int argc, char** argv)
+{
+    if (!ParseOptions(argc, argv) || !Link(codeBase))
+    {
+        exit(EXIT_FAILURE);
+    }
+
+    if (!Write(outfileName, WriteRom, "w") ||
+        (rawFileName && !Write(rawFileName, WriteRaw, "wb")) ||
+        (mapFileName && !Write(mapFileName, WriteMapFile, "w")))
+    {
+        exit(EXIT_FAILURE);
+    }
+    if (verbose)
+    {
+        WriteMap(stdout);
+    }
+
+    return 0;
+}
+
+// end of main.c
@@ -0,0 +1,431 @@
+/*
+ *  main.c -- prof16, the report of the cc16 -p basic block counters
+ *
+ *  A program compiled with cc16 -p counts the runs of each of its basic blocks
+ *  in RAM.  prof16 reads the asm16 source cc16 wrote and a RAM dump taken at the
+ *  end of a run, e.g. with sim16 -d or the +ramdump=<file> plusarg of a
+ *  Verilated test bench, and reports the hottest blocks and functions.
+ *
+ *  cc16 puts a comment before each counter,
+ *
+ *      ; profile block <n> in <function> at <file>:<line>
+ *
+ *  followed by the increment of the 32-bit counter, whose low word is at the
+ *  address of the first "mov".  The instructions after the increment up to the
+ *  next block are the block's, so the runs of a block times its instructions
+ *  are the instructions it executed, not counting the called functions.  The
+ *  copy of a block that cc16 -n inlined increments the same counter, so only the
+ *  first copy is read.
+ *
+ *  prof16 -t reports an instruction trace instead, see trace.c.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <getopt.h>
+#include "prof16.h"
+
+#define RAM_SIZE        0x1000
+#define PROFILE_GUARD   0x07fe          // the last two words of the cc16 -p counter region
+#define MAX_BLOCKS      1024
+#define MAX_FILES       16
+
+struct Block
+{
+    int id;
+    char fct[NAME_LEN];
+    char file[256];
+    int line;
+    int addr;                       // of the low word of the counter
+    int instrs;
+    unsigned long runs;
+    unsigned long long executed;    // runs * instrs
+};
+
+struct Function
+{
+    char name[NAME_LEN];
+    int blocks;
+    unsigned long calls;            // runs of the entry block
+    unsigned long long executed;
+};
+
+// a source file, read once for the annotations
+struct Source
+{
+    char name[256];
+    char **lines;
+    int lineQty;
+};
+
+// options
+static char *asmFileName = NULL;
+static char *dumpFileName = NULL;
+static int traceMode = 0;
+static int fold = 0;
+int rows = 20;
+
+static struct Block blocks[MAX_BLOCKS];
+static int blockQty;
+static struct Function fcts[MAX_BLOCKS];
+static int fctQty;
+static struct Source sources[MAX_FILES];
+static int sourceQty;
+static unsigned short ram[RAM_SIZE];
+
+static void Usage(FILE *fp)
+{
+    fprintf(fp, "usage: prof16 [-n <rows>] [-h] <asm file> <ram dump>\n");
+    fprintf(fp, "       prof16 -t [-f] [-n <rows>] [-h] <trace file> <map file>\n");
+}
+
+static void ParseOptions(int argc, char* argv[])
+{
+	const char* optStr = "tfn:h";
+	int opt;
+
+	while ((opt = getopt(argc, argv, optStr)) != -1)
+	{
+		switch (opt)
+		{
+			case 't':
+				traceMode = 1;
+				break;
+			case 'f':
+				fold = 1;
+				break;
+			case 'n':
+				rows = atoi(optarg);
+				break;
+			case 'h':
+				Usage(stdout);
+				printf("\n");
+				printf("     options:\n");
+				printf("         -t:            report an instruction trace by label and by instruction format\n");
+				printf("         -f:            with -t, count the numbered labels of cc16 in the label before them\n");
+				printf("         -n <rows>:     report this many of the hottest blocks or labels, 0 for all (default 20)\n");
+				printf("         -h:            display this help\n");
+				printf("\n");
+				printf("     The asm file is the output of cc16 -p and the ram dump is a $writememh file of\n");
+				printf("     the RAM at the end of the run, e.g. from sim16 -d <file>.  With -t the trace file is\n");
+				printf("     from sim16 -T <file> or cpu16_trace.v and the map file is from ld16 -m, asm16 -m or\n");
+				printf("     asm16 -v.  The trace has the clocks of the instructions only, so for a trace that\n");
+				printf("     did not wrap they total one less than the cycles of sim16, which counts the reset.\n");
+				exit(0);
+			default:
+				Usage(stdout);
+				exit(-1);
+		}
+	}
+
+	if (optind + 2 != argc)
+	{
+	    Usage(stderr);
+	    exit(-1);
+	}
+	// or the trace and the map files with -t
+	asmFileName = argv[optind];
+	dumpFileName = argv[optind + 1];
+}
+
+// an instruction is indented and starts with its lower case mnemonic
+static int IsInstr(const char *line)
+{
+    return !strncmp(line, "    ", 4) && line[4] >= 'a' && line[4] <= 'z';
+}
+
+// find the blocks and count their instructions
+static int ReadAsm(const char *fileName)
+{
+    FILE *fp;
+    char line[512];
+    struct Block *block = NULL;
+    int inCounter = 0;
+
+    if ((fp = fopen(fileName, "r")) == NULL)
+    {
+        perror(fileName);
+        return -1;
+    }
+
+    while (fgets(line, sizeof line, fp))
+    {
+        if (!strncmp(line, "; profile block ", 16))
+        {
+            if (blockQty == MAX_BLOCKS)
+            {
+                fprintf(stderr, "%s: more than %d blocks\n", fileName, MAX_BLOCKS);
+                break;
+            }
+            block = &blocks[blockQty];
+            memset(block, 0, sizeof *block);
+            block->addr = -1;
+            if (sscanf(line, "; profile block %d in %63s at %255[^\n]", &block->id, block->fct, block->file) != 3)
+            {
+                fprintf(stderr, "%s: bad profile comment: %s", fileName, line);
+                block = NULL;
+                continue;
+            }
+
+            // the line number follows the last ':' as the file name may have one
+            char *colon = strrchr(block->file, ':');
+            if (colon)
+            {
+                *colon = '\0';
+                block->line = atoi(colon + 1);
+            }
+            inCounter = 1;
+
+            // a copy of an inlined function counts its blocks with the same counters
+            for (int i = 0; i < blockQty; i++)
+            {
+                if (blocks[i].id == block->id)
+                {
+                    block = NULL;
+                    break;
+                }
+            }
+            if (block)
+            {
+                blockQty++;
+            }
+        }
+        else if (!strncmp(line, "; fct entry", 11) || !strncmp(line, "; end program", 13))
+        {
+            // the stack frame is not part of a block
+            block = NULL;
+        }
+        else if (block && inCounter)
+        {
+            // the counter itself is not counted, it ends at its _PG<n> label
+            if (block->addr < 0 && IsInstr(line))
+            {
+                sscanf(line, " mov dx,%x", &block->addr);
+            }
+            if (!strncmp(line, "_PG", 3))
+            {
+                inCounter = 0;
+            }
+        }
+        else if (block && IsInstr(line))
+        {
+            block->instrs++;
+        }
+    }
+    fclose(fp);
+
+    return blockQty;
+}
+
+// read a $writememh file, i.e. whitespace separated hex words with optional
+// // comments and @<addr> directives
+static int ReadDump(const char *fileName)
+{
+    FILE *fp;
+    char token[80];
+    int addr = 0, words = 0;
+
+    if ((fp = fopen(fileName, "r")) == NULL)
+    {
+        perror(fileName);
+        return -1;
+    }
+
+    while (fscanf(fp, "%79s", token) == 1)
+    {
+        if (!strncmp(token, "//", 2))
+        {
+            int c;
+
+            while ((c = fgetc(fp)) != EOF && c != '\n')
+                ;
+        }
+        else if (token[0] == '@')
+        {
+            addr = strtol(token + 1, NULL, 16);
+        }
+        else if (isxdigit((unsigned char)token[0]))
+        {
+            if (addr < RAM_SIZE)
+            {
+                ram[addr++] = (unsigned short)strtoul(token, NULL, 16);
+                words++;
+            }
+        }
+    }
+    fclose(fp);
+
+    return words;
+}
+
+static struct Function *FindFunction(const char *name)
+{
+    int i;
+
+    for (i = 0; i < fctQty; i++)
+    {
+        if (!strcmp(fcts[i].name, name))
+        {
+            return &fcts[i];
+        }
+    }
+
+    // the first block of a function is its entry
+    snprintf(fcts[fctQty].name, NAME_LEN, "%s", name);
+    return &fcts[fctQty++];
+}
+
+// the source line, with the leading white space skipped, or "" if the file can't be read
+static const char *SourceLine(const char *fileName, int line)
+{
+    struct Source *source = NULL;
+    int i;
+
+    for (i = 0; i < sourceQty; i++)
+    {
+        if (!strcmp(sources[i].name, fileName))
+        {
+            source = &sources[i];
+        }
+    }
+    if (!source && sourceQty < MAX_FILES)
+    {
+        FILE *fp;
+        char text[512];
+
+        source = &sources[sourceQty++];
+        snprintf(source->name, sizeof source->name, "%s", fileName);
+        if ((fp = fopen(fileName, "r")))
+        {
+            while (fgets(text, sizeof text, fp))
+            {
+                text[strcspn(text, "\r\n")] = '\0';
+                source->lines = realloc(source->lines, (source->lineQty + 1) * sizeof(char *));
+                source->lines[source->lineQty++] = strdup(text);
+            }
+            fclose(fp);
+        }
+    }
+    if (!source || line < 1 || line > source->lineQty)
+    {
+        return "";
+    }
+    for (i = 0; isspace((unsigned char)source->lines[line - 1][i]); i++)
+        ;
+    return source->lines[line - 1] + i;
+}
+
+static int CompareBlocks(const void *a, const void *b)
+{
+    const struct Block *x = a, *y = b;
+
+    if (x->executed != y->executed)
+        return x->executed < y->executed ? 1 : -1;
+    if (x->runs != y->runs)
+        return x->runs < y->runs ? 1 : -1;
+    return x->id - y->id;
+}
+
+static int CompareFunctions(const void *a, const void *b)
+{
+    const struct Function *x = a, *y = b;
+
+    if (x->executed != y->executed)
+        return x->executed < y->executed ? 1 : -1;
+    return strcmp(x->name, y->name);
+}
+
+double Percent(unsigned long long part, unsigned long long total)
+{
+    return total ? 100.0 * part / total : 0.0;
+}
+
+// the block counters of cc16 -p
+static int CounterReport()
+{
+    unsigned long long total = 0;
+    int i;
+
+    if (ReadAsm(asmFileName) < 0 || ReadDump(dumpFileName) < 0)
+    {
+        return -1;
+    }
+    if (!blockQty)
+    {
+        fprintf(stderr, "%s: no profile blocks, compile with cc16 -p\n", asmFileName);
+        return -1;
+    }
+    if (ram[PROFILE_GUARD] || ram[PROFILE_GUARD + 1])
+    {
+        fprintf(stderr, "%s: the stack overflowed into the profile counters, the counts may be wrong\n",
+            dumpFileName);
+    }
+
+    for (i = 0; i < blockQty; i++)
+    {
+        struct Block *block = &blocks[i];
+        struct Function *fct = FindFunction(block->fct);
+
+        if (block->addr >= 0 && block->addr + 1 < RAM_SIZE)
+        {
+            block->runs = ram[block->addr] | (unsigned long)ram[block->addr + 1] << 16;
+        }
+        block->executed = (unsigned long long)block->runs * block->instrs;
+        if (!fct->blocks++)
+        {
+            fct->calls = block->runs;
+        }
+        fct->executed += block->executed;
+        total += block->executed;
+    }
+
+    qsort(blocks, blockQty, sizeof blocks[0], CompareBlocks);
+    qsort(fcts, fctQty, sizeof fcts[0], CompareFunctions);
+
+    printf("%s: %d blocks in %d functions, %llu instructions executed in the blocks\n",
+        asmFileName, blockQty, fctQty, total);
+
+    printf("\nhot blocks\n");
+    printf("%10s %6s %12s %6s %5s  %-16s %s\n", "runs", "instrs", "executed", "%", "block", "function", "source");
+    for (i = 0; i < blockQty && (!rows || i < rows); i++)
+    {
+        struct Block *block = &blocks[i];
+        char where[300];
+
+        if (!block->runs)
+        {
+            break;
+        }
+        snprintf(where, sizeof where, "%s:%d", block->file, block->line);
+        printf("%10lu %6d %12llu %6.2f %5d  %-16s %s  %s\n", block->runs, block->instrs, block->executed,
+            Percent(block->executed, total), block->id, block->fct, where, SourceLine(block->file, block->line));
+    }
+
+    printf("\nhot functions\n");
+    printf("%10s %6s %12s %6s  %s\n", "calls", "blocks", "executed", "%", "function");
+    for (i = 0; i < fctQty; i++)
+    {
+        struct Function *fct = &fcts[i];
+
+        printf("%10lu %6d %12llu %6.2f  %s\n", fct->calls, fct->blocks, fct->executed,
+            Percent(fct->executed, total), fct->name);
+    }
+
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    ParseOptions(argc, argv);
+
+    if ((traceMode ? TraceReport(asmFileName, dumpFileName, fold) : CounterReport()) < 0)
+    {
+        exit(EXIT_FAILURE);
+    }
+
+    return 0;
+}
+
+// end of main.c
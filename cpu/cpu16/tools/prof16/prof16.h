@@ -0,0 +1,20 @@
+/*
+ *  prof16.h -- definitions shared by the prof16 reports
+ */
+
+#ifndef PROF16_H
+#define PROF16_H
+
+#define NAME_LEN        64
+
+// report this many of the hottest blocks or labels, 0 for all
+extern int rows;
+
+double Percent(unsigned long long part, unsigned long long total);
+
+// trace.c
+int TraceReport(const char *traceFileName, const char *mapFileName, int fold);
+
+#endif // PROF16_H
+
+// end of prof16.h
@@ -0,0 +1,307 @@
+/*
+ *  trace.c -- prof16 -t, the report of an instruction trace
+ *
+ *  The trace is the binary ring file that cpu16_trace.v writes in a test bench
+ *  or that sim16 -T writes, little endian 32-bit words:
+ *
+ *      header: "TR16" (0x36315254), the ring size in records, the records written, 0
+ *      record: the opcode << 16 | the IP, the clocks of the instruction
+ *
+ *  Each IP is attributed to the label at or before it in the symbol map, for a
+ *  flat profile by label, and each opcode to its instruction format, for a
+ *  histogram of the clocks per instruction of each format.
+ *
+ *  The clocks are those of the instructions traced.  The reset clock before
+ *  the first instruction is not in the trace, so a whole trace totals one
+ *  clock less than the cycles sim16 reports.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "prof16.h"
+
+#define TRACE_MAGIC         0x36315254
+#define TRACE_HEADER_BYTES  16
+#define ROM_BASE            0xf000
+#define MAX_LABELS          4096
+#define CLOCK_COLUMNS       9           // 1-8 clocks and 9 or more
+
+struct Label
+{
+    char name[NAME_LEN];
+    unsigned short addr;
+    unsigned long long instrs;
+    unsigned long long clocks;
+};
+
+// an instruction format, by the 5-bit opcode field
+struct OpClass
+{
+    const char *name;
+    unsigned long long instrs;
+    unsigned long long clocks;
+    unsigned long long hist[CLOCK_COLUMNS];
+};
+
+static struct Label labels[MAX_LABELS + 1];  // and the one before the first label
+static int labelQty;
+static struct Label unknown = {"(before the first label)"};
+
+static struct OpClass opClasses[] =
+{
+    {"alu reg"},                // 00000
+    {"alu [reg]"},              // 00001
+    {"imm16, jmp"},             // 00011
+    {"mul, div"},               // 00100
+    {"zp load"},                // 00101
+    {"zp store"},               // 00110
+    {"shift"},                  // 00111
+    {"jsr direct"},             // 01000
+    {"load [reg+#], pop"},      // 01001
+    {"store [reg+#], push"},    // 01010
+    {"store direct"},           // 01100
+    {"alu direct"},             // 01101
+    {"jsr reg"},                // 01110
+    {"branch"},                 // 1000t
+    {"branch call"},            // 1010t
+    {"alu imm8"},               // 11+++
+    {"reset, invalid"},
+};
+
+#define OP_CLASS_QTY ((int)(sizeof opClasses / sizeof opClasses[0]))
+
+static struct OpClass *OpClass(unsigned short opcode)
+{
+    static const signed char classes[32] =
+    {
+        0, 1, -1, 2, 3, 4, 5, 6, 7, 8, 9, -1, 10, 11, 12, -1,
+        13, 13, -1, -1, 14, 14, -1, -1, 15, 15, 15, 15, 15, 15, 15, 15,
+    };
+    int i = classes[opcode >> 11];
+
+    return &opClasses[i < 0 ? OP_CLASS_QTY - 1 : i];
+}
+
+// a label cc16 numbers, e.g. _LP12 or LT3, or one of a copy of an inlined function
+static int IsNumbered(const char *name)
+{
+    static const char *prefixes[] = {"_LP", "_PG", "LT", "LZ", "LE"};
+    const char *suffix = strstr(name, "_I");
+    int i, len;
+
+    if (suffix && suffix[2] && strspn(suffix + 2, "0123456789") == strlen(suffix + 2))
+    {
+        return 1;
+    }
+    if (!strcmp(name, "_PG_Clear"))
+    {
+        return 1;
+    }
+    for (i = 0; i < (int)(sizeof prefixes / sizeof prefixes[0]); i++)
+    {
+        len = strlen(prefixes[i]);
+        if (!strncmp(name, prefixes[i], len) && name[len] &&
+            strspn(name + len, "0123456789") == strlen(name + len))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ *  The labels in the ROM from a symbol map, "0x<addr> <name>" lines as ld16 -m
+ *  writes them or "0x<addr> <name> <words>" lines as asm16 -m writes them, or
+ *  "Label <name> is at address 0x<addr>" lines as asm16 -v reports them.
+ */
+static int ReadMap(const char *fileName, int fold)
+{
+    FILE *fp;
+    char line[512], name[NAME_LEN], extra[8];
+    unsigned addr;
+    int n;
+
+    if ((fp = fopen(fileName, "r")) == NULL)
+    {
+        perror(fileName);
+        return -1;
+    }
+
+    while (fgets(line, sizeof line, fp))
+    {
+        n = sscanf(line, " 0x%x %63s %7s", &addr, name, extra);
+        if ((n != 2 && (n != 3 || strspn(extra, "0123456789") != strlen(extra))) &&
+            sscanf(line, "Label %63s is at address 0x%x", name, &addr) != 2)
+        {
+            continue;
+        }
+        if (addr < ROM_BASE || addr > 0xffff || (fold && IsNumbered(name)))
+        {
+            continue;
+        }
+        if (labelQty == MAX_LABELS)
+        {
+            fprintf(stderr, "%s: more than %d labels\n", fileName, MAX_LABELS);
+            break;
+        }
+        snprintf(labels[labelQty].name, NAME_LEN, "%s", name);
+        labels[labelQty++].addr = addr;
+    }
+    fclose(fp);
+
+    return labelQty;
+}
+
+static int CompareAddrs(const void *a, const void *b)
+{
+    const struct Label *x = a, *y = b;
+
+    return x->addr != y->addr ? x->addr - y->addr : strcmp(x->name, y->name);
+}
+
+static int CompareClocks(const void *a, const void *b)
+{
+    const struct Label *x = a, *y = b;
+
+    if (x->clocks != y->clocks)
+        return x->clocks < y->clocks ? 1 : -1;
+    return x->addr - y->addr;
+}
+
+// the label at or before the address
+static struct Label *FindLabel(unsigned short addr)
+{
+    int lo = 0, hi = labelQty - 1, mid;
+
+    if (!labelQty || addr < labels[0].addr)
+    {
+        return &unknown;
+    }
+    while (lo < hi)
+    {
+        mid = (lo + hi + 1) / 2;
+        if (labels[mid].addr <= addr)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    return &labels[lo];
+}
+
+static int GetWord(FILE *fp, unsigned long *word)
+{
+    unsigned char bytes[4];
+
+    if (fread(bytes, 1, 4, fp) != 4)
+    {
+        return 0;
+    }
+    *word = bytes[0] | bytes[1] << 8 | bytes[2] << 16 | (unsigned long)bytes[3] << 24;
+    return 1;
+}
+
+int TraceReport(const char *traceFileName, const char *mapFileName, int fold)
+{
+    FILE *fp;
+    unsigned long magic, ring, records, reserved, word, clocks, qty, first, i;
+    unsigned long long totalInstrs = 0, totalClocks = 0, cum = 0;
+    int j, k;
+
+    if (ReadMap(mapFileName, fold) < 0)
+    {
+        return -1;
+    }
+    qsort(labels, labelQty, sizeof labels[0], CompareAddrs);
+
+    if ((fp = fopen(traceFileName, "rb")) == NULL)
+    {
+        perror(traceFileName);
+        return -1;
+    }
+    if (!GetWord(fp, &magic) || !GetWord(fp, &ring) || !GetWord(fp, &records) || !GetWord(fp, &reserved) ||
+        magic != TRACE_MAGIC || !ring)
+    {
+        fprintf(stderr, "%s: not an instruction trace\n", traceFileName);
+        fclose(fp);
+        return -1;
+    }
+
+    // the oldest record follows the last one written once the ring is full
+    qty = records < ring ? records : ring;
+    first = records < ring ? 0 : records % ring;
+    for (i = 0; i < qty; i++)
+    {
+        if (i == 0 || (first + i) % ring == 0)
+        {
+            fseek(fp, TRACE_HEADER_BYTES + 8 * ((first + i) % ring), SEEK_SET);
+        }
+        if (!GetWord(fp, &word) || !GetWord(fp, &clocks))
+        {
+            fprintf(stderr, "%s: %lu of %lu records\n", traceFileName, i, qty);
+            break;
+        }
+
+        struct Label *label = FindLabel(word & 0xffff);
+        struct OpClass *op = OpClass(word >> 16);
+
+        label->instrs++;
+        label->clocks += clocks;
+        op->instrs++;
+        op->clocks += clocks;
+        op->hist[clocks < CLOCK_COLUMNS ? (clocks ? clocks - 1 : 0) : CLOCK_COLUMNS - 1]++;
+        totalInstrs++;
+        totalClocks += clocks;
+    }
+    fclose(fp);
+
+    printf("%s: %llu instructions, %llu clocks (%.2f clocks/instr)", traceFileName, totalInstrs, totalClocks,
+        totalInstrs ? (double)totalClocks / totalInstrs : 0.0);
+    if (records > ring)
+    {
+        printf(", the %lu oldest were overwritten", records - ring);
+    }
+    printf("\n");
+
+    printf("\nflat profile\n");
+    printf("%12s %6s %6s %12s %6s  %s\n", "clocks", "%", "cum %", "instrs", "c/i", "label");
+    if (unknown.instrs)
+    {
+        labels[labelQty++] = unknown;
+    }
+    qsort(labels, labelQty, sizeof labels[0], CompareClocks);
+    for (j = 0; j < labelQty && (!rows || j < rows) && labels[j].instrs; j++)
+    {
+        cum += labels[j].clocks;
+        printf("%12llu %6.2f %6.2f %12llu %6.2f  %s\n", labels[j].clocks, Percent(labels[j].clocks, totalClocks),
+            Percent(cum, totalClocks), labels[j].instrs, (double)labels[j].clocks / labels[j].instrs, labels[j].name);
+    }
+
+    printf("\nclocks per instruction\n");
+    printf("%-20s %12s %6s %6s ", "format", "instrs", "%", "c/i");
+    for (k = 1; k < CLOCK_COLUMNS; k++)
+    {
+        printf(" %8d", k);
+    }
+    printf(" %7d+\n", CLOCK_COLUMNS);
+    for (j = 0; j < OP_CLASS_QTY; j++)
+    {
+        struct OpClass *op = &opClasses[j];
+
+        if (!op->instrs)
+        {
+            continue;
+        }
+        printf("%-20s %12llu %6.2f %6.2f ", op->name, op->instrs, Percent(op->instrs, totalInstrs),
+            (double)op->clocks / op->instrs);
+        for (k = 0; k < CLOCK_COLUMNS; k++)
+        {
+            printf(" %8llu", op->hist[k]);
+        }
+        printf("\n");
+    }
+
+    return 0;
+}
+
+// end of trace.c
@@ -0,0 +1,321 @@
+/*
+ *  cpu16.c -- CPU16 instruction execution
+ *
+ *  Each call to Cpu16Step() retires one instruction by walking the same states
+ *  as the CPU16 state machine in cpu16.v:
+ *
+ *      S_SELECT -> S_DECODE [-> S_COMPUTE_ADDR [-> S_COMPUTE_SUB_ADDR]] [-> S_COMPUTE]
+ *      S_SELECT -> S_DECODE -> S_MULDIV...
+ *
+ *  and charges one clock per state visited, plus S_DECODE_WAIT/S_COMPUTE_WAIT
+ *  when the module is instantiated with RAM_WAIT=1.  S_MULDIV is repeated until
+ *  the MULDIV unit is done, MULDIV_CYCLES or DIVMOD_CYCLES clocks.  The
+ *  instruction formats are decoded with the masks and opcodes in asm16.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "sim16.h"
+
+// S_COMPUTE state -- transfer the ALU output to the destination and set the flags
+static inline void Compute(struct Cpu16 *cpu, unsigned aluop, unsigned dreg, unsigned B)
+{
+    AluCompute(cpu, aluop, dreg, B);
+    cpu->cycles++;
+}
+
+// S_MULDIV state -- the MULDIV unit result, the flags are set like S_COMPUTE without the carry
+static void MulDiv(struct Cpu16 *cpu, unsigned op, unsigned dreg, unsigned sreg)
+{
+    unsigned short a = cpu->regs[dreg], b = cpu->regs[sreg];
+    unsigned short n = (a & 0x8000) ? -a : a, d = (b & 0x8000) ? -b : b;
+    unsigned short y;
+
+    if (op == MD_MUL)
+    {
+        y = (unsigned)a * b;
+        cpu->cycles += MULDIV_CYCLES;
+    }
+    else
+    {
+        if (op == MD_DIV)
+            y = !d ? 0 : ((a ^ b) & 0x8000) ? -(n / d) : n / d;
+        else
+            y = !d ? a : (a & 0x8000) ? -(n % d) : n % d;
+        cpu->cycles += DIVMOD_CYCLES;
+    }
+    cpu->regs[dreg] = y;
+    cpu->zero = y == 0;
+    cpu->neg = (y >> 15) & 1;
+}
+
+void Cpu16Reset(struct Cpu16 *cpu)
+{
+    // S_RESET state
+    cpu->regs[REG_IP] = RESET_ADDR;
+    cpu->halted = 0;
+    cpu->cycles++;
+}
+
+// execute one instruction, returns 0 once the program has halted
+int Cpu16Step(struct System16 *sys)
+{
+    struct Cpu16 *cpu = &sys->cpu;
+    unsigned short *regs = cpu->regs;
+    unsigned short pc = regs[REG_IP];
+    unsigned short instr, addr, data;
+    unsigned dreg, sreg, aluop;
+
+    // S_SELECT, [S_DECODE_WAIT], S_DECODE
+    instr = MemRead(sys, pc);
+    regs[REG_IP] = pc + 1;
+    cpu->cycles += cpu->ramWait ? 3 : 2;
+    cpu->instrs++;
+
+    dreg = (instr & DREG_MASK) >> DREG_SHIFT;
+    sreg = (instr & SREG_MASK) >> SREG_SHIFT;
+    aluop = (instr & ALU_OP_MASK) >> ALU_OP_SHIFT;
+
+    // the default next state after S_DECODE waits a cycle when opcode[11] is set
+#define COMPUTE_WAIT()  if (cpu->ramWait && (instr & 0x0800)) cpu->cycles++
+
+    switch ((instr & OPCODE_MASK) >> OPCODE_SHIFT)
+    {
+        // 00000aaa0++++bbb  operation A+B->A
+        case REG_OPCODE:
+            if (instr & 0x0080)
+                goto reset;
+            Compute(cpu, aluop, dreg, regs[sreg]);
+            break;
+
+        // 00001aaa01+++bbb  operation A+[B]->A
+        case REG_INDIR_OPCODE:
+            if ((instr & 0x00c0) != 0x0040)
+                goto reset;
+            addr = regs[sreg];
+            if (sreg == REG_SP)
+                regs[REG_SP]++;
+            COMPUTE_WAIT();
+            Compute(cpu, aluop, dreg, MemRead(sys, addr));
+            break;
+
+        // 00011aaa0++++000  operation A+imm16->A, also jmp
+        case IMMEDIATE16_OPCODE:
+            if (instr & 0x0087)
+                goto reset;
+            data = MemRead(sys, regs[REG_IP]);
+            regs[REG_IP]++;
+            COMPUTE_WAIT();
+            Compute(cpu, aluop, dreg, data);
+            if (dreg == REG_IP && regs[REG_IP] == pc)
+                cpu->halted = 1;
+            break;
+
+        // 00100aaa000oobbb  multiply/divide A*B->A
+        case MULDIV_OPCODE:
+            if ((instr & 0x00e0) || aluop > MD_MOD)
+                goto reset;
+            MulDiv(cpu, aluop, dreg, sreg);
+            break;
+
+        // 00111aaa0ss00bbb, 00111aaa1ss0####  shift A<<B->A, A<<#->A
+        case SHIFT_OPCODE:
+        {
+            unsigned shiftop = (instr & SHIFT_OP_MASK) >> SHIFT_OP_SHIFT;
+
+            if ((instr & 0x0010) || shiftop > SH_ASR || ((instr & SHIFT_IMMED_FLAG) == 0 && (instr & 0x0008)))
+                goto reset;
+            COMPUTE_WAIT();
+            ShiftCompute(cpu, shiftop, dreg, (instr & SHIFT_IMMED_FLAG) ? instr & SHIFT_COUNT_MASK : regs[sreg]);
+            cpu->cycles++;
+            break;
+        }
+
+        // 11+++aaa########  immediate binary operation
+        case 0x18: case 0x19: case 0x1a: case 0x1b:
+        case 0x1c: case 0x1d: case 0x1e: case 0x1f:
+            COMPUTE_WAIT();
+            Compute(cpu, (instr >> 11) & 0xf, dreg, instr & IMMED8_MASK);
+            break;
+
+        // 00101aaa########  load ZP memory
+        case ZP_LOAD_OPCODE:
+            COMPUTE_WAIT();
+            Compute(cpu, OP_LOAD_B, dreg, MemRead(sys, instr & IMMED8_MASK));
+            break;
+
+        // 00110aaa########  store ZP memory
+        case ZP_STORE_OPCODE:
+            MemWrite(sys, instr & IMMED8_MASK, regs[dreg]);
+            break;
+
+        // 01000???00000???  store IP -> [SP], <imm16> -> IP, direct subroutine call
+        case DIRECT_CALL_OPCODE:
+            if (instr & 0x00f8)
+                goto reset;
+            data = MemRead(sys, regs[REG_IP]);
+            regs[REG_IP]++;
+            MemWrite(sys, regs[REG_SP], regs[REG_IP]);
+            regs[REG_SP]--;
+            regs[REG_IP] = data;
+            cpu->cycles += 2;       // S_COMPUTE_ADDR, S_COMPUTE_SUB_ADDR
+            break;
+
+        // 01001aaa#####bbb  load [B+#] -> A, also pop and rts
+        case INDEX5_LOAD_OPCODE:
+            addr = regs[sreg] + SEXT5((instr & INDEX5_MASK) >> INDEX5_SHIFT);
+            if (sreg == REG_SP)
+                regs[REG_SP]++;
+            COMPUTE_WAIT();
+            Compute(cpu, OP_LOAD_B, dreg, MemRead(sys, addr));
+            break;
+
+        // 01010aaa#####bbb  store A -> [B+#], also push
+        case INDEX5_STORE_OPCODE:
+            addr = regs[sreg] + SEXT5((instr & INDEX5_MASK) >> INDEX5_SHIFT);
+            data = regs[dreg];
+            if (sreg == REG_SP)
+                regs[REG_SP]--;
+            MemWrite(sys, addr, data);
+            break;
+
+        // 0110000000000aaa  store A -> [imm16]
+        case DIRECT_STORE_OPCODE:
+            if (instr & 0x07f8)
+                goto reset;
+            data = regs[sreg];
+            addr = MemRead(sys, regs[REG_IP]);
+            regs[REG_IP]++;
+            MemWrite(sys, addr, data);
+            cpu->cycles++;          // S_COMPUTE_ADDR
+            break;
+
+        // 01101aaa01+++000  operation A <op> [imm16] -> A
+        case DIRECT_OPCODE:
+            if ((instr & 0x00c7) != 0x0040)
+                goto reset;
+            addr = MemRead(sys, regs[REG_IP]);
+            regs[REG_IP]++;
+            cpu->cycles++;          // S_COMPUTE_ADDR
+            Compute(cpu, aluop, dreg, MemRead(sys, addr));
+            break;
+
+        // 01110aaa00cccbbb  store A -> [B], C -> IP, register subroutine call
+        case REG_CALL_OPCODE:
+        {
+            unsigned short target = regs[(instr & AREG_MASK) >> AREG_SHIFT];
+
+            if (instr & 0x00c0)
+                goto reset;
+            addr = regs[sreg];
+            data = regs[dreg];
+            if (sreg == REG_SP)
+                regs[REG_SP]--;
+            MemWrite(sys, addr, data);
+            regs[REG_IP] = target;
+            break;
+        }
+
+        // 1000tttt########  conditional branch
+        case IP_REL_BRANCH_OPCODE:
+        case IP_REL_BRANCH_OPCODE | 0x1:
+            if (BranchTaken(cpu, (instr & BRCOND_MASK) >> BRCOND_SHIFT))
+            {
+                regs[REG_IP] += SEXT8(instr & IMMED8_MASK);
+                if (regs[REG_IP] == pc)
+                    cpu->halted = 1;
+            }
+            break;
+
+        // 1010tttt########  conditional subroutine branch
+        case IP_REL_CALL_OPCODE:
+        case IP_REL_CALL_OPCODE | 0x1:
+            if (BranchTaken(cpu, (instr & BRCOND_MASK) >> BRCOND_SHIFT))
+            {
+                MemWrite(sys, regs[REG_SP], regs[REG_IP]);
+                regs[REG_SP]--;
+                regs[REG_IP] += SEXT8(instr & IMMED8_MASK);
+            }
+            break;
+
+        // fall-through RESET, e.g. the "reset" instruction
+        default:
+        reset:
+            Cpu16Reset(cpu);
+            break;
+    }
+#undef COMPUTE_WAIT
+
+    return !cpu->halted;
+}
+
+// run until the program halts or the cycle limit is reached, returns the cycles executed
+unsigned long long Cpu16Run(struct System16 *sys, unsigned long long maxCycles, int trace)
+{
+    struct Cpu16 *cpu = &sys->cpu;
+    unsigned long long start = cpu->cycles;
+
+    while (cpu->cycles - start < maxCycles)
+    {
+        if (trace)
+        {
+            unsigned short *r = cpu->regs;
+            fprintf(stderr, "%04X: %04X  ax=%04X bx=%04X cx=%04X dx=%04X ep=%04X bp=%04X sp=%04X %c%c%c\n",
+                r[REG_IP], MemRead(sys, r[REG_IP]), r[REG_AX], r[REG_BX], r[REG_CX], r[REG_DX], r[REG_EP], r[REG_BP], r[REG_SP],
+                cpu->carry ? 'C' : '-', cpu->zero ? 'Z' : '-', cpu->neg ? 'N' : '-');
+        }
+        if (!Cpu16Step(sys))
+            break;
+    }
+
+    return cpu->cycles - start;
+}
+
+// a 32-bit word of the trace ring, little endian as $fwrite "%u" writes it
+static void PutWord(FILE *fp, unsigned long word)
+{
+    putc(word & 0xff, fp);
+    putc((word >> 8) & 0xff, fp);
+    putc((word >> 16) & 0xff, fp);
+    putc((word >> 24) & 0xff, fp);
+}
+
+static void PutHeader(FILE *fp, unsigned long ringSize, unsigned long records)
+{
+    fseek(fp, 0, SEEK_SET);
+    PutWord(fp, TRACE_MAGIC);
+    PutWord(fp, ringSize);
+    PutWord(fp, records);
+    PutWord(fp, 0);
+}
+
+// run like Cpu16Run and write each instruction to the trace ring, see TRACE_MAGIC
+unsigned long long Cpu16RunRing(struct System16 *sys, unsigned long long maxCycles, FILE *fp, unsigned long ringSize)
+{
+    struct Cpu16 *cpu = &sys->cpu;
+    unsigned long long start = cpu->cycles, before;
+    unsigned long records = 0;
+    unsigned short ip, opcode;
+    int running = 1;
+
+    PutHeader(fp, ringSize, 0);
+    while (running && cpu->cycles - start < maxCycles)
+    {
+        ip = cpu->regs[REG_IP];
+        opcode = MemRead(sys, ip);
+        before = cpu->cycles;
+        running = Cpu16Step(sys);
+
+        // the oldest record is overwritten once the ring is full
+        if (records && records % ringSize == 0)
+            fseek(fp, TRACE_HEADER_BYTES, SEEK_SET);
+        PutWord(fp, (unsigned long)opcode << 16 | ip);
+        PutWord(fp, (unsigned long)(cpu->cycles - before));
+        records++;
+    }
+    PutHeader(fp, ringSize, records);
+
+    return cpu->cycles - start;
+}
+
+// end of cpu16.c
@@ -0,0 +1,995 @@
+/*
+ *  jit.c -- CPU16 to x86-64 basic block translator
+ *
+ *  Cpu16RunJit() translates the straight line runs of ROM code that end at a
+ *  bra/bcc/bsr, jmp, jsr or rts into x86-64 code and runs them natively.  The
+ *  instructions are decoded with Cpu16Predecode() so the translator charges
+ *  exactly the clocks the interpreters charge.  While a block runs:
+ *
+ *      r8-r14  ax, bx, cx, dx, ep, bp, sp (zero extended to 32 bits)
+ *      r15d    last ALU result, the zero and neg flags are derived from it
+ *      ebx     last carry generating ALU result, the carry flag is bit 16
+ *      rbp     cycle counter
+ *      rdi     struct JitState
+ *      rsi     RAM
+ *
+ *  so the flags are only computed when a branch or the interpreter needs them.
+ *  Blocks with a constant successor are linked to it the first time the exit
+ *  is taken, rts and the register jsr look their target up in a table, and
+ *  the cycle limit is checked at every block exit.
+ *
+ *  Only RAM is accessed from translated code.  A load or store whose address
+ *  turns out not to be in RAM (basic_io_16, sound_io_16, keypad_io_16 or a
+ *  ROM table) exits the block before the instruction and the instruction is
+ *  run by Cpu16Step(), as are the instructions at a constant I/O address,
+ *  code in RAM and the rare formats the translator doesn't handle.
+ *
+ *  Cpu16CrossCheckJit() runs the translated code one block at a time against
+ *  a second system run by Cpu16Step() and reports the first difference.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include "sim16.h"
+
+#if defined(__x86_64__) && defined(__linux__)
+
+#include <sys/mman.h>
+
+#define CODE_SIZE           (16 * 1024 * 1024)
+#define BLOCK_BYTES         (16 * 1024)     // worst case size of one block
+#define MAX_BLOCK_INSTRS    64
+#define MAX_SIDE_EXITS      MAX_BLOCK_INSTRS
+
+// state shared by the C code and the translated code
+struct JitState
+{
+    unsigned short  regs[8];                // ax..sp between blocks, ip on exit
+    unsigned        zn;                     // last ALU result, zero and neg flags
+    unsigned        c;                      // last carry generating ALU result, carry flag is bit 16
+    unsigned long long cycles;
+    unsigned long long instrs;
+    unsigned long long limit;               // exit when cycles reaches limit
+    unsigned short *ram;
+    void          **table;                  // translated block by address for the indirect exits
+    unsigned char  *patch;                  // rel32 of the exit that wants to be linked
+    int             step;                   // run the instruction at ip with Cpu16Step()
+    int             halted;
+};
+
+#define ST(field)   ((int)offsetof(struct JitState, field))
+
+// x86-64 registers
+enum { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+enum { CC_AE = 0x3, CC_Z = 0x4, CC_NZ = 0x5 };
+enum { ALU_ADD = 0, ALU_OR = 1, ALU_AND = 4, ALU_SUB = 5, ALU_XOR = 6, ALU_CMP = 7 };
+enum { SHIFT_SHL = 4, SHIFT_SHR = 5, SHIFT_SAR = 7 };
+
+#define HREG(r)     (R8 + (r))              // host register of a CPU16 register other than ip
+#define HSP         HREG(REG_SP)
+
+// an exit taken before an instruction that has to be interpreted
+struct SideExit
+{
+    unsigned char  *fixup;
+    unsigned short  pc;
+    int             instrs;
+    int             cycles;
+};
+
+typedef void (*JitEnter)(struct JitState *st, void *code);
+
+static unsigned char *codeBuf;              // prologue, epilogue, then the blocks
+static unsigned char *codeFree;
+static unsigned char *epilogue;
+static unsigned char *codeStart;            // first block
+static JitEnter enter;
+static unsigned flushes;
+
+static void *blocks[ROM_SIZE];              // translated ROM blocks
+static unsigned char noJit[ROM_SIZE];       // the instruction is always interpreted
+static void *table[0x10000];                // blocks by IP for the indirect exits
+static void *noTable[0x10000];              // no indirect linking when cross checking
+static int linking;
+
+static struct System16 *jitSys;
+static struct SideExit sideExits[MAX_SIDE_EXITS];
+static int sideExitQty;
+
+// --- emitter -----------------------------------------------------------------
+
+static unsigned char *jp;
+
+static void B(unsigned x)
+{
+    *jp++ = (unsigned char)x;
+}
+
+static void D(unsigned x)
+{
+    memcpy(jp, &x, 4);
+    jp += 4;
+}
+
+static void Rex(int w, int r, int x, int b)
+{
+    int rex = 0x40 | (w << 3) | ((r & 8) >> 1) | ((x & 8) >> 2) | ((b & 8) >> 3);
+
+    if (rex != 0x40)
+        B(rex);
+}
+
+// [base + index*scale + disp32], index < 0 for none, base must not be rsp or r12
+static void Mem(int reg, int base, int index, int scale, int disp)
+{
+    if (index < 0)
+    {
+        B(0x80 | ((reg & 7) << 3) | (base & 7));
+    }
+    else
+    {
+        B(0x80 | ((reg & 7) << 3) | 4);
+        B(((scale == 8 ? 3 : scale == 4 ? 2 : scale == 2 ? 1 : 0) << 6) | ((index & 7) << 3) | (base & 7));
+    }
+    D(disp);
+}
+
+// <op> dst, src
+static void OpRR(int w, int op, int dst, int src)
+{
+    Rex(w, src, 0, dst);
+    B(op);
+    B(0xc0 | ((src & 7) << 3) | (dst & 7));
+}
+
+#define MovRR(dst, src)     OpRR(0, 0x89, dst, src)
+
+// <alu> dst, imm32
+static void AluRI(int w, int alu, int dst, unsigned imm)
+{
+    Rex(w, 0, 0, dst);
+    B(0x81);
+    B(0xc0 | (alu << 3) | (dst & 7));
+    D(imm);
+}
+
+static void TestRI(int dst, unsigned imm)
+{
+    Rex(0, 0, 0, dst);
+    B(0xf7);
+    B(0xc0 | (dst & 7));
+    D(imm);
+}
+
+static void MovRI(int dst, unsigned imm)
+{
+    Rex(0, 0, 0, dst);
+    B(0xb8 + (dst & 7));
+    D(imm);
+}
+
+static void MovRI64(int dst, unsigned long long imm)
+{
+    Rex(1, 0, 0, dst);
+    B(0xb8 + (dst & 7));
+    D((unsigned)imm);
+    D((unsigned)(imm >> 32));
+}
+
+static void ShiftRI(int shift, int dst, int n)
+{
+    Rex(0, 0, 0, dst);
+    B(0xc1);
+    B(0xc0 | (shift << 3) | (dst & 7));
+    B(n);
+}
+
+// movzx dst, src16
+static void MovzxRR(int dst, int src)
+{
+    Rex(0, dst, 0, src);
+    B(0x0f);
+    B(0xb7);
+    B(0xc0 | ((dst & 7) << 3) | (src & 7));
+}
+
+// movsx dst, src16
+static void MovsxRR(int dst, int src)
+{
+    Rex(0, dst, 0, src);
+    B(0x0f);
+    B(0xbf);
+    B(0xc0 | ((dst & 7) << 3) | (src & 7));
+}
+
+// movzx dst, word [base + index*2 + disp]
+static void LoadW(int dst, int base, int index, int disp)
+{
+    Rex(0, dst, index < 0 ? 0 : index, base);
+    B(0x0f);
+    B(0xb7);
+    Mem(dst, base, index, 2, disp);
+}
+
+// mov word [base + index*2 + disp], src
+static void StoreW(int src, int base, int index, int disp)
+{
+    B(0x66);
+    Rex(0, src, index < 0 ? 0 : index, base);
+    B(0x89);
+    Mem(src, base, index, 2, disp);
+}
+
+// mov word [base + index*2 + disp], imm16
+static void StoreWI(int base, int index, int disp, unsigned imm)
+{
+    B(0x66);
+    Rex(0, 0, index < 0 ? 0 : index, base);
+    B(0xc7);
+    Mem(0, base, index, 2, disp);
+    B(imm & 0xff);
+    B((imm >> 8) & 0xff);
+}
+
+// mov reg, [base + disp] and mov [base + disp], reg
+static void Load(int w, int dst, int base, int disp)
+{
+    Rex(w, dst, 0, base);
+    B(0x8b);
+    Mem(dst, base, -1, 0, disp);
+}
+
+static void Store(int w, int src, int base, int disp)
+{
+    Rex(w, src, 0, base);
+    B(0x89);
+    Mem(src, base, -1, 0, disp);
+}
+
+// mov dword [base + disp], imm32
+static void StoreDI(int base, int disp, unsigned imm)
+{
+    Rex(0, 0, 0, base);
+    B(0xc7);
+    Mem(0, base, -1, 0, disp);
+    D(imm);
+}
+
+// add qword [base + disp], imm32
+static void AddMI64(int base, int disp, unsigned imm)
+{
+    Rex(1, 0, 0, base);
+    B(0x81);
+    Mem(0, base, -1, 0, disp);
+    D(imm);
+}
+
+// cmp reg, qword [base + disp]
+static void CmpRM64(int reg, int base, int disp)
+{
+    Rex(1, reg, 0, base);
+    B(0x3b);
+    Mem(reg, base, -1, 0, disp);
+}
+
+static void Push(int reg)
+{
+    Rex(0, 0, 0, reg);
+    B(0x50 + (reg & 7));
+}
+
+static void Pop(int reg)
+{
+    Rex(0, 0, 0, reg);
+    B(0x58 + (reg & 7));
+}
+
+static void JmpR(int reg)
+{
+    Rex(0, 0, 0, reg);
+    B(0xff);
+    B(0xe0 | (reg & 7));
+}
+
+// jcc/jmp rel32, returns the rel32 field for SetRel()
+static unsigned char *Jcc(int cc)
+{
+    unsigned char *rel;
+
+    B(0x0f);
+    B(0x80 | cc);
+    rel = jp;
+    D(0);
+    return rel;
+}
+
+static unsigned char *Jmp(void)
+{
+    unsigned char *rel;
+
+    B(0xe9);
+    rel = jp;
+    D(0);
+    return rel;
+}
+
+static void SetRel(unsigned char *rel, void *target)
+{
+    int disp = (int)((unsigned char *)target - (rel + 4));
+
+    memcpy(rel, &disp, 4);
+}
+
+// --- translator --------------------------------------------------------------
+
+// eax = A <op> B, where B is the host register breg or imm when breg < 0
+static void EmitAlu(unsigned aluop, int a, int breg, unsigned imm)
+{
+    // the carry flag into edx
+#define CARRY_IN() \
+    MovRR(RDX, RBX); \
+    ShiftRI(SHIFT_SHR, RDX, 16); \
+    AluRI(0, ALU_AND, RDX, 1)
+
+    // B operand of the binary operations
+#define BINOP(op, alu) \
+    if (breg >= 0) \
+        OpRR(0, op, RAX, breg); \
+    else \
+        AluRI(0, alu, RAX, imm)
+
+    if (aluop != OP_ZERO && aluop != OP_LOAD_B)
+        MovRR(RAX, a);
+
+    switch (aluop)
+    {
+        case OP_ZERO:   OpRR(0, 0x31, RAX, RAX); break;
+        case OP_LOAD_A: break;
+        case OP_INC:    AluRI(0, ALU_ADD, RAX, 1); break;
+        case OP_DEC:    AluRI(0, ALU_SUB, RAX, 1); break;
+        case OP_ASL:    ShiftRI(SHIFT_SHL, RAX, 1); break;
+        case OP_ROL:
+            ShiftRI(SHIFT_SHL, RAX, 1);
+            CARRY_IN();
+            OpRR(0, 0x09, RAX, RDX);
+            break;
+        case OP_LSR:
+        case OP_ROR:
+            MovRR(RDX, RAX);
+            AluRI(0, ALU_AND, RDX, 1);
+            ShiftRI(SHIFT_SHL, RDX, 16);
+            ShiftRI(SHIFT_SHR, RAX, 1);
+            OpRR(0, 0x09, RAX, RDX);
+            if (aluop == OP_ROR)
+            {
+                CARRY_IN();
+                ShiftRI(SHIFT_SHL, RDX, 15);
+                OpRR(0, 0x09, RAX, RDX);
+            }
+            break;
+        case OP_OR:     BINOP(0x09, ALU_OR); break;
+        case OP_AND:    BINOP(0x21, ALU_AND); break;
+        case OP_XOR:    BINOP(0x31, ALU_XOR); break;
+        case OP_LOAD_B:
+            if (breg >= 0)
+                MovRR(RAX, breg);
+            else
+                MovRI(RAX, imm);
+            break;
+        case OP_ADD:    BINOP(0x01, ALU_ADD); break;
+        case OP_SUB:    BINOP(0x29, ALU_SUB); break;
+        case OP_ADC:
+            BINOP(0x01, ALU_ADD);
+            CARRY_IN();
+            OpRR(0, 0x01, RAX, RDX);
+            break;
+        case OP_SBB:
+            BINOP(0x29, ALU_SUB);
+            CARRY_IN();
+            OpRR(0, 0x29, RAX, RDX);
+            break;
+    }
+#undef CARRY_IN
+#undef BINOP
+}
+
+// S_COMPUTE -- the result goes to dreg and becomes the lazy flags
+static void EmitCompute(unsigned aluop, unsigned dreg, int breg, unsigned imm)
+{
+    EmitAlu(aluop, HREG(dreg), breg, imm);
+    MovzxRR(HREG(dreg), RAX);
+    MovRR(R15, RAX);
+    if (aluop & 0x4)
+        MovRR(RBX, RAX);
+}
+
+static void EmitIncSp(int alu)
+{
+    AluRI(0, alu, HSP, 1);
+    MovzxRR(HSP, HSP);
+}
+
+// ecx = the 16-bit address, leave the block when it is not in RAM
+static void EmitRamCheck(unsigned short pc, int instrs, int cycles)
+{
+    struct SideExit *se = &sideExits[sideExitQty++];
+
+    TestRI(RCX, 0xf000);
+    se->fixup = Jcc(CC_NZ);
+    se->pc = pc;
+    se->instrs = instrs;
+    se->cycles = cycles;
+}
+
+// charge the clocks and instructions of the block up to the exit
+static void EmitCount(int instrs, int cycles)
+{
+    if (cycles)
+        AluRI(1, ALU_ADD, RBP, cycles);
+    if (instrs)
+        AddMI64(RDI, ST(instrs), instrs);
+}
+
+// exit to a constant address, linked to the target block the first time it is taken
+static void EmitDirectExit(unsigned short target, int instrs, int cycles, int halt)
+{
+    unsigned char *rel;
+    int i;
+
+    EmitCount(instrs, cycles);
+    StoreWI(RDI, -1, ST(regs) + 2 * REG_IP, target);
+    if (halt)
+    {
+        StoreDI(RDI, ST(halted), 1);
+        SetRel(Jmp(), epilogue);
+        return;
+    }
+    CmpRM64(RBP, RDI, ST(limit));
+    SetRel(Jcc(CC_AE), epilogue);
+    rel = Jmp();
+
+    // link right away when the target is already translated
+    i = target & (ROM_SIZE-1);
+    if (linking && (target & 0xf000) == ROM_BASE && blocks[i])
+    {
+        SetRel(rel, blocks[i]);
+        return;
+    }
+
+    // otherwise ask to be linked
+    SetRel(rel, jp);
+    MovRI64(RAX, (unsigned long long)(size_t)rel);
+    Store(1, RAX, RDI, ST(patch));
+    SetRel(Jmp(), epilogue);
+}
+
+// exit to the address in eax through the block table
+static void EmitIndirectExit(int instrs, int cycles)
+{
+    EmitCount(instrs, cycles);
+    StoreW(RAX, RDI, -1, ST(regs) + 2 * REG_IP);
+    CmpRM64(RBP, RDI, ST(limit));
+    SetRel(Jcc(CC_AE), epilogue);
+    Load(1, RCX, RDI, ST(table));
+    Rex(1, RCX, RAX, RCX);                  // mov rcx, [rcx + rax*8]
+    B(0x8b);
+    Mem(RCX, RCX, RAX, 8, 0);
+    OpRR(1, 0x85, RCX, RCX);
+    SetRel(Jcc(CC_Z), epilogue);
+    JmpR(RCX);
+}
+
+// jump to the returned fixups when the branch condition is true
+static int EmitBranchTest(unsigned cond, unsigned char **fixups)
+{
+    int pol = (cond >> 3) & 1;
+    int qty = 0;
+
+    if (cond & 0x1)
+    {
+        TestRI(RBX, 0x10000);
+        fixups[qty++] = Jcc(pol ? CC_NZ : CC_Z);
+    }
+    if (cond & 0x2)
+    {
+        TestRI(R15, 0xffff);
+        fixups[qty++] = Jcc(pol ? CC_Z : CC_NZ);
+    }
+    if (cond & 0x4)
+    {
+        TestRI(R15, 0x8000);
+        fixups[qty++] = Jcc(pol ? CC_NZ : CC_Z);
+    }
+    return qty;
+}
+
+static void Flush(void)
+{
+    codeFree = codeStart;
+    memset(blocks, 0, sizeof blocks);
+    memset(noJit, 0, sizeof noJit);
+    memset(table, 0, sizeof table);
+    flushes++;
+}
+
+// translate the block at pc, returns NULL when its first instruction has to be interpreted
+static void *Translate(unsigned short pc)
+{
+    struct System16 *sys = jitSys;
+    unsigned char *start, *fixups[3];
+    struct Decoded d;
+    int instrs = 0, cycles = 0;
+    int h, i, qty;
+
+    if (codeBuf + CODE_SIZE - codeFree < BLOCK_BYTES)
+        Flush();
+    start = jp = codeFree;
+    sideExitQty = 0;
+
+    for (;;)
+    {
+        unsigned dreg, sreg, aluop;
+        unsigned short target;
+        int n, c, words;
+
+        if (instrs == MAX_BLOCK_INSTRS || (pc & 0xf000) != ROM_BASE)
+            goto fallthrough;
+
+        h = Cpu16Predecode(sys, pc, &d);
+        dreg = d.dreg;
+        sreg = d.sreg;
+        aluop = (h - H_REG) & 0xf;
+        words = 1;
+        n = instrs + 1;                     // counts including this instruction
+        c = cycles + d.cycles;
+
+        if (h >= H_REG && h < H_INDIR)
+        {
+            // 00000aaa0++++bbb  operation A+B->A, also mov ip,reg
+            if (aluop >= OP_OR && sreg == REG_IP)
+                goto fallthrough;
+            if (dreg == REG_IP)
+            {
+                if (aluop != OP_LOAD_B)
+                    goto fallthrough;
+                MovRR(RAX, HREG(sreg));
+                MovRR(R15, RAX);
+                EmitIndirectExit(n, c);
+                break;
+            }
+            EmitCompute(aluop, dreg, aluop >= OP_OR ? HREG(sreg) : -1, 0);
+        }
+        else if (h >= H_INDIR && h < H_IMM16)
+        {
+            // 00001aaa01+++bbb  operation A+[B]->A
+            if (dreg == REG_IP || sreg == REG_IP)
+                goto fallthrough;
+            MovRR(RCX, HREG(sreg));
+            EmitRamCheck(pc, instrs, cycles);
+            LoadW(RCX, RSI, RCX, 0);
+            if (sreg == REG_SP)
+                EmitIncSp(ALU_ADD);
+            EmitCompute(aluop, dreg, RCX, 0);
+        }
+        else if (h >= H_IMM16 && h < H_DIRECT)
+        {
+            // operation A+imm16->A and immediate binary operation
+            if (dreg == REG_IP)
+                goto fallthrough;
+            EmitCompute(aluop, dreg, -1, d.imm);
+            words = (h < H_IMM8) ? 2 : 1;
+        }
+        else if (h >= H_DIRECT && h < H_BRANCH)
+        {
+            // 01101aaa01+++000  operation A <op> [imm16] -> A, ROM words are constants
+            if (dreg == REG_IP)
+                goto fallthrough;
+            if ((d.imm & 0xf000) == RAM_BASE)
+            {
+                LoadW(RCX, RSI, -1, 2 * d.imm);
+                EmitCompute(aluop, dreg, RCX, 0);
+            }
+            else if ((d.imm & 0xf000) == ROM_BASE)
+            {
+                EmitCompute(aluop, dreg, -1, sys->rom[d.imm & (ROM_SIZE-1)]);
+            }
+            else
+            {
+                goto fallthrough;
+            }
+            words = 2;
+        }
+        else if (h >= H_BRANCH || h == H_BRANCH_SELF)
+        {
+            // 1000tttt########  conditional branch
+            target = pc + 1 + d.imm;
+            if (d.cond == BRCOND_ALLWAYS)
+            {
+                EmitDirectExit(target, n, c, h == H_BRANCH_SELF);
+                break;
+            }
+            qty = EmitBranchTest(d.cond, fixups);
+            EmitDirectExit(pc + 1, n, c, 0);
+            for (i = 0; i < qty; i++)
+                SetRel(fixups[i], jp);
+            EmitDirectExit(target, n, c, h == H_BRANCH_SELF);
+            break;
+        }
+        else switch (h)
+        {
+            // 00101aaa########  load ZP memory
+            case H_ZP_LOAD:
+                if (dreg == REG_IP)
+                    goto fallthrough;
+                LoadW(RCX, RSI, -1, 2 * d.imm);
+                EmitCompute(OP_LOAD_B, dreg, RCX, 0);
+                break;
+
+            // 00110aaa########  store ZP memory
+            case H_ZP_STORE:
+                if (dreg == REG_IP)
+                    goto fallthrough;
+                StoreW(HREG(dreg), RSI, -1, 2 * d.imm);
+                break;
+
+            // 01001aaa#####bbb  load [B+#] -> A, also pop and rts
+            case H_INDEX_LOAD:
+                if (sreg == REG_IP)
+                    goto fallthrough;
+                MovRR(RCX, HREG(sreg));
+                AluRI(0, ALU_ADD, RCX, d.imm);
+                MovzxRR(RCX, RCX);
+                EmitRamCheck(pc, instrs, cycles);
+                LoadW(RCX, RSI, RCX, 0);
+                if (sreg == REG_SP)
+                    EmitIncSp(ALU_ADD);
+                if (dreg == REG_IP)
+                {
+                    MovRR(RAX, RCX);
+                    MovRR(R15, RAX);
+                    EmitIndirectExit(n, c);
+                    goto done;
+                }
+                EmitCompute(OP_LOAD_B, dreg, RCX, 0);
+                break;
+
+            // 01010aaa#####bbb  store A -> [B+#], also push
+            case H_INDEX_STORE:
+                if (dreg == REG_IP || sreg == REG_IP)
+                    goto fallthrough;
+                MovRR(RCX, HREG(sreg));
+                AluRI(0, ALU_ADD, RCX, d.imm);
+                MovzxRR(RCX, RCX);
+                EmitRamCheck(pc, instrs, cycles);
+                StoreW(HREG(dreg), RSI, RCX, 0);
+                if (sreg == REG_SP)
+                    EmitIncSp(ALU_SUB);
+                break;
+
+            // 0110000000000aaa  store A -> [imm16]
+            case H_DIRECT_STORE:
+                if (sreg == REG_IP || (d.imm & 0xf000) != RAM_BASE)
+                    goto fallthrough;
+                StoreW(HREG(sreg), RSI, -1, 2 * d.imm);
+                words = 2;
+                break;
+
+            // 01000???00000???  store IP -> [SP], <imm16> -> IP, direct subroutine call
+            case H_DIRECT_CALL:
+                MovRR(RCX, HSP);
+                EmitRamCheck(pc, instrs, cycles);
+                StoreWI(RSI, RCX, 0, (unsigned short)(pc + 2));
+                EmitIncSp(ALU_SUB);
+                EmitDirectExit(d.imm, n, c, 0);
+                goto done;
+
+            // 00111aaa1ss0####  shift A<<#->A, the shifts by a register are interpreted
+            case H_SHIFT_IMM:
+                if (dreg == REG_IP)
+                    goto fallthrough;
+                if (d.cond == SH_ASR)
+                    MovsxRR(RAX, HREG(dreg));
+                else
+                    MovRR(RAX, HREG(dreg));
+                ShiftRI(d.cond == SH_ASL ? SHIFT_SHL : d.cond == SH_LSR ? SHIFT_SHR : SHIFT_SAR, RAX, d.imm);
+                MovzxRR(HREG(dreg), RAX);
+                MovRR(R15, RAX);
+                break;
+
+            // 01110aaa00cccbbb  store A -> [B], C -> IP, register subroutine call
+            case H_REG_CALL:
+                if (d.areg == REG_IP || sreg == REG_IP)
+                    goto fallthrough;
+                MovRR(RDX, HREG(d.areg));
+                MovRR(RCX, HREG(sreg));
+                EmitRamCheck(pc, instrs, cycles);
+                if (dreg == REG_IP)
+                    StoreWI(RSI, RCX, 0, (unsigned short)(pc + 1));
+                else
+                    StoreW(HREG(dreg), RSI, RCX, 0);
+                if (sreg == REG_SP)
+                    EmitIncSp(ALU_SUB);
+                MovRR(RAX, RDX);
+                EmitIndirectExit(n, c);
+                goto done;
+
+            // 0001111101011000  jmp, i.e. mov ip,imm16
+            case H_JMP:
+                MovRI(R15, d.imm);
+                EmitDirectExit(d.imm, n, c, d.imm == pc);
+                goto done;
+
+            // 1010tttt########  conditional subroutine branch
+            case H_CALL:
+                target = pc + 1 + d.imm;
+                if (d.cond != BRCOND_ALLWAYS)
+                {
+                    qty = EmitBranchTest(d.cond, fixups);
+                    EmitDirectExit(pc + 1, n, c, 0);
+                    for (i = 0; i < qty; i++)
+                        SetRel(fixups[i], jp);
+                }
+                MovRR(RCX, HSP);
+                EmitRamCheck(pc, instrs, cycles);
+                StoreWI(RSI, RCX, 0, (unsigned short)(pc + 1));
+                EmitIncSp(ALU_SUB);
+                EmitDirectExit(target, n, c, 0);
+                goto done;
+
+            // reset, the multiply/divide unit and the instructions that straddle the end of the ROM
+            default:
+                goto fallthrough;
+        }
+
+        pc += words;
+        instrs = n;
+        cycles = c;
+    }
+    goto done;
+
+fallthrough:
+    // the instruction at pc is interpreted, or starts the next block
+    if (instrs == 0)
+    {
+        jp = start;
+        return NULL;
+    }
+    EmitDirectExit(pc, instrs, cycles, 0);
+
+done:
+    // exits before the instructions whose address is not in RAM
+    for (i = 0; i < sideExitQty; i++)
+    {
+        struct SideExit *se = &sideExits[i];
+
+        SetRel(se->fixup, jp);
+        EmitCount(se->instrs, se->cycles);
+        StoreWI(RDI, -1, ST(regs) + 2 * REG_IP, se->pc);
+        StoreDI(RDI, ST(step), 1);
+        SetRel(Jmp(), epilogue);
+    }
+
+    codeFree = jp;
+    return start;
+}
+
+// the translated block at pc, translating it the first time
+static void *Lookup(unsigned short pc)
+{
+    int i = pc & (ROM_SIZE-1);
+
+    if ((pc & 0xf000) != ROM_BASE)
+        return NULL;
+    if (!blocks[i] && !noJit[i])
+    {
+        if ((blocks[i] = Translate(pc)) == NULL)
+            noJit[i] = 1;
+        else if (linking)
+            table[pc] = blocks[i];
+    }
+    return blocks[i];
+}
+
+// allocate the code buffer and emit the prologue and the epilogue
+static int Init(void)
+{
+    int i;
+
+    if (codeBuf)
+        return 1;
+    codeBuf = mmap(NULL, CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (codeBuf == MAP_FAILED)
+    {
+        perror("sim16: jit");
+        codeBuf = NULL;
+        return 0;
+    }
+
+    // void enter(struct JitState *st, void *code)
+    jp = codeBuf;
+    enter = (JitEnter)(void *)jp;
+    Push(RBX);
+    Push(RBP);
+    Push(R12);
+    Push(R13);
+    Push(R14);
+    Push(R15);
+    OpRR(1, 0x89, RAX, RSI);
+    Load(1, RSI, RDI, ST(ram));
+    for (i = REG_AX; i <= REG_SP; i++)
+        LoadW(HREG(i), RDI, -1, ST(regs) + 2 * i);
+    Load(0, R15, RDI, ST(zn));
+    Load(0, RBX, RDI, ST(c));
+    Load(1, RBP, RDI, ST(cycles));
+    JmpR(RAX);
+
+    epilogue = jp;
+    for (i = REG_AX; i <= REG_SP; i++)
+        StoreW(HREG(i), RDI, -1, ST(regs) + 2 * i);
+    Store(0, R15, RDI, ST(zn));
+    Store(0, RBX, RDI, ST(c));
+    Store(1, RBP, RDI, ST(cycles));
+    Pop(R15);
+    Pop(R14);
+    Pop(R13);
+    Pop(R12);
+    Pop(RBP);
+    Pop(RBX);
+    B(0xc3);
+    codeStart = jp;
+
+    return 1;
+}
+
+// copy the CPU state to and from the translated code's lazy form
+static void CpuToJit(struct System16 *sys, struct JitState *st)
+{
+    struct Cpu16 *cpu = &sys->cpu;
+
+    memcpy(st->regs, cpu->regs, sizeof st->regs);
+    st->zn = (cpu->neg ? 0x8000 : 0) | (cpu->zero ? 0 : 1);
+    st->c = cpu->carry << 16;
+    st->cycles = cpu->cycles;
+    st->instrs = cpu->instrs;
+    st->halted = cpu->halted;
+}
+
+static void JitToCpu(struct System16 *sys, struct JitState *st)
+{
+    struct Cpu16 *cpu = &sys->cpu;
+
+    memcpy(cpu->regs, st->regs, sizeof cpu->regs);
+    cpu->zero = (st->zn & 0xffff) == 0;
+    cpu->neg = (st->zn >> 15) & 1;
+    cpu->carry = (st->c >> 16) & 1;
+    cpu->cycles = st->cycles;
+    cpu->instrs = st->instrs;
+    cpu->halted = st->halted;
+}
+
+// compare the system with the one run by the interpreter, returns 0 when they differ
+static int Compare(struct System16 *sys, struct System16 *shadow, unsigned short pc)
+{
+    struct Cpu16 *a = &sys->cpu, *b = &shadow->cpu;
+    const char *what = NULL;
+
+    if (memcmp(a->regs, b->regs, sizeof a->regs))
+        what = "registers";
+    else if (a->carry != b->carry || a->zero != b->zero || a->neg != b->neg)
+        what = "flags";
+    else if (a->cycles != b->cycles)
+        what = "cycles";
+    else if (a->halted != b->halted)
+        what = "halted";
+    else if (memcmp(sys->ram, shadow->ram, sizeof sys->ram))
+        what = "RAM";
+    else if (sys->leds != shadow->leds || memcmp(sys->display, shadow->display, sizeof sys->display) ||
+             sys->displayCtrl != shadow->displayCtrl || memcmp(sys->sound, shadow->sound, sizeof sys->sound))
+        what = "I/O";
+
+    if (what == NULL)
+        return 1;
+
+    fprintf(stderr, "sim16: jit and interpreter %s differ after the block at 0x%04X (instr %llu)\n", what, pc, b->instrs);
+    fprintf(stderr, "jit:\n");
+    SysReport(sys, stderr);
+    fprintf(stderr, "cycles  = %llu\n", a->cycles);
+    fprintf(stderr, "interpreter:\n");
+    SysReport(shadow, stderr);
+    fprintf(stderr, "cycles  = %llu\n", b->cycles);
+    return 0;
+}
+
+// run translated code, stepping shadow along with it when it isn't NULL
+static int Run(struct System16 *sys, unsigned long long maxCycles, struct System16 *shadow)
+{
+    struct JitState st;
+    unsigned long long blocksRun = 0;
+
+    memset(&st, 0, sizeof st);
+    jitSys = sys;
+    linking = (shadow == NULL);
+    Flush();
+
+    CpuToJit(sys, &st);
+    st.limit = st.cycles + maxCycles;
+    st.ram = sys->ram;
+    st.table = linking ? table : noTable;
+
+    while (!st.halted && st.cycles < st.limit)
+    {
+        unsigned short pc = st.regs[REG_IP];
+        unsigned char *patch = st.patch;
+        unsigned gen = flushes;
+        void *code;
+
+        st.patch = NULL;
+        code = st.step ? NULL : Lookup(pc);
+        if (patch && code && linking && gen == flushes)
+            SetRel(patch, code);
+
+        if (code)
+        {
+            enter(&st, code);
+            blocksRun++;
+        }
+        else
+        {
+            st.step = 0;
+            JitToCpu(sys, &st);
+            Cpu16Step(sys);
+            CpuToJit(sys, &st);
+        }
+
+        if (shadow)
+        {
+            JitToCpu(sys, &st);
+            while (shadow->cpu.instrs < sys->cpu.instrs && Cpu16Step(shadow))
+                ;
+            if (!Compare(sys, shadow, pc))
+                return -1;
+        }
+    }
+
+    JitToCpu(sys, &st);
+    if (shadow && verbose)
+        printf("jit: cross checked %llu blocks\n", blocksRun);
+    return 0;
+}
+
+unsigned long long Cpu16RunJit(struct System16 *sys, unsigned long long maxCycles)
+{
+    unsigned long long start = sys->cpu.cycles;
+
+    if (!Init())
+        return Cpu16RunPredecoded(sys, maxCycles);
+    Run(sys, maxCycles, NULL);
+    return sys->cpu.cycles - start;
+}
+
+int Cpu16CrossCheckJit(struct System16 *sys, struct System16 *shadow, unsigned long long maxCycles)
+{
+    if (!Init())
+        return -1;
+    return Run(sys, maxCycles, shadow);
+}
+
+#else
+
+// other hosts run the predecoded interpreter instead
+unsigned long long Cpu16RunJit(struct System16 *sys, unsigned long long maxCycles)
+{
+    return Cpu16RunPredecoded(sys, maxCycles);
+}
+
+int Cpu16CrossCheckJit(struct System16 *sys, struct System16 *shadow, unsigned long long maxCycles)
+{
+    fprintf(stderr, "sim16: the jit is only supported on x86-64 Linux\n");
+    return -1;
+}
+
+#endif
+
+// end of jit.c
@@ -0,0 +1,209 @@
+/*
+ * main function for sim16
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+#include "sim16.h"
+
+// options
+static char *romFileName = "rom.bin";
+static unsigned long long maxCycles = 1000000000ULL;
+static int trace = 0;
+static int naive = 0;
+static int jit = 0;
+static int crossCheck = 0;
+static char *dumpFileName = NULL;
+static char *ringFileName = NULL;
+static unsigned long ringSize = TRACE_RING;
+int verbose = 0;
+
+static struct System16 sys;
+static struct System16 shadow;
+
+static void Usage(FILE *fp)
+{
+    fprintf(fp, "usage: sim16 [-s <switches>] [-b <buttons>] [-k <keycode>] [-c <cycles>] [-d <dump file>] [-T <trace file> [-R <records>]] [-w] [-n] [-j] [-x] [-t] [-v] [-h] [<rom file>]\n");
+}
+
+static void ParseOptions(int argc, char* argv[])
+{
+	const char* optStr = "s:b:k:c:d:T:R:wnjxtvh";
+	int opt;
+
+	while ((opt = getopt(argc, argv, optStr)) != -1)
+	{
+		switch (opt)
+		{
+			case 's':
+				sys.switches = strtoul(optarg, NULL, 0);
+				break;
+			case 'b':
+				sys.buttons = strtoul(optarg, NULL, 0);
+				break;
+			case 'k':
+				sys.keypad = strtoul(optarg, NULL, 0);
+				break;
+			case 'c':
+				maxCycles = strtoull(optarg, NULL, 0);
+				break;
+			case 'd':
+				dumpFileName = optarg;
+				break;
+			case 'T':
+				ringFileName = optarg;
+				break;
+			case 'R':
+				ringSize = strtoul(optarg, NULL, 0);
+				break;
+			case 'w':
+				sys.cpu.ramWait = 1;
+				break;
+			case 'n':
+				naive = 1;
+				break;
+			case 'j':
+				jit = 1;
+				break;
+			case 'x':
+				crossCheck = 1;
+				break;
+			case 't':
+				trace = 1;
+				break;
+			case 'v':
+				verbose = 1;
+				break;
+			case 'h':
+				Usage(stdout);
+				printf("\n");
+				printf("     options:\n");
+				printf("         -s <switches>: set the switch register value\n");
+				printf("         -b <buttons>:  set the button register value\n");
+				printf("         -k <keycode>:  set the keypad register value\n");
+				printf("         -c <cycles>:   set the maximum number of CPU cycles to run (default %llu)\n", maxCycles);
+				printf("         -d <dump file>: write the RAM to this file at the end, one hex word per line\n");
+				printf("                        as $writememh does, e.g. for the cc16 -p counters and prof16\n");
+				printf("         -T <trace file>: write each instruction to a binary trace ring, as cpu16_trace.v\n");
+				printf("                        does in a test bench, see prof16 -t, implies -n\n");
+				printf("         -R <records>:  set the size of the trace ring (default %d)\n", TRACE_RING);
+				printf("         -w:            simulate a CPU16 with RAM_WAIT=1\n");
+				printf("         -n:            use the naive interpreter instead of the predecoded one\n");
+				printf("         -j:            translate the ROM code to x86-64 code and run it natively,\n");
+				printf("                        the cycle limit is checked at the end of each block\n");
+				printf("         -x:            cross check the -j translation against the interpreter\n");
+				printf("         -t:            trace every instruction to stderr, implies -n\n");
+				printf("         -v:            set verbose mode\n");
+				printf("         -h:            display this help\n");
+				printf("\n");
+				printf("     The rom file defaults to rom.bin.  The simulation ends when a taken branch targets\n");
+				printf("     itself, e.g. \"__Exit: bra __Exit\", or when the cycle limit is reached.\n");
+				exit(0);
+			default:
+				Usage(stdout);
+				exit(-1);
+		}
+	}
+
+	// the ROM file name is the first non-option cmd line arg
+	if (optind < argc)
+	{
+	    romFileName = argv[optind];
+	}
+}
+
+int main(int argc, char** argv)
+{
+    struct timespec start, end;
+    unsigned long long cycles;
+    double secs;
+    int words, ramWait;
+    unsigned short switches, buttons, keypad;
+
+    ParseOptions(argc, argv);
+
+    // reset everything but the inputs and the CPU configuration
+    switches = sys.switches;
+    buttons = sys.buttons;
+    keypad = sys.keypad;
+    ramWait = sys.cpu.ramWait;
+    SysReset(&sys);
+    sys.switches = switches;
+    sys.buttons = buttons;
+    sys.keypad = keypad;
+    sys.cpu.ramWait = ramWait;
+
+    if ((words = SysLoadRom(&sys, romFileName)) < 0)
+    {
+        exit(EXIT_FAILURE);
+    }
+    if (verbose)
+    {
+        printf("loaded %d words from %s\n", words, romFileName);
+    }
+
+    Cpu16Reset(&sys.cpu);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (crossCheck)
+    {
+        // the interpreter runs a copy of the system alongside the translated code
+        cycles = sys.cpu.cycles;
+        shadow = sys;
+        if (Cpu16CrossCheckJit(&sys, &shadow, maxCycles) < 0)
+        {
+            exit(3);
+        }
+        cycles = sys.cpu.cycles - cycles;
+    }
+    else if (ringFileName)
+    {
+        FILE *fp;
+
+        if (!ringSize)
+        {
+            fprintf(stderr, "sim16: the trace ring needs at least one record\n");
+            exit(EXIT_FAILURE);
+        }
+        if (!(fp = fopen(ringFileName, "wb")))
+        {
+            perror(ringFileName);
+            exit(EXIT_FAILURE);
+        }
+        cycles = Cpu16RunRing(&sys, maxCycles, fp, ringSize);
+        fclose(fp);
+    }
+    else if (naive || trace)
+        cycles = Cpu16Run(&sys, maxCycles, trace);
+    else if (jit)
+        cycles = Cpu16RunJit(&sys, maxCycles);
+    else
+        cycles = Cpu16RunPredecoded(&sys, maxCycles);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    SysReport(&sys, stdout);
+    if (dumpFileName && SysDumpRam(&sys, dumpFileName) < 0)
+    {
+        exit(EXIT_FAILURE);
+    }
+    printf("cycles  = %llu\n", sys.cpu.cycles);
+    printf("instrs  = %llu (%.2f cycles/instr)\n", sys.cpu.instrs, sys.cpu.instrs ? (double)sys.cpu.cycles / sys.cpu.instrs : 0.0);
+    if (verbose)
+    {
+        printf("time    = %.6f s (%.1f MIPS, %.1f MHz)\n", secs, secs > 0 ? sys.cpu.instrs / secs / 1e6 : 0.0, secs > 0 ? cycles / secs / 1e6 : 0.0);
+    }
+
+    if (!sys.cpu.halted)
+    {
+        printf("cycle limit reached at ip=0x%04X\n", sys.cpu.regs[REG_IP]);
+        return 2;
+    }
+
+    return 0;
+}
+
+// end of main.c
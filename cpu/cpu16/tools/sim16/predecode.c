@@ -0,0 +1,414 @@
+/*
+ *  predecode.c -- predecoded CPU16 execution
+ *
+ *  Cpu16RunPredecoded() retires the same instructions with the same cycle
+ *  counts as Cpu16Step(), but every word of RAM and ROM is decoded at most
+ *  once into a struct Decoded.  The Decoded entry holds the address of a
+ *  handler that is specialized for the instruction format and ALU operation,
+ *  the register numbers, the immediate (imm16 words are fetched at decode
+ *  time) and the clocks the instruction takes.  Dispatch is a computed goto
+ *  (a gcc extension) straight to the handler, so the inner loop has no decode
+ *  switch and no ALU operation switch.
+ *
+ *  The ROM is decoded when the run starts.  RAM entries start out pointing at
+ *  the decode handler and MemWrite() points them back at it whenever the word
+ *  or the word after it is written, so self modifying and downloaded code in
+ *  RAM still works.  Instructions fetched from anywhere else and the few
+ *  forms that are not worth a handler are executed by Cpu16Step().
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "sim16.h"
+
+// decode the instruction at pc into d, returns the handler id
+int Cpu16Predecode(struct System16 *sys, unsigned short pc, struct Decoded *d)
+{
+    unsigned short instr = MemRead(sys, pc);
+    unsigned aluop = (instr & ALU_OP_MASK) >> ALU_OP_SHIFT;
+    int decodeCycles = sys->cpu.ramWait ? 3 : 2;
+    int computeWait = sys->cpu.ramWait && (instr & 0x0800);
+
+    d->dreg = (instr & DREG_MASK) >> DREG_SHIFT;
+    d->sreg = (instr & SREG_MASK) >> SREG_SHIFT;
+    d->areg = (instr & AREG_MASK) >> AREG_SHIFT;
+    d->cond = (instr & BRCOND_MASK) >> BRCOND_SHIFT;
+    d->cycles = decodeCycles;
+    d->imm = 0;
+
+    // the imm16 word of an instruction at the end of RAM or ROM is not covered by the invalidation
+    switch ((instr & OPCODE_MASK) >> OPCODE_SHIFT)
+    {
+        case IMMEDIATE16_OPCODE:
+        case DIRECT_CALL_OPCODE:
+        case DIRECT_STORE_OPCODE:
+        case DIRECT_OPCODE:
+            if (((pc + 1) & 0x0fff) == 0)
+                return H_STEP;
+            d->imm = MemRead(sys, pc + 1);
+            break;
+    }
+
+    switch ((instr & OPCODE_MASK) >> OPCODE_SHIFT)
+    {
+        case REG_OPCODE:
+            if (instr & 0x0080)
+                return H_RESET;
+            d->cycles += 1;
+            return H_REG + aluop;
+
+        case REG_INDIR_OPCODE:
+            if ((instr & 0x00c0) != 0x0040)
+                return H_RESET;
+            d->cycles += 1 + computeWait;
+            return H_INDIR + aluop;
+
+        case IMMEDIATE16_OPCODE:
+            if (instr & 0x0087)
+                return H_RESET;
+            d->cycles += 1 + computeWait;
+            if (d->dreg == REG_IP)
+                return (aluop == OP_LOAD_B) ? H_JMP : H_STEP;
+            return H_IMM16 + aluop;
+
+        case 0x18: case 0x19: case 0x1a: case 0x1b:
+        case 0x1c: case 0x1d: case 0x1e: case 0x1f:
+            d->imm = instr & IMMED8_MASK;
+            d->cycles += 1 + computeWait;
+            return H_IMM8 + ((instr >> 11) & 0xf);
+
+        case ZP_LOAD_OPCODE:
+            d->imm = instr & IMMED8_MASK;
+            d->cycles += 1 + computeWait;
+            return H_ZP_LOAD;
+
+        case ZP_STORE_OPCODE:
+            d->imm = instr & IMMED8_MASK;
+            return H_ZP_STORE;
+
+        case DIRECT_CALL_OPCODE:
+            if (instr & 0x00f8)
+                return H_RESET;
+            d->cycles += 2;
+            return H_DIRECT_CALL;
+
+        case INDEX5_LOAD_OPCODE:
+            d->imm = SEXT5((instr & INDEX5_MASK) >> INDEX5_SHIFT);
+            d->cycles += 1 + computeWait;
+            return H_INDEX_LOAD;
+
+        case INDEX5_STORE_OPCODE:
+            d->imm = SEXT5((instr & INDEX5_MASK) >> INDEX5_SHIFT);
+            return H_INDEX_STORE;
+
+        case DIRECT_STORE_OPCODE:
+            if (instr & 0x07f8)
+                return H_RESET;
+            d->cycles += 1;
+            return H_DIRECT_STORE;
+
+        case DIRECT_OPCODE:
+            if ((instr & 0x00c7) != 0x0040)
+                return H_RESET;
+            d->cycles += 2;
+            return H_DIRECT + aluop;
+
+        case REG_CALL_OPCODE:
+            if (instr & 0x00c0)
+                return H_RESET;
+            return H_REG_CALL;
+
+        case SHIFT_OPCODE:
+            d->cond = (instr & SHIFT_OP_MASK) >> SHIFT_OP_SHIFT;
+            if ((instr & 0x0010) || d->cond > SH_ASR || ((instr & SHIFT_IMMED_FLAG) == 0 && (instr & 0x0008)))
+                return H_RESET;
+            d->cycles += 1 + computeWait;
+            if ((instr & SHIFT_IMMED_FLAG) == 0)
+                return H_SHIFT;
+            d->imm = instr & SHIFT_COUNT_MASK;
+            return H_SHIFT_IMM;
+
+        // the multiply/divide unit is rare enough to be left to Cpu16Step()
+        case MULDIV_OPCODE:
+            return H_STEP;
+
+        case IP_REL_BRANCH_OPCODE:
+        case IP_REL_BRANCH_OPCODE | 0x1:
+            d->imm = SEXT8(instr & IMMED8_MASK);
+            return (d->imm == 0xffff) ? H_BRANCH_SELF : H_BRANCH + d->cond;
+
+        case IP_REL_CALL_OPCODE:
+        case IP_REL_CALL_OPCODE | 0x1:
+            d->imm = SEXT8(instr & IMMED8_MASK);
+            return H_CALL;
+    }
+
+    return H_RESET;
+}
+
+// run until the program halts or the cycle limit is reached, returns the cycles executed
+unsigned long long Cpu16RunPredecoded(struct System16 *sys, unsigned long long maxCycles)
+{
+#define REG_LABEL(n)    [H_REG + n] = &&reg_##n,
+#define INDIR_LABEL(n)  [H_INDIR + n] = &&indir_##n,
+#define IMM16_LABEL(n)  [H_IMM16 + n] = &&imm16_##n,
+#define IMM8_LABEL(n)   [H_IMM8 + n] = &&imm8_##n,
+#define DIRECT_LABEL(n) [H_DIRECT + n] = &&direct_##n,
+#define BRANCH_LABEL(n) [H_BRANCH + n] = &&branch_##n,
+    static const void *const handlers[H_QTY] =
+    {
+        [H_DECODE] = &&decode,
+        [H_STEP] = &&step,
+        [H_RESET] = &&reset,
+        [H_ZP_LOAD] = &&zp_load,
+        [H_ZP_STORE] = &&zp_store,
+        [H_INDEX_LOAD] = &&index_load,
+        [H_INDEX_STORE] = &&index_store,
+        [H_DIRECT_STORE] = &&direct_store,
+        [H_DIRECT_CALL] = &&direct_call,
+        [H_REG_CALL] = &&reg_call,
+        [H_JMP] = &&jmp,
+        [H_BRANCH_SELF] = &&branch_self,
+        [H_CALL] = &&call,
+        [H_SHIFT] = &&shift,
+        [H_SHIFT_IMM] = &&shift_imm,
+        ALU_OPS(REG_LABEL)
+        ALU_OPS(INDIR_LABEL)
+        ALU_OPS(IMM16_LABEL)
+        ALU_OPS(IMM8_LABEL)
+        ALU_OPS(DIRECT_LABEL)
+        ALU_OPS(BRANCH_LABEL)
+    };
+    struct Cpu16 *cpu = &sys->cpu;
+    unsigned short *regs = cpu->regs;
+    unsigned long long start = cpu->cycles;
+    unsigned long long cycles = cpu->cycles, instrs = cpu->instrs, limit = start + maxCycles;
+    struct Decoded *pages[16] = {0};
+    struct Decoded *d;
+    unsigned short pc, addr, data;
+    int i;
+
+    // only RAM and ROM are cached, code fetched from the I/O pages is stepped
+    pages[RAM_BASE >> 12] = sys->ramCode;
+    pages[ROM_BASE >> 12] = sys->romCode;
+
+    sys->decodeHandler = &&decode;
+    for (i = 0; i < RAM_SIZE; i++)
+        sys->ramCode[i].handler = &&decode;
+    for (i = 0; i < ROM_SIZE; i++)
+        sys->romCode[i].handler = handlers[Cpu16Predecode(sys, ROM_BASE + i, &sys->romCode[i])];
+
+    // fetch the next instruction, S_SELECT
+#define NEXT() \
+    do \
+    { \
+        if (cycles >= limit) \
+            goto done; \
+        pc = regs[REG_IP]; \
+        if (!pages[pc >> 12]) \
+            goto step; \
+        d = &pages[pc >> 12][pc & 0x0fff]; \
+        goto *d->handler; \
+    } while (0)
+
+    // retire the instruction, S_DECODE
+#define BEGIN(words) \
+    regs[REG_IP] = pc + (words); \
+    cycles += d->cycles; \
+    instrs++
+
+    // the counters live in locals, they are written back around Cpu16Step()
+#define SAVE() \
+    cpu->cycles = cycles; \
+    cpu->instrs = instrs
+#define LOAD() \
+    cycles = cpu->cycles; \
+    instrs = cpu->instrs
+
+    NEXT();
+
+decode:
+    d->handler = handlers[Cpu16Predecode(sys, pc, d)];
+    goto *d->handler;
+
+step:
+    SAVE();
+    i = Cpu16Step(sys);
+    LOAD();
+    if (!i)
+        goto done;
+    NEXT();
+
+    // fall-through RESET, the S_RESET state of Cpu16Reset()
+reset:
+    BEGIN(1);
+    regs[REG_IP] = RESET_ADDR;
+    cpu->halted = 0;
+    cycles++;
+    NEXT();
+
+    // 00000aaa0++++bbb  operation A+B->A
+#define REG_HANDLER(n) \
+reg_##n: \
+    BEGIN(1); \
+    AluCompute(cpu, n, d->dreg, regs[d->sreg]); \
+    NEXT();
+    ALU_OPS(REG_HANDLER)
+
+    // 00111aaa0ss00bbb  shift A<<B->A
+shift:
+    BEGIN(1);
+    ShiftCompute(cpu, d->cond, d->dreg, regs[d->sreg]);
+    NEXT();
+
+    // 00111aaa1ss0####  shift A<<#->A
+shift_imm:
+    BEGIN(1);
+    ShiftCompute(cpu, d->cond, d->dreg, d->imm);
+    NEXT();
+
+    // 00001aaa01+++bbb  operation A+[B]->A
+#define INDIR_HANDLER(n) \
+indir_##n: \
+    BEGIN(1); \
+    addr = regs[d->sreg]; \
+    if (d->sreg == REG_SP) \
+        regs[REG_SP]++; \
+    AluCompute(cpu, n, d->dreg, MemRead(sys, addr)); \
+    NEXT();
+    ALU_OPS(INDIR_HANDLER)
+
+    // 00011aaa0++++000  operation A+imm16->A
+#define IMM16_HANDLER(n) \
+imm16_##n: \
+    BEGIN(2); \
+    AluCompute(cpu, n, d->dreg, d->imm); \
+    NEXT();
+    ALU_OPS(IMM16_HANDLER)
+
+    // 11+++aaa########  immediate binary operation
+#define IMM8_HANDLER(n) \
+imm8_##n: \
+    BEGIN(1); \
+    AluCompute(cpu, n, d->dreg, d->imm); \
+    NEXT();
+    ALU_OPS(IMM8_HANDLER)
+
+    // 01101aaa01+++000  operation A <op> [imm16] -> A
+#define DIRECT_HANDLER(n) \
+direct_##n: \
+    BEGIN(2); \
+    AluCompute(cpu, n, d->dreg, MemRead(sys, d->imm)); \
+    NEXT();
+    ALU_OPS(DIRECT_HANDLER)
+
+    // 1000tttt########  conditional branch
+#define BRANCH_HANDLER(n) \
+branch_##n: \
+    BEGIN(1); \
+    if (BranchTaken(cpu, n)) \
+        regs[REG_IP] += d->imm; \
+    NEXT();
+    ALU_OPS(BRANCH_HANDLER)
+
+    // a branch to itself ends the simulation when it is taken
+branch_self:
+    BEGIN(1);
+    if (BranchTaken(cpu, d->cond))
+    {
+        regs[REG_IP] = pc;
+        cpu->halted = 1;
+        goto done;
+    }
+    NEXT();
+
+    // 0001111101011000  jmp, i.e. mov ip,imm16
+jmp:
+    BEGIN(2);
+    AluCompute(cpu, OP_LOAD_B, REG_IP, d->imm);
+    if (d->imm == pc)
+    {
+        cpu->halted = 1;
+        goto done;
+    }
+    NEXT();
+
+    // 00101aaa########  load ZP memory
+zp_load:
+    BEGIN(1);
+    AluCompute(cpu, OP_LOAD_B, d->dreg, sys->ram[d->imm]);
+    NEXT();
+
+    // 00110aaa########  store ZP memory
+zp_store:
+    BEGIN(1);
+    MemWrite(sys, d->imm, regs[d->dreg]);
+    NEXT();
+
+    // 01000???00000???  store IP -> [SP], <imm16> -> IP, direct subroutine call
+direct_call:
+    BEGIN(2);
+    MemWrite(sys, regs[REG_SP], regs[REG_IP]);
+    regs[REG_SP]--;
+    regs[REG_IP] = d->imm;
+    NEXT();
+
+    // 01001aaa#####bbb  load [B+#] -> A, also pop and rts
+index_load:
+    BEGIN(1);
+    addr = regs[d->sreg] + d->imm;
+    if (d->sreg == REG_SP)
+        regs[REG_SP]++;
+    AluCompute(cpu, OP_LOAD_B, d->dreg, MemRead(sys, addr));
+    NEXT();
+
+    // 01010aaa#####bbb  store A -> [B+#], also push
+index_store:
+    BEGIN(1);
+    addr = regs[d->sreg] + d->imm;
+    data = regs[d->dreg];
+    if (d->sreg == REG_SP)
+        regs[REG_SP]--;
+    MemWrite(sys, addr, data);
+    NEXT();
+
+    // 0110000000000aaa  store A -> [imm16]
+direct_store:
+    BEGIN(2);
+    MemWrite(sys, d->imm, regs[d->sreg]);
+    NEXT();
+
+    // 01110aaa00cccbbb  store A -> [B], C -> IP, register subroutine call
+reg_call:
+    BEGIN(1);
+    pc = regs[d->areg];
+    addr = regs[d->sreg];
+    data = regs[d->dreg];
+    if (d->sreg == REG_SP)
+        regs[REG_SP]--;
+    MemWrite(sys, addr, data);
+    regs[REG_IP] = pc;
+    NEXT();
+
+    // 1010tttt########  conditional subroutine branch
+call:
+    BEGIN(1);
+    if (BranchTaken(cpu, d->cond))
+    {
+        MemWrite(sys, regs[REG_SP], regs[REG_IP]);
+        regs[REG_SP]--;
+        regs[REG_IP] += d->imm;
+    }
+    NEXT();
+
+done:
+    SAVE();
+    return cycles - start;
+
+#undef NEXT
+#undef BEGIN
+#undef SAVE
+#undef LOAD
+}
+
+// end of predecode.c
@@ -0,0 +1,270 @@
+/*
+ *  sim16.h -- definitions for sim16, the system16 instruction set simulator
+ *
+ *  The simulator models the CPU16 module in cpu16.v state by state so that
+ *  the cycle counts it reports match the hardware, and it models the system16
+ *  memory map from system16.v:
+ *
+ *      0x0000-0x0fff: RAM
+ *      0x2000-0x20ff: basic I/O (basic_io_16.v)
+ *      0x3000-0x30ff: sound I/O (sound_io_16.v)
+ *      0x4000:        keypad data reg (keypad_io_16.v)
+ *      0xf000-0xffff: ROM (rom_sync.v, loaded from rom.bin with $readmemh semantics)
+ */
+
+#ifndef SIM16_H
+#define SIM16_H
+
+#include <stdio.h>
+#include "../asm16/asm16.h"
+
+// memory map
+#define RAM_BASE            0x0000
+#define RAM_SIZE            0x1000
+#define ROM_BASE            0xf000
+#define ROM_SIZE            0x1000
+#define BASIC_IO_BASE       0x2000
+#define SOUND_IO_BASE       0x3000
+#define KEYPAD_IO_BASE      0x4000
+#define RESET_ADDR          0xf000
+
+// I/O registers
+#define SWITCH_REG          0x2000
+#define BUTTON_REG          0x2002
+#define LED_REG             0x2010
+#define DISPLAY1_REG        0x2020
+#define DISPLAY_CTRL_REG    0x2024
+#define SOUND_REG_QTY       7
+#define KEYPAD_REG          0x4000
+
+// S_MULDIV clocks of the multiply and of the divide/remainder, see MULDIV in cpu16.v
+#define MULDIV_CYCLES       2
+#define DIVMOD_CYCLES       17
+
+// CPU state, the registers use the regIds from asm16.h
+struct Cpu16
+{
+    unsigned short  regs[8];                // ax, bx, cx, dx, ep, bp, sp, ip
+    int             carry;                  // carry flag
+    int             zero;                   // zero flag
+    int             neg;                    // negative flag
+    int             ramWait;                // RAM_WAIT parameter of the CPU16 module
+    int             halted;                 // set when a taken branch targets itself
+    unsigned long long cycles;              // CPU clock cycles
+    unsigned long long instrs;              // retired instructions
+};
+
+// predecoded instruction, see predecode.c
+struct Decoded
+{
+    const void     *handler;                // computed goto label of the instruction handler
+    unsigned char   dreg;                   // A register
+    unsigned char   sreg;                   // B register
+    unsigned char   areg;                   // C register of the register call
+    unsigned char   cond;                   // branch condition or shift operator
+    unsigned char   cycles;                 // clocks, including the wait states
+    unsigned short  imm;                    // imm8, sign extended index or branch offset, or imm16
+};
+
+// system state
+struct System16
+{
+    struct Cpu16    cpu;
+    unsigned short  ram[RAM_SIZE];
+    unsigned short  rom[ROM_SIZE];
+
+    // predecode caches for the RAM and the ROM, a RAM write invalidates the
+    // entry at its address and the one before it (the imm16 word of a
+    // two-word instruction) by pointing them back at the decode handler
+    struct Decoded  ramCode[RAM_SIZE];
+    struct Decoded  romCode[ROM_SIZE];
+    const void     *decodeHandler;
+
+    // basic I/O
+    unsigned short  switches;
+    unsigned short  buttons;
+    unsigned short  leds;
+    unsigned short  display[4];
+    unsigned short  displayCtrl;
+
+    // sound I/O
+    unsigned short  sound[SOUND_REG_QTY];
+
+    // keypad I/O
+    unsigned short  keypad;
+};
+
+// system16.c
+void SysReset(struct System16 *sys);
+int SysLoadRom(struct System16 *sys, const char *fileName);
+int SysDumpRam(struct System16 *sys, const char *fileName);
+unsigned short IoRead(struct System16 *sys, unsigned short addr);
+void IoWrite(struct System16 *sys, unsigned short addr, unsigned short data);
+void SysReport(struct System16 *sys, FILE *fp);
+
+// cpu16.c
+void Cpu16Reset(struct Cpu16 *cpu);
+int Cpu16Step(struct System16 *sys);
+unsigned long long Cpu16Run(struct System16 *sys, unsigned long long maxCycles, int trace);
+unsigned long long Cpu16RunRing(struct System16 *sys, unsigned long long maxCycles, FILE *fp, unsigned long ringSize);
+
+/*
+ *  The binary instruction trace of -T is the ring file that cpu16_trace.v
+ *  writes in a test bench, little endian 32-bit words:
+ *
+ *      header: TRACE_MAGIC, the ring size in records, the records written, 0
+ *      record: the opcode << 16 | the IP, the clocks of the instruction
+ *
+ *  Once the ring is full the oldest record is overwritten, so the one after
+ *  the last written, records written % ring size, is the oldest.
+ */
+#define TRACE_MAGIC         0x36315254      // "TR16"
+#define TRACE_HEADER_BYTES  16
+#define TRACE_RING          65536           // default ring size in records
+
+// predecode.c
+#define ALU_OPS(X) \
+    X(0) X(1) X(2) X(3) X(4) X(5) X(6) X(7) X(8) X(9) X(10) X(11) X(12) X(13) X(14) X(15)
+
+// handler ids, the ALU formats and the branch have one handler per ALU op or condition
+enum
+{
+    H_DECODE,
+    H_STEP,
+    H_RESET,
+    H_ZP_LOAD,
+    H_ZP_STORE,
+    H_INDEX_LOAD,
+    H_INDEX_STORE,
+    H_DIRECT_STORE,
+    H_DIRECT_CALL,
+    H_REG_CALL,
+    H_JMP,
+    H_BRANCH_SELF,
+    H_CALL,
+    H_SHIFT,
+    H_SHIFT_IMM,
+    H_REG,
+    H_INDIR = H_REG + 16,
+    H_IMM16 = H_INDIR + 16,
+    H_IMM8 = H_IMM16 + 16,
+    H_DIRECT = H_IMM8 + 16,
+    H_BRANCH = H_DIRECT + 16,
+    H_QTY = H_BRANCH + 16
+};
+
+int Cpu16Predecode(struct System16 *sys, unsigned short pc, struct Decoded *d);
+unsigned long long Cpu16RunPredecoded(struct System16 *sys, unsigned long long maxCycles);
+
+// jit.c
+unsigned long long Cpu16RunJit(struct System16 *sys, unsigned long long maxCycles);
+int Cpu16CrossCheckJit(struct System16 *sys, struct System16 *shadow, unsigned long long maxCycles);
+
+// main.c
+extern int verbose;
+
+// sign extensions used by the indexed and IP relative formats
+#define SEXT5(x)    ((unsigned short)(((x) & 0x10) ? ((x) | 0xffe0) : (x)))
+#define SEXT8(x)    ((unsigned short)(((x) & 0x80) ? ((x) | 0xff00) : (x)))
+
+// ALU module -- returns the 16-bit result plus the carry out in bit 16
+static inline unsigned Alu(unsigned aluop, unsigned A, unsigned B, unsigned carry)
+{
+    switch (aluop)
+    {
+        // unary operations
+        case OP_ZERO:   return 0;
+        case OP_LOAD_A: return A;
+        case OP_INC:    return (A + 1) & 0x1ffff;
+        case OP_DEC:    return (A - 1) & 0x1ffff;
+
+        // unary operations that generate and/or use carry
+        case OP_ASL:    return A << 1;
+        case OP_LSR:    return ((A & 1) << 16) | (A >> 1);
+        case OP_ROL:    return (A << 1) | carry;
+        case OP_ROR:    return ((A & 1) << 16) | (carry << 15) | (A >> 1);
+
+        // binary operations
+        case OP_OR:     return A | B;
+        case OP_AND:    return A & B;
+        case OP_XOR:    return A ^ B;
+        case OP_LOAD_B: return B;
+
+        // binary operations that generate and/or use carry
+        case OP_ADD:    return A + B;
+        case OP_SUB:    return (A - B) & 0x1ffff;
+        case OP_ADC:    return A + B + carry;
+        default:        return (A - B - carry) & 0x1ffff;   // OP_SBB
+    }
+}
+
+// transfer the ALU output to the destination and set the flags, the carry
+// flag is only written by the operations that generate it
+static inline void AluCompute(struct Cpu16 *cpu, unsigned aluop, unsigned dreg, unsigned B)
+{
+    unsigned Y = Alu(aluop, cpu->regs[dreg], B, cpu->carry);
+
+    cpu->regs[dreg] = (unsigned short)Y;
+    if (aluop & 0x4)
+        cpu->carry = (Y >> 16) & 1;
+    cpu->zero = (Y & 0xffff) == 0;
+    cpu->neg = (Y >> 15) & 1;
+}
+
+// the barrel shifter, a count of 16 or more shifts every bit out
+static inline unsigned short Shift(unsigned shiftop, unsigned short A, unsigned count)
+{
+    if (count > 15)
+        return (shiftop == SH_ASR && (A & 0x8000)) ? 0xffff : 0;
+    if (shiftop == SH_ASL)
+        return A << count;
+    if (shiftop == SH_LSR || !(A & 0x8000))
+        return A >> count;
+    return ~((unsigned short)~A >> count);
+}
+
+// S_COMPUTE state of the shift format, the shifter replaces the ALU and the carry is unchanged
+static inline void ShiftCompute(struct Cpu16 *cpu, unsigned shiftop, unsigned dreg, unsigned count)
+{
+    unsigned short Y = Shift(shiftop, cpu->regs[dreg], count);
+
+    cpu->regs[dreg] = Y;
+    cpu->zero = Y == 0;
+    cpu->neg = (Y >> 15) & 1;
+}
+
+// branch condition test for the IP relative formats
+static inline int BranchTaken(struct Cpu16 *cpu, unsigned cond)
+{
+    return (cond == BRCOND_ALLWAYS) ||
+           ((cond & 0x1) && (((cond >> 3) & 1) == cpu->carry)) ||
+           ((cond & 0x2) && (((cond >> 3) & 1) == cpu->zero)) ||
+           ((cond & 0x4) && (((cond >> 3) & 1) == cpu->neg));
+}
+
+// memory read, RAM and ROM are decoded inline since they are almost every access
+static inline unsigned short MemRead(struct System16 *sys, unsigned short addr)
+{
+    if ((addr & 0xf000) == RAM_BASE)
+        return sys->ram[addr & (RAM_SIZE-1)];
+    if ((addr & 0xf000) == ROM_BASE)
+        return sys->rom[addr & (ROM_SIZE-1)];
+    return IoRead(sys, addr);
+}
+
+// memory write, only RAM is chip selected by the system, everything else is an I/O register
+static inline void MemWrite(struct System16 *sys, unsigned short addr, unsigned short data)
+{
+    if ((addr & 0xf000) == RAM_BASE)
+    {
+        sys->ram[addr & (RAM_SIZE-1)] = data;
+        sys->ramCode[addr & (RAM_SIZE-1)].handler = sys->decodeHandler;
+        sys->ramCode[(addr - 1) & (RAM_SIZE-1)].handler = sys->decodeHandler;
+    }
+    else
+        IoWrite(sys, addr, data);
+}
+
+#endif // SIM16_H
+
+// end of sim16.h
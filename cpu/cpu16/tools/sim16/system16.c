@@ -0,0 +1,218 @@
+/*
+ *  system16.c -- system16 memory map, I/O devices and ROM loader
+ *
+ *  The I/O registers are decoded the same way as basic_io_16.v, sound_io_16.v
+ *  and keypad_io_16.v decode them.  Reads from unmapped addresses return 0 and
+ *  writes to unmapped addresses (including ROM) are ignored.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "sim16.h"
+
+// display characters for the pattern codes in basic_io_16.v
+static const char displayChars[] = "0123456789AbCdEF -JLPSUc";
+
+void SysReset(struct System16 *sys)
+{
+    memset(&sys->cpu, 0, sizeof sys->cpu);
+    memset(sys->ram, 0, sizeof sys->ram);
+    sys->leds = 0;
+    sys->displayCtrl = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        // the display is initialized to all blank
+        sys->display[i] = 0x10;
+    }
+    memset(sys->sound, 0, sizeof sys->sound);
+}
+
+// load the ROM image from a $readmemh file, i.e. whitespace separated hex words
+// with optional // and /* */ comments and @<addr> directives
+int SysLoadRom(struct System16 *sys, const char *fileName)
+{
+    FILE *fp;
+    int c, addr = 0, words = 0;
+    char token[80];
+
+    if ((fp = fopen(fileName, "r")) == NULL)
+    {
+        perror(fileName);
+        return -1;
+    }
+
+    memset(sys->rom, 0, sizeof sys->rom);
+    while ((c = fgetc(fp)) != EOF)
+    {
+        int len = 0;
+
+        if (isspace(c))
+            continue;
+
+        // comments
+        if (c == '/')
+        {
+            c = fgetc(fp);
+            if (c == '/')
+            {
+                while ((c = fgetc(fp)) != EOF && c != '\n')
+                    ;
+                continue;
+            }
+            if (c == '*')
+            {
+                int prev = 0;
+                while ((c = fgetc(fp)) != EOF && !(prev == '*' && c == '/'))
+                    prev = c;
+                continue;
+            }
+            fprintf(stderr, "%s: unexpected '/'\n", fileName);
+            fclose(fp);
+            return -1;
+        }
+
+        // collect the token
+        do
+        {
+            if (len < (int)sizeof token - 1)
+                token[len++] = c;
+        } while ((c = fgetc(fp)) != EOF && !isspace(c));
+        token[len] = '\0';
+
+        if (token[0] == '@')
+        {
+            addr = strtol(token + 1, NULL, 16);
+        }
+        else
+        {
+            char *end;
+            unsigned long word = strtoul(token, &end, 16);
+
+            if (*end != '\0')
+            {
+                // asm16 emits "****" for instructions it could not encode
+                fprintf(stderr, "%s: invalid word \"%s\" at ROM offset 0x%03X\n", fileName, token, addr);
+                fclose(fp);
+                return -1;
+            }
+            if (addr >= ROM_SIZE)
+            {
+                fprintf(stderr, "%s: image is larger than the %d word ROM\n", fileName, ROM_SIZE);
+                fclose(fp);
+                return -1;
+            }
+            sys->rom[addr++] = (unsigned short)word;
+            words++;
+        }
+    }
+    fclose(fp);
+
+    return words;
+}
+
+// write the RAM as $writememh does, one hex word per line
+int SysDumpRam(struct System16 *sys, const char *fileName)
+{
+    FILE *fp;
+    int addr;
+
+    if ((fp = fopen(fileName, "w")) == NULL)
+    {
+        perror(fileName);
+        return -1;
+    }
+    for (addr = 0; addr < RAM_SIZE; addr++)
+    {
+        fprintf(fp, "%04x\n", sys->ram[addr]);
+    }
+    fclose(fp);
+
+    return 0;
+}
+
+unsigned short IoRead(struct System16 *sys, unsigned short addr)
+{
+    switch (addr & 0xff00)
+    {
+        case BASIC_IO_BASE:
+            switch (addr)
+            {
+                case SWITCH_REG:    return sys->switches;
+                case BUTTON_REG:    return sys->buttons & 0x1f;
+                case LED_REG:       return sys->leds;
+            }
+            return 0;
+
+        case SOUND_IO_BASE:
+            if ((addr & 0xff) < SOUND_REG_QTY)
+                return sys->sound[addr & 0xff];
+            return 0;
+
+        case KEYPAD_IO_BASE:
+            if (addr == KEYPAD_REG)
+                return sys->keypad & 0x1f;
+            return 0;
+    }
+
+    return 0;
+}
+
+void IoWrite(struct System16 *sys, unsigned short addr, unsigned short data)
+{
+    // register widths from sound_io_16.v
+    static const unsigned short soundMasks[SOUND_REG_QTY] = {0x0fff, 0x0fff, 0x0fff, 0x03ff, 0x0007, 0x0007, 0x000f};
+
+    switch (addr & 0xff00)
+    {
+        case BASIC_IO_BASE:
+            if (addr == LED_REG)
+                sys->leds = data;
+            else if ((addr & 0xfffc) == DISPLAY1_REG)
+                sys->display[addr & 0x3] = data & 0xff;
+            else if (addr == DISPLAY_CTRL_REG)
+                sys->displayCtrl = data & 1;
+            break;
+
+        case SOUND_IO_BASE:
+            if ((addr & 0xff) < SOUND_REG_QTY)
+                sys->sound[addr & 0xff] = data & soundMasks[addr & 0xff];
+            break;
+    }
+}
+
+// report the state of the outputs and the CPU
+void SysReport(struct System16 *sys, FILE *fp)
+{
+    struct Cpu16 *cpu = &sys->cpu;
+    unsigned short *r = cpu->regs;
+    int i;
+
+    fprintf(fp, "leds    = 0x%04X (", sys->leds);
+    for (i = 15; i >= 0; i--)
+    {
+        fputc((sys->leds & (1 << i)) ? '1' : '0', fp);
+        if (i && (i % 4) == 0)
+            fputc(' ', fp);
+    }
+    fprintf(fp, ")\n");
+
+    fprintf(fp, "display = ");
+    for (i = 0; i < 4; i++)
+    {
+        if (sys->displayCtrl)
+            fprintf(fp, "%02X ", sys->display[i]);
+        else if (sys->display[i] < sizeof displayChars - 1)
+            fputc(displayChars[sys->display[i]], fp);
+        else
+            fputc('?', fp);
+    }
+    fprintf(fp, "\n");
+
+    fprintf(fp, "regs    = ax=%04X bx=%04X cx=%04X dx=%04X ep=%04X bp=%04X sp=%04X ip=%04X %c%c%c\n",
+        r[REG_AX], r[REG_BX], r[REG_CX], r[REG_DX], r[REG_EP], r[REG_BP], r[REG_SP], r[REG_IP],
+        cpu->carry ? 'C' : '-', cpu->zero ? 'Z' : '-', cpu->neg ? 'N' : '-');
+}
+
+// end of system16.c
@@ -0,0 +1,43 @@
+/*
+ *  system6502_vl.cpp -- Verilator driver for system6502
+ *
+ *  Runs the Verilated system6502 for a number of board clocks with the ROM, the
+ *  switches and the buttons given on the command line, then reports the LEDs,
+ *  the 7-segment display and the simulation speed.  With -v every change of the
+ *  LEDs is printed as it happens.  The board has no keypad, -k is ignored.
+ */
+
+#include "Vsystem6502.h"
+#include "harness.h"
+
+int main(int argc, char **argv)
+{
+    Harness<Vsystem6502> h(argc, argv, "system6502_vl", "rom", "rom.bin");
+    Vsystem6502 *top = h.top;
+    SevenSeg display;
+    unsigned leds;
+
+    top->sw = h.options.switches;
+    top->btn = h.options.buttons;
+    top->clk = 0;
+    top->eval();
+    leds = top->led;
+
+    h.StartClock();
+    while (h.cycles < h.options.maxCycles && !h.context.gotFinish())
+    {
+        h.Tick();
+        display.Sample(top->an, top->seg);
+        if (h.options.verbose && top->led != leds)
+            printf("%12llu: leds = %04X\n", (unsigned long long)h.cycles, top->led);
+        leds = top->led;
+    }
+
+    printf("leds    = %04X\n", top->led);
+    display.Print(stdout);
+    h.ReportSpeed(stdout);
+
+    return 0;
+}
+
+// end of system6502_vl.cpp
@@ -25,6 +25,15 @@ module RAM_sync(clk, addr, din, cs, dout, we);
 
     reg [DATA_WIDTH-1:0] mem [0:(1<<ADDR_WIDTH)-1];  // memory array
 
+    // a Verilated build writes the memory at the end to the file named with +ramdump=<file>
+`ifdef VERILATOR
+    reg [8*256-1:0] dump_file;
+    final begin
+        if ($value$plusargs("ramdump=%s", dump_file))
+            $writememh(dump_file, mem);
+    end
+`endif
+
     always @(posedge clk) begin
         if (cs) begin
             if (we)
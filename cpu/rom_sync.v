@@ -25,8 +25,17 @@ module ROM_sync (clk, addr, data);
 
     reg [DATA_WIDTH-1:0] mem [0:(1<<ADDR_WIDTH)-1]; // memory array
 
-    // load the ROM with the binary file
+    // load the ROM with the binary file, a Verilated build can name another with +rom=<file>
+`ifdef VERILATOR
+    reg [8*256-1:0] init_file;
+    initial begin
+        if (!$value$plusargs("rom=%s", init_file))
+            init_file = MEM_INIT_FILE;
+        $readmemh(init_file, mem);
+    end
+`else
     initial $readmemh(MEM_INIT_FILE, mem);
+`endif
 
     always @(posedge clk) begin
         data <= mem[addr];
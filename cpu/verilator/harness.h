@@ -0,0 +1,282 @@
+/*
+ *  harness.h -- common code for the Verilator drivers of the board test benches
+ *
+ *  A driver wraps its Verilated top in a Harness, which owns the simulation
+ *  context, parses the common options, toggles the 100MHz board clock, and
+ *  optionally dumps an FST waveform.  The board inputs are modelled here too:
+ *  the switches, the buttons and the Digilent PmodKYPD keypad.
+ *
+ *  The ROM image is handed to the design as a plusarg, e.g. +rom=<file>, which
+ *  rom_sync.v and flash.v read when they are Verilated.  Any +<name>=<value>
+ *  arg on the command line is handed to the design too, e.g. +ramdump=<file>
+ *  for ram_sync.v.
+ */
+
+#ifndef HARNESS_H
+#define HARNESS_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <getopt.h>
+#include "verilated.h"
+#if VM_TRACE
+#include "verilated_fst_c.h"
+#endif
+
+// common options
+struct HarnessOptions
+{
+    const char *romFile;            // ROM image, passed to the design as a plusarg
+    uint64_t maxCycles = 10000000;  // board clocks to simulate
+    unsigned switches = 0;
+    unsigned buttons = 0;
+    int key = -1;                   // keypad key held down, 0x0-0xf, -1 if none
+    uint64_t keyCycle = 0;          // board clock at which the key is pressed
+    const char *fstFile = nullptr;  // FST waveform file
+    bool verbose = false;
+};
+
+/*
+ *  The PmodKYPD columns are driven low one at a time and the rows read back
+ *  low where a key in the driven column is held down.  The physical layout is
+ *
+ *      1 2 3 A
+ *      4 5 6 B
+ *      7 8 9 C
+ *      0 F E D
+ *
+ *  with column 1 and row 1 on the msb of COLS and ROWS.
+ */
+static inline unsigned KeypadRows(int key, unsigned cols)
+{
+    static const char layout[4][4] =
+    {
+        {0x1, 0x2, 0x3, 0xa},
+        {0x4, 0x5, 0x6, 0xb},
+        {0x7, 0x8, 0x9, 0xc},
+        {0x0, 0xf, 0xe, 0xd},
+    };
+
+    if (key >= 0)
+    {
+        for (int row = 0; row < 4; row++)
+            for (int col = 0; col < 4; col++)
+                if (layout[row][col] == key && !(cols & (8 >> col)))
+                    return 0xf & ~(8 >> row);
+    }
+
+    return 0xf;
+}
+
+template <class Top> class Harness
+{
+public:
+    VerilatedContext context;
+    Top *top;
+    HarnessOptions options;
+    uint64_t cycles = 0;
+
+    /*
+     *  extraOpts and extraOpt() let a driver add its own options; extraOpt()
+     *  returns false for an option it does not know.  The ROM plusarg name is
+     *  the one the design's ROM module reads, e.g. "rom" or "flash".
+     */
+    Harness(int argc, char **argv, const char *name, const char *plusarg, const char *defaultRom,
+            const char *extraOpts = "", bool (*extraOpt)(int opt, const char *arg) = nullptr,
+            const char *extraHelp = "")
+    {
+        std::string optStr = std::string("s:b:k:K:c:f:vh") + extraOpts;
+        int opt;
+
+        options.romFile = defaultRom;
+        while ((opt = getopt(argc, argv, optStr.c_str())) != -1)
+        {
+            switch (opt)
+            {
+                case 's':
+                    options.switches = strtoul(optarg, NULL, 0);
+                    break;
+                case 'b':
+                    options.buttons = strtoul(optarg, NULL, 0);
+                    break;
+                case 'k':
+                    options.key = strtol(optarg, NULL, 16) & 0xf;
+                    break;
+                case 'K':
+                    options.keyCycle = strtoull(optarg, NULL, 0);
+                    break;
+                case 'c':
+                    options.maxCycles = strtoull(optarg, NULL, 0);
+                    break;
+                case 'f':
+                    options.fstFile = optarg;
+                    break;
+                case 'v':
+                    options.verbose = true;
+                    break;
+                case 'h':
+                    printf("usage: %s [-s <switches>] [-b <buttons>] [-k <key> [-K <cycle>]] [-c <cycles>] [-f <fst file>] [-v] [-h] [+<plusarg>...] [<rom file>]\n", name);
+                    printf("\n");
+                    printf("     options:\n");
+                    printf("         -s <switches>: set the switches\n");
+                    printf("         -b <buttons>:  set the buttons, C=1 U=2 L=4 R=8 D=0x10\n");
+                    printf("         -k <key>:      hold down keypad key 0-F\n");
+                    printf("         -K <cycle>:    press the key at this board clock (default 0)\n");
+                    printf("         -c <cycles>:   set the number of 100MHz board clocks to simulate (default %llu)\n",
+                        (unsigned long long)options.maxCycles);
+                    printf("         -f <fst file>: dump the waveform, needs a build with TRACE=1\n");
+                    printf("%s", extraHelp);
+                    printf("         -v:            set verbose mode\n");
+                    printf("         -h:            display this help\n");
+                    printf("\n");
+                    printf("     The rom file defaults to %s.  A +<name>=<value> plusarg is passed to the design,\n", defaultRom);
+                    printf("     e.g. +ramdump=<file> writes the RAM to the file at the end.\n");
+                    exit(0);
+                default:
+                    if (extraOpt && extraOpt(opt, optarg))
+                        break;
+                    exit(-1);
+            }
+        }
+
+        // the ROM file name is the first non-option cmd line arg that is not a plusarg
+        std::vector<std::string> plusargs;
+        bool romSet = false;
+
+        for (int i = optind; i < argc; i++)
+        {
+            if (argv[i][0] == '+')
+                plusargs.push_back(argv[i]);
+            else if (!romSet)
+            {
+                options.romFile = argv[i];
+                romSet = true;
+            }
+        }
+
+        plusargs.push_back(std::string("+") + plusarg + "=" + options.romFile);
+        std::vector<const char *> args = {argv[0]};
+        for (const std::string &arg : plusargs)
+            args.push_back(arg.c_str());
+        context.commandArgs(args.size(), args.data());
+
+        top = new Top(&context);
+#if VM_TRACE
+        if (options.fstFile)
+        {
+            context.traceEverOn(true);
+            trace = new VerilatedFstC;
+            top->trace(trace, 99);
+            trace->open(options.fstFile);
+        }
+#else
+        if (options.fstFile)
+            fprintf(stderr, "%s: built without tracing, rebuild with \"make verilate TRACE=1\"\n", name);
+#endif
+    }
+
+    ~Harness()
+    {
+        top->final();
+#if VM_TRACE
+        if (trace)
+            trace->close();
+        delete trace;
+#endif
+        delete top;
+    }
+
+    // one period of the 100MHz board clock
+    void Tick()
+    {
+        top->clk = 1;
+        Eval();
+        top->clk = 0;
+        Eval();
+        cycles++;
+    }
+
+    int KeyHeld()
+    {
+        return cycles >= options.keyCycle ? options.key : -1;
+    }
+
+    void StartClock()
+    {
+        start = std::chrono::steady_clock::now();
+    }
+
+    // simulated clocks per wall second, compared to the real 100MHz board
+    void ReportSpeed(FILE *fp)
+    {
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double rate = secs > 0 ? cycles / secs : 0.0;
+
+        fprintf(fp, "cycles  = %llu\n", (unsigned long long)cycles);
+        fprintf(fp, "time    = %.3f s (%.3f MHz, %.5fx real time)\n", secs, rate / 1e6, rate / 100e6);
+    }
+
+private:
+#if VM_TRACE
+    VerilatedFstC *trace = nullptr;
+#endif
+    std::chrono::steady_clock::time_point start;
+
+    void Eval()
+    {
+        top->eval();
+        context.timeInc(5);     // 5ns half period
+#if VM_TRACE
+        if (trace)
+            trace->dump(context.time());
+#endif
+    }
+};
+
+/*
+ *  The board's four digit 7-segment display is multiplexed: an[3:0] selects
+ *  a digit, active low, and seg[6:0] carries its segments, also active low.
+ *  Latch each digit as it is scanned and print the display as the segment
+ *  patterns, most significant digit first.
+ */
+struct SevenSeg
+{
+    unsigned char digit[4] = {0x7f, 0x7f, 0x7f, 0x7f};
+
+    void Sample(unsigned an, unsigned seg)
+    {
+        for (int i = 0; i < 4; i++)
+            if (!(an & (1 << i)))
+                digit[i] = seg & 0x7f;
+    }
+
+    // decode the segment patterns back to hex digits, '?' if not a hex digit
+    void Print(FILE *fp)
+    {
+        static const unsigned char hex[16] =
+        {
+            0x40, 0x79, 0x24, 0x30, 0x19, 0x12, 0x02, 0x78,
+            0x00, 0x18, 0x08, 0x03, 0x46, 0x21, 0x06, 0x0e,
+        };
+
+        fprintf(fp, "display = ");
+        for (int i = 3; i >= 0; i--)
+        {
+            int c = '?';
+
+            for (int h = 0; h < 16; h++)
+                if (hex[h] == digit[i])
+                    c = "0123456789ABCDEF"[h];
+            if (digit[i] == 0x7f)
+                c = ' ';
+            fputc(c, fp);
+        }
+        fprintf(fp, "\n");
+    }
+};
+
+#endif // HARNESS_H
@@ -0,0 +1,48 @@
+#
+#  Name: verilator.mk
+#
+#  Description: Verilator build flow shared by the board test bench Makefiles.  The
+#               design is compiled to C++ and linked with a driver built on harness.h,
+#               which runs many times faster than the iverilog flow.
+#
+#               The including Makefile sets:
+#                   VL_TOP       Verilated top module
+#                   VL_SOURCES   Verilog sources
+#                   VL_DRIVER    C++ driver with main()
+#                   VL_DIR       path to this directory
+#                   VL_ARGS      driver arguments for "make vrun"
+#                   VL_INCLUDES  optional -I<dir> flags for `include files
+#
+#               Targets:
+#                   "make verilate"            builds obj_dir/V<top>
+#                   "make verilate TRACE=1"    builds with FST waveform support, see -f,
+#                                              "make vclean" first when switching
+#                   "make vrun"                builds and runs
+#                   "make vclean"              deletes the Verilator output
+#
+#  Copyright:   Copyright (C) 2023 Jeff Westerinen
+#               All rights reserved.
+#
+
+VERILATOR ?= verilator
+VL_OBJ_DIR = obj_dir
+VL_BIN = $(VL_OBJ_DIR)/V$(VL_TOP)
+
+VL_FLAGS = --cc --exe --build -j 0 -O3 --x-assign fast --x-initial fast -Wno-fatal -Wno-lint -Wno-style \
+	--top-module $(VL_TOP) $(VL_INCLUDES) -CFLAGS "-O2 -I$(abspath $(VL_DIR))"
+ifeq ($(TRACE),1)
+VL_FLAGS += --trace-fst
+endif
+
+verilate: $(VL_BIN)
+
+$(VL_BIN): $(VL_SOURCES) $(VL_DRIVER) $(VL_DIR)/harness.h
+	$(VERILATOR) $(VL_FLAGS) $(VL_SOURCES) $(VL_DRIVER)
+
+vrun: $(VL_BIN)
+	$(VL_BIN) $(VL_ARGS)
+
+vclean:
+	rm -rf $(VL_OBJ_DIR)
+
+.PHONY: verilate vrun vclean